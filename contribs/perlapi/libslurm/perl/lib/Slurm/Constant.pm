@@ -1212,6 +1212,8 @@ head2 SLURM ERRNO
 
 =item * ESLURMD_STEP_NOTSUSPENDED               4029
 
+=item * ESLURMD_FILE_CACHED                     4030
+
 =back
 
 =head3 slurmd errors in user batch job
@@ -231,6 +231,7 @@ enum {
 	ESLURMD_JOB_NOTRUNNING,
 	ESLURMD_STEP_SUSPENDED,
 	ESLURMD_STEP_NOTSUSPENDED,
+	ESLURMD_FILE_CACHED,
 
 	/* slurmd errors in user batch job */
 	ESCRIPT_CHDIR_FAILED =			4100,
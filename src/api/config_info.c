@@ -1869,6 +1869,17 @@ void slurm_print_slurmd_status (FILE* out,
 			     time_str, sizeof(time_str));
 	fprintf(out, "Boot time                = %s\n", time_str);
 
+	fprintf(out, "Credentials verified     = %u (%u cached)\n",
+		slurmd_status_ptr->cred_verify_cnt,
+		slurmd_status_ptr->cred_verify_hits);
+	if (slurmd_status_ptr->cred_verify_cnt) {
+		fprintf(out, "Credential verify usec   = ave:%"PRIu64
+			" max:%"PRIu64"\n",
+			slurmd_status_ptr->cred_verify_time /
+			slurmd_status_ptr->cred_verify_cnt,
+			slurmd_status_ptr->cred_verify_max);
+	}
+
 	fprintf(out, "Hostname                 = %s\n",
 		slurmd_status_ptr->hostname);
 
@@ -1024,6 +1024,135 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **job_info_msg_pptr,
 	return SLURM_PROTOCOL_SUCCESS;
 }
 
+/* Sort job IDs in increasing order */
+static int _job_id_cmp(const void *x, const void *y)
+{
+	uint32_t a = *(uint32_t *) x;
+	uint32_t b = *(uint32_t *) y;
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+/* Merge the changed and removed jobs of a RESPONSE_JOB_INFO_DELTA into an
+ * earlier job information response. The changed job records are moved
+ * from delta_msg into job_info_msg. */
+static void _merge_job_info_delta(job_info_msg_t *job_info_msg,
+				  job_info_delta_msg_t *delta_msg)
+{
+	job_info_msg_t *new_msg = delta_msg->job_info_msg;
+	uint32_t *remove_ids, remove_cnt, i, j;
+
+	/* Remove jobs purged or replaced by this response */
+	remove_cnt = delta_msg->purge_cnt + new_msg->record_count;
+	remove_ids = xmalloc(sizeof(uint32_t) * (remove_cnt + 1));
+	if (delta_msg->purge_cnt) {
+		memcpy(remove_ids, delta_msg->purge_job_ids,
+		       sizeof(uint32_t) * delta_msg->purge_cnt);
+	}
+	for (i = 0, j = delta_msg->purge_cnt; i < new_msg->record_count; i++)
+		remove_ids[j++] = new_msg->job_array[i].job_id;
+	qsort(remove_ids, remove_cnt, sizeof(uint32_t), _job_id_cmp);
+
+	for (i = 0, j = 0; i < job_info_msg->record_count; i++) {
+		if (bsearch(&job_info_msg->job_array[i].job_id, remove_ids,
+			    remove_cnt, sizeof(uint32_t), _job_id_cmp)) {
+			slurm_free_job_info_members(
+				&job_info_msg->job_array[i]);
+			continue;
+		}
+		if (i != j) {
+			memcpy(&job_info_msg->job_array[j],
+			       &job_info_msg->job_array[i],
+			       sizeof(slurm_job_info_t));
+		}
+		j++;
+	}
+	xfree(remove_ids);
+
+	/* Add the changed jobs */
+	if (new_msg->record_count) {
+		xrealloc(job_info_msg->job_array, sizeof(slurm_job_info_t) *
+			 (j + new_msg->record_count));
+		memcpy(&job_info_msg->job_array[j], new_msg->job_array,
+		       sizeof(slurm_job_info_t) * new_msg->record_count);
+		j += new_msg->record_count;
+		new_msg->record_count = 0;	/* records moved, not freed */
+	}
+	job_info_msg->record_count = j;
+	job_info_msg->last_update = new_msg->last_update;
+}
+
+/*
+ * slurm_load_jobs_delta - issue RPC to get slurm all job configuration
+ *	information, transferring only the jobs changed since an earlier
+ *	response and merging them into it
+ * IN/OUT job_info_msg_pptr - place to store a job configuration pointer.
+ *	If it points to a response from an earlier call made with the same
+ *	show_flags, that response is updated (or replaced) and its job_array
+ *	may be reallocated. Records are not kept in any particular order.
+ * IN show_flags - job filtering options
+ * RET 0 or -1 on error, in which case *job_info_msg_pptr is unchanged
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int slurm_load_jobs_delta(job_info_msg_t **job_info_msg_pptr,
+				 uint16_t show_flags)
+{
+	int rc;
+	slurm_msg_t resp_msg;
+	slurm_msg_t req_msg;
+	job_info_request_msg_t req;
+	job_info_msg_t *old_msg = *job_info_msg_pptr;
+	job_info_delta_msg_t *delta_msg;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	req.last_update  = old_msg ? old_msg->last_update : (time_t) 0;
+	req.show_flags   = show_flags;
+	if (req.last_update)
+		req.show_flags |= SHOW_DELTA;
+	req_msg.msg_type = REQUEST_JOB_INFO;
+	req_msg.data     = &req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO:
+		/* Controller could not determine the changes, or a full
+		 * response was requested */
+		slurm_free_job_info_msg(old_msg);
+		*job_info_msg_pptr = (job_info_msg_t *)resp_msg.data;
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		delta_msg = (job_info_delta_msg_t *) resp_msg.data;
+		if (!old_msg) {
+			slurm_free_job_info_delta_msg(delta_msg);
+			slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		}
+		_merge_job_info_delta(old_msg, delta_msg);
+		slurm_free_job_info_delta_msg(delta_msg);
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc == SLURM_NO_CHANGE_IN_DATA)
+			break;
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_PROTOCOL_SUCCESS;
+}
+
 /*
  * slurm_load_job_user - issue RPC to get slurm information about all jobs
  *	to be run as the specified user
@@ -64,6 +64,7 @@
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/read_config.h"
+#include "src/common/siphash.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_protocol_interface.h"
@@ -77,6 +78,14 @@
 
 #define MAX_THREADS      8	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define MAX_PIPELINE     64	/* Most blocks broadcast at once */
+
+/* A block being broadcast by a pipeline thread */
+typedef struct {
+	struct bcast_parameters *params;
+	char *node_list;	/* nodes yet to receive the file */
+	file_bcast_msg_t msg;	/* copy of the message, owns msg.block */
+} bcast_block_t;
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -84,10 +93,15 @@ void *src;				/* source mmap'd address */
 struct stat f_stat;			/* source file stats */
 job_sbcast_cred_msg_t *sbcast_cred;	/* job alloc info and sbcast cred */
 
+static pthread_mutex_t pipeline_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pipeline_cond  = PTHREAD_COND_INITIALIZER;
+static int pipeline_active = 0;		/* blocks now being broadcast */
+static int pipeline_rc = SLURM_SUCCESS;	/* worst result of pipelined blocks */
+
 static int   _bcast_file(struct bcast_parameters *params);
 static int   _file_bcast(struct bcast_parameters *params,
-			 file_bcast_msg_t *bcast_msg,
-			 job_sbcast_cred_msg_t *sbcast_cred);
+			 file_bcast_msg_t *bcast_msg, char *node_list,
+			 hostlist_t cached);
 static int   _file_state(struct bcast_parameters *params);
 static int  _get_job_info(struct bcast_parameters *params);
 
@@ -164,10 +178,13 @@ static int _get_job_info(struct bcast_parameters *params)
 	return rc;
 }
 
-/* Issue the RPC to transfer the file's data */
+/*
+ * Issue the RPC to transfer the file's data to node_list. Nodes which
+ * already had the file in their cache are added to cached, if not NULL.
+ */
 static int _file_bcast(struct bcast_parameters *params,
-		       file_bcast_msg_t *bcast_msg,
-		       job_sbcast_cred_msg_t *sbcast_cred)
+		       file_bcast_msg_t *bcast_msg, char *node_list,
+		       hostlist_t cached)
 {
 	List ret_list = NULL;
 	ListIterator itr;
@@ -180,7 +197,7 @@ static int _file_bcast(struct bcast_parameters *params,
 	msg.msg_type = REQUEST_FILE_BCAST;
 
 	ret_list = slurm_send_recv_msgs(
-		sbcast_cred->node_list, &msg, params->timeout, true);
+		node_list, &msg, params->timeout, true);
 	if (ret_list == NULL) {
 		error("slurm_send_recv_msgs: %m");
 		exit(1);
@@ -192,6 +209,10 @@ static int _file_bcast(struct bcast_parameters *params,
 					       ret_data_info->data);
 		if (msg_rc == SLURM_SUCCESS)
 			continue;
+		if ((msg_rc == ESLURMD_FILE_CACHED) && cached) {
+			hostlist_push_host(cached, ret_data_info->node_name);
+			continue;
+		}
 
 		error("REQUEST_FILE_BCAST(%s): %s",
 		      ret_data_info->node_name,
@@ -204,6 +225,85 @@ static int _file_bcast(struct bcast_parameters *params,
 	return rc;
 }
 
+static void *_bcast_block_thread(void *arg)
+{
+	bcast_block_t *block = (bcast_block_t *) arg;
+	int rc;
+
+	rc = _file_bcast(block->params, &block->msg, block->node_list, NULL);
+
+	slurm_mutex_lock(&pipeline_mutex);
+	pipeline_rc = MAX(pipeline_rc, rc);
+	pipeline_active--;
+	slurm_cond_broadcast(&pipeline_cond);
+	slurm_mutex_unlock(&pipeline_mutex);
+
+	xfree(block->msg.block);
+	xfree(block);
+	return NULL;
+}
+
+/*
+ * Start broadcasting a block while earlier blocks are still in transit.
+ * Each slurmd relays a block to its children in the message forwarding
+ * tree while writing it, so with several blocks in flight every level of
+ * the tree is kept busy.
+ * RET the first error of a block broadcast by an earlier call
+ */
+static int _bcast_block_pipelined(struct bcast_parameters *params,
+				  file_bcast_msg_t *bcast_msg,
+				  char *node_list)
+{
+	bcast_block_t *block;
+	pthread_attr_t attr;
+	pthread_t thread_id;
+	int rc;
+
+	slurm_mutex_lock(&pipeline_mutex);
+	while ((pipeline_rc == SLURM_SUCCESS) &&
+	       (pipeline_active >= params->pipeline))
+		slurm_cond_wait(&pipeline_cond, &pipeline_mutex);
+	if ((rc = pipeline_rc) != SLURM_SUCCESS) {
+		slurm_mutex_unlock(&pipeline_mutex);
+		return rc;
+	}
+	pipeline_active++;
+	slurm_mutex_unlock(&pipeline_mutex);
+
+	/* _next_block() reuses its buffer, so copy the block */
+	block = xmalloc(sizeof(bcast_block_t));
+	block->params = params;
+	block->node_list = node_list;
+	memcpy(&block->msg, bcast_msg, sizeof(file_bcast_msg_t));
+	block->msg.block = xmalloc(bcast_msg->block_len);
+	memcpy(block->msg.block, bcast_msg->block, bcast_msg->block_len);
+
+	slurm_attr_init(&attr);
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate error %m");
+	while (pthread_create(&thread_id, &attr, _bcast_block_thread, block)) {
+		error("pthread_create error %m");
+		usleep(10000);
+	}
+	slurm_attr_destroy(&attr);
+
+	return SLURM_SUCCESS;
+}
+
+/* Wait for all pipelined blocks, return the first error of any of them */
+static int _bcast_pipeline_wait(void)
+{
+	int rc;
+
+	slurm_mutex_lock(&pipeline_mutex);
+	while (pipeline_active)
+		slurm_cond_wait(&pipeline_cond, &pipeline_mutex);
+	rc = pipeline_rc;
+	slurm_mutex_unlock(&pipeline_mutex);
+
+	return rc;
+}
+
 /* load a buffer with data from the file to broadcast,
  * return number of bytes read, zero on end of file */
 static int _get_block_none(char **buffer, int *orig_len, bool *more)
@@ -363,6 +463,32 @@ static int _next_block(struct bcast_parameters *params,
 	return _get_block_none(buffer, orig_len, more);
 }
 
+/*
+ * Remove nodes which copied the file from their cache from node_list,
+ * they need no more blocks.
+ * RET count of nodes still needing the file
+ */
+static int _remove_cached_nodes(char **node_list, hostlist_t cached)
+{
+	hostlist_t hl = hostlist_create(*node_list);
+	hostlist_iterator_t itr = hostlist_iterator_create(cached);
+	char *node;
+	int cnt;
+
+	while ((node = hostlist_next(itr))) {
+		hostlist_delete_host(hl, node);
+		free(node);
+	}
+	hostlist_iterator_destroy(itr);
+
+	xfree(*node_list);
+	*node_list = hostlist_ranged_string_xmalloc(hl);
+	cnt = hostlist_count(hl);
+	hostlist_destroy(hl);
+
+	return cnt;
+}
+
 /* read and broadcast the file */
 static int _bcast_file(struct bcast_parameters *params)
 {
@@ -373,6 +499,8 @@ static int _bcast_file(struct bcast_parameters *params)
 	uint32_t size_uncompressed = 0, size_compressed = 0;
 	uint32_t time_compression = 0;
 	bool more = true;
+	char *node_list = xstrdup(sbcast_cred->node_list);
+	hostlist_t cached = NULL;
 	DEF_TIMERS;
 
 	if (params->block_size)
@@ -399,6 +527,15 @@ static int _bcast_file(struct bcast_parameters *params)
 	if (!params->fanout)
 		params->fanout = MAX_THREADS;
 	slurm_set_tree_width(MIN(MAX_THREADS, params->fanout));
+	params->pipeline = MAX(1, MIN(MAX_PIPELINE, params->pipeline));
+
+	if (bcast_cache_size()) {
+		START_TIMER;
+		bcast_msg.file_hash = bcast_file_hash(src, f_stat.st_size);
+		END_TIMER;
+		debug("File hashed in %s", TIME_STR);
+		cached = hostlist_create(NULL);
+	}
 
 	while (more) {
 		START_TIMER;
@@ -412,18 +549,39 @@ static int _bcast_file(struct bcast_parameters *params)
 		      bcast_msg.block_len);
 		bcast_msg.compress = params->compress;
 		bcast_msg.uncomp_len = orig_len;
+		bcast_msg.block_cksum = bcast_block_cksum(
+			(char *) src + bcast_msg.block_offset, orig_len);
 		bcast_msg.block = buffer;
 		if (!more)
 			bcast_msg.last_block = 1;
 
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
+		/* The first block creates the file on each node, so must
+		 * arrive before any other */
+		if ((params->pipeline > 1) && (bcast_msg.block_no > 1))
+			rc = _bcast_block_pipelined(params, &bcast_msg,
+						    node_list);
+		else
+			rc = _file_bcast(params, &bcast_msg, node_list,
+					 cached);
 		if (rc != SLURM_SUCCESS)
 			break;
 		if (bcast_msg.last_block)
 			break;	/* end of file */
+		if ((bcast_msg.block_no == 1) && cached &&
+		    hostlist_count(cached) &&
+		    !_remove_cached_nodes(&node_list, cached))
+			break;	/* every node had the file cached */
 		bcast_msg.block_no++;
 		bcast_msg.block_offset += orig_len;
 	}
+	rc = MAX(rc, _bcast_pipeline_wait());
+	if (cached && hostlist_count(cached)) {
+		char *cached_str = hostlist_ranged_string_xmalloc(cached);
+		verbose("File copied from sbcast cache on %s", cached_str);
+		xfree(cached_str);
+	}
+	FREE_NULL_HOSTLIST(cached);
+	xfree(node_list);
 	xfree(bcast_msg.user_name);
 	xfree(buffer);
 
@@ -447,7 +605,7 @@ static int _bcast_file(struct bcast_parameters *params)
 static int _decompress_data_zlib(file_bcast_msg_t *req)
 {
 #if HAVE_LIBZ
-	static z_stream strm;
+	z_stream strm;	/* blocks may be decompressed concurrently */
 	int chunk = (256 * 1024); /* must match common/file_bcast.c */
 	int ret;
 	int flush = Z_NO_FLUSH, have;
@@ -557,3 +715,49 @@ extern int bcast_decompress_data(file_bcast_msg_t *req)
 	      __func__, req->compress);
 	return -1;
 }
+
+extern uint32_t bcast_block_cksum(char *data, uint32_t len)
+{
+	unsigned char *ptr = (unsigned char *) data;
+	uint32_t sum1 = 1, sum2 = 0, cksum, n;
+
+	while (len) {
+		/* Largest run for which sum2 can not overflow */
+		n = MIN(len, 5552);
+		len -= n;
+		while (n--) {
+			sum1 += *ptr++;
+			sum2 += sum1;
+		}
+		sum1 %= 65521;
+		sum2 %= 65521;
+	}
+
+	/* Zero is sent for blocks whose checksum was not computed */
+	cksum = (sum2 << 16) | sum1;
+	return cksum ? cksum : 1;
+}
+
+extern uint64_t bcast_file_hash(void *data, uint64_t len)
+{
+	static uint8_t hash_key[KEYLEN] = { 's', 'b', 'c', 'a', 's', 't', 0, 0,
+					    0, 0, 0, 0, 0, 0, 0, 1 };
+	uint64_t hash = 0;
+
+	siphash((uint8_t *) &hash, (uint8_t *) data, len, hash_key);
+
+	return hash ? hash : 1;
+}
+
+extern uint64_t bcast_cache_size(void)
+{
+	char *sbcast_params, *tmp;
+	uint64_t size = 0;
+
+	if ((sbcast_params = slurm_get_sbcast_parameters()) &&
+	    (tmp = xstrcasestr(sbcast_params, "CacheSize=")))
+		size = strtoull(tmp + 10, NULL, 10) * 1024 * 1024;
+	xfree(sbcast_params);
+
+	return size;
+}
@@ -47,6 +47,7 @@ struct bcast_parameters {
 	int  fanout;
 	bool force;
 	uint32_t job_id;
+	int  pipeline;		/* blocks broadcast at once */
 	bool preserve;
 	char *src_fname;
 	uint32_t step_id;
@@ -66,10 +67,26 @@ typedef struct file_bcast_info {
 	int received_blocks;	/* number of blocks received */
 	time_t start_time;	/* transfer start time */
 	uid_t uid;		/* uid of owner */
+	uint16_t modes;		/* from last block, applied when complete */
+	time_t atime;
+	time_t mtime;
+	uint64_t file_hash;	/* hash of file for the cache, 0 if none */
 } file_bcast_info_t;
 
 extern int bcast_file(struct bcast_parameters *params);
 
 extern int bcast_decompress_data(file_bcast_msg_t *req);
 
+/*
+ * Return the Adler-32 checksum of a block of file data, or one should that
+ * be zero, as zero identifies a block sent without a checksum
+ */
+extern uint32_t bcast_block_cksum(char *data, uint32_t len);
+
+/* Return the hash identifying a file in the slurmd sbcast cache, never zero */
+extern uint64_t bcast_file_hash(void *data, uint64_t len);
+
+/* Return the SbcastParameters CacheSize in bytes, zero if not caching */
+extern uint64_t bcast_cache_size(void);
+
 #endif
@@ -38,8 +38,13 @@
 
 #include "config.h"
 
+#if HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
 #include <errno.h>
 #include <poll.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -60,6 +65,7 @@
 strong_alias(eio_handle_create,		slurm_eio_handle_create);
 strong_alias(eio_handle_destroy,	slurm_eio_handle_destroy);
 strong_alias(eio_handle_mainloop,	slurm_eio_handle_mainloop);
+strong_alias(eio_handle_set_backend,	slurm_eio_handle_set_backend);
 strong_alias(eio_message_socket_readable, slurm_eio_message_socket_readable);
 strong_alias(eio_message_socket_accept,	slurm_eio_message_socket_accept);
 strong_alias(eio_new_obj,		slurm_eio_new_obj);
@@ -70,6 +76,17 @@ strong_alias(eio_remove_obj,		slurm_eio_remove_obj);
 strong_alias(eio_signal_shutdown,	slurm_eio_signal_shutdown);
 strong_alias(eio_signal_wakeup,		slurm_eio_signal_wakeup);
 
+#if HAVE_SYS_EPOLL_H
+/* epoll registration of a file descriptor, indexed by descriptor */
+typedef struct {
+	eio_obj_t *obj;		/* object polling the descriptor */
+	uint32_t events;	/* events registered, zero if none */
+	uint32_t gen;		/* last wakeup on which obj wanted events */
+	short fake_revents;	/* events to report every wakeup for
+				 * descriptors epoll can not poll */
+} eio_epoll_reg_t;
+#endif
+
 /*
  * outside threads can stick new objects on the new_objs List and
  * the eio thread will move them to the main obj_list the next time
@@ -86,6 +103,20 @@ struct eio_handle_components {
 	uint16_t shutdown_wait;
 	List obj_list;
 	List new_objs;
+	uint32_t obj_gen;		/* objects added to or removed from
+					 * obj_list, changed only by the
+					 * mainloop or before it starts */
+	eio_backend_t backend;
+#if HAVE_SYS_EPOLL_H
+	int epoll_fd;
+	eio_epoll_reg_t *reg;		/* registrations, indexed by fd */
+	int reg_size;
+	int *reg_fds;			/* descriptors with registrations */
+	int reg_cnt;
+	int fake_cnt;			/* registrations with fake_revents */
+	uint32_t gen;			/* wakeup counter */
+	bool reg_stale;			/* objects added or removed */
+#endif
 };
 
 
@@ -94,11 +125,18 @@ struct eio_handle_components {
 
 static int          _poll_internal(struct pollfd *pfds, unsigned int nfds,
 				   time_t shutdown_time);
+static bool         _is_readable(eio_obj_t *obj);
+static bool         _is_writable(eio_obj_t *obj);
 static unsigned int _poll_setup_pollfds(struct pollfd *, eio_obj_t **, List);
 static void         _poll_dispatch(struct pollfd *, unsigned int, eio_obj_t **,
 		                   List objList);
 static void         _poll_handle_event(short revents, eio_obj_t *obj,
 		                       List objList);
+static int          _poll_mainloop(eio_handle_t *eio);
+#if HAVE_SYS_EPOLL_H
+static int          _epoll_mainloop(eio_handle_t *eio);
+#endif
+
 
 
 eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
@@ -128,6 +166,40 @@ eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 	return eio;
 }
 
+#if HAVE_SYS_EPOLL_H
+/* Return true if LaunchParameters selects the epoll backend by default */
+static bool _epoll_default(void)
+{
+	static pthread_mutex_t default_mutex = PTHREAD_MUTEX_INITIALIZER;
+	static int use_epoll = -1;
+	char *launch_params;
+
+	slurm_mutex_lock(&default_mutex);
+	if (use_epoll == -1) {
+		launch_params = slurm_get_launch_params();
+		use_epoll = (launch_params &&
+			     strstr(launch_params, "eio_epoll")) ? 1 : 0;
+		xfree(launch_params);
+	}
+	slurm_mutex_unlock(&default_mutex);
+
+	return use_epoll;
+}
+#endif
+
+int eio_handle_set_backend(eio_handle_t *eio, eio_backend_t backend)
+{
+	xassert(eio != NULL);
+	xassert(eio->magic == EIO_MAGIC);
+
+#if !HAVE_SYS_EPOLL_H
+	if (backend == EIO_BACKEND_EPOLL)
+		return SLURM_ERROR;
+#endif
+	eio->backend = backend;
+	return SLURM_SUCCESS;
+}
+
 void eio_handle_destroy(eio_handle_t *eio)
 {
 	xassert(eio != NULL);
@@ -270,7 +342,8 @@ static int _eio_wakeup_handler(eio_handle_t *eio)
 	}
 
 	/* move new eio objects from the new_objs to the obj_list */
-	list_transfer(eio->obj_list, eio->new_objs);
+	if (list_transfer(eio->obj_list, eio->new_objs))
+		eio->obj_gen++;
 
 	if (rc < 0)
 		return error("eio_clear: read: %m");
@@ -279,6 +352,19 @@ static int _eio_wakeup_handler(eio_handle_t *eio)
 }
 
 int eio_handle_mainloop(eio_handle_t *eio)
+{
+	xassert (eio != NULL);
+	xassert (eio->magic == EIO_MAGIC);
+
+#if HAVE_SYS_EPOLL_H
+	if ((eio->backend == EIO_BACKEND_EPOLL) ||
+	    ((eio->backend == EIO_BACKEND_DEFAULT) && _epoll_default()))
+		return _epoll_mainloop(eio);
+#endif
+	return _poll_mainloop(eio);
+}
+
+static int _poll_mainloop(eio_handle_t *eio)
 {
 	int            retval  = 0;
 	struct pollfd *pollfds = NULL;
@@ -287,9 +373,6 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	unsigned int   n       = 0;
 	time_t shutdown_time;
 
-	xassert (eio != NULL);
-	xassert (eio->magic == EIO_MAGIC);
-
 	for (;;) {
 
 		/* Alloc memory for pfds and map if needed */
@@ -348,6 +431,283 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	return retval;
 }
 
+#if HAVE_SYS_EPOLL_H
+/* Translate epoll events into their poll equivalents */
+static short _epoll_revents(uint32_t events)
+{
+	short revents = 0;
+
+	if (events & EPOLLIN)
+		revents |= POLLIN;
+	if (events & EPOLLOUT)
+		revents |= POLLOUT;
+	if (events & EPOLLERR)
+		revents |= POLLERR;
+	if (events & EPOLLHUP)
+		revents |= POLLHUP;
+#ifdef POLLRDHUP
+	if (events & EPOLLRDHUP)
+		revents |= POLLRDHUP;
+#endif
+	return revents;
+}
+
+/*
+ * Register an object's descriptor for events, or update its registration.
+ * Descriptors epoll rejects are reported ready every wakeup, as poll()
+ * would report them: regular files as readable and writable, closed
+ * descriptors with POLLNVAL.
+ * RET SLURM_SUCCESS or SLURM_ERROR if another object has the descriptor
+ */
+static int _epoll_register(eio_handle_t *eio, eio_obj_t *obj, uint32_t events)
+{
+	struct epoll_event ev;
+	eio_epoll_reg_t *reg;
+	int fd = obj->fd, rc, new_size;
+
+	if (fd >= eio->reg_size) {
+		new_size = MAX(fd + 1, eio->reg_size * 2);
+		new_size = MAX(new_size, 64);
+		xrealloc(eio->reg, sizeof(eio_epoll_reg_t) * new_size);
+		xrealloc(eio->reg_fds, sizeof(int) * new_size);
+		eio->reg_size = new_size;
+	}
+	reg = &eio->reg[fd];
+	if ((reg->gen == eio->gen) && (reg->obj != obj))
+		return SLURM_ERROR;
+	reg->gen = eio->gen;
+	if ((reg->obj == obj) && (reg->events == events))
+		return SLURM_SUCCESS;
+
+	if (!reg->events)
+		eio->reg_fds[eio->reg_cnt++] = fd;
+	if (reg->fake_revents) {
+		reg->fake_revents = 0;
+		eio->fake_cnt--;
+	}
+	reg->obj = obj;
+	reg->events = events;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+	rc = epoll_ctl(eio->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+	if ((rc < 0) && (errno == ENOENT))
+		rc = epoll_ctl(eio->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	if (rc == 0)
+		return SLURM_SUCCESS;
+
+	if (errno == EPERM)
+		reg->fake_revents = _epoll_revents(events & ~EPOLLRDHUP);
+	else
+		reg->fake_revents = POLLNVAL;
+	debug4("eio: epoll_ctl(%d): %m", fd);
+	eio->fake_cnt++;
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Bring epoll registrations up to date with the readable() and writable()
+ * state of every object, removing those of objects no longer polled.
+ * RET count of objects polled or -1 if descriptors are shared
+ */
+static int _epoll_update(eio_handle_t *eio)
+{
+	ListIterator itr;
+	eio_obj_t *obj;
+	eio_epoll_reg_t *reg;
+	uint32_t events;
+	int i, j, fd, nobj = 0;
+
+	eio->gen++;
+	if (eio->reg_stale) {
+		/*
+		 * A removed object's memory and descriptor may both have been
+		 * reused by a new object, whose descriptor the kernel would
+		 * not know of. Recheck every registration with the kernel.
+		 */
+		for (i = 0; i < eio->reg_cnt; i++)
+			eio->reg[eio->reg_fds[i]].obj = NULL;
+		eio->reg_stale = false;
+	}
+	itr = list_iterator_create(eio->obj_list);
+	while ((obj = list_next(itr))) {
+		/* Adopt objects a handler appended to its List directly */
+		obj->eio = eio;
+		events = 0;
+		if (_is_readable(obj))
+			events |= EPOLLIN | EPOLLRDHUP;
+		if (_is_writable(obj))
+			events |= EPOLLOUT;
+		if (!events)
+			continue;
+		nobj++;
+		if ((obj->fd >= 0) &&
+		    (_epoll_register(eio, obj, events) != SLURM_SUCCESS)) {
+			nobj = -1;
+			break;
+		}
+	}
+	list_iterator_destroy(itr);
+
+	for (i = 0, j = 0; i < eio->reg_cnt; i++) {
+		fd = eio->reg_fds[i];
+		reg = &eio->reg[fd];
+		if ((nobj >= 0) && (reg->gen == eio->gen)) {
+			eio->reg_fds[j++] = fd;
+			continue;
+		}
+		/* Fails harmlessly if the descriptor has been closed */
+		(void) epoll_ctl(eio->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+		if (reg->fake_revents)
+			eio->fake_cnt--;
+		memset(reg, 0, sizeof(eio_epoll_reg_t));
+	}
+	eio->reg_cnt = j;
+
+	return nobj;
+}
+
+/* Return true if objects were added to or removed from eio's obj_list since
+ * its generation was gen and it held cnt objects */
+static bool _epoll_objs_changed(eio_handle_t *eio, uint32_t gen, int cnt)
+{
+	return ((eio->obj_gen != gen) || (list_count(eio->obj_list) != cnt));
+}
+
+static int _epoll_mainloop(eio_handle_t *eio)
+{
+	struct epoll_event ev, *events = NULL;
+	int max_events = 0, nobj, nev, i, fd, timeout;
+	uint32_t start_gen;
+	int start_cnt;
+	int retval = 0;
+	eio_epoll_reg_t *reg;
+	time_t shutdown_time;
+
+	if ((eio->epoll_fd = epoll_create(64)) < 0) {
+		error("eio: epoll_create: %m");
+		return _poll_mainloop(eio);
+	}
+	fd_set_close_on_exec(eio->epoll_fd);
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = eio->fds[0];
+	if (epoll_ctl(eio->epoll_fd, EPOLL_CTL_ADD, eio->fds[0], &ev) < 0) {
+		error("eio: epoll_ctl: %m");
+		close(eio->epoll_fd);
+		return _poll_mainloop(eio);
+	}
+
+	for (;;) {
+		nobj = _epoll_update(eio);
+		if (nobj < 0) {
+			debug("eio: descriptor polled by multiple objects, "
+			      "using poll");
+			break;
+		}
+		debug4("eio: handling events for %d objects", nobj);
+		if (nobj == 0)
+			goto done;
+
+		if (max_events < (nobj + 1)) {
+			max_events = nobj + 1;
+			xrealloc(events, sizeof(struct epoll_event) *
+					 max_events);
+		}
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+		if (eio->fake_cnt)
+			timeout = 0;
+		else if (shutdown_time)
+			timeout = 1000;	/* Return every 1000 msec */
+		else
+			timeout = -1;
+		while ((nev = epoll_wait(eio->epoll_fd, events, max_events,
+					 timeout)) < 0) {
+			if (errno == EINTR) {
+				nev = 0;
+				break;
+			}
+			error("epoll_wait: %m");
+			retval = -1;
+			goto done;
+		}
+
+		/*
+		 * Once a handler adds or removes objects, stop dispatching:
+		 * later events may be for objects since freed. Events are
+		 * level-triggered, so any not handled are reported again.
+		 * The generation misses an object a handler appended directly
+		 * to its List, until next registered, so check the count too.
+		 */
+		start_gen = eio->obj_gen;
+		start_cnt = list_count(eio->obj_list);
+		for (i = 0; i < nev; i++) {
+			if (events[i].data.fd == eio->fds[0]) {
+				_eio_wakeup_handler(eio);
+				break;
+			}
+		}
+		for (i = 0; i < nev; i++) {
+			if (_epoll_objs_changed(eio, start_gen, start_cnt)) {
+				eio->reg_stale = true;
+				break;
+			}
+			fd = events[i].data.fd;
+			if ((fd == eio->fds[0]) || (fd >= eio->reg_size))
+				continue;
+			reg = &eio->reg[fd];
+			if (!reg->obj || (reg->gen != eio->gen) ||
+			    reg->fake_revents)
+				continue;
+			_poll_handle_event(_epoll_revents(events[i].events),
+					   reg->obj, eio->obj_list);
+		}
+		for (i = 0; eio->fake_cnt && (i < eio->reg_cnt); i++) {
+			if (_epoll_objs_changed(eio, start_gen, start_cnt)) {
+				eio->reg_stale = true;
+				break;
+			}
+			reg = &eio->reg[eio->reg_fds[i]];
+			if (reg->fake_revents && (reg->gen == eio->gen))
+				_poll_handle_event(reg->fake_revents,
+						   reg->obj, eio->obj_list);
+		}
+		if (_epoll_objs_changed(eio, start_gen, start_cnt))
+			eio->reg_stale = true;
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+		if (shutdown_time &&
+		    (difftime(time(NULL), shutdown_time)>=eio->shutdown_wait)) {
+			error("%s: Abandoning IO %d secs after job shutdown "
+			      "initiated", __func__, eio->shutdown_wait);
+			retval = -1;
+			goto done;
+		}
+	}
+
+	/* Fall back to poll() */
+	retval = -2;
+done:
+	xfree(events);
+	close(eio->epoll_fd);
+	eio->epoll_fd = -1;
+	xfree(eio->reg);
+	xfree(eio->reg_fds);
+	eio->reg_size = eio->reg_cnt = eio->fake_cnt = 0;
+	eio->reg_stale = false;
+	if (retval == -2)
+		return _poll_mainloop(eio);
+	return retval;
+}
+#endif
+
 static int
 _poll_internal(struct pollfd *pfds, unsigned int nfds, time_t shutdown_time)
 {
@@ -541,6 +901,8 @@ void eio_obj_destroy(void *arg)
 		/* 	close(obj->fd); */
 		/* 	obj->fd = -1; */
 		/* } */
+		if (obj->eio)
+			obj->eio->obj_gen++;
 		xfree(obj->ops);
 		xfree(obj);
 	}
@@ -559,6 +921,8 @@ void eio_new_initial_obj(eio_handle_t *eio, eio_obj_t *obj)
 	xassert(eio != NULL);
 	xassert(eio->magic == EIO_MAGIC);
 
+	obj->eio = eio;
+	eio->obj_gen++;
 	list_enqueue(eio->obj_list, obj);
 }
 
@@ -571,6 +935,7 @@ void eio_new_obj(eio_handle_t *eio, eio_obj_t *obj)
 	xassert(eio != NULL);
 	xassert(eio->magic == EIO_MAGIC);
 
+	obj->eio = eio;
 	list_enqueue(eio->new_objs, obj);
 	eio_signal_wakeup(eio);
 }
@@ -67,11 +67,34 @@ struct eio_obj {
 	void *arg;                        /* application-specific data       */
 	struct io_operations *ops;        /* pointer to ops struct for obj   */
 	bool shutdown;
+	eio_handle_t *eio;                /* handle polling obj, set by eio  */
 };
 
+/* Event notification mechanisms for eio_handle_mainloop() */
+typedef enum {
+	EIO_BACKEND_DEFAULT,	/* epoll if LaunchParameters includes
+				 * "eio_epoll", otherwise poll */
+	EIO_BACKEND_POLL,	/* poll(), objects rescanned every wakeup */
+	EIO_BACKEND_EPOLL	/* epoll, objects registered persistently */
+} eio_backend_t;
+
 eio_handle_t *eio_handle_create(uint16_t);
 void eio_handle_destroy(eio_handle_t *eio);
 
+/*
+ * Select the event notification mechanism used by eio_handle_mainloop().
+ * Must be called before the mainloop starts.
+ *
+ * With epoll, file descriptors stay registered across wakeups and only
+ * those with events are dispatched, so the cost of a wakeup no longer
+ * grows with the number of objects polled. readable() and writable() are
+ * still called for every object on every wakeup and the kernel is only
+ * told of changes in their results.
+ *
+ * RET SLURM_SUCCESS or SLURM_ERROR if epoll is unavailable
+ */
+int eio_handle_set_backend(eio_handle_t *eio, eio_backend_t backend);
+
 /*
  * Add an eio_obj_t "obj" to an eio_handle_t "eio"'s internal object list.
  *
@@ -244,6 +244,35 @@ static uint32_t	_build_id(char *gres_name)
 	return id;
 }
 
+/* Type ids let mismatched types be rejected without a string compare */
+static uint32_t _type_id(char *type_model)
+{
+	if (!type_model)
+		return 0;
+	return _build_id(type_model);
+}
+
+static bool _type_match(char *type_model1, uint32_t type_id1,
+			char *type_model2, uint32_t type_id2)
+{
+	if (type_id1 != type_id2)
+		return false;
+	return !xstrcmp(type_model1, type_model2);
+}
+
+/* Return the gres_context index for a plugin_id or -1 if none.
+ * Caller must hold gres_context_lock */
+static int _gres_context_inx(uint32_t plugin_id)
+{
+	int i;
+
+	for (i = 0; i < gres_context_cnt; i++) {
+		if (gres_context[i].plugin_id == plugin_id)
+			return i;
+	}
+	return -1;
+}
+
 static int _gres_find_id(void *x, void *key)
 {
 	uint32_t *plugin_id = (uint32_t *)key;
@@ -1347,12 +1376,14 @@ static void _gres_node_list_delete(void *list_element)
 	xfree(gres_node_ptr->topo_gres_cnt_alloc);
 	xfree(gres_node_ptr->topo_gres_cnt_avail);
 	xfree(gres_node_ptr->topo_model);
+	xfree(gres_node_ptr->topo_type_id);
 	for (i = 0; i < gres_node_ptr->type_cnt; i++) {
 		xfree(gres_node_ptr->type_model[i]);
 	}
 	xfree(gres_node_ptr->type_cnt_alloc);
 	xfree(gres_node_ptr->type_cnt_avail);
 	xfree(gres_node_ptr->type_model);
+	xfree(gres_node_ptr->type_id);
 	xfree(gres_node_ptr);
 	xfree(gres_ptr);
 }
@@ -1385,8 +1416,12 @@ static void _add_gres_type(char *type, gres_node_state_t *gres_data,
 		gres_data->type_model =
 			xrealloc(gres_data->type_model,
 				 sizeof(char *) * gres_data->type_cnt);
+		gres_data->type_id =
+			xrealloc(gres_data->type_id,
+				 sizeof(uint32_t) * gres_data->type_cnt);
 		gres_data->type_cnt_avail[i] += tmp_gres_cnt;
 		gres_data->type_model[i] = xstrdup(type);
+		gres_data->type_id[i] = _type_id(type);
 	}
 }
 
@@ -1780,6 +1815,7 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 		xfree(gres_data->topo_gres_bitmap);
 		xfree(gres_data->topo_cpus_bitmap);
 		xfree(gres_data->topo_model);
+		xfree(gres_data->topo_type_id);
 		gres_data->topo_cnt = set_cnt;
 	}
 
@@ -1811,6 +1847,8 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 				 set_cnt * sizeof(bitstr_t *));
 		gres_data->topo_model = xrealloc(gres_data->topo_model,
 						 set_cnt * sizeof(char *));
+		gres_data->topo_type_id = xrealloc(gres_data->topo_type_id,
+						   set_cnt * sizeof(uint32_t));
 		gres_data->topo_cnt = set_cnt;
 
 		iter = list_iterator_create(gres_conf_list);
@@ -1840,6 +1878,8 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 			}
 			gres_data->topo_model[i] = xstrdup(gres_slurmd_conf->
 							   type);
+			gres_data->topo_type_id[i] =
+				_type_id(gres_data->topo_model[i]);
 			i++;
 		}
 		list_iterator_destroy(iter);
@@ -1918,6 +1958,7 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 			xfree(gres_data->topo_gres_cnt_alloc);
 			xfree(gres_data->topo_gres_cnt_avail);
 			xfree(gres_data->topo_model);
+			xfree(gres_data->topo_type_id);
 		}
 		gres_data->topo_cnt = 0;
 	} else if ((fast_schedule == 0) &&
@@ -2358,6 +2399,7 @@ static void *_node_state_dup(void *gres_data)
 	new_gres->topo_gres_cnt_avail = xmalloc(gres_ptr->topo_cnt *
 						sizeof(uint64_t));
 	new_gres->topo_model = xmalloc(gres_ptr->topo_cnt * sizeof(char *));
+	new_gres->topo_type_id = xmalloc(gres_ptr->topo_cnt * sizeof(uint32_t));
 	for (i = 0; i < gres_ptr->topo_cnt; i++) {
 		if (gres_ptr->topo_cpus_bitmap[i]) {
 			new_gres->topo_cpus_bitmap[i] =
@@ -2370,6 +2412,7 @@ static void *_node_state_dup(void *gres_data)
 		new_gres->topo_gres_cnt_avail[i] =
 			gres_ptr->topo_gres_cnt_avail[i];
 		new_gres->topo_model[i] = xstrdup(gres_ptr->topo_model[i]);
+		new_gres->topo_type_id[i] = gres_ptr->topo_type_id[i];
 	}
 
 	new_gres->type_cnt       = gres_ptr->type_cnt;
@@ -2378,10 +2421,12 @@ static void *_node_state_dup(void *gres_data)
 	new_gres->type_cnt_avail = xmalloc(gres_ptr->type_cnt *
 					   sizeof(uint64_t));
 	new_gres->type_model = xmalloc(gres_ptr->type_cnt * sizeof(char *));
+	new_gres->type_id = xmalloc(gres_ptr->type_cnt * sizeof(uint32_t));
 	for (i = 0; i < gres_ptr->type_cnt; i++) {
 		new_gres->type_cnt_alloc[i] = gres_ptr->type_cnt_alloc[i];
 		new_gres->type_cnt_avail[i] = gres_ptr->type_cnt_avail[i];
 		new_gres->type_model[i] = xstrdup(gres_ptr->type_model[i]);
+		new_gres->type_id[i] = gres_ptr->type_id[i];
 	}
 	return new_gres;
 }
@@ -2903,6 +2948,7 @@ static int _job_state_validate(char *config, gres_job_state_t **gres_data,
 		gres_ptr = xmalloc(sizeof(gres_job_state_t));
 		gres_ptr->gres_cnt_alloc = cnt;
 		gres_ptr->type_model = type;
+		gres_ptr->type_id = _type_id(type);
 		type = NULL;
 
 		*gres_data = gres_ptr;
@@ -2998,6 +3044,7 @@ static void *_job_state_dup(void *gres_data)
 	new_gres_ptr->gres_cnt_alloc	= gres_ptr->gres_cnt_alloc;
 	new_gres_ptr->node_cnt		= gres_ptr->node_cnt;
 	new_gres_ptr->type_model	= xstrdup(gres_ptr->type_model);
+	new_gres_ptr->type_id		= gres_ptr->type_id;
 
 	if (gres_ptr->gres_bit_alloc) {
 		new_gres_ptr->gres_bit_alloc = xmalloc(sizeof(bitstr_t *) *
@@ -3025,6 +3072,7 @@ static void *_job_state_dup2(void *gres_data, int node_index)
 	new_gres_ptr->gres_cnt_alloc	= gres_ptr->gres_cnt_alloc;
 	new_gres_ptr->node_cnt		= 1;
 	new_gres_ptr->type_model	= xstrdup(gres_ptr->type_model);
+	new_gres_ptr->type_id		= gres_ptr->type_id;
 
 	if (gres_ptr->gres_bit_alloc && gres_ptr->gres_bit_alloc[node_index]) {
 		new_gres_ptr->gres_bit_alloc	= xmalloc(sizeof(bitstr_t *));
@@ -3223,6 +3271,8 @@ extern int gres_plugin_job_state_unpack(List *gres_list, Buf buffer,
 			safe_unpack64(&gres_job_ptr->gres_cnt_alloc, buffer);
 			safe_unpackstr_xmalloc(&gres_job_ptr->type_model,
 					       &utmp32, buffer);
+			gres_job_ptr->type_id =
+				_type_id(gres_job_ptr->type_model);
 			safe_unpack32(&gres_job_ptr->node_cnt, buffer);
 			safe_unpack8(&has_more, buffer);
 
@@ -3389,9 +3439,10 @@ static void	_job_core_filter(void *job_gres_data, void *node_gres_data,
 		     node_gres_ptr->topo_gres_cnt_avail[i]))
 			continue;
 		if (job_gres_ptr->type_model &&
-		    (!node_gres_ptr->topo_model[i] ||
-		     xstrcmp(job_gres_ptr->type_model,
-			     node_gres_ptr->topo_model[i])))
+		    !_type_match(job_gres_ptr->type_model,
+				 job_gres_ptr->type_id,
+				 node_gres_ptr->topo_model[i],
+				 node_gres_ptr->topo_type_id[i]))
 			continue;
 		if (!node_gres_ptr->topo_cpus_bitmap[i]) {
 			FREE_NULL_BITMAP(avail_cpu_bitmap);	/* No filter */
@@ -3443,9 +3494,10 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 		}
 		for (i = 0; i < node_gres_ptr->topo_cnt; i++) {
 			if (job_gres_ptr->type_model &&
-			    (!node_gres_ptr->topo_model[i] ||
-			     xstrcmp(node_gres_ptr->topo_model[i],
-				     job_gres_ptr->type_model)))
+			    !_type_match(job_gres_ptr->type_model,
+					 job_gres_ptr->type_id,
+					 node_gres_ptr->topo_model[i],
+					 node_gres_ptr->topo_type_id[i]))
 				continue;
 			if (!node_gres_ptr->topo_cpus_bitmap[i]) {
 				gres_avail += node_gres_ptr->
@@ -3524,9 +3576,10 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 			     node_gres_ptr->topo_gres_cnt_avail[i]))
 				continue;
 			if (job_gres_ptr->type_model &&
-			    (!node_gres_ptr->topo_model[i] ||
-			     xstrcmp(node_gres_ptr->topo_model[i],
-				     job_gres_ptr->type_model)))
+			    !_type_match(job_gres_ptr->type_model,
+					 job_gres_ptr->type_id,
+					 node_gres_ptr->topo_model[i],
+					 node_gres_ptr->topo_type_id[i]))
 				continue;
 			if (!node_gres_ptr->topo_cpus_bitmap[i]) {
 				cpus_avail[i] = cpu_end_bit - cpu_start_bit + 1;
@@ -3615,9 +3668,10 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 		return cpu_cnt;
 	} else if (job_gres_ptr->type_model) {
 		for (i = 0; i < node_gres_ptr->type_cnt; i++) {
-			if (node_gres_ptr->type_model[i] &&
-			    !xstrcmp(node_gres_ptr->type_model[i],
-				     job_gres_ptr->type_model))
+			if (_type_match(node_gres_ptr->type_model[i],
+					node_gres_ptr->type_id[i],
+					job_gres_ptr->type_model,
+					job_gres_ptr->type_id))
 				break;
 		}
 		if (i >= node_gres_ptr->type_cnt)
@@ -3657,7 +3711,7 @@ extern void gres_plugin_job_core_filter(List job_gres_list, List node_gres_list,
 					char *node_name)
 {
 	int i;
-	ListIterator  job_gres_iter, node_gres_iter;
+	ListIterator  job_gres_iter;
 	gres_state_t *job_gres_ptr, *node_gres_ptr;
 
 	if ((job_gres_list == NULL) || (cpu_bitmap == NULL))
@@ -3672,30 +3726,19 @@ extern void gres_plugin_job_core_filter(List job_gres_list, List node_gres_list,
 	slurm_mutex_lock(&gres_context_lock);
 	job_gres_iter = list_iterator_create(job_gres_list);
 	while ((job_gres_ptr = (gres_state_t *) list_next(job_gres_iter))) {
-		node_gres_iter = list_iterator_create(node_gres_list);
-		while ((node_gres_ptr = (gres_state_t *)
-				list_next(node_gres_iter))) {
-			if (job_gres_ptr->plugin_id == node_gres_ptr->plugin_id)
-				break;
-		}
-		list_iterator_destroy(node_gres_iter);
-		if (node_gres_ptr == NULL) {
+		node_gres_ptr = list_find_first(node_gres_list, _gres_find_id,
+						&job_gres_ptr->plugin_id);
+		i = _gres_context_inx(job_gres_ptr->plugin_id);
+		if ((i < 0) || !node_gres_ptr) {
 			/* node lack resources required by the job */
 			bit_nclear(cpu_bitmap, cpu_start_bit, cpu_end_bit);
 			break;
 		}
-
-		for (i = 0; i < gres_context_cnt; i++) {
-			if (job_gres_ptr->plugin_id !=
-			    gres_context[i].plugin_id)
-				continue;
-			_job_core_filter(job_gres_ptr->gres_data,
-					 node_gres_ptr->gres_data,
-					 use_total_gres, cpu_bitmap,
-					 cpu_start_bit, cpu_end_bit,
-					 gres_context[i].gres_name, node_name);
-			break;
-		}
+		_job_core_filter(job_gres_ptr->gres_data,
+				 node_gres_ptr->gres_data,
+				 use_total_gres, cpu_bitmap,
+				 cpu_start_bit, cpu_end_bit,
+				 gres_context[i].gres_name, node_name);
 	}
 	list_iterator_destroy(job_gres_iter);
 	slurm_mutex_unlock(&gres_context_lock);
@@ -3724,7 +3767,7 @@ extern uint32_t gres_plugin_job_test(List job_gres_list, List node_gres_list,
 {
 	int i;
 	uint32_t cpu_cnt, tmp_cnt;
-	ListIterator job_gres_iter,  node_gres_iter;
+	ListIterator job_gres_iter;
 	gres_state_t *job_gres_ptr, *node_gres_ptr;
 	bool topo_set = false;
 
@@ -3739,44 +3782,146 @@ extern uint32_t gres_plugin_job_test(List job_gres_list, List node_gres_list,
 	slurm_mutex_lock(&gres_context_lock);
 	job_gres_iter = list_iterator_create(job_gres_list);
 	while ((job_gres_ptr = (gres_state_t *) list_next(job_gres_iter))) {
-		node_gres_iter = list_iterator_create(node_gres_list);
-		while ((node_gres_ptr = (gres_state_t *)
-				list_next(node_gres_iter))) {
-			if (job_gres_ptr->plugin_id == node_gres_ptr->plugin_id)
-				break;
-		}
-		list_iterator_destroy(node_gres_iter);
-		if (node_gres_ptr == NULL) {
+		node_gres_ptr = list_find_first(node_gres_list, _gres_find_id,
+						&job_gres_ptr->plugin_id);
+		i = _gres_context_inx(job_gres_ptr->plugin_id);
+		if ((i < 0) || !node_gres_ptr) {
 			/* node lack resources required by the job */
 			cpu_cnt = 0;
 			break;
 		}
+		tmp_cnt = _job_test(job_gres_ptr->gres_data,
+				    node_gres_ptr->gres_data,
+				    use_total_gres, cpu_bitmap,
+				    cpu_start_bit, cpu_end_bit,
+				    &topo_set, job_id, node_name,
+				    gres_context[i].gres_name);
+		if (tmp_cnt != NO_VAL) {
+			if (cpu_cnt == NO_VAL)
+				cpu_cnt = tmp_cnt;
+			else
+				cpu_cnt = MIN(tmp_cnt, cpu_cnt);
+		}
+		if (cpu_cnt == 0)
+			break;
+	}
+	list_iterator_destroy(job_gres_iter);
+	slurm_mutex_unlock(&gres_context_lock);
 
-		for (i=0; i<gres_context_cnt; i++) {
-			if (job_gres_ptr->plugin_id !=
-			    gres_context[i].plugin_id)
+	return cpu_cnt;
+}
+
+/* Count-only equivalent of _job_test() with no cpu_bitmap. The topology
+ * branch there only fails if the usable topology records lack enough GRES,
+ * so sum those directly rather than picking records and building bitmaps */
+static bool _job_node_avail(gres_job_state_t *job_gres_ptr,
+			    gres_node_state_t *node_gres_ptr,
+			    bool use_total_gres)
+{
+	int i;
+	uint64_t gres_avail = 0;
+
+	if (node_gres_ptr->no_consume)
+		use_total_gres = true;
+
+	if (job_gres_ptr->gres_cnt_alloc && node_gres_ptr->topo_cnt) {
+		gres_avail = node_gres_ptr->gres_cnt_avail;
+		if (!use_total_gres)
+			gres_avail -= node_gres_ptr->gres_cnt_alloc;
+		if (job_gres_ptr->gres_cnt_alloc > gres_avail)
+			return false;
+
+		gres_avail = 0;
+		for (i = 0; i < node_gres_ptr->topo_cnt; i++) {
+			if (node_gres_ptr->topo_gres_cnt_avail[i] == 0)
+				continue;
+			if (!use_total_gres &&
+			    (node_gres_ptr->topo_gres_cnt_alloc[i] >=
+			     node_gres_ptr->topo_gres_cnt_avail[i]))
+				continue;
+			if (job_gres_ptr->type_model &&
+			    !_type_match(job_gres_ptr->type_model,
+					 job_gres_ptr->type_id,
+					 node_gres_ptr->topo_model[i],
+					 node_gres_ptr->topo_type_id[i]))
 				continue;
-			tmp_cnt = _job_test(job_gres_ptr->gres_data,
-					    node_gres_ptr->gres_data,
-					    use_total_gres, cpu_bitmap,
-					    cpu_start_bit, cpu_end_bit,
-					    &topo_set, job_id, node_name,
-					    gres_context[i].gres_name);
-			if (tmp_cnt != NO_VAL) {
-				if (cpu_cnt == NO_VAL)
-					cpu_cnt = tmp_cnt;
-				else
-					cpu_cnt = MIN(tmp_cnt, cpu_cnt);
+			if (node_gres_ptr->topo_cpus_bitmap[i] &&
+			    (bit_ffs(node_gres_ptr->topo_cpus_bitmap[i]) < 0))
+				continue;	/* no CPUs can reach it */
+			gres_avail += node_gres_ptr->topo_gres_cnt_avail[i];
+			if (!use_total_gres) {
+				gres_avail -= node_gres_ptr->
+					      topo_gres_cnt_alloc[i];
 			}
-			break;
+			if (gres_avail >= job_gres_ptr->gres_cnt_alloc)
+				return true;
 		}
-		if (cpu_cnt == 0)
+		return false;
+	} else if (job_gres_ptr->type_model) {
+		for (i = 0; i < node_gres_ptr->type_cnt; i++) {
+			if (_type_match(node_gres_ptr->type_model[i],
+					node_gres_ptr->type_id[i],
+					job_gres_ptr->type_model,
+					job_gres_ptr->type_id))
+				break;
+		}
+		if (i >= node_gres_ptr->type_cnt)
+			return false;	/* no such type */
+		gres_avail = node_gres_ptr->type_cnt_avail[i];
+		if (!use_total_gres)
+			gres_avail -= node_gres_ptr->type_cnt_alloc[i];
+	} else {
+		gres_avail = node_gres_ptr->gres_cnt_avail;
+		if (!use_total_gres)
+			gres_avail -= node_gres_ptr->gres_cnt_alloc;
+	}
+
+	return (job_gres_ptr->gres_cnt_alloc <= gres_avail);
+}
+
+/*
+ * Determine if a node has enough GRES for a job, without regard to which of
+ *	its CPUs the job might use. Same result as testing the return value of
+ *	gres_plugin_job_test() with no cpu_bitmap for zero, but much cheaper.
+ * IN job_gres_list  - job's gres_list built by gres_plugin_job_state_validate()
+ * IN node_gres_list - node's gres_list built by
+ *                     gres_plugin_node_config_validate()
+ * IN use_total_gres - if set then consider all gres resources as available,
+ *		       and none are commited to running jobs
+ * RET true if the node can satisfy the job's GRES request
+ */
+extern bool gres_plugin_job_node_avail(List job_gres_list, List node_gres_list,
+				       bool use_total_gres)
+{
+	ListIterator job_gres_iter;
+	gres_state_t *job_gres_ptr, *node_gres_ptr;
+	bool avail = true;
+
+	if (job_gres_list == NULL)
+		return true;
+	if (node_gres_list == NULL)
+		return false;
+
+	(void) gres_plugin_init();
+
+	slurm_mutex_lock(&gres_context_lock);
+	job_gres_iter = list_iterator_create(job_gres_list);
+	while ((job_gres_ptr = (gres_state_t *) list_next(job_gres_iter))) {
+		node_gres_ptr = list_find_first(node_gres_list, _gres_find_id,
+						&job_gres_ptr->plugin_id);
+		if ((_gres_context_inx(job_gres_ptr->plugin_id) < 0) ||
+		    !node_gres_ptr ||
+		    !_job_node_avail(job_gres_ptr->gres_data,
+				     node_gres_ptr->gres_data,
+				     use_total_gres)) {
+			avail = false;
 			break;
+		}
 	}
 	list_iterator_destroy(job_gres_iter);
 	slurm_mutex_unlock(&gres_context_lock);
 
-	return cpu_cnt;
+	return avail;
 }
 
 /*
@@ -3807,9 +3952,10 @@ static bool _cores_on_gres(bitstr_t *core_bitmap, bitstr_t *alloc_core_bitmap,
 		if (!bit_test(node_gres_ptr->topo_gres_bitmap[i], gres_inx))
 			continue;
 		if (job_gres_ptr->type_model &&
-		    (!node_gres_ptr->topo_model[i] ||
-		     xstrcmp(job_gres_ptr->type_model,
-			     node_gres_ptr->topo_model[i])))
+		    !_type_match(job_gres_ptr->type_model,
+				 job_gres_ptr->type_id,
+				 node_gres_ptr->topo_model[i],
+				 node_gres_ptr->topo_type_id[i]))
 			continue;
 		if (!node_gres_ptr->topo_cpus_bitmap[i])
 			return true;
@@ -4024,9 +4170,10 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 	    node_gres_ptr->topo_gres_cnt_alloc) {
 		for (i = 0; i < node_gres_ptr->topo_cnt; i++) {
 			if (job_gres_ptr->type_model &&
-			    (!node_gres_ptr->topo_model[i] ||
-			     xstrcmp(job_gres_ptr->type_model,
-				     node_gres_ptr->topo_model[i])))
+			    !_type_match(job_gres_ptr->type_model,
+					 job_gres_ptr->type_id,
+					 node_gres_ptr->topo_model[i],
+					 node_gres_ptr->topo_type_id[i]))
 				continue;
 			sz1 = bit_size(job_gres_ptr->gres_bit_alloc[node_offset]);
 			sz2 = bit_size(node_gres_ptr->topo_gres_bitmap[i]);
@@ -4103,9 +4250,10 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 	if (!type_array_updated && job_gres_ptr->type_model) {
 		gres_cnt = job_gres_ptr->gres_cnt_alloc;
 		for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-			if (!node_gres_ptr->type_model[j] ||
-			    xstrcmp(job_gres_ptr->type_model,
-				    node_gres_ptr->type_model[j]))
+			if (!_type_match(job_gres_ptr->type_model,
+					 job_gres_ptr->type_id,
+					 node_gres_ptr->type_model[j],
+					 node_gres_ptr->type_id[j]))
 				continue;
 			k = node_gres_ptr->type_cnt_avail[j] -
 			    node_gres_ptr->type_cnt_alloc[j];
@@ -4349,9 +4497,10 @@ static int _job_dealloc(void *job_gres_data, void *node_gres_data,
 	if (!type_array_updated && job_gres_ptr->type_model) {
 		gres_cnt = job_gres_ptr->gres_cnt_alloc;
 		for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-			if (!node_gres_ptr->type_model[j] ||
-			    xstrcmp(job_gres_ptr->type_model,
-				    node_gres_ptr->type_model[j]))
+			if (!_type_match(job_gres_ptr->type_model,
+					 job_gres_ptr->type_id,
+					 node_gres_ptr->type_model[j],
+					 node_gres_ptr->type_id[j]))
 				continue;
 			k = MIN(gres_cnt, node_gres_ptr->type_cnt_alloc[j]);
 			node_gres_ptr->type_cnt_alloc[j] -= k;
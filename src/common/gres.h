@@ -110,17 +110,20 @@ typedef struct gres_node_state {
 	uint64_t *topo_gres_cnt_alloc;
 	uint64_t *topo_gres_cnt_avail;
 	char **topo_model;		/* Type of this gres (e.g. model name) */
+	uint32_t *topo_type_id;		/* Hash of topo_model, 0 if NULL */
 
 	/* Gres type specific information (if gres.conf contains type option) */
 	uint16_t type_cnt;		/* Size of type_ arrays */
 	uint64_t *type_cnt_alloc;
 	uint64_t *type_cnt_avail;
 	char **type_model;		/* Type of this gres (e.g. model name) */
+	uint32_t *type_id;		/* Hash of type_model, 0 if NULL */
 } gres_node_state_t;
 
 /* Gres job state as used by slurmctld daemon */
 typedef struct gres_job_state {
 	char *type_model;		/* Type of this gres (e.g. model name) */
+	uint32_t type_id;		/* Hash of type_model, 0 if NULL */
 
 	/* Count of resources needed per node */
 	uint64_t gres_cnt_alloc;
@@ -504,6 +507,20 @@ extern uint32_t gres_plugin_job_test(List job_gres_list, List node_gres_list,
 				     int cpu_start_bit, int cpu_end_bit,
 				     uint32_t job_id, char *node_name);
 
+/*
+ * Determine if a node has enough GRES for a job, without regard to which of
+ *	its CPUs the job might use. Same result as testing the return value of
+ *	gres_plugin_job_test() with no cpu_bitmap for zero, but much cheaper.
+ * IN job_gres_list  - job's gres_list built by gres_plugin_job_state_validate()
+ * IN node_gres_list - node's gres_list built by
+ *                     gres_plugin_node_config_validate()
+ * IN use_total_gres - if set then consider all gres resources as available,
+ *		       and none are commited to running jobs
+ * RET true if the node can satisfy the job's GRES request
+ */
+extern bool gres_plugin_job_node_avail(List job_gres_list, List node_gres_list,
+				       bool use_total_gres);
+
 /*
  * Allocate resource to a job and update node and job gres information
  * IN job_gres_list - job's gres_list built by gres_plugin_job_state_validate()
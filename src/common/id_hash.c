@@ -0,0 +1,234 @@
+/*****************************************************************************\
+ *  id_hash.c - hash table of items keyed by a numeric ID
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "src/common/id_hash.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+/*
+ * Define slurm-specific aliases for use by plugins, see slurm_xlator.h
+ * for details.
+ */
+strong_alias(id_hash_init,	slurm_id_hash_init);
+strong_alias(id_hash_free,	slurm_id_hash_free);
+strong_alias(id_hash_add,	slurm_id_hash_add);
+strong_alias(id_hash_find,	slurm_id_hash_find);
+strong_alias(id_hash_remove,	slurm_id_hash_remove);
+strong_alias(id_hash_count,	slurm_id_hash_count);
+strong_alias(id_hash_probes,	slurm_id_hash_probes);
+
+#define ID_HASH_MIN_BITS	10	/* 1024 entries */
+#define ID_HASH_MAX_BITS	31	/* masks are 32-bit */
+#define ID_HASH_MAX_LOAD_PCT	70
+
+typedef struct {
+	uint64_t key;
+	void *item;			/* NULL if entry unused */
+} id_hash_entry_t;
+
+struct id_hash {
+	uint32_t bits;			/* table size is 2^bits */
+	uint32_t count;			/* entries in use */
+	id_hash_entry_t *table;
+};
+
+/* Fibonacci hashing: spreads sequential IDs across the whole table */
+static inline uint32_t _hash_inx(id_hash_t *hash, uint64_t key)
+{
+	return (uint32_t) ((key * 0x9e3779b97f4a7c15ULL) >>
+			   (64 - hash->bits));
+}
+
+static void _alloc_table(id_hash_t *hash, uint32_t bits)
+{
+	hash->bits = bits;
+	hash->table = xmalloc(sizeof(id_hash_entry_t) << bits);
+}
+
+/* Insert an entry known not to be present, without growing the table */
+static void _insert(id_hash_t *hash, uint64_t key, void *item)
+{
+	uint32_t mask = (1U << hash->bits) - 1;
+	uint32_t inx = _hash_inx(hash, key);
+
+	while (hash->table[inx].item)
+		inx = (inx + 1) & mask;
+	hash->table[inx].key  = key;
+	hash->table[inx].item = item;
+	hash->count++;
+}
+
+static void _grow(id_hash_t *hash)
+{
+	id_hash_entry_t *old_table = hash->table;
+	uint32_t i, old_size = 1U << hash->bits;
+
+	_alloc_table(hash, hash->bits + 1);
+	hash->count = 0;
+	for (i = 0; i < old_size; i++) {
+		if (old_table[i].item)
+			_insert(hash, old_table[i].key, old_table[i].item);
+	}
+	xfree(old_table);
+}
+
+/* Return the index of a key's entry or -1 if not found */
+static int64_t _find_inx(id_hash_t *hash, uint64_t key)
+{
+	uint32_t mask = (1U << hash->bits) - 1;
+	uint32_t inx = _hash_inx(hash, key);
+
+	while (hash->table[inx].item) {
+		if (hash->table[inx].key == key)
+			return inx;
+		inx = (inx + 1) & mask;
+	}
+	return -1;
+}
+
+extern id_hash_t *id_hash_init(uint32_t size)
+{
+	id_hash_t *hash = xmalloc(sizeof(id_hash_t));
+	uint32_t bits = ID_HASH_MIN_BITS;
+
+	while ((bits < ID_HASH_MAX_BITS) &&
+	       (((uint64_t) size * 100) >
+		((uint64_t) ID_HASH_MAX_LOAD_PCT << bits)))
+		bits++;
+	_alloc_table(hash, bits);
+
+	return hash;
+}
+
+extern void id_hash_free(id_hash_t *hash)
+{
+	if (!hash)
+		return;
+	xfree(hash->table);
+	xfree(hash);
+}
+
+extern void *id_hash_add(id_hash_t *hash, uint64_t key, void *item)
+{
+	int64_t inx;
+	void *old_item;
+
+	xassert(hash);
+	xassert(item);
+
+	if ((inx = _find_inx(hash, key)) >= 0) {
+		old_item = hash->table[inx].item;
+		hash->table[inx].item = item;
+		return old_item;
+	}
+	if (((uint64_t) (hash->count + 1) * 100) >
+	    ((uint64_t) ID_HASH_MAX_LOAD_PCT << hash->bits)) {
+		if (hash->bits < ID_HASH_MAX_BITS)
+			_grow(hash);
+		else if ((hash->count + 1) >= (1U << hash->bits))
+			fatal("%s: table full", __func__);
+	}
+	_insert(hash, key, item);
+
+	return NULL;
+}
+
+extern void *id_hash_find(id_hash_t *hash, uint64_t key)
+{
+	int64_t inx;
+
+	if (!hash || ((inx = _find_inx(hash, key)) < 0))
+		return NULL;
+	return hash->table[inx].item;
+}
+
+extern void *id_hash_remove(id_hash_t *hash, uint64_t key)
+{
+	uint32_t mask, inx, next, home;
+	int64_t found;
+	void *item;
+
+	xassert(hash);
+
+	if ((found = _find_inx(hash, key)) < 0)
+		return NULL;
+	inx = found;
+	item = hash->table[inx].item;
+	hash->count--;
+
+	/* Shift back any following entries in the same probe sequence
+	 * which would otherwise become unreachable */
+	mask = (1U << hash->bits) - 1;
+	next = (inx + 1) & mask;
+	while (hash->table[next].item) {
+		home = _hash_inx(hash, hash->table[next].key);
+		/* Move the entry if its home slot is not within the
+		 * (cyclic) range (inx, next] */
+		if (((next - home) & mask) >= ((next - inx) & mask)) {
+			hash->table[inx] = hash->table[next];
+			inx = next;
+		}
+		next = (next + 1) & mask;
+	}
+	hash->table[inx].item = NULL;
+
+	return item;
+}
+
+extern uint32_t id_hash_count(id_hash_t *hash)
+{
+	if (!hash)
+		return 0;
+	return hash->count;
+}
+
+extern double id_hash_probes(id_hash_t *hash)
+{
+	uint32_t i, mask, size;
+	uint64_t probes = 0;
+
+	if (!hash || !hash->count)
+		return 0.0;
+
+	size = 1U << hash->bits;
+	mask = size - 1;
+	for (i = 0; i < size; i++) {
+		if (!hash->table[i].item)
+			continue;
+		probes += ((i - _hash_inx(hash, hash->table[i].key)) & mask);
+		probes++;
+	}
+	return (double) probes / hash->count;
+}
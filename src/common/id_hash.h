@@ -0,0 +1,109 @@
+/*****************************************************************************\
+ *  id_hash.h - hash table of items keyed by a numeric ID
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * An open addressing (linear probing) hash table mapping 64-bit keys to
+ * item pointers. Keys and items are stored together in one array, so a
+ * lookup normally touches a single cache line. The table doubles in size
+ * as needed to keep its load factor below 70%, so lookup cost does not
+ * depend upon the number of entries. Removal shifts entries back rather
+ * than leaving tombstones.
+ *
+ * Composite keys, such as a job array's job ID and task ID, can be built
+ * with ID_HASH_KEY2().
+ *
+ * The table is not thread safe, callers must provide their own locking.
+ *
+ * xhash is not used for this as it keys items by a string built for every
+ * lookup and allocates a separate uthash node for every item.
+ */
+
+#ifndef _ID_HASH_H
+#define _ID_HASH_H
+
+#include <inttypes.h>
+
+#define ID_HASH_KEY2(_id1, _id2) \
+	((((uint64_t) (_id1)) << 32) | ((uint64_t) (_id2) & 0xffffffff))
+
+typedef struct id_hash id_hash_t;
+
+/*
+ * id_hash_init - create a hash table
+ * IN size - expected number of entries, zero to use a default. The table
+ *	grows beyond this as needed.
+ * RET the table, free with id_hash_free()
+ */
+extern id_hash_t *id_hash_init(uint32_t size);
+
+/* id_hash_free - free a hash table, but not the items in it */
+extern void id_hash_free(id_hash_t *hash);
+
+/*
+ * id_hash_add - add an item to a hash table, replacing any existing item
+ *	with the same key
+ * IN hash - table to add to
+ * IN key - item's key
+ * IN item - item to add, may not be NULL
+ * RET the replaced item or NULL
+ * NOTE: the table stops growing at 2^31 entries and is fatal once full
+ */
+extern void *id_hash_add(id_hash_t *hash, uint64_t key, void *item);
+
+/*
+ * id_hash_find - find an item in a hash table
+ * IN hash - table to search, may be NULL
+ * IN key - key of item to find
+ * RET the item or NULL if not found
+ */
+extern void *id_hash_find(id_hash_t *hash, uint64_t key);
+
+/*
+ * id_hash_remove - remove an item from a hash table
+ * IN hash - table to remove from
+ * IN key - key of item to remove
+ * RET the removed item or NULL if not found
+ */
+extern void *id_hash_remove(id_hash_t *hash, uint64_t key);
+
+/* id_hash_count - return the number of items in a hash table */
+extern uint32_t id_hash_count(id_hash_t *hash);
+
+/*
+ * id_hash_probes - return the mean number of table entries examined by
+ *	successful lookups of the items currently in a hash table, for
+ *	testing and diagnostics (1.0 is optimal)
+ */
+extern double id_hash_probes(id_hash_t *hash);
+
+#endif /* !_ID_HASH_H */
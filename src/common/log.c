@@ -59,6 +59,7 @@
 #include <errno.h>
 #include <poll.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -141,6 +142,70 @@ static log_t            *sched_log = NULL;
 
 #define LOG_INITIALIZED ((log != NULL) && (log->initialized))
 #define SCHED_LOG_INITIALIZED ((sched_log != NULL) && (sched_log->initialized))
+
+/*
+ * Asynchronous logging (log_options_t.async): messages for the log files
+ * are copied to a ring buffer owned by the logging thread, and written by
+ * the writer thread. Messages only for the log file do not take log_lock.
+ */
+#define LOG_RING_SIZE	(64 * 1024)	/* bytes, a power of two */
+#define LOG_OUT_FILE	0
+#define LOG_OUT_SCHED	1
+
+typedef struct {
+	uint64_t usec;		/* time queued, to merge the rings in order */
+	uint32_t len;		/* message length, without newline */
+	uint16_t out;		/* LOG_OUT_* */
+	uint16_t level;
+} log_rec_t;
+
+typedef struct log_ring {
+	pthread_mutex_t mutex;	/* owner thread vs. writer thread */
+	char *data;
+	uint32_t head;		/* offset of the oldest message */
+	uint32_t tail;		/* offset to queue messages at */
+	uint32_t dropped;	/* messages dropped for lack of space */
+	uint32_t gen;		/* async_gen when taken */
+	bool orphan;		/* owner thread has exited */
+	struct log_ring *next;
+} log_ring_t;
+
+typedef struct {
+	uint64_t usec;
+	uint32_t offset;	/* in writer_stage */
+	uint32_t len;
+	uint16_t out;
+} log_entry_t;
+
+static pthread_mutex_t  ring_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t       *ring_list = NULL;	/* rings of live threads */
+static log_ring_t       *ring_free = NULL;	/* rings to reuse */
+static pthread_key_t    ring_key;
+static bool             ring_key_created = false;
+static uint32_t         async_gen = 0;		/* incremented in fork child */
+
+static bool             log_async = false;	/* queue log file messages */
+static bool             log_async_fast = false;	/* ... without log_lock */
+static log_level_t      async_sync_level;	/* stderr or syslog level */
+static log_level_t      async_file_level;
+static bool             async_prefix_level;
+static uint32_t         log_file_gen = 0;	/* incremented on log (re)init */
+
+/* Writer thread state, writer_lock protects the output state */
+static pthread_mutex_t  writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t  writer_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   writer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t        writer_tid;
+static bool             writer_running = false;
+static bool             writer_sleeping = false;
+static bool             writer_shutdown = false;
+static int              writer_fd[2] = { -1, -1 };  /* by LOG_OUT_* */
+static uint32_t         writer_file_gen = 0;
+static char             *writer_stage = NULL;
+static uint32_t         writer_stage_size = 0;
+static log_entry_t      *writer_entries = NULL;
+static uint32_t         writer_entry_size = 0;
+static uint32_t         async_dropped = 0;
 /* define a default argv0 */
 #if HAVE_PROGRAM_INVOCATION_NAME
 /* This used to use program_invocation_short_name, but on some systems
@@ -152,12 +217,24 @@ extern char * program_invocation_name;
 #endif
 
 
+static void _log_async_flush(void);
+static void _log_async_child(void);
+
 /*
- * pthread_atfork handlers:
+ * pthread_atfork handlers. Queued messages are written before forking, as
+ * the writer thread does not exist in the child.
  */
-static void _atfork_prep()   { slurm_mutex_lock(&log_lock);   }
+static void _atfork_prep()
+{
+	_log_async_flush();
+	slurm_mutex_lock(&log_lock);
+}
 static void _atfork_parent() { slurm_mutex_unlock(&log_lock); }
-static void _atfork_child()  { slurm_mutex_unlock(&log_lock); }
+static void _atfork_child()
+{
+	slurm_mutex_unlock(&log_lock);
+	_log_async_child();
+}
 static bool at_forked = false;
 #define atfork_install_handlers()					\
 	while (!at_forked) {						\
@@ -166,6 +243,8 @@ static bool at_forked = false;
 	}
 
 static void _log_flush(log_t *log);
+static void _log_async_update(void);
+static void _log_async_stop(void);
 
 
 /* Write the current local time into the provided buffer. Returns the
@@ -356,6 +435,7 @@ _log_init(char *prog, log_options_t opt, log_facility_t fac, char *logfile )
 			fd_set_close_on_exec(fd);
 	}
 
+	_log_async_update();
 	log->initialized = 1;
  out:
 	return rc;
@@ -438,6 +518,7 @@ _sched_log_init(char *prog, log_options_t opt, log_facility_t fac,
 			fd_set_close_on_exec(fd);
 	}
 
+	log_file_gen++;
 	sched_log->initialized = 1;
  out:
 	return rc;
@@ -474,6 +555,7 @@ void log_fini(void)
 	if (!log)
 		return;
 
+	_log_async_stop();
 	slurm_mutex_lock(&log_lock);
 	_log_flush(log);
 	xfree(log->argv0);
@@ -494,7 +576,9 @@ void sched_log_fini(void)
 	if (!sched_log)
 		return;
 
+	_log_async_flush();
 	slurm_mutex_lock(&log_lock);
+	log_file_gen++;
 	_log_flush(sched_log);
 	xfree(sched_log->argv0);
 	xfree(sched_log->fpfx);
@@ -523,6 +607,7 @@ void log_set_fpfx(char *prefix)
 		log->fpfx = xstrdup(prefix);
 		xstrcatchar(log->fpfx, ' ');
 	}
+	_log_async_update();
 	slurm_mutex_unlock(&log_lock);
 }
 
@@ -582,6 +667,7 @@ int log_alter_with_fp(log_options_t opt, log_facility_t fac, FILE *fp_in)
 		/* don't close fd on out since this fd was made
 		 * outside of the logger */
 	}
+	_log_async_update();
 	slurm_mutex_unlock(&log_lock);
 	return rc;
 }
@@ -953,6 +1039,494 @@ _log_printf(log_t *log, cbuf_t cb, FILE *stream, const char *fmt, ...)
 
 }
 
+/* Return the prefix for messages at level, and their syslog priority */
+static char *_level_prefix(log_level_t level, int *priority)
+{
+	char *pfx = "";
+	int prio;
+
+	switch (level) {
+	case LOG_LEVEL_FATAL:
+		prio = LOG_CRIT;
+		pfx = "fatal: ";
+		break;
+
+	case LOG_LEVEL_ERROR:
+		prio = LOG_ERR;
+		pfx = "error: ";
+		break;
+
+	case LOG_LEVEL_SCHED:
+	case LOG_LEVEL_INFO:
+	case LOG_LEVEL_VERBOSE:
+		prio = LOG_INFO;
+		break;
+
+	case LOG_LEVEL_DEBUG:
+		prio = LOG_DEBUG;
+		pfx = "debug:  ";
+		break;
+
+	case LOG_LEVEL_DEBUG2:
+		prio = LOG_DEBUG;
+		pfx = "debug2: ";
+		break;
+
+	case LOG_LEVEL_DEBUG3:
+		prio = LOG_DEBUG;
+		pfx = "debug3: ";
+		break;
+
+	case LOG_LEVEL_DEBUG4:
+		prio = LOG_DEBUG;
+		pfx = "debug4: ";
+		break;
+
+	case LOG_LEVEL_DEBUG5:
+		prio = LOG_DEBUG;
+		pfx = "debug5: ";
+		break;
+
+	default:
+		prio = LOG_ERR;
+		pfx = "internal error: ";
+		break;
+	}
+
+	if (priority)
+		*priority = prio;
+	return pfx;
+}
+
+/* Copy len bytes to/from ring buffer offset off, which wraps around */
+static void _ring_put(log_ring_t *ring, uint32_t off, void *src, uint32_t len)
+{
+	uint32_t pos = off & (LOG_RING_SIZE - 1);
+	uint32_t part = MIN(len, LOG_RING_SIZE - pos);
+
+	memcpy(ring->data + pos, src, part);
+	memcpy(ring->data, (char *) src + part, len - part);
+}
+
+static void _ring_get(log_ring_t *ring, uint32_t off, void *dst, uint32_t len)
+{
+	uint32_t pos = off & (LOG_RING_SIZE - 1);
+	uint32_t part = MIN(len, LOG_RING_SIZE - pos);
+
+	memcpy(dst, ring->data + pos, part);
+	memcpy((char *) dst + part, ring->data, len - part);
+}
+
+/* pthread key destructor, the writer thread recycles the ring once empty */
+static void _ring_orphan(void *arg)
+{
+	log_ring_t *ring = (log_ring_t *) arg;
+
+	if (ring->gen != async_gen)	/* ring of the parent process */
+		return;
+	slurm_mutex_lock(&ring->mutex);
+	ring->orphan = true;
+	slurm_mutex_unlock(&ring->mutex);
+}
+
+/* Return the calling thread's ring buffer */
+static log_ring_t *_ring_get_own(void)
+{
+	log_ring_t *ring = pthread_getspecific(ring_key);
+
+	if (ring && (ring->gen == async_gen))
+		return ring;
+
+	slurm_mutex_lock(&ring_list_lock);
+	if ((ring = ring_free)) {
+		ring_free = ring->next;
+	} else {
+		ring = xmalloc(sizeof(log_ring_t));
+		ring->data = xmalloc(LOG_RING_SIZE);
+		slurm_mutex_init(&ring->mutex);
+	}
+	ring->head = ring->tail = 0;
+	ring->dropped = 0;
+	ring->gen = async_gen;
+	ring->orphan = false;
+	ring->next = ring_list;
+	ring_list = ring;
+	slurm_mutex_unlock(&ring_list_lock);
+
+	pthread_setspecific(ring_key, ring);
+	return ring;
+}
+
+/*
+ * Queue a message for the writer thread.
+ * RET false if it must be written synchronously: an error for which there
+ *	is no space
+ */
+static bool _log_queue(int out, log_level_t level, char *msg)
+{
+	log_ring_t *ring = _ring_get_own();
+	struct timeval now;
+	log_rec_t rec;
+
+	rec.len = strlen(msg);
+	rec.out = out;
+	rec.level = level;
+	gettimeofday(&now, NULL);
+	rec.usec = ((uint64_t) now.tv_sec * 1000000) + now.tv_usec;
+
+	slurm_mutex_lock(&ring->mutex);
+	if ((ring->tail - ring->head) + sizeof(rec) + rec.len > LOG_RING_SIZE) {
+		if (level > LOG_LEVEL_ERROR)
+			ring->dropped++;
+		slurm_mutex_unlock(&ring->mutex);
+		return (level > LOG_LEVEL_ERROR);
+	}
+	_ring_put(ring, ring->tail, &rec, sizeof(rec));
+	_ring_put(ring, ring->tail + sizeof(rec), msg, rec.len);
+	ring->tail += sizeof(rec) + rec.len;
+	slurm_mutex_unlock(&ring->mutex);
+
+	if (writer_sleeping) {
+		slurm_mutex_lock(&writer_wake_lock);
+		pthread_cond_signal(&writer_cond);
+		slurm_mutex_unlock(&writer_wake_lock);
+	}
+	return true;
+}
+
+static int _entry_cmp(const void *x, const void *y)
+{
+	const log_entry_t *e1 = x, *e2 = y;
+
+	if (e1->usec != e2->usec)
+		return (e1->usec < e2->usec) ? -1 : 1;
+	return (e1->offset < e2->offset) ? -1 : 1;
+}
+
+static void _write_all(int fd, char *buf, int len)
+{
+	int rc;
+
+	while ((fd >= 0) && (len > 0)) {
+		rc = write(fd, buf, len);
+		if (rc < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return;		/* can not log it, discard */
+		}
+		buf += rc;
+		len -= rc;
+	}
+}
+
+/* (Re)open the writer thread's descriptors if the log files changed */
+static void _writer_open(void)
+{
+	log_t *logs[2];
+	int i;
+
+	slurm_mutex_lock(&log_lock);
+	if (writer_file_gen != log_file_gen) {
+		logs[LOG_OUT_FILE] = log;
+		logs[LOG_OUT_SCHED] = sched_log;
+		for (i = 0; i < 2; i++) {
+			if (writer_fd[i] >= 0)
+				close(writer_fd[i]);
+			writer_fd[i] = -1;
+			if (logs[i] && logs[i]->logfp &&
+			    ((writer_fd[i] = dup(fileno(logs[i]->logfp))) >= 0))
+				fd_set_close_on_exec(writer_fd[i]);
+		}
+		writer_file_gen = log_file_gen;
+	}
+	slurm_mutex_unlock(&log_lock);
+}
+
+/*
+ * Write the messages queued in all rings, in the order they were queued.
+ * RET count of messages written
+ */
+static int _log_async_pass(void)
+{
+	log_ring_t *ring, **prev;
+	log_rec_t rec;
+	uint32_t stage_off = 0, cnt = 0, dropped = 0, i;
+	uint32_t out_len[2] = { 0, 0 };
+	char *out[2] = { NULL, NULL }, *msg = NULL;
+	bool orphan;
+
+	slurm_mutex_lock(&writer_lock);
+
+	slurm_mutex_lock(&ring_list_lock);
+	prev = &ring_list;
+	while ((ring = *prev)) {
+		slurm_mutex_lock(&ring->mutex);
+		if ((stage_off + (ring->tail - ring->head)) >
+		    writer_stage_size) {
+			writer_stage_size = stage_off + LOG_RING_SIZE;
+			xrealloc(writer_stage, writer_stage_size);
+		}
+		while (ring->head != ring->tail) {
+			_ring_get(ring, ring->head, &rec, sizeof(rec));
+			_ring_get(ring, ring->head + sizeof(rec),
+				  writer_stage + stage_off, rec.len);
+			ring->head += sizeof(rec) + rec.len;
+			if (cnt >= writer_entry_size) {
+				writer_entry_size = (cnt + 1) * 2;
+				xrealloc(writer_entries, writer_entry_size *
+					 sizeof(log_entry_t));
+			}
+			writer_entries[cnt].usec = rec.usec;
+			writer_entries[cnt].offset = stage_off;
+			writer_entries[cnt].len = rec.len;
+			writer_entries[cnt].out = rec.out;
+			stage_off += rec.len;
+			cnt++;
+		}
+		dropped += ring->dropped;
+		ring->dropped = 0;
+		orphan = ring->orphan;
+		slurm_mutex_unlock(&ring->mutex);
+		if (orphan) {
+			*prev = ring->next;
+			ring->next = ring_free;
+			ring_free = ring;
+		} else
+			prev = &ring->next;
+	}
+	slurm_mutex_unlock(&ring_list_lock);
+
+	if (!cnt && !dropped) {
+		slurm_mutex_unlock(&writer_lock);
+		return 0;
+	}
+
+	if (dropped) {
+		async_dropped += dropped;
+		xlogfmtcat(&msg, "[%M] error: %u log messages dropped, log "
+			   "writer could not keep up\n", dropped);
+		out_len[LOG_OUT_FILE] = strlen(msg);
+	}
+	for (i = 0; i < cnt; i++)
+		out_len[writer_entries[i].out] += writer_entries[i].len + 1;
+	for (i = 0; i < 2; i++) {
+		if (out_len[i])
+			out[i] = xmalloc(out_len[i]);
+		out_len[i] = 0;
+	}
+
+	/* Messages queued by different threads are merged by time */
+	qsort(writer_entries, cnt, sizeof(log_entry_t), _entry_cmp);
+	for (i = 0; i < cnt; i++) {
+		log_entry_t *e = &writer_entries[i];
+		memcpy(out[e->out] + out_len[e->out],
+		       writer_stage + e->offset, e->len);
+		out_len[e->out] += e->len;
+		out[e->out][out_len[e->out]++] = '\n';
+	}
+	if (msg) {
+		memcpy(out[LOG_OUT_FILE] + out_len[LOG_OUT_FILE], msg,
+		       strlen(msg));
+		out_len[LOG_OUT_FILE] += strlen(msg);
+		xfree(msg);
+	}
+
+	_writer_open();
+	for (i = 0; i < 2; i++) {
+		_write_all(writer_fd[i], out[i], out_len[i]);
+		xfree(out[i]);
+	}
+	slurm_mutex_unlock(&writer_lock);
+
+	return cnt;
+}
+
+/* Return true if any ring has messages to write */
+static bool _log_async_pending(void)
+{
+	log_ring_t *ring;
+	bool pending = false;
+
+	slurm_mutex_lock(&ring_list_lock);
+	for (ring = ring_list; ring && !pending; ring = ring->next) {
+		slurm_mutex_lock(&ring->mutex);
+		pending = (ring->head != ring->tail) || ring->dropped;
+		slurm_mutex_unlock(&ring->mutex);
+	}
+	slurm_mutex_unlock(&ring_list_lock);
+
+	return pending;
+}
+
+static void *_log_writer(void *arg)
+{
+	struct timespec ts;
+	bool shutdown = false;
+
+	while (!shutdown) {
+		if (_log_async_pass())
+			continue;
+
+		/* Set writer_sleeping before checking for messages, so
+		 * threads queueing messages after the check wake us */
+		slurm_mutex_lock(&writer_wake_lock);
+		writer_sleeping = true;
+		if (!writer_shutdown && !_log_async_pending()) {
+			ts.tv_sec = time(NULL) + 1;
+			ts.tv_nsec = 0;
+			pthread_cond_timedwait(&writer_cond, &writer_wake_lock,
+					       &ts);
+		}
+		writer_sleeping = false;
+		shutdown = writer_shutdown;
+		slurm_mutex_unlock(&writer_wake_lock);
+	}
+	(void) _log_async_pass();
+
+	return NULL;
+}
+
+/*
+ * Start or stop queueing messages after the log options or files change.
+ * Called with log_lock held.
+ */
+static void _log_async_update(void)
+{
+	pthread_attr_t attr;
+	sigset_t all_set, old_set;
+	int rc;
+
+	log_file_gen++;
+	if (!log->opt.async || log->opt.buffered || !log->logfp) {
+		log_async = log_async_fast = false;
+		return;
+	}
+
+	if (!writer_running) {
+		if (!ring_key_created) {
+			if (pthread_key_create(&ring_key, _ring_orphan))
+				return;
+			ring_key_created = true;
+		}
+		writer_shutdown = false;
+		/* The writer inherits this thread's signal mask. Start it
+		 * with every signal blocked, so that signals sent to the
+		 * process are never delivered to it (daemons typically block
+		 * their signals and start a sigwait() thread only later). */
+		sigfillset(&all_set);
+		pthread_sigmask(SIG_BLOCK, &all_set, &old_set);
+		slurm_attr_init(&attr);
+		rc = pthread_create(&writer_tid, &attr, _log_writer, NULL);
+		slurm_attr_destroy(&attr);
+		pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+		if (rc) {
+			log_async = log_async_fast = false;
+			return;
+		}
+		writer_running = true;
+	}
+
+	async_sync_level = MAX(log->opt.stderr_level, log->opt.syslog_level);
+	async_file_level = log->opt.logfile_level;
+	async_prefix_level = log->opt.prefix_level;
+	log_async_fast = !log->fpfx || !log->fpfx[0];
+	log_async = true;
+}
+
+/* Write all queued messages */
+static void _log_async_flush(void)
+{
+	if (writer_running)
+		(void) _log_async_pass();
+}
+
+/* Stop the writer thread, once it has written all queued messages */
+static void _log_async_stop(void)
+{
+	int i;
+
+	slurm_mutex_lock(&log_lock);
+	log_async = log_async_fast = false;
+	slurm_mutex_unlock(&log_lock);
+	if (!writer_running)
+		return;
+
+	slurm_mutex_lock(&writer_wake_lock);
+	writer_shutdown = true;
+	pthread_cond_signal(&writer_cond);
+	slurm_mutex_unlock(&writer_wake_lock);
+	pthread_join(writer_tid, NULL);
+	writer_running = false;
+
+	slurm_mutex_lock(&writer_lock);
+	for (i = 0; i < 2; i++) {
+		if (writer_fd[i] >= 0)
+			close(writer_fd[i]);
+		writer_fd[i] = -1;
+	}
+	writer_file_gen = log_file_gen - 1;
+	slurm_mutex_unlock(&writer_lock);
+}
+
+/*
+ * Called in the child after fork(). The writer thread does not exist here,
+ * so log synchronously until logging is set up again (e.g. after daemon()).
+ * The parent's rings are abandoned, it writes their messages.
+ */
+static void _log_async_child(void)
+{
+	log_async = log_async_fast = false;
+	writer_running = writer_sleeping = writer_shutdown = false;
+	async_gen++;
+	ring_list = ring_free = NULL;
+	slurm_mutex_init(&ring_list_lock);
+	slurm_mutex_init(&writer_lock);
+	slurm_mutex_init(&writer_wake_lock);
+	pthread_cond_init(&writer_cond, NULL);
+	writer_fd[LOG_OUT_FILE] = writer_fd[LOG_OUT_SCHED] = -1;
+	writer_file_gen = log_file_gen - 1;
+}
+
+/*
+ * Queue a message only for the log file without taking log_lock.
+ * RET false if it must be logged by log_msg(), before args are used
+ */
+static bool _log_async_msg(log_level_t level, const char *fmt, va_list args)
+{
+	char *buf, *msgbuf = NULL;
+
+	if (!log_async_fast || (level <= async_sync_level) ||
+	    (xstrncmp(fmt, "sched: ", 7) == 0))
+		return false;
+	if (level > async_file_level)
+		return true;	/* not logged anywhere */
+
+	buf = vxstrfmt(fmt, args);
+	xlogfmtcat(&msgbuf, "[%M] %s%s",
+		   async_prefix_level ? _level_prefix(level, NULL) : "", buf);
+	if (!_log_queue(LOG_OUT_FILE, level, msgbuf)) {
+		slurm_mutex_lock(&log_lock);
+		if (LOG_INITIALIZED && log->logfp) {
+			_log_printf(log, log->fbuf, log->logfp, "%s\n", msgbuf);
+			fflush(log->logfp);
+		}
+		slurm_mutex_unlock(&log_lock);
+	}
+	xfree(buf);
+	xfree(msgbuf);
+	return true;
+}
+
+uint32_t log_async_dropped(void)
+{
+	uint32_t dropped;
+
+	slurm_mutex_lock(&writer_lock);
+	dropped = async_dropped;
+	slurm_mutex_unlock(&writer_lock);
+	return dropped;
+}
+
 /*
  * log a message at the specified level to facilities that have been
  * configured to receive messages at that level
@@ -964,6 +1538,9 @@ static void log_msg(log_level_t level, const char *fmt, va_list args)
 	char *msgbuf = NULL;
 	int priority = LOG_INFO;
 
+	if (_log_async_msg(level, fmt, args))
+		return;
+
 	slurm_mutex_lock(&log_lock);
 
 	if (!LOG_INITIALIZED) {
@@ -976,9 +1553,11 @@ static void log_msg(log_level_t level, const char *fmt, va_list args)
 	    (xstrncmp(fmt, "sched: ", 7) == 0)) {
 		buf = vxstrfmt(fmt, args);
 		xlogfmtcat(&msgbuf, "[%M] %s%s%s", sched_log->fpfx, pfx, buf);
-		_log_printf(sched_log, sched_log->fbuf, sched_log->logfp,
-			    "%s\n", msgbuf);
-		fflush(sched_log->logfp);
+		if (!log_async || !_log_queue(LOG_OUT_SCHED, level, msgbuf)) {
+			_log_printf(sched_log, sched_log->fbuf,
+				    sched_log->logfp, "%s\n", msgbuf);
+			fflush(sched_log->logfp);
+		}
 		xfree(msgbuf);
 	}
 	if ((level > log->opt.syslog_level)  &&
@@ -989,56 +1568,8 @@ static void log_msg(log_level_t level, const char *fmt, va_list args)
 		return;
 	}
 
-	if (log->opt.prefix_level || (log->opt.syslog_level > level)) {
-		switch (level) {
-		case LOG_LEVEL_FATAL:
-			priority = LOG_CRIT;
-			pfx = "fatal: ";
-			break;
-
-		case LOG_LEVEL_ERROR:
-			priority = LOG_ERR;
-			pfx = "error: ";
-			break;
-
-		case LOG_LEVEL_SCHED:
-		case LOG_LEVEL_INFO:
-		case LOG_LEVEL_VERBOSE:
-			priority = LOG_INFO;
-			break;
-
-		case LOG_LEVEL_DEBUG:
-			priority = LOG_DEBUG;
-			pfx = "debug:  ";
-			break;
-
-		case LOG_LEVEL_DEBUG2:
-			priority = LOG_DEBUG;
-			pfx = "debug2: ";
-			break;
-
-		case LOG_LEVEL_DEBUG3:
-			priority = LOG_DEBUG;
-			pfx = "debug3: ";
-			break;
-
-		case LOG_LEVEL_DEBUG4:
-			priority = LOG_DEBUG;
-			pfx = "debug4: ";
-			break;
-
-		case LOG_LEVEL_DEBUG5:
-			priority = LOG_DEBUG;
-			pfx = "debug5: ";
-			break;
-
-		default:
-			priority = LOG_ERR;
-			pfx = "internal error: ";
-			break;
-		}
-
-	}
+	if (log->opt.prefix_level || (log->opt.syslog_level > level))
+		pfx = _level_prefix(level, &priority);
 
 	if (!buf) {
 		/* format the basic message,
@@ -1064,8 +1595,11 @@ static void log_msg(log_level_t level, const char *fmt, va_list args)
 	if ((level <= log->opt.logfile_level) && (log->logfp != NULL)) {
 
 		xlogfmtcat(&msgbuf, "[%M] %s%s%s", log->fpfx, pfx, buf);
-		_log_printf(log, log->fbuf, log->logfp, "%s\n", msgbuf);
-		fflush(log->logfp);
+		if (!log_async || !_log_queue(LOG_OUT_FILE, level, msgbuf)) {
+			_log_printf(log, log->fbuf, log->logfp, "%s\n",
+				    msgbuf);
+			fflush(log->logfp);
+		}
 
 		xfree(msgbuf);
 	}
@@ -1111,6 +1645,7 @@ _log_flush(log_t *log)
 void
 log_flush()
 {
+	_log_async_flush();
 	slurm_mutex_lock(&log_lock);
 	_log_flush(log);
 	slurm_mutex_unlock(&log_lock);
@@ -46,6 +46,7 @@
 #ifndef _LOG_H
 #define _LOG_H
 
+#include <inttypes.h>
 #include <syslog.h>
 #include <stdio.h>
 
@@ -99,6 +100,7 @@ typedef struct {
 	log_level_t logfile_level;  /* max level to log to logfile        */
 	unsigned    prefix_level:1; /* prefix level (e.g. "debug: ") if 1 */
 	unsigned    buffered:1;     /* Use internal buffer to never block */
+	unsigned    async:1;        /* Write logfile from a separate thread */
 } 	log_options_t;
 
 extern char *slurm_prog_name;
@@ -222,10 +224,21 @@ bool log_has_data(void);
 
 /*
  * log_flush() attempts to flush all data in the internal
- * log buffer to the appropriate output stream.
+ * log buffer to the appropriate output stream. With asynchronous
+ * logging, also writes all queued messages to the log files.
  */
 void log_flush(void);
 
+/*
+ * Asynchronous logging (log_options_t.async):
+ *
+ * Messages for the log file and scheduler log file are queued in a ring
+ * buffer per thread and written by a writer thread. Once a thread's ring is
+ * full, its messages are dropped, except for errors, which are written
+ * directly. log_async_dropped() returns the count of messages dropped.
+ */
+uint32_t log_async_dropped(void);
+
 /* log_set_debug_flags()
  * Set or reset the debug flags based on the configuration
  * file or the scontrol command.
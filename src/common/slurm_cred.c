@@ -57,6 +57,7 @@
 #include "src/common/plugin.h"
 #include "src/common/plugrack.h"
 #include "src/common/slurm_cred.h"
+#include "src/common/siphash.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_time.h"
 #include "src/common/xassert.h"
@@ -80,6 +81,15 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
  */
 #define DEFAULT_EXPIRATION_WINDOW 120
 
+/*
+ * Default count of threads signing credentials with SLURM_CRED_OPT_SIGN_ASYNC.
+ * May be altered with "AuthInfo=cred_sign_threads=8".
+ */
+#define DEFAULT_SIGN_THREADS 4
+#define SIGN_BATCH_MAX 16	/* credentials taken by a signer at once */
+
+#define VERIFY_CACHE_SIZE 4096	/* credentials known to be verified */
+
 #define EXTREME_DEBUG   0
 #define MAX_TIME 0x7fffffff
 
@@ -107,6 +117,25 @@ typedef struct {
 } job_state_t;
 
 
+/*
+ * A credential the verifier has already checked the signature of
+ */
+typedef struct {
+	uint64_t digest;	/* keyed hash of the packed credential */
+	time_t   expiration;	/* Time at which cred is no longer good	*/
+	char    *signature;
+	uint32_t siglen;
+} verify_cache_t;
+
+/*
+ * A credential waiting for a signer thread
+ */
+typedef struct {
+	slurm_cred_t  *cred;
+	uint16_t       protocol_version;
+	struct timeval queued;
+} sign_req_t;
+
 /*
  * Completion of slurm credential context
  */
@@ -146,6 +175,18 @@ struct slurm_cred_context {
 
 	void          *exkey;      /* Old public key if key is updated      */
 	time_t         exkey_exp;  /* Old key expiration time               */
+
+	verify_cache_t *verify_cache; /* Verified creds (for verifier)      */
+
+	/* Credentials signed by a pool of threads (for creator) */
+	char          *key_path;   /* private key file, for signer threads  */
+	uint32_t       key_gen;    /* incremented on each key update        */
+	int            sign_thread_cnt;
+	pthread_t     *sign_tids;
+	List           sign_list;  /* sign_req_t waiting to be signed       */
+	bool           sign_shutdown;
+	pthread_mutex_t sign_mutex;
+	pthread_cond_t sign_cond;
 };
 
 
@@ -186,6 +227,8 @@ struct slurm_job_credential {
 
 	char     *signature; 	/* credential signature			*/
 	unsigned int siglen;	/* signature length in bytes		*/
+	bool      sign_pending;	/* queued for a signer thread		*/
+	pthread_cond_t sign_cond; /* signaled once signed		*/
 };
 
 /*
@@ -233,6 +276,13 @@ static bool init_run = false;
 static time_t crypto_restart_time = (time_t) 0;
 static List sbcast_cache_list = NULL;
 static int cred_expire = DEFAULT_EXPIRATION_WINDOW;
+static int cred_sign_threads = DEFAULT_SIGN_THREADS;
+
+static uint8_t verify_hash_key[KEYLEN];
+static bool verify_hash_key_set = false;
+
+static pthread_mutex_t cred_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static slurm_cred_stats_t cred_stats;
 
 /*
  * Static prototypes:
@@ -285,6 +335,12 @@ static void _cred_state_pack_one(cred_state_t *s, Buf buffer);
 static void _sbast_cache_add(sbcast_cred_t *sbcast_cred);
 static void _sbcast_cache_del(void *x);
 
+static bool _sign_queue(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+			uint16_t protocol_version);
+static void _sign_threads_start(slurm_cred_ctx_t ctx);
+static void _sign_threads_stop(slurm_cred_ctx_t ctx);
+static int  _wait_signed(slurm_cred_t *cred);
+
 static int _slurm_crypto_init(void)
 {
 	char	*auth_info, *tok;
@@ -303,8 +359,17 @@ static int _slurm_crypto_init(void)
 				      cred_expire);
 				cred_expire = DEFAULT_EXPIRATION_WINDOW;
 			}
-		xfree(auth_info);
 		}
+		if ((tok = strstr(auth_info, "cred_sign_threads="))) {
+			cred_sign_threads = atoi(tok + 18);
+			if ((cred_sign_threads < 0) ||
+			    (cred_sign_threads > 64)) {
+				error("AuthInfo=cred_sign_threads=%d invalid",
+				      cred_sign_threads);
+				cred_sign_threads = DEFAULT_SIGN_THREADS;
+			}
+		}
+		xfree(auth_info);
 	}
 
 	slurm_mutex_lock( &g_context_lock );
@@ -381,6 +446,7 @@ slurm_cred_creator_ctx_create(const char *path)
 	ctx->key = (*(ops.crypto_read_private_key))(path);
 	if (!ctx->key)
  		goto fail;
+	ctx->key_path = xstrdup(path);
 
 	slurm_mutex_unlock(&ctx->mutex);
 	return ctx;
@@ -431,6 +497,9 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 	if (_slurm_crypto_init() < 0)
 		return;
 
+	/* Signs queued credentials first, the threads use ctx->mutex */
+	_sign_threads_stop(ctx);
+
 	slurm_mutex_lock(&ctx->mutex);
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 
@@ -440,11 +509,20 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 		(*(ops.crypto_destroy_key))(ctx->key);
 	FREE_NULL_LIST(ctx->job_list);
 	FREE_NULL_LIST(ctx->state_list);
+	if (ctx->verify_cache) {
+		int i;
+		for (i = 0; i < VERIFY_CACHE_SIZE; i++)
+			xfree(ctx->verify_cache[i].signature);
+		xfree(ctx->verify_cache);
+	}
+	xfree(ctx->key_path);
 
 	xassert(ctx->magic = ~CRED_CTX_MAGIC);
 
 	slurm_mutex_unlock(&ctx->mutex);
 	slurm_mutex_destroy(&ctx->mutex);
+	slurm_mutex_destroy(&ctx->sign_mutex);
+	pthread_cond_destroy(&ctx->sign_cond);
 
 	xfree(ctx);
 
@@ -468,6 +546,10 @@ slurm_cred_ctx_set(slurm_cred_ctx_t ctx, slurm_cred_opt_t opt, ...)
 	case SLURM_CRED_OPT_EXPIRY_WINDOW:
 		ctx->expiry_window = va_arg(ap, int);
 		break;
+	case SLURM_CRED_OPT_SIGN_ASYNC:
+		if (va_arg(ap, int) && (ctx->type == SLURM_CRED_CREATOR))
+			_sign_threads_start(ctx);
+		break;
 	default:
 		slurm_seterrno(EINVAL);
 		rc = SLURM_ERROR;
@@ -500,6 +582,10 @@ slurm_cred_ctx_get(slurm_cred_ctx_t ctx, slurm_cred_opt_t opt, ...)
 		intp  = va_arg(ap, int *);
 		*intp = ctx->expiry_window;
 		break;
+	case SLURM_CRED_OPT_SIGN_ASYNC:
+		intp  = va_arg(ap, int *);
+		*intp = (ctx->sign_thread_cnt > 0);
+		break;
 	default:
 		slurm_seterrno(EINVAL);
 		rc = SLURM_ERROR;
@@ -589,6 +675,11 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 #endif
 	cred->ctime  = time(NULL);
 
+	if (_sign_queue(ctx, cred, protocol_version)) {
+		slurm_mutex_unlock(&cred->mutex);
+		return cred;
+	}
+
 	slurm_mutex_lock(&ctx->mutex);
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_CREATOR);
@@ -615,6 +706,7 @@ slurm_cred_copy(slurm_cred_t *cred)
 	xassert(cred != NULL);
 
 	slurm_mutex_lock(&cred->mutex);
+	_wait_signed(cred);
 
 	rcred = _slurm_cred_alloc();
 	slurm_mutex_lock(&rcred->mutex);
@@ -905,6 +997,7 @@ slurm_cred_destroy(slurm_cred_t *cred)
 	xassert(cred->magic == CRED_MAGIC);
 
 	slurm_mutex_lock(&cred->mutex);
+	_wait_signed(cred);
 #ifndef HAVE_BG
 	FREE_NULL_BITMAP(cred->job_core_bitmap);
 	FREE_NULL_BITMAP(cred->step_core_bitmap);
@@ -922,6 +1015,7 @@ slurm_cred_destroy(slurm_cred_t *cred)
 
 	slurm_mutex_unlock(&cred->mutex);
 	slurm_mutex_destroy(&cred->mutex);
+	pthread_cond_destroy(&cred->sign_cond);
 
 	xfree(cred);
 }
@@ -1076,18 +1170,21 @@ error:
 int
 slurm_cred_get_signature(slurm_cred_t *cred, char **datap, uint32_t *datalen)
 {
+	int rc;
+
 	xassert(cred    != NULL);
 	xassert(datap   != NULL);
 	xassert(datalen != NULL);
 
 	slurm_mutex_lock(&cred->mutex);
+	rc = _wait_signed(cred);
 
 	*datap   = (char *) cred->signature;
 	*datalen = cred->siglen;
 
 	slurm_mutex_unlock(&cred->mutex);
 
-	return SLURM_SUCCESS;
+	return rc;
 }
 
 #ifndef HAVE_BG
@@ -1277,9 +1374,13 @@ slurm_cred_pack(slurm_cred_t *cred, Buf buffer, uint16_t protocol_version)
 	xassert(cred->magic == CRED_MAGIC);
 
 	slurm_mutex_lock(&cred->mutex);
+	if (_wait_signed(cred) != SLURM_SUCCESS) {
+		/* An empty signature is rejected by slurm_cred_unpack() */
+		error("%s: credential for job %u.%u is unsigned",
+		      __func__, cred->jobid, cred->stepid);
+	}
 
 	_pack_cred(cred, buffer, protocol_version);
-	xassert(cred->siglen > 0);
 	packmem(cred->signature, cred->siglen, buffer);
 
 	slurm_mutex_unlock(&cred->mutex);
@@ -1364,7 +1465,8 @@ slurm_cred_unpack(Buf buffer, uint16_t protocol_version)
 		sigp = (char **) &cred->signature;
 		safe_unpackmem_xmalloc(sigp, &len, buffer);
 		cred->siglen = len;
-		xassert(len > 0);
+		if (len == 0)
+			goto unpack_error;
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		uint32_t tmp_mem;
 		safe_unpack32(&cred->jobid, buffer);
@@ -1432,7 +1534,8 @@ slurm_cred_unpack(Buf buffer, uint16_t protocol_version)
 		sigp = (char **) &cred->signature;
 		safe_unpackmem_xmalloc(sigp, &len, buffer);
 		cred->siglen = len;
-		xassert(len > 0);
+		if (len == 0)
+			goto unpack_error;
 	} else {
 		error("slurm_cred_unpack: protocol_version"
 		      " %hu not supported", protocol_version);
@@ -1480,6 +1583,38 @@ slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+void
+slurm_cred_get_stats(slurm_cred_stats_t *stats)
+{
+	slurm_mutex_lock(&cred_stats_mutex);
+	*stats = cred_stats;
+	slurm_mutex_unlock(&cred_stats_mutex);
+}
+
+void
+slurm_cred_reset_stats(void)
+{
+	uint32_t sign_queue;
+
+	slurm_mutex_lock(&cred_stats_mutex);
+	sign_queue = cred_stats.sign_queue;
+	memset(&cred_stats, 0, sizeof(slurm_cred_stats_t));
+	cred_stats.sign_queue = sign_queue;
+	slurm_mutex_unlock(&cred_stats_mutex);
+}
+
+void
+slurm_cred_pack_stats(Buf buffer, uint16_t protocol_version)
+{
+	slurm_mutex_lock(&cred_stats_mutex);
+	pack32(cred_stats.sign_cnt, buffer);
+	pack32(cred_stats.sign_queue, buffer);
+	pack64(cred_stats.sign_time, buffer);
+	pack64(cred_stats.sign_max, buffer);
+	pack64(cred_stats.sign_wait, buffer);
+	slurm_mutex_unlock(&cred_stats_mutex);
+}
+
 void
 slurm_cred_print(slurm_cred_t *cred)
 {
@@ -1545,6 +1680,26 @@ _verifier_ctx_init(slurm_cred_ctx_t ctx)
 
 	ctx->job_list   = list_create((ListDelF) _job_state_destroy);
 	ctx->state_list = list_create((ListDelF) _cred_state_destroy);
+	ctx->verify_cache = xmalloc(sizeof(verify_cache_t) *
+				    VERIFY_CACHE_SIZE);
+
+	/*
+	 * The cache is keyed by a hash of the credential, which must not be
+	 * predictable or a forged credential could be given the hash of one
+	 * already verified.
+	 */
+	if (!verify_hash_key_set) {
+		int fd = open("/dev/urandom", O_RDONLY);
+		if ((fd < 0) ||
+		    (read(fd, verify_hash_key, KEYLEN) != KEYLEN)) {
+			error("%s: can not read /dev/urandom, credential "
+			      "verification cache disabled", __func__);
+			xfree(ctx->verify_cache);
+		} else
+			verify_hash_key_set = true;
+		if (fd >= 0)
+			close(fd);
+	}
 
 	return;
 }
@@ -1569,6 +1724,10 @@ _ctx_update_private_key(slurm_cred_ctx_t ctx, const char *path)
 
 	tmpk = ctx->key;
 	ctx->key = pk;
+	/* signer threads read their own copy of the new key */
+	xfree(ctx->key_path);
+	ctx->key_path = xstrdup(path);
+	ctx->key_gen++;
 
 	slurm_mutex_unlock(&ctx->mutex);
 
@@ -1605,6 +1764,14 @@ _ctx_update_public_key(slurm_cred_ctx_t ctx, const char *path)
 	 */
 	ctx->exkey_exp = time(NULL) + ctx->expiry_window + 60;
 
+	if (ctx->verify_cache) {
+		int i;
+		for (i = 0; i < VERIFY_CACHE_SIZE; i++) {
+			xfree(ctx->verify_cache[i].signature);
+			ctx->verify_cache[i].expiration = (time_t) 0;
+		}
+	}
+
 	slurm_mutex_unlock(&ctx->mutex);
 	return SLURM_SUCCESS;
 }
@@ -1634,6 +1801,8 @@ _slurm_cred_ctx_alloc(void)
 	/* Contents initialized to zero */
 
 	slurm_mutex_init(&ctx->mutex);
+	slurm_mutex_init(&ctx->sign_mutex);
+	pthread_cond_init(&ctx->sign_cond, NULL);
 	slurm_mutex_lock(&ctx->mutex);
 
 	ctx->expiry_window = cred_expire;
@@ -1652,6 +1821,7 @@ _slurm_cred_alloc(void)
 	/* Contents initialized to zero */
 
 	slurm_mutex_init(&cred->mutex);
+	pthread_cond_init(&cred->sign_cond, NULL);
 	cred->uid = (uid_t) -1;
 
 	xassert(cred->magic = CRED_MAGIC);
@@ -1673,6 +1843,46 @@ _print_data(char *data, int datalen)
 }
 #endif
 
+static uint64_t
+_usec_since(struct timeval *tv)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - tv->tv_sec) * 1000000 +
+		(now.tv_usec - tv->tv_usec);
+}
+
+/* Sign the packed credential in buffer with key */
+static int
+_sign_buffer(void *key, Buf buffer, char **sig, unsigned int *siglen)
+{
+	struct timeval tv;
+	uint64_t usec;
+	int rc;
+
+	gettimeofday(&tv, NULL);
+	rc = (*(ops.crypto_sign))(key, get_buf_data(buffer),
+				  get_buf_offset(buffer), sig, siglen);
+	usec = _usec_since(&tv);
+
+	slurm_mutex_lock(&cred_stats_mutex);
+	cred_stats.sign_cnt++;
+	cred_stats.sign_time += usec;
+	if (usec > cred_stats.sign_max)
+		cred_stats.sign_max = usec;
+	slurm_mutex_unlock(&cred_stats_mutex);
+
+	if (rc) {
+		error("Credential sign: %s",
+		      (*(ops.crypto_str_error))(rc));
+		xfree(*sig);
+		*siglen = 0;
+		return SLURM_ERROR;
+	}
+	return SLURM_SUCCESS;
+}
+
 static int
 _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 		 uint16_t protocol_version)
@@ -1682,18 +1892,195 @@ _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer, protocol_version);
-	rc = (*(ops.crypto_sign))(ctx->key,
-				  get_buf_data(buffer),
-				  get_buf_offset(buffer),
-				  &cred->signature,
-				  &cred->siglen);
+	rc = _sign_buffer(ctx->key, buffer, &cred->signature, &cred->siglen);
 	free_buf(buffer);
 
-	if (rc) {
-		error("Credential sign: %s",
-		      (*(ops.crypto_str_error))(rc));
-		return SLURM_ERROR;
+	return rc;
+}
+
+/* Sign one queued credential, with the signer thread's copy of the key
+ * if it has one */
+static void
+_sign_one(slurm_cred_ctx_t ctx, void *key, sign_req_t *req)
+{
+	slurm_cred_t *cred = req->cred;
+	char *sig = NULL;
+	unsigned int siglen = 0;
+	uint64_t usec;
+	Buf buffer;
+
+	buffer = init_buf(4096);
+	slurm_mutex_lock(&cred->mutex);
+	_pack_cred(cred, buffer, req->protocol_version);
+	slurm_mutex_unlock(&cred->mutex);
+
+	/* Retry with the context's key if the thread's copy failed */
+	if (!key || (_sign_buffer(key, buffer, &sig, &siglen) !=
+		     SLURM_SUCCESS)) {
+		slurm_mutex_lock(&ctx->mutex);
+		(void) _sign_buffer(ctx->key, buffer, &sig, &siglen);
+		slurm_mutex_unlock(&ctx->mutex);
+	}
+	free_buf(buffer);
+	if (!sig) {
+		error("Credential for job %u.%u can not be signed",
+		      cred->jobid, cred->stepid);
+	}
+
+	slurm_mutex_lock(&cred->mutex);
+	cred->signature = sig;
+	cred->siglen = siglen;
+	cred->sign_pending = false;
+	pthread_cond_broadcast(&cred->sign_cond);
+	slurm_mutex_unlock(&cred->mutex);
+
+	usec = _usec_since(&req->queued);
+	slurm_mutex_lock(&cred_stats_mutex);
+	cred_stats.sign_queue--;
+	cred_stats.sign_wait += usec;
+	slurm_mutex_unlock(&cred_stats_mutex);
+	xfree(req);
+}
+
+/*
+ * Signer thread. Crypto plugins keep state in their keys (a munge context
+ * for crypto/munge), so each thread signs with its own copy of the key.
+ */
+static void *
+_sign_thread(void *arg)
+{
+	slurm_cred_ctx_t ctx = (slurm_cred_ctx_t) arg;
+	sign_req_t *reqs[SIGN_BATCH_MAX];
+	void *key = NULL;
+	uint32_t key_gen = 0;
+	char *path;
+	int i, cnt;
+
+	while (1) {
+		slurm_mutex_lock(&ctx->sign_mutex);
+		while (!ctx->sign_shutdown && !list_count(ctx->sign_list))
+			pthread_cond_wait(&ctx->sign_cond, &ctx->sign_mutex);
+		for (cnt = 0; cnt < SIGN_BATCH_MAX; cnt++) {
+			if (!(reqs[cnt] = list_dequeue(ctx->sign_list)))
+				break;
+		}
+		slurm_mutex_unlock(&ctx->sign_mutex);
+		if (cnt == 0)	/* shutdown and the queue is empty */
+			break;
+
+		slurm_mutex_lock(&ctx->mutex);
+		if (key && (key_gen == ctx->key_gen)) {
+			slurm_mutex_unlock(&ctx->mutex);
+		} else {
+			path = xstrdup(ctx->key_path);
+			key_gen = ctx->key_gen;
+			slurm_mutex_unlock(&ctx->mutex);
+			if (key)
+				(*(ops.crypto_destroy_key))(key);
+			key = (*(ops.crypto_read_private_key))(path);
+			if (!key)
+				error("%s: can not read key %s", __func__,
+				      path);
+			xfree(path);
+		}
+
+		for (i = 0; i < cnt; i++)
+			_sign_one(ctx, key, reqs[i]);
 	}
+
+	if (key)
+		(*(ops.crypto_destroy_key))(key);
+	return NULL;
+}
+
+static void
+_sign_threads_start(slurm_cred_ctx_t ctx)
+{
+	pthread_attr_t attr;
+	int i;
+
+	slurm_mutex_lock(&ctx->sign_mutex);
+	if (ctx->sign_tids || (cred_sign_threads == 0)) {
+		slurm_mutex_unlock(&ctx->sign_mutex);
+		return;
+	}
+	ctx->sign_list = list_create(NULL);
+	ctx->sign_tids = xmalloc(sizeof(pthread_t) * cred_sign_threads);
+	for (i = 0; i < cred_sign_threads; i++) {
+		slurm_attr_init(&attr);
+		if (pthread_create(&ctx->sign_tids[i], &attr, _sign_thread,
+				   ctx))
+			fatal("pthread_create: %m");
+		slurm_attr_destroy(&attr);
+	}
+	ctx->sign_thread_cnt = cred_sign_threads;
+	slurm_mutex_unlock(&ctx->sign_mutex);
+	debug("%s: %d credential signer threads", __func__,
+	      cred_sign_threads);
+}
+
+static void
+_sign_threads_stop(slurm_cred_ctx_t ctx)
+{
+	int i;
+
+	slurm_mutex_lock(&ctx->sign_mutex);
+	if (!ctx->sign_tids) {
+		slurm_mutex_unlock(&ctx->sign_mutex);
+		return;
+	}
+	ctx->sign_shutdown = true;
+	pthread_cond_broadcast(&ctx->sign_cond);
+	slurm_mutex_unlock(&ctx->sign_mutex);
+
+	for (i = 0; i < ctx->sign_thread_cnt; i++)
+		pthread_join(ctx->sign_tids[i], NULL);
+
+	slurm_mutex_lock(&ctx->sign_mutex);
+	ctx->sign_thread_cnt = 0;
+	xfree(ctx->sign_tids);
+	FREE_NULL_LIST(ctx->sign_list);
+	slurm_mutex_unlock(&ctx->sign_mutex);
+}
+
+/* Queue cred for the signer threads. Called with cred->mutex locked.
+ * RET false if ctx has no signer threads, so the caller must sign it */
+static bool
+_sign_queue(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+	    uint16_t protocol_version)
+{
+	sign_req_t *req;
+
+	slurm_mutex_lock(&ctx->sign_mutex);
+	if (!ctx->sign_list || ctx->sign_shutdown) {
+		slurm_mutex_unlock(&ctx->sign_mutex);
+		return false;
+	}
+	req = xmalloc(sizeof(sign_req_t));
+	req->cred = cred;
+	req->protocol_version = protocol_version;
+	gettimeofday(&req->queued, NULL);
+	cred->sign_pending = true;
+	list_enqueue(ctx->sign_list, req);
+	pthread_cond_signal(&ctx->sign_cond);
+	slurm_mutex_unlock(&ctx->sign_mutex);
+
+	slurm_mutex_lock(&cred_stats_mutex);
+	cred_stats.sign_queue++;
+	slurm_mutex_unlock(&cred_stats_mutex);
+
+	return true;
+}
+
+/* Wait for a signer thread to sign cred. Called with cred->mutex locked.
+ * RET SLURM_SUCCESS or SLURM_ERROR if cred could not be signed */
+static int
+_wait_signed(slurm_cred_t *cred)
+{
+	while (cred->sign_pending)
+		pthread_cond_wait(&cred->sign_cond, &cred->mutex);
+	if (!cred->signature || (cred->siglen == 0))
+		return SLURM_ERROR;
 	return SLURM_SUCCESS;
 }
 
@@ -1703,25 +2090,69 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 {
 	Buf            buffer;
 	int            rc;
+	verify_cache_t *cache = NULL;
+	uint64_t       digest = 0, usec;
+	struct timeval tv;
+	bool           hit = false;
 
 	debug("Checking credential with %u bytes of sig data", cred->siglen);
+	gettimeofday(&tv, NULL);
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer, protocol_version);
 
-	rc = (*(ops.crypto_verify_sign))(ctx->key,
-					 get_buf_data(buffer),
-					 get_buf_offset(buffer),
-					 cred->signature,
-					 cred->siglen);
-	if (rc && _exkey_is_valid(ctx)) {
-		rc = (*(ops.crypto_verify_sign))(ctx->exkey,
+	/*
+	 * A credential may be verified more than once, e.g. on a retried
+	 * launch (crypto/munge would reject those as replayed). Replays are
+	 * caught by _credential_replayed().
+	 */
+	if (ctx->verify_cache) {
+		siphash((uint8_t *) &digest, (uint8_t *) get_buf_data(buffer),
+			get_buf_offset(buffer), verify_hash_key);
+		cache = &ctx->verify_cache[digest % VERIFY_CACHE_SIZE];
+		hit = (cache->signature && (cache->digest == digest) &&
+		       (cache->expiration >= time(NULL)) &&
+		       (cache->siglen == cred->siglen) &&
+		       !memcmp(cache->signature, cred->signature,
+			       cred->siglen));
+	}
+
+	if (hit) {
+		rc = 0;
+	} else {
+		rc = (*(ops.crypto_verify_sign))(ctx->key,
 						 get_buf_data(buffer),
 						 get_buf_offset(buffer),
 						 cred->signature,
 						 cred->siglen);
+		if (rc && _exkey_is_valid(ctx)) {
+			rc = (*(ops.crypto_verify_sign))(ctx->exkey,
+							 get_buf_data(buffer),
+							 get_buf_offset(buffer),
+							 cred->signature,
+							 cred->siglen);
+		}
 	}
 	free_buf(buffer);
 
+	if (!rc && !hit && cache) {
+		xfree(cache->signature);
+		cache->digest = digest;
+		cache->expiration = cred->ctime + ctx->expiry_window;
+		cache->siglen = cred->siglen;
+		cache->signature = xmalloc(cred->siglen);
+		memcpy(cache->signature, cred->signature, cred->siglen);
+	}
+
+	usec = _usec_since(&tv);
+	slurm_mutex_lock(&cred_stats_mutex);
+	cred_stats.verify_cnt++;
+	if (hit)
+		cred_stats.verify_hits++;
+	cred_stats.verify_time += usec;
+	if (usec > cred_stats.verify_max)
+		cred_stats.verify_max = usec;
+	slurm_mutex_unlock(&cred_stats_mutex);
+
 	if (rc) {
 		error("Credential signature check: %s",
 		      (*(ops.crypto_str_error))(rc));
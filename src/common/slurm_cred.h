@@ -98,7 +98,8 @@ slurm_cred_ctx_t slurm_cred_verifier_ctx_create(const char *pubkey);
  *
  */
 typedef enum {
-	SLURM_CRED_OPT_EXPIRY_WINDOW /* expiration time of creds (int );  */
+	SLURM_CRED_OPT_EXPIRY_WINDOW,/* expiration time of creds (int );  */
+	SLURM_CRED_OPT_SIGN_ASYNC    /* sign creds on a thread pool (int) */
 } slurm_cred_opt_t;
 
 int slurm_cred_ctx_set(slurm_cred_ctx_t ctx, slurm_cred_opt_t opt, ...);
@@ -172,9 +173,33 @@ int slurm_crypto_init(void);
 /* Terminate the plugin and release all memory. */
 int slurm_crypto_fini(void);
 
+/* Credential signing and verification statistics, for this process */
+typedef struct {
+	uint32_t sign_cnt;	/* credentials signed */
+	uint32_t sign_queue;	/* credentials waiting for a signer thread */
+	uint64_t sign_time;	/* usec spent signing */
+	uint64_t sign_max;	/* longest signature, usec */
+	uint64_t sign_wait;	/* usec from creation to signed, with
+				 * SLURM_CRED_OPT_SIGN_ASYNC */
+	uint32_t verify_cnt;	/* credentials verified */
+	uint32_t verify_hits;	/* of which already verified */
+	uint64_t verify_time;	/* usec spent verifying */
+	uint64_t verify_max;	/* longest verification, usec */
+} slurm_cred_stats_t;
+
+extern void slurm_cred_get_stats(slurm_cred_stats_t *stats);
+extern void slurm_cred_reset_stats(void);
+/* Pack signing statistics for sdiag */
+extern void slurm_cred_pack_stats(Buf buffer, uint16_t protocol_version);
+
 /*
  * Create a slurm credential using the values in `arg.'
  * The credential is signed using the creators public key.
+ * With SLURM_CRED_OPT_SIGN_ASYNC set in `ctx', the credential is signed
+ * by a pool of threads instead, and functions which need its signature
+ * (slurm_cred_pack() and the like) wait for it. If a thread can not sign
+ * it, slurm_cred_get_signature() fails and slurm_cred_pack() packs an empty
+ * signature, which slurm_cred_unpack() rejects.
  *
  * `arg' must be non-NULL and have valid values. The arguments
  * will be copied as is into the slurm job credential.
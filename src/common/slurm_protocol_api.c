@@ -3342,20 +3342,12 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
-	header_t header;
 	int rc;
-	void *auth_cred = NULL;
-	slurm_msg_t msg;
-	Buf buffer;
-	ret_data_info_t *ret_data_info = NULL;
 	List ret_list = NULL;
 	int orig_timeout = timeout;
 
 	xassert(fd >= 0);
 
-	slurm_msg_t_init(&msg);
-	msg.conn_fd = fd;
-
 	if (timeout <= 0) {
 		/* convert secs to msec */
 		timeout  = slurm_get_msg_timeout() * 1000;
@@ -3394,15 +3386,45 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 	 *  the message.
 	 */
 	if (slurm_msg_recvfrom_timeout(fd, &buf, &buflen, 0, timeout) < 0) {
-		forward_init(&header.forward, NULL);
 		rc = errno;
-		goto total_return;
+		error("slurm_receive_msgs: %s", slurm_strerror(rc));
+		usleep(10000);	/* Discourage brute force attack */
+		errno = rc;
+		return NULL;
 	}
 
 #if	_DEBUG
 	_print_data (buf, buflen);
 #endif
-	buffer = create_buf(buf, buflen);
+	ret_list = slurm_unpack_received_msgs(fd, create_buf(buf, buflen));
+	if (errno != SLURM_SUCCESS) {
+		rc = errno;
+		usleep(10000);	/* Discourage brute force attack */
+		errno = rc;
+	}
+
+	return ret_list;
+}
+
+/*
+ * Unpack a complete message received by slurm_receive_msgs() or read by the
+ *	caller, along with the responses of any nodes it was forwarded to
+ * IN fd	- file descriptor the message came from, used for logging,
+ *		  or -1 if no longer open
+ * IN buffer	- message, without its length prefix, freed by this function
+ * RET List	- as for slurm_receive_msgs(), errno is set to the result
+ */
+List slurm_unpack_received_msgs(int fd, Buf buffer)
+{
+	header_t header;
+	int rc;
+	void *auth_cred = NULL;
+	slurm_msg_t msg;
+	ret_data_info_t *ret_data_info = NULL;
+	List ret_list = NULL;
+
+	slurm_msg_t_init(&msg);
+	msg.conn_fd = fd;
 
 	if (unpack_header(&header, buffer) == SLURM_ERROR) {
 		free_buf(buffer);
@@ -3414,7 +3436,7 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 		slurm_addr_t resp_addr;
 		char addr_str[32];
 		int uid = _unpack_msg_uid(buffer);
-		if (!slurm_get_peer_addr(fd, &resp_addr)) {
+		if ((fd >= 0) && !slurm_get_peer_addr(fd, &resp_addr)) {
 			slurm_print_slurm_addr(
 				&resp_addr, addr_str, sizeof(addr_str));
 			error("Invalid Protocol Version %u from uid=%d at %s",
@@ -3501,7 +3523,6 @@ total_return:
 			list_push(ret_list, ret_data_info);
 		}
 		error("slurm_receive_msgs: %s", slurm_strerror(rc));
-		usleep(10000);	/* Discourage brute force attack */
 	} else {
 		if (!ret_list)
 			ret_list = list_create(destroy_data_info);
@@ -3774,13 +3795,97 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
 	set_buf_offset(buffer, tmplen);
 }
 
+/* Create an authentication credential for a message */
+static void *_create_auth_cred(slurm_msg_t *msg)
+{
+	void *auth_cred;
+
+	if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
+		auth_cred = g_slurm_auth_create(NULL, 2, _global_auth_key());
+	} else {
+		char *auth_info = slurm_get_auth_info();
+		auth_cred = g_slurm_auth_create(NULL, 2, auth_info);
+		xfree(auth_info);
+	}
+	return auth_cred;
+}
+
+/* Pack a message's header, authentication credential and body. The
+ * credential is destroyed.
+ * RET buffer or NULL on error with errno set */
+static Buf _pack_node_msg(slurm_msg_t *msg, void *auth_cred)
+{
+	header_t header;
+	Buf      buffer;
+	int      rc;
+
+	if (auth_cred == NULL) {
+		error("authentication: %s",
+		      g_slurm_auth_errstr(g_slurm_auth_errno(NULL)) );
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
+	}
+
+	init_header(&header, msg, msg->flags);
+
+	/*
+	 * Pack header into buffer for transmission
+	 */
+	buffer = init_buf(BUF_SIZE);
+	pack_header(&header, buffer);
+
+	/*
+	 * Pack auth credential
+	 */
+	rc = g_slurm_auth_pack(auth_cred, buffer);
+	(void) g_slurm_auth_destroy(auth_cred);
+	if (rc) {
+		error("authentication: %s",
+		      g_slurm_auth_errstr(g_slurm_auth_errno(auth_cred)));
+		free_buf(buffer);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
+	}
+
+	/*
+	 * Pack message into buffer
+	 */
+	_pack_msg(msg, &header, buffer);
+
+	return buffer;
+}
+
+/*
+ * Pack a message for a node as slurm_send_node_msg() would send it, less
+ *	its length prefix, for the caller to send
+ * IN msg - message to pack, not using a persistent connection
+ * RET buffer to be freed by the caller or NULL on error with errno set
+ */
+extern Buf slurm_pack_node_msg(slurm_msg_t *msg)
+{
+	void *auth_cred;
+
+	xassert(!msg->conn);
+
+	auth_cred = _create_auth_cred(msg);
+
+	if (msg->forward.init != FORWARD_INIT) {
+		forward_init(&msg->forward, NULL);
+		msg->ret_list = NULL;
+	}
+
+	if (!msg->forward.tree_width)
+		msg->forward.tree_width = slurm_get_tree_width();
+
+	return _pack_node_msg(msg, auth_cred);
+}
+
 /*
  *  Send a slurm message over an open file descriptor `fd'
  *    Returns the size of the message sent in bytes, or -1 on failure.
  */
 int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 {
-	header_t header;
 	Buf      buffer;
 	int      rc;
 	void *   auth_cred;
@@ -3823,13 +3928,7 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	 * but we may need to generate the credential again later if we
 	 * wait too long for the incoming message.
 	 */
-	if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
-		auth_cred = g_slurm_auth_create(NULL, 2, _global_auth_key());
-	} else {
-		char *auth_info = slurm_get_auth_info();
-		auth_cred = g_slurm_auth_create(NULL, 2, auth_info);
-		xfree(auth_info);
-	}
+	auth_cred = _create_auth_cred(msg);
 
 	if (msg->forward.init != FORWARD_INIT) {
 		forward_init(&msg->forward, NULL);
@@ -3843,45 +3942,11 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 
 	if (difftime(time(NULL), start_time) >= 60) {
 		(void) g_slurm_auth_destroy(auth_cred);
-		if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
-			auth_cred = g_slurm_auth_create(NULL, 2,
-							_global_auth_key());
-		} else {
-			char *auth_info = slurm_get_auth_info();
-			auth_cred = g_slurm_auth_create(NULL, 2, auth_info);
-			xfree(auth_info);
-		}
-	}
-	if (auth_cred == NULL) {
-		error("authentication: %s",
-		      g_slurm_auth_errstr(g_slurm_auth_errno(NULL)) );
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
-	}
-
-	init_header(&header, msg, msg->flags);
-
-	/*
-	 * Pack header into buffer for transmission
-	 */
-	buffer = init_buf(BUF_SIZE);
-	pack_header(&header, buffer);
-
-	/*
-	 * Pack auth credential
-	 */
-	rc = g_slurm_auth_pack(auth_cred, buffer);
-	(void) g_slurm_auth_destroy(auth_cred);
-	if (rc) {
-		error("authentication: %s",
-		      g_slurm_auth_errstr(g_slurm_auth_errno(auth_cred)));
-		free_buf(buffer);
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		auth_cred = _create_auth_cred(msg);
 	}
 
-	/*
-	 * Pack message into buffer
-	 */
-	_pack_msg(msg, &header, buffer);
+	if (!(buffer = _pack_node_msg(msg, auth_cred)))
+		return SLURM_ERROR;
 
 #if	_DEBUG
 	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
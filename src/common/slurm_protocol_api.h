@@ -1023,6 +1023,16 @@ int slurm_receive_msg(int fd, slurm_msg_t *msg, int timeout);
  */
 List slurm_receive_msgs(int fd, int steps, int timeout);
 
+/*
+ * Unpack a complete message received by slurm_receive_msgs() or read by the
+ *	caller, along with the responses of any nodes it was forwarded to
+ * IN fd	- file descriptor the message came from, used for logging,
+ *		  or -1 if no longer open
+ * IN buffer	- message, without its length prefix, freed by this function
+ * RET List	- as for slurm_receive_msgs(), errno is set to the result
+ */
+List slurm_unpack_received_msgs(int fd, Buf buffer);
+
 /*
  *  Receive a slurm message on the open slurm descriptor "fd" waiting
  *    at most "timeout" seconds for the message data. This will also
@@ -1055,6 +1065,14 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(int open_fd, slurm_msg_t *msg);
 
+/*
+ * Pack a message for a node as slurm_send_node_msg() would send it, less
+ *	its length prefix, for the caller to send
+ * IN msg - message to pack, not using a persistent connection
+ * RET buffer to be freed by the caller or NULL on error with errno set
+ */
+extern Buf slurm_pack_node_msg(slurm_msg_t *msg);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
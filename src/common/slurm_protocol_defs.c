@@ -695,6 +695,15 @@ extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg)
 	xfree(msg);
 }
 
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_job_info_msg(msg->job_info_msg);
+		xfree(msg->purge_job_ids);
+		xfree(msg);
+	}
+}
+
 extern void slurm_free_job_step_info_request_msg(job_step_info_request_msg_t *msg)
 {
 	xfree(msg);
@@ -1406,13 +1415,46 @@ extern void slurm_free_suspend_int_msg(suspend_int_msg_t *msg)
 
 extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 {
+	uint32_t i;
+
 	if (msg) {
 		xfree(msg->rpc_type_id);
 		xfree(msg->rpc_type_cnt);
 		xfree(msg->rpc_type_time);
+		xfree(msg->rpc_type_queue_depth);
+		xfree(msg->rpc_type_queue_time);
 		xfree(msg->rpc_user_id);
 		xfree(msg->rpc_user_cnt);
 		xfree(msg->rpc_user_time);
+		if (msg->lock_name) {
+			for (i = 0; i < msg->lock_size; i++)
+				xfree(msg->lock_name[i]);
+			xfree(msg->lock_name);
+		}
+		xfree(msg->lock_cnt);
+		xfree(msg->lock_wait_cnt);
+		xfree(msg->lock_wait_time);
+		xfree(msg->lock_hold_time);
+		if (msg->lock_site_name) {
+			for (i = 0; i < msg->lock_site_size; i++)
+				xfree(msg->lock_site_name[i]);
+			xfree(msg->lock_site_name);
+		}
+		xfree(msg->lock_site_cnt);
+		xfree(msg->lock_site_wait_time);
+		xfree(msg->lock_site_wait_max);
+		xfree(msg->lock_site_hold_time);
+		xfree(msg->lock_site_hold_max);
+		if (msg->state_file_name) {
+			for (i = 0; i < msg->state_file_size; i++)
+				xfree(msg->state_file_name[i]);
+			xfree(msg->state_file_name);
+		}
+		xfree(msg->state_file_cnt);
+		xfree(msg->state_file_bytes);
+		xfree(msg->state_file_time);
+		xfree(msg->state_file_max);
+		xfree(msg->agent_rpc_hist);
 		xfree(msg);
 	}
 }
@@ -4393,6 +4435,8 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_FED_INFO";
 	case RESPONSE_FED_INFO:
 		return "RESPONSE_FED_INFO";
+	case RESPONSE_JOB_INFO_DELTA:
+		return "RESPONSE_JOB_INFO_DELTA";
 
 	case REQUEST_UPDATE_JOB:				/* 3001 */
 		return "REQUEST_UPDATE_JOB";
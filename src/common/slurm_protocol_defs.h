@@ -247,6 +247,7 @@ typedef enum {
 	RESPONSE_LAYOUT_INFO,
 	REQUEST_FED_INFO,
 	RESPONSE_FED_INFO,		/* 2050 */
+	RESPONSE_JOB_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -594,6 +595,12 @@ typedef struct job_info_request_msg {
 	uint16_t show_flags;
 } job_info_request_msg_t;
 
+typedef struct job_info_delta_msg {
+	job_info_msg_t *job_info_msg;	/* jobs to add or replace */
+	uint32_t purge_cnt;
+	uint32_t *purge_job_ids;	/* jobs to remove */
+} job_info_delta_msg_t;
+
 typedef struct job_step_info_request_msg {
 	time_t last_update;
 	uint32_t job_id;
@@ -1111,6 +1118,10 @@ typedef struct file_bcast_msg {
 	uint32_t block_len;	/* length of this data block */
 	uint32_t block_offset;	/* offset for this data block */
 	uint32_t uncomp_len;	/* uncompressed length of this data block */
+	uint32_t block_cksum;	/* checksum of uncompressed block data,
+				 * zero if not computed */
+	uint64_t file_hash;	/* hash of whole file for the slurmd sbcast
+				 * cache, zero if not computed */
 	char *block;		/* data for this block */
 	uint64_t file_size;	/* file size */
 } file_bcast_msg_t;
@@ -1272,6 +1283,7 @@ extern void slurm_free_last_update_msg(last_update_msg_t * msg);
 extern void slurm_free_return_code_msg(return_code_msg_t * msg);
 extern void slurm_free_job_alloc_info_msg(job_alloc_info_msg_t * msg);
 extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg);
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg);
 extern void slurm_free_job_step_info_request_msg(
 		job_step_info_request_msg_t *msg);
 extern void slurm_free_front_end_info_request_msg(
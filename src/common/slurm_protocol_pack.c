@@ -457,6 +457,8 @@ static void _pack_job_desc_msg(job_desc_msg_t * job_desc_ptr, Buf buffer,
 static int _unpack_job_desc_msg(job_desc_msg_t ** job_desc_buffer_ptr,
 				Buf buffer,
 				uint16_t protocol_version);
+static int _unpack_job_info_delta_msg(job_info_delta_msg_t **msg, Buf buffer,
+				      uint16_t protocol_version);
 static int _unpack_job_info_msg(job_info_msg_t ** msg, Buf buffer,
 				uint16_t protocol_version);
 
@@ -1062,6 +1064,7 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					 msg->protocol_version);
 		break;
 	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_INFO_DELTA:
 		_pack_job_info_msg((slurm_msg_t *) msg, buffer);
 		break;
 	case RESPONSE_PARTITION_INFO:
@@ -1737,6 +1740,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					  buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg(
+			(job_info_delta_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case RESPONSE_PARTITION_INFO:
 		rc = _unpack_partition_info_msg((partition_info_msg_t **) &
 						(msg->data), buffer,
@@ -6042,6 +6050,33 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Unpack RESPONSE_JOB_INFO_DELTA, as packed by pack_all_jobs_delta() */
+static int
+_unpack_job_info_delta_msg(job_info_delta_msg_t **msg, Buf buffer,
+			   uint16_t protocol_version)
+{
+	xassert(msg != NULL);
+	*msg = xmalloc(sizeof(job_info_delta_msg_t));
+
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack32_array(&(*msg)->purge_job_ids,
+				    &(*msg)->purge_cnt, buffer);
+		if (_unpack_job_info_msg(&(*msg)->job_info_msg, buffer,
+					 protocol_version))
+			goto unpack_error;
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_msg(*msg);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 /* Translate bitmap representation from hex to decimal format, replacing
  * array_task_str and store the bitmap in job->array_bitmap. */
 static void _xlate_task_str(job_info_t *job_ptr)
@@ -13625,7 +13660,30 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 
 	grow_buf(buffer,  msg->block_len);
 
-	if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		pack16(msg->block_no, buffer);
+		pack16(msg->compress, buffer);
+		pack16(msg->last_block, buffer);
+		pack16(msg->force, buffer);
+		pack16(msg->modes, buffer);
+
+		pack32(msg->uid, buffer);
+		packstr(msg->user_name, buffer);
+		pack32(msg->gid, buffer);
+
+		pack_time(msg->atime, buffer);
+		pack_time(msg->mtime, buffer);
+
+		packstr(msg->fname, buffer);
+		pack32(msg->block_len, buffer);
+		pack32(msg->uncomp_len, buffer);
+		pack32(msg->block_offset, buffer);
+		pack32(msg->block_cksum, buffer);
+		pack64(msg->file_hash, buffer);
+		pack64(msg->file_size, buffer);
+		packmem(msg->block, msg->block_len, buffer);
+		pack_sbcast_cred(msg->cred, buffer);
+	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		pack16 ( msg->block_no, buffer );
 		pack16 ( msg->compress, buffer );
 		pack16 ( msg->last_block, buffer );
@@ -13677,7 +13735,35 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 	msg = xmalloc ( sizeof (file_bcast_msg_t) ) ;
 	*msg_ptr = msg;
 
-	if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack16(&msg->block_no, buffer);
+		safe_unpack16(&msg->compress, buffer);
+		safe_unpack16(&msg->last_block, buffer);
+		safe_unpack16(&msg->force, buffer);
+		safe_unpack16(&msg->modes, buffer);
+
+		safe_unpack32(&msg->uid, buffer);
+		safe_unpackstr_xmalloc(&msg->user_name, &uint32_tmp, buffer);
+		safe_unpack32(&msg->gid, buffer);
+
+		safe_unpack_time(&msg->atime, buffer);
+		safe_unpack_time(&msg->mtime, buffer);
+
+		safe_unpackstr_xmalloc(&msg->fname, &uint32_tmp, buffer);
+		safe_unpack32(&msg->block_len, buffer);
+		safe_unpack32(&msg->uncomp_len, buffer);
+		safe_unpack32(&msg->block_offset, buffer);
+		safe_unpack32(&msg->block_cksum, buffer);
+		safe_unpack64(&msg->file_hash, buffer);
+		safe_unpack64(&msg->file_size, buffer);
+		safe_unpackmem_xmalloc(&msg->block, &uint32_tmp, buffer);
+		if (uint32_tmp != msg->block_len)
+			goto unpack_error;
+
+		msg->cred = unpack_sbcast_cred(buffer);
+		if (msg->cred == NULL)
+			goto unpack_error;
+	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		safe_unpack16 ( & msg->block_no, buffer );
 		safe_unpack16 ( & msg->compress, buffer );
 		safe_unpack16 ( & msg->last_block, buffer );
@@ -14040,6 +14126,11 @@ static void _pack_slurmd_status(slurmd_status_t *msg, Buf buffer,
 		packstr(msg->slurmd_logfile, buffer);
 		packstr(msg->step_list, buffer);
 		packstr(msg->version, buffer);
+
+		pack32(msg->cred_verify_cnt, buffer);
+		pack32(msg->cred_verify_hits, buffer);
+		pack64(msg->cred_verify_time, buffer);
+		pack64(msg->cred_verify_max, buffer);
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		pack_time(msg->booted, buffer);
 		pack_time(msg->last_slurmctld_msg, buffer);
@@ -14098,6 +14189,11 @@ static int _unpack_slurmd_status(slurmd_status_t **msg_ptr, Buf buffer,
 					&uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&msg->version,
 					&uint32_tmp, buffer);
+
+		safe_unpack32(&msg->cred_verify_cnt, buffer);
+		safe_unpack32(&msg->cred_verify_hits, buffer);
+		safe_unpack64(&msg->cred_verify_time, buffer);
+		safe_unpack64(&msg->cred_verify_max, buffer);
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		uint32_t tmp_mem;
 		safe_unpack_time(&msg->booted, buffer);
@@ -14638,17 +14734,109 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 			safe_unpack32(&msg->bf_depth_try_sum,	buffer);
 			safe_unpack32(&msg->bf_queue_len_sum,	buffer);
 			safe_unpack32(&msg->bf_active,		buffer);
+
+			if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->rpc_worker_cnt,	buffer);
+				safe_unpack32(&msg->rpc_queue_len,	buffer);
+				safe_unpack32(&msg->rpc_queue_max,	buffer);
+
+				safe_unpack32(&msg->bf_table_size,	buffer);
+				safe_unpack32(&msg->bf_table_size_sum,	buffer);
+				safe_unpack32(&msg->bf_table_add_cnt,	buffer);
+				safe_unpack64(&msg->bf_table_add_time,	buffer);
+				safe_unpack32(&msg->bf_table_find_cnt,	buffer);
+				safe_unpack64(&msg->bf_table_find_time,	buffer);
+			}
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
 		safe_unpack16_array(&msg->rpc_type_id,   &uint32_tmp, buffer);
 		safe_unpack32_array(&msg->rpc_type_cnt,  &uint32_tmp, buffer);
 		safe_unpack64_array(&msg->rpc_type_time, &uint32_tmp, buffer);
+		if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+			safe_unpack32_array(&msg->rpc_type_queue_depth,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->rpc_type_queue_time,
+					    &uint32_tmp, buffer);
+		}
 
 		safe_unpack32(&msg->rpc_user_size,		buffer);
 		safe_unpack32_array(&msg->rpc_user_id,   &uint32_tmp, buffer);
 		safe_unpack32_array(&msg->rpc_user_cnt,  &uint32_tmp, buffer);
 		safe_unpack64_array(&msg->rpc_user_time, &uint32_tmp, buffer);
+
+		if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+			safe_unpack32(&msg->lock_size,		buffer);
+			safe_unpackstr_array(&msg->lock_name, &uint32_tmp,
+					     buffer);
+			if (uint32_tmp != msg->lock_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->lock_cnt, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != (msg->lock_size * 2))
+				goto unpack_error;
+			safe_unpack32_array(&msg->lock_wait_cnt, &uint32_tmp,
+					    buffer);
+			safe_unpack64_array(&msg->lock_wait_time, &uint32_tmp,
+					    buffer);
+			safe_unpack64_array(&msg->lock_hold_time, &uint32_tmp,
+					    buffer);
+
+			safe_unpack32(&msg->lock_site_size,	buffer);
+			safe_unpackstr_array(&msg->lock_site_name,
+					     &uint32_tmp, buffer);
+			if (uint32_tmp != msg->lock_site_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->lock_site_cnt, &uint32_tmp,
+					    buffer);
+			safe_unpack64_array(&msg->lock_site_wait_time,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->lock_site_wait_max,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->lock_site_hold_time,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->lock_site_hold_max,
+					    &uint32_tmp, buffer);
+
+			safe_unpack32(&msg->state_file_size,	buffer);
+			safe_unpackstr_array(&msg->state_file_name,
+					     &uint32_tmp, buffer);
+			if (uint32_tmp != msg->state_file_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->state_file_cnt, &uint32_tmp,
+					    buffer);
+			safe_unpack32_array(&msg->state_file_bytes,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->state_file_time,
+					    &uint32_tmp, buffer);
+			safe_unpack64_array(&msg->state_file_max, &uint32_tmp,
+					    buffer);
+
+			safe_unpack32(&msg->agent_rpc_active,	buffer);
+			safe_unpack32(&msg->agent_rpc_queued,	buffer);
+			safe_unpack32(&msg->agent_rpc_max,	buffer);
+			safe_unpack32(&msg->agent_rpc_cnt,	buffer);
+			safe_unpack32(&msg->agent_rpc_fail,	buffer);
+			safe_unpack32(&msg->agent_rpc_timeout,	buffer);
+			safe_unpack32(&msg->agent_rpc_retry,	buffer);
+			safe_unpack32_array(&msg->agent_rpc_hist,
+					    &msg->agent_rpc_hist_size, buffer);
+
+			safe_unpack32(&msg->dbd_agent_queue_size, buffer);
+			safe_unpack32(&msg->dbd_agent_spool_cnt, buffer);
+			safe_unpack64(&msg->dbd_agent_spool_bytes, buffer);
+			safe_unpack32(&msg->dbd_agent_dropped,	buffer);
+			safe_unpack32(&msg->dbd_agent_batch_cnt, buffer);
+			safe_unpack32(&msg->dbd_agent_msg_cnt,	buffer);
+			safe_unpack64(&msg->dbd_agent_batch_time, buffer);
+			safe_unpack64(&msg->dbd_agent_batch_max, buffer);
+
+			safe_unpack32(&msg->cred_sign_cnt,	buffer);
+			safe_unpack32(&msg->cred_sign_queue,	buffer);
+			safe_unpack64(&msg->cred_sign_time,	buffer);
+			safe_unpack64(&msg->cred_sign_max,	buffer);
+			safe_unpack64(&msg->cred_sign_wait,	buffer);
+		}
 	} else {
 		error("_unpack_stats_response_msg: protocol_version "
 		      "%hu not supported", protocol_version);
@@ -188,6 +188,15 @@
 #define	list_delete_item	slurm_list_delete_item
 #define	list_install_fork_handlers slurm_list_install_fork_handlers
 
+/* id_hash.[ch] functions */
+#define	id_hash_init		slurm_id_hash_init
+#define	id_hash_free		slurm_id_hash_free
+#define	id_hash_add		slurm_id_hash_add
+#define	id_hash_find		slurm_id_hash_find
+#define	id_hash_remove		slurm_id_hash_remove
+#define	id_hash_count		slurm_id_hash_count
+#define	id_hash_probes		slurm_id_hash_probes
+
 /* log.[ch] functions */
 #define	log_init		slurm_log_init
 #define	log_reinit		slurm_log_reinit
@@ -405,6 +414,7 @@
 #define eio_handle_create		slurm_eio_handle_create
 #define eio_handle_destroy		slurm_eio_handle_destroy
 #define eio_handle_mainloop		slurm_eio_handle_mainloop
+#define eio_handle_set_backend		slurm_eio_handle_set_backend
 #define eio_message_socket_accept	slurm_eio_message_socket_accept
 #define eio_message_socket_readable	slurm_eio_message_socket_readable
 #define eio_new_obj			slurm_eio_new_obj
@@ -4081,6 +4081,8 @@ extern void slurmdb_destroy_stats_rec(void *object)
 		xfree(rpc_stats->rollup_count);
 		xfree(rpc_stats->rollup_time);
 		xfree(rpc_stats->rollup_max_time);
+		xfree(rpc_stats->rollup_units);
+		xfree(rpc_stats->rollup_max_unit_time);
 
 		xfree(rpc_stats->rpc_type_id);
 		xfree(rpc_stats->rpc_type_cnt);
@@ -5719,6 +5719,8 @@ extern void slurmdb_pack_stats_msg(void *object, uint16_t protocol_version,
 		pack16_array(stats_ptr->rollup_count,    i, buffer);
 		pack64_array(stats_ptr->rollup_time,     i, buffer);
 		pack64_array(stats_ptr->rollup_max_time, i, buffer);
+		pack64_array(stats_ptr->rollup_units,    i, buffer);
+		pack64_array(stats_ptr->rollup_max_unit_time, i, buffer);
 
 		/* RPC type statistics */
 		for (i = 0; i < stats_ptr->type_cnt; i++) {
@@ -5770,6 +5772,14 @@ extern int slurmdb_unpack_stats_msg(void **object, uint16_t protocol_version,
 				    buffer);
 		if (uint32_tmp != 3)
 			goto unpack_error;
+		safe_unpack64_array(&stats_ptr->rollup_units, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != 3)
+			goto unpack_error;
+		safe_unpack64_array(&stats_ptr->rollup_max_unit_time,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != 3)
+			goto unpack_error;
 
 		/* RPC type statistics */
 		safe_unpack32(&stats_ptr->type_cnt, buffer);
@@ -77,6 +77,12 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurmdb_slurmdbd_free_id_rc_msg);
 #define DBD_MAGIC		0xDEAD3219
 #define MAX_AGENT_QUEUE		10000
 #define MAX_DBD_MSG_LEN		16384
+#define MAX_DBD_BATCH_CNT	2000	/* Messages in one DBD_SEND_MULT_MSG */
+#define MAX_DBD_BATCH_SIZE	(4 * 1024 * 1024) /* and their total bytes */
+#define MAX_DBD_BATCHES		40	/* Batches sent per _send_mult_msgs() */
+#define DBD_AGENT_WINDOW	4	/* Batches sent ahead of their replies */
+#define MAX_DBD_SPOOL_SIZE	((off_t) 1024 * 1024 * 1024) /* Bytes spooled
+							       * to disk */
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
 
 uint16_t running_cache = 0;
@@ -87,6 +93,28 @@ static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
 static List      agent_list     = (List) NULL;
 static pthread_t agent_tid      = 0;
+static uint32_t  agent_skipped  = 0;	/* Messages at the head of agent_list
+					 * slurmdbd failed to process */
+static uint32_t  agent_in_flight = 0;	/* Messages following those sent but
+					 * not yet acknowledged */
+static bool      agent_serial    = false; /* Send one batch at a time after
+					   * a failure, until agent_list
+					   * drains */
+
+/* Messages queued after agent_list fills are appended to a spool file in
+ * StateSaveLocation. It starts with the offset of the first unread record,
+ * followed by records in the dbd.messages format. Protected by agent_lock */
+static int       spool_fd        = -1;
+static off_t     spool_read_off  = 0;
+static off_t     spool_write_off = 0;
+static uint32_t  spool_cnt       = 0;
+
+/* Agent statistics for sdiag, protected by agent_lock */
+static uint32_t  stat_dropped    = 0;	/* Messages discarded */
+static uint32_t  stat_batch_cnt  = 0;	/* Batches acknowledged */
+static uint32_t  stat_msg_cnt    = 0;	/* Messages acknowledged */
+static uint64_t  stat_batch_time = 0;	/* usec from send to reply */
+static uint64_t  stat_batch_max  = 0;
 
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
@@ -101,11 +129,14 @@ static time_t    slurmdbd_shutdown   = 0;
 
 
 static void * _agent(void *x);
+static int    _agent_queue_add(Buf buffer);
 static void   _create_agent(void);
 static int _unpack_config_name(char **object, uint16_t rpc_version, Buf buffer);
 static int    _get_return_code(void);
 static Buf    _load_dbd_rec(int fd);
+static int    _load_dbd_file(int fd, off_t skip_to);
 static void   _load_dbd_state(void);
+static int    _max_agent_queue(void);
 static void   _open_slurmdbd_conn(bool db_needed);
 static int    _purge_job_start_req(void);
 static int    _save_dbd_rec(int fd, Buf buffer);
@@ -113,6 +144,10 @@ static void   _save_dbd_state(void);
 static int    _send_fini_msg(void);
 static void   _sig_handler(int signal);
 static void   _shutdown_agent(void);
+static int    _spool_append(Buf buffer);
+static void   _spool_close(bool remove);
+static char  *_spool_file_name(void);
+static void   _spool_load(int max_cnt);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
 
@@ -321,15 +356,7 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 	Buf buffer;
 	int cnt, rc = SLURM_SUCCESS;
 	static time_t syslog_time = 0;
-	static int max_agent_queue = 0;
-
-	/* Whatever our max job count is times that by 2 or
-	 * MAX_AGENT_QUEUE which ever is bigger */
-	if (!max_agent_queue)
-		max_agent_queue =
-			MAX(MAX_AGENT_QUEUE,
-			    ((slurmctld_conf.max_job_cnt * 2) +
-			     (node_record_count * 4)));
+	int max_agent_queue = _max_agent_queue();
 
 	buffer = slurm_persist_msg_pack(
 		slurmdbd_conn, (persist_msg_t *)req);
@@ -353,16 +380,24 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		if (slurmdbd_conn->trigger_callbacks.dbd_fail)
 			(slurmdbd_conn->trigger_callbacks.dbd_fail)();
 	}
-	if (cnt == (max_agent_queue - 1))
-		cnt -= _purge_job_start_req();
-	if (cnt < max_agent_queue) {
-		if (list_enqueue(agent_list, buffer) == NULL)
-			fatal("list_enqueue: memory allocation failure");
-	} else {
-		error("slurmdbd: agent queue is full, discarding request");
-		if (slurmdbd_conn->trigger_callbacks.acct_full)
-			(slurmdbd_conn->trigger_callbacks.acct_full)();
-		rc = SLURM_ERROR;
+	if (_agent_queue_add(buffer) != SLURM_SUCCESS) {
+		/* The spool is full too, or can not be written. Only queue
+		 * the message if that would not put it ahead of any spooled
+		 * message. */
+		if (!spool_cnt && (cnt >= (max_agent_queue - 1)))
+			cnt -= _purge_job_start_req();
+		if (!spool_cnt && (cnt < max_agent_queue)) {
+			if (list_enqueue(agent_list, buffer) == NULL)
+				fatal("list_enqueue: memory allocation failure");
+		} else {
+			error("slurmdbd: agent queue is full, "
+			      "discarding request");
+			stat_dropped++;
+			free_buf(buffer);
+			if (slurmdbd_conn->trigger_callbacks.acct_full)
+				(slurmdbd_conn->trigger_callbacks.acct_full)();
+			rc = SLURM_ERROR;
+		}
 	}
 
 	slurm_cond_broadcast(&agent_cond);
@@ -1756,7 +1791,13 @@ static int _get_return_code(void)
 	return rc;
 }
 
-static int _handle_mult_rc_ret(void)
+/* Handle the reply to a DBD_SEND_MULT_MSG of batch_cnt messages. The batch
+ * follows agent_skipped messages at the head of agent_list which remain
+ * queued, each message acknowledged is removed and any other is added to
+ * agent_skipped.
+ * RET SLURM_SUCCESS if every message was acknowledged,
+ *     SLURM_COMMUNICATIONS_RECEIVE_ERROR if no reply was received */
+static int _handle_mult_rc_ret(uint32_t batch_cnt)
 {
 	Buf buffer;
 	uint16_t msg_type;
@@ -1764,10 +1805,13 @@ static int _handle_mult_rc_ret(void)
 	dbd_list_msg_t *list_msg = NULL;
 	int rc = SLURM_ERROR;
 	Buf out_buf = NULL;
+	uint32_t done = 0;
 
 	buffer = slurm_persist_recv_msg(slurmdbd_conn);
-	if (buffer == NULL)
-		return rc;
+	if (buffer == NULL) {
+		rc = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
+		goto fini;
+	}
 
 	safe_unpack16(&msg_type, buffer);
 	switch(msg_type) {
@@ -1784,20 +1828,31 @@ static int _handle_mult_rc_ret(void)
 		if (agent_list) {
 			ListIterator itr =
 				list_iterator_create(list_msg->my_list);
-			while ((out_buf = list_next(itr))) {
-				Buf b;
-				if ((rc = _unpack_return_code(
-					    slurmdbd_conn->version, out_buf))
-				    != SLURM_SUCCESS)
-					break;
-
-				if ((b = list_dequeue(agent_list))) {
-					free_buf(b);
-				} else {
+			ListIterator agent_itr =
+				list_iterator_create(agent_list);
+			uint32_t i;
+
+			for (i = 0; i < agent_skipped; i++)
+				(void) list_next(agent_itr);
+			rc = SLURM_SUCCESS;
+			while ((done < batch_cnt) &&
+			       (out_buf = list_next(itr))) {
+				if (!list_next(agent_itr)) {
 					error("slurmdbd: DBD_GOT_MULT_MSG "
 					      "unpack message error");
+					break;
+				}
+				done++;
+				if (_unpack_return_code(slurmdbd_conn->version,
+							out_buf)
+				    == SLURM_SUCCESS)
+					list_delete_item(agent_itr);
+				else {
+					rc = SLURM_ERROR;
+					agent_skipped++;
 				}
 			}
+			list_iterator_destroy(agent_itr);
 			list_iterator_destroy(itr);
 		}
 		slurm_mutex_unlock(&agent_lock);
@@ -1843,6 +1898,14 @@ static int _handle_mult_rc_ret(void)
 
 unpack_error:
 	free_buf(buffer);
+fini:
+	/* Messages not acknowledged stay queued */
+	if ((done < batch_cnt) && (rc == SLURM_SUCCESS))
+		rc = SLURM_ERROR;
+	slurm_mutex_lock(&agent_lock);
+	agent_skipped += batch_cnt - done;
+	agent_in_flight -= batch_cnt;
+	slurm_mutex_unlock(&agent_lock);
 	return rc;
 }
 
@@ -1911,19 +1974,163 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Pack the next messages queued but not yet sent into a DBD_SEND_MULT_MSG
+ * NOTE: agent_lock must be locked on entry
+ * OUT batch_cnt - number of messages packed
+ * RET buffer to send or NULL if there is nothing to send */
+static Buf _pack_batch(uint32_t *batch_cnt)
+{
+	slurmdbd_msg_t list_req;
+	dbd_list_msg_t list_msg;
+	ListIterator itr;
+	Buf buffer;
+	uint32_t i = 0, size = 0;
+
+	*batch_cnt = 0;
+	if (!agent_list ||
+	    (list_count(agent_list) <= (agent_skipped + agent_in_flight)))
+		return NULL;
+
+	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	list_msg.my_list = list_create(NULL);
+	itr = list_iterator_create(agent_list);
+	while ((buffer = list_next(itr))) {
+		if (i++ < (agent_skipped + agent_in_flight))
+			continue;
+		list_enqueue(list_msg.my_list, buffer);
+		size += get_buf_offset(buffer);
+		if ((++(*batch_cnt) >= MAX_DBD_BATCH_CNT) ||
+		    (size >= MAX_DBD_BATCH_SIZE))
+			break;
+	}
+	list_iterator_destroy(itr);
+
+	list_req.msg_type = DBD_SEND_MULT_MSG;
+	list_req.data = &list_msg;
+	buffer = pack_slurmdbd_msg(&list_req, SLURM_PROTOCOL_VERSION);
+	FREE_NULL_LIST(list_msg.my_list);
+	agent_in_flight += *batch_cnt;
+
+	return buffer;
+}
+
+/* Record the time from sending msg_cnt messages to their reply
+ * NOTE: agent_lock must be locked on entry */
+static void _agent_stat(uint32_t msg_cnt, struct timeval *tv1)
+{
+	struct timeval tv2;
+	uint64_t usec;
+
+	gettimeofday(&tv2, NULL);
+	usec = ((tv2.tv_sec - tv1->tv_sec) * 1000000) +
+	       (tv2.tv_usec - tv1->tv_usec);
+	stat_batch_cnt++;
+	stat_msg_cnt += msg_cnt;
+	stat_batch_time += usec;
+	stat_batch_max = MAX(stat_batch_max, usec);
+}
+
+/*
+ * Send the queued messages in DBD_SEND_MULT_MSG batches. Up to
+ * DBD_AGENT_WINDOW batches are sent ahead of the reply to the first, so that
+ * slurmdbd is working on one batch while the next is in transit. Messages
+ * stay at the head of agent_list until acknowledged.
+ *
+ * slurmdbd stops processing a batch at its first failed message, but still
+ * processes the batches sent after it. Those already have been applied,
+ * ahead of the failed message, so each one acknowledged is removed from
+ * agent_list like any other: sending it again would apply it twice, which
+ * some messages (e.g. DBD_JOB_SUSPEND) do not allow. Only the failed and
+ * unprocessed messages stay queued for a retry. To limit how far ahead of
+ * a failed message others are applied, batches are then sent one at a
+ * time until agent_list has drained.
+ * NOTE: slurmdbd_lock must be locked on entry, agent_lock must not be
+ * RET SLURM_SUCCESS if every message sent was acknowledged
+ */
+static int _send_mult_msgs(void)
+{
+	uint32_t batch_cnt[DBD_AGENT_WINDOW];
+	struct timeval batch_sent[DBD_AGENT_WINDOW];
+	int first = 0, in_window = 0, sent = 0, window, i, rc, rc2;
+	bool sending = true;
+	Buf buffer;
+
+	rc = SLURM_SUCCESS;
+	window = agent_serial ? 1 : DBD_AGENT_WINDOW;
+	while (1) {
+		while (sending && (in_window < window) &&
+		       (sent < MAX_DBD_BATCHES)) {
+			i = (first + in_window) % DBD_AGENT_WINDOW;
+			slurm_mutex_lock(&agent_lock);
+			buffer = _pack_batch(&batch_cnt[i]);
+			slurm_mutex_unlock(&agent_lock);
+			if (!buffer)
+				break;
+			gettimeofday(&batch_sent[i], NULL);
+			rc2 = slurm_persist_send_msg(slurmdbd_conn, buffer);
+			free_buf(buffer);
+			if (rc2 != SLURM_SUCCESS) {
+				if (!*slurmdbd_conn->shutdown)
+					error("slurmdbd: Failure sending "
+					      "message: %d: %m", rc2);
+				slurm_mutex_lock(&agent_lock);
+				agent_in_flight -= batch_cnt[i];
+				slurm_mutex_unlock(&agent_lock);
+				rc = rc2;
+				sending = false;
+				break;
+			}
+			in_window++;
+			sent++;
+		}
+		if (!in_window)
+			break;
+
+		rc2 = _handle_mult_rc_ret(batch_cnt[first]);
+		if (rc2 == SLURM_COMMUNICATIONS_RECEIVE_ERROR) {
+			/* Replies to the rest of the window are lost too */
+			error("slurmdbd: Failure receiving reply to "
+			      "%d message batches", in_window);
+			slurm_mutex_lock(&agent_lock);
+			for (i = 1; i < in_window; i++) {
+				agent_in_flight -= batch_cnt[
+					(first + i) % DBD_AGENT_WINDOW];
+			}
+			slurm_mutex_unlock(&agent_lock);
+			rc = rc2;
+			break;
+		}
+		slurm_mutex_lock(&agent_lock);
+		_agent_stat(batch_cnt[first], &batch_sent[first]);
+		slurm_mutex_unlock(&agent_lock);
+		if (rc2 != SLURM_SUCCESS) {
+			/* Collect the replies already on their way, but
+			 * leave the rest of the queue for a retry */
+			if (rc == SLURM_SUCCESS)
+				rc = rc2;
+			sending = false;
+			agent_serial = true;
+		}
+		first = (first + 1) % DBD_AGENT_WINDOW;
+		in_window--;
+	}
+	slurm_mutex_lock(&agent_lock);
+	agent_skipped = 0;
+	slurm_mutex_unlock(&agent_lock);
+
+	return rc;
+}
+
 static void *_agent(void *x)
 {
 	int cnt, rc;
 	Buf buffer;
 	struct timespec abs_time;
+	struct timeval tv1;
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
-	slurmdbd_msg_t list_req;
-	dbd_list_msg_t list_msg;
+	int max_agent_queue;
 
-	list_req.msg_type = DBD_SEND_MULT_MSG;
-	list_req.data = &list_msg;
-	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
 	/* DEF_TIMERS; */
 
 	/* Prepare to catch SIGUSR1 to interrupt pending
@@ -1946,10 +2153,17 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
+		/* Read spooled messages back once the queue has drained */
+		max_agent_queue = _max_agent_queue();
+		if (agent_list && spool_cnt &&
+		    (list_count(agent_list) < (max_agent_queue / 2)))
+			_spool_load(max_agent_queue - list_count(agent_list));
 		if (agent_list && slurmdbd_conn->fd)
 			cnt = list_count(agent_list);
 		else
 			cnt = 0;
+		if (cnt == 0)
+			agent_serial = false;
 		if ((cnt == 0) || (slurmdbd_conn->fd < 0) ||
 		    (fail_time && (difftime(time(NULL), fail_time) < 10))) {
 			slurm_mutex_unlock(&slurmdbd_lock);
@@ -1962,100 +2176,57 @@ static void *_agent(void *x)
 		} else if ((cnt > 0) && ((cnt % 100) == 0))
 			info("slurmdbd: agent queue size %u", cnt);
 		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			int handle_agent_count = 1000;
-			if (cnt > handle_agent_count) {
-				int agent_count = 0;
-				ListIterator agent_itr =
-					list_iterator_create(agent_list);
-				list_msg.my_list = list_create(NULL);
-				while ((buffer = list_next(agent_itr))) {
-					list_enqueue(list_msg.my_list, buffer);
-					agent_count++;
-					if (agent_count > handle_agent_count)
-						break;
-				}
-				list_iterator_destroy(agent_itr);
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else if (cnt > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else
-				buffer = (Buf) list_peek(agent_list);
+		if (cnt == 1) {
+			buffer = (Buf) list_peek(agent_list);
+			agent_in_flight = 1;
 		} else
 			buffer = NULL;
 		slurm_mutex_unlock(&agent_lock);
-		if (buffer == NULL) {
-			slurm_mutex_unlock(&slurmdbd_lock);
-
-			slurm_mutex_lock(&assoc_cache_mutex);
-			if (slurmdbd_conn->fd >= 0 && running_cache)
-				slurm_cond_signal(&assoc_cache_cond);
-			slurm_mutex_unlock(&assoc_cache_mutex);
-
-			continue;
-		}
 
 		/* NOTE: agent_lock is clear here, so we can add more
 		 * requests to the queue while waiting for this RPC to
 		 * complete. */
-		rc = slurm_persist_send_msg(slurmdbd_conn, buffer);
-		if (rc != SLURM_SUCCESS) {
-			if (*slurmdbd_conn->shutdown) {
-				slurm_mutex_unlock(&slurmdbd_lock);
-				break;
-			}
-			error("slurmdbd: Failure sending message: %d: %m", rc);
-		} else if (list_msg.my_list) {
-			rc = _handle_mult_rc_ret();
+		if (!buffer) {
+			rc = _send_mult_msgs();
 		} else {
-			rc = _get_return_code();
-			if (rc == EAGAIN) {
-				if (*slurmdbd_conn->shutdown) {
-					slurm_mutex_unlock(&slurmdbd_lock);
-					break;
-				}
-				error("slurmdbd: Failure with "
-				      "message need to resend: %d: %m", rc);
+			gettimeofday(&tv1, NULL);
+			rc = slurm_persist_send_msg(slurmdbd_conn, buffer);
+			if (rc != SLURM_SUCCESS) {
+				if (!*slurmdbd_conn->shutdown)
+					error("slurmdbd: Failure sending "
+					      "message: %d: %m", rc);
+			} else {
+				rc = _get_return_code();
+				if ((rc == EAGAIN) && !*slurmdbd_conn->shutdown)
+					error("slurmdbd: Failure with message "
+					      "need to resend: %d: %m", rc);
 			}
 		}
 		slurm_mutex_unlock(&slurmdbd_lock);
+		if (*slurmdbd_conn->shutdown && (rc != SLURM_SUCCESS)) {
+			slurm_mutex_lock(&agent_lock);
+			agent_in_flight = 0;
+			slurm_mutex_unlock(&agent_lock);
+			break;
+		}
 		slurm_mutex_lock(&assoc_cache_mutex);
 		if (slurmdbd_conn->fd >= 0 && running_cache)
 			slurm_cond_signal(&assoc_cache_cond);
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/* If we sent a mult_msg we just need to free
-			   buffer, we don't need to requeue, just mark
-			   list_msg.my_list as NULL as that is the
-			   sign we sent a mult_msg.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-			} else
+		if (buffer) {
+			agent_in_flight = 0;
+			if (agent_list && (rc == SLURM_SUCCESS)) {
+				_agent_stat(1, &tv1);
 				buffer = (Buf) list_dequeue(agent_list);
-
-			free_buf(buffer);
-			fail_time = 0;
-		} else {
-			/* We still need to free a mult_msg even if we
-			   got a failure.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
 				free_buf(buffer);
 			}
-
-			fail_time = time(NULL);
 		}
+		if (rc == SLURM_SUCCESS)
+			fail_time = 0;
+		else
+			fail_time = time(NULL);
 		slurm_mutex_unlock(&agent_lock);
 		/* END_TIMER; */
 		/* info("at the end with %s", TIME_STR); */
@@ -2077,13 +2248,37 @@ static void *_agent(void *x)
 	return NULL;
 }
 
+/* Write a queued message to the state save file unless it is a registration
+ * message. We do not want to store those. If an admin puts in an incorrect
+ * cluster name we can get a deadlock unless they add the bogus cluster name
+ * to the accounting system.
+ * RET SLURM_SUCCESS or SLURM_ERROR on write failure */
+static int _save_dbd_msg(int fd, Buf buffer, int *wrote)
+{
+	uint16_t msg_type;
+	uint32_t offset;
+	int rc;
+
+	offset = get_buf_offset(buffer);
+	if (offset < 2)
+		return SLURM_SUCCESS;
+	set_buf_offset(buffer, 0);
+	unpack16(&msg_type, buffer);
+	set_buf_offset(buffer, offset);
+	if (msg_type == DBD_REGISTER_CTLD)
+		return SLURM_SUCCESS;
+
+	rc = _save_dbd_rec(fd, buffer);
+	if (rc == SLURM_SUCCESS)
+		(*wrote)++;
+	return rc;
+}
+
 static void _save_dbd_state(void)
 {
 	char *dbd_fname;
 	Buf buffer;
-	int fd, rc, wrote = 0;
-	uint16_t msg_type;
-	uint32_t offset;
+	int fd, rc = SLURM_SUCCESS, wrote = 0;
 
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
@@ -2091,7 +2286,7 @@ static void _save_dbd_state(void)
 	fd = open(dbd_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
 	if (fd < 0) {
 		error("slurmdbd: Creating state save file %s", dbd_fname);
-	} else if (agent_list && list_count(agent_list)) {
+	} else if ((agent_list && list_count(agent_list)) || spool_cnt) {
 		char curr_ver_str[10];
 		snprintf(curr_ver_str, sizeof(curr_ver_str),
 			 "VER%d", SLURM_PROTOCOL_VERSION);
@@ -2102,35 +2297,38 @@ static void _save_dbd_state(void)
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 
-		while ((buffer = list_dequeue(agent_list))) {
-			/* We do not want to store registration
-			   messages.  If an admin puts in an incorrect
-			   cluster name we can get a deadlock unless
-			   they add the bogus cluster name to the
-			   accounting system.
-			*/
-			offset = get_buf_offset(buffer);
-			if (offset < 2) {
-				free_buf(buffer);
-				continue;
-			}
-			set_buf_offset(buffer, 0);
-			unpack16(&msg_type, buffer);
-			set_buf_offset(buffer, offset);
-			if (msg_type == DBD_REGISTER_CTLD) {
-				free_buf(buffer);
-				continue;
-			}
+		while (agent_list && (buffer = list_dequeue(agent_list))) {
+			rc = _save_dbd_msg(fd, buffer, &wrote);
+			free_buf(buffer);
+			if (rc != SLURM_SUCCESS)
+				goto end_it;
+		}
 
-			rc = _save_dbd_rec(fd, buffer);
+		/* Spooled messages were queued after those in agent_list */
+		if (spool_cnt &&
+		    (lseek(spool_fd, spool_read_off, SEEK_SET) !=
+		     spool_read_off)) {
+			error("slurmdbd: lseek(%s): %m", "dbd.spool");
+			goto end_it;
+		}
+		while (spool_cnt) {
+			if (!(buffer = _load_dbd_rec(spool_fd))) {
+				stat_dropped += spool_cnt;
+				spool_cnt = 0;
+				break;
+			}
+			rc = _save_dbd_msg(fd, buffer, &wrote);
 			free_buf(buffer);
 			if (rc != SLURM_SUCCESS)
 				break;
-			wrote++;
+			spool_read_off = lseek(spool_fd, 0, SEEK_CUR);
+			spool_cnt--;
 		}
 	}
 
 end_it:
+	/* Anything not written to dbd.messages stays in the spool */
+	_spool_close(spool_cnt == 0);
 	if (fd >= 0) {
 		verbose("slurmdbd: saved %d pending RPCs", wrote);
 		(void) close(fd);
@@ -2138,12 +2336,106 @@ end_it:
 	xfree(dbd_fname);
 }
 
-static void _load_dbd_state(void)
+/* Queue the messages saved in a state file
+ * IN fd - file positioned at its VER%d header record
+ * IN skip_to - if set, offset of the first record after the header to load
+ * RET count of messages recovered */
+static int _load_dbd_file(int fd, off_t skip_to)
 {
-	char *dbd_fname;
 	Buf buffer;
-	int fd, recovered = 0;
+	int recovered = 0;
 	uint16_t rpc_version = 0;
+	char *ver_str = NULL;
+	uint32_t ver_str_len;
+
+	buffer = _load_dbd_rec(fd);
+	if (buffer == NULL)
+		return recovered;
+	/* This is set to the end of the buffer for send so we
+	   need to set it back to 0 */
+	set_buf_offset(buffer, 0);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if (remaining_buf(buffer))
+		goto unpack_error;
+	debug3("Version string in dbd_state header is %s", ver_str);
+	free_buf(buffer);
+	buffer = NULL;
+	if (skip_to && (lseek(fd, skip_to, SEEK_SET) != skip_to)) {
+		error("slurmdbd: state recover error: %m");
+		xfree(ver_str);
+		return recovered;
+	}
+unpack_error:
+	if (ver_str) {
+		char curr_ver_str[10];
+		snprintf(curr_ver_str, sizeof(curr_ver_str),
+			 "VER%d", SLURM_PROTOCOL_VERSION);
+		if (!xstrcmp(ver_str, curr_ver_str))
+			rpc_version = SLURM_PROTOCOL_VERSION;
+	}
+
+	xfree(ver_str);
+	while (1) {
+		/* If the buffer was not the VER%d string it
+		   was an actual message so we don't want to
+		   skip it.
+		*/
+		if (!buffer)
+			buffer = _load_dbd_rec(fd);
+		if (buffer == NULL)
+			break;
+		if (rpc_version != SLURM_PROTOCOL_VERSION) {
+			/* unpack and repack with new
+			 * PROTOCOL_VERSION just so we keep
+			 * things up to date.
+			 */
+			slurmdbd_msg_t msg;
+			int rc;
+			set_buf_offset(buffer, 0);
+			rc = unpack_slurmdbd_msg(
+				&msg, rpc_version, buffer);
+			free_buf(buffer);
+			if (rc == SLURM_SUCCESS)
+				buffer = pack_slurmdbd_msg(
+					&msg, SLURM_PROTOCOL_VERSION);
+			else
+				buffer = NULL;
+		}
+		if (!buffer) {
+			error("no buffer given");
+			continue;
+		}
+		if (_agent_queue_add(buffer) != SLURM_SUCCESS) {
+			stat_dropped++;
+			free_buf(buffer);
+		} else
+			recovered++;
+		buffer = NULL;
+	}
+
+	return recovered;
+}
+
+static void _load_dbd_state(void)
+{
+	char *dbd_fname, *spool_fname = NULL, *old_fname = NULL;
+	int fd, recovered = 0;
+	uint64_t read_off;
+
+	/* A spool is left behind if slurmctld did not shutdown cleanly.
+	 * Requeued messages may be spooled again, so move it out of the way
+	 * before loading anything. */
+	if (spool_fd < 0) {
+		spool_fname = _spool_file_name();
+		old_fname = xstrdup_printf("%s.old", spool_fname);
+		if (rename(spool_fname, old_fname) != 0) {
+			if (errno != ENOENT)
+				error("slurmdbd: Renaming spool file %s: %m",
+				      spool_fname);
+			xfree(old_fname);
+		}
+		xfree(spool_fname);
+	}
 
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
@@ -2157,72 +2449,27 @@ static void _load_dbd_state(void)
 			error("slurmdbd: Opening state save file %s: %m",
 			      dbd_fname);
 	} else {
-		char *ver_str = NULL;
-		uint32_t ver_str_len;
-
-		buffer = _load_dbd_rec(fd);
-		if (buffer == NULL)
-			goto end_it;
-		/* This is set to the end of the buffer for send so we
-		   need to set it back to 0 */
-		set_buf_offset(buffer, 0);
-		safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
-		if (remaining_buf(buffer))
-			goto unpack_error;
-		debug3("Version string in dbd_state header is %s", ver_str);
-		free_buf(buffer);
-		buffer = NULL;
-	unpack_error:
-		if (ver_str) {
-			char curr_ver_str[10];
-			snprintf(curr_ver_str, sizeof(curr_ver_str),
-				 "VER%d", SLURM_PROTOCOL_VERSION);
-			if (!xstrcmp(ver_str, curr_ver_str))
-				rpc_version = SLURM_PROTOCOL_VERSION;
-		}
-
-		xfree(ver_str);
-		while (1) {
-			/* If the buffer was not the VER%d string it
-			   was an actual message so we don't want to
-			   skip it.
-			*/
-			if (!buffer)
-				buffer = _load_dbd_rec(fd);
-			if (buffer == NULL)
-				break;
-			if (rpc_version != SLURM_PROTOCOL_VERSION) {
-				/* unpack and repack with new
-				 * PROTOCOL_VERSION just so we keep
-				 * things up to date.
-				 */
-				slurmdbd_msg_t msg;
-				int rc;
-				set_buf_offset(buffer, 0);
-				rc = unpack_slurmdbd_msg(
-					&msg, rpc_version, buffer);
-				free_buf(buffer);
-				if (rc == SLURM_SUCCESS)
-					buffer = pack_slurmdbd_msg(
-						&msg, SLURM_PROTOCOL_VERSION);
-				else
-					buffer = NULL;
-			}
-			if (!buffer) {
-				error("no buffer given");
-				continue;
-			}
-			if (!list_enqueue(agent_list, buffer))
-				fatal("slurmdbd: list_enqueue, no memory");
-			recovered++;
-			buffer = NULL;
-		}
-
-	end_it:
+		recovered = _load_dbd_file(fd, 0);
 		verbose("slurmdbd: recovered %d pending RPCs", recovered);
 		(void) close(fd);
 	}
 	xfree(dbd_fname);
+
+	if (!old_fname)
+		return;
+	fd = open(old_fname, O_RDONLY);
+	if (fd < 0) {
+		error("slurmdbd: Opening spool file %s: %m", old_fname);
+	} else if (read(fd, &read_off, sizeof(read_off)) != sizeof(read_off)) {
+		error("slurmdbd: Reading spool file %s: %m", old_fname);
+		(void) close(fd);
+	} else {
+		recovered = _load_dbd_file(fd, (off_t) read_off);
+		verbose("slurmdbd: recovered %d spooled RPCs", recovered);
+		(void) close(fd);
+	}
+	(void) unlink(old_fname);
+	xfree(old_fname);
 }
 
 static int _save_dbd_rec(int fd, Buf buffer)
@@ -2312,6 +2559,162 @@ static Buf _load_dbd_rec(int fd)
 	return buffer;
 }
 
+/* Whatever our max job count is times that by 2 or
+ * MAX_AGENT_QUEUE which ever is bigger. This is not cached as the agent
+ * starts before the node table is built. */
+static int _max_agent_queue(void)
+{
+	return MAX(MAX_AGENT_QUEUE, ((slurmctld_conf.max_job_cnt * 2) +
+				     (node_record_count * 4)));
+}
+
+/* Queue a message for the agent. Once agent_list is full, messages are
+ * appended to the spool file until the agent has read it all back.
+ * NOTE: agent_lock must be locked on entry
+ * RET SLURM_SUCCESS or SLURM_ERROR if the caller still owns buffer */
+static int _agent_queue_add(Buf buffer)
+{
+	if (!spool_cnt && (list_count(agent_list) < _max_agent_queue())) {
+		if (list_enqueue(agent_list, buffer) == NULL)
+			fatal("list_enqueue: memory allocation failure");
+		return SLURM_SUCCESS;
+	}
+	return _spool_append(buffer);
+}
+
+static char *_spool_file_name(void)
+{
+	char *spool_fname = slurm_get_state_save_location();
+	xstrcat(spool_fname, "/dbd.spool");
+	return spool_fname;
+}
+
+/* Record the offset of the first unread record in the spool header */
+static void _spool_write_header(void)
+{
+	uint64_t read_off = spool_read_off;
+
+	if (pwrite(spool_fd, &read_off, sizeof(read_off), 0) !=
+	    sizeof(read_off))
+		error("slurmdbd: Writing spool file header: %m");
+}
+
+static int _spool_create(void)
+{
+	char *spool_fname, curr_ver_str[10];
+	Buf buffer;
+	int rc;
+
+	spool_fname = _spool_file_name();
+	spool_fd = open(spool_fname, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (spool_fd < 0) {
+		error("slurmdbd: Creating spool file %s: %m", spool_fname);
+		xfree(spool_fname);
+		return SLURM_ERROR;
+	}
+	xfree(spool_fname);
+	fd_set_close_on_exec(spool_fd);
+
+	spool_read_off = 0;
+	_spool_write_header();
+	snprintf(curr_ver_str, sizeof(curr_ver_str),
+		 "VER%d", SLURM_PROTOCOL_VERSION);
+	buffer = init_buf(strlen(curr_ver_str));
+	packstr(curr_ver_str, buffer);
+	if (lseek(spool_fd, sizeof(uint64_t), SEEK_SET) == sizeof(uint64_t))
+		rc = _save_dbd_rec(spool_fd, buffer);
+	else
+		rc = SLURM_ERROR;
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS) {
+		_spool_close(true);
+		return rc;
+	}
+	spool_read_off = spool_write_off = lseek(spool_fd, 0, SEEK_CUR);
+	_spool_write_header();
+	info("slurmdbd: agent queue is full, spooling requests to disk");
+
+	return SLURM_SUCCESS;
+}
+
+/* Append a message to the spool, freeing buffer on success
+ * NOTE: agent_lock must be locked on entry */
+static int _spool_append(Buf buffer)
+{
+	if ((spool_fd < 0) && (_spool_create() != SLURM_SUCCESS))
+		return SLURM_ERROR;
+	if ((spool_write_off + get_buf_offset(buffer)) > MAX_DBD_SPOOL_SIZE)
+		return SLURM_ERROR;
+
+	if ((lseek(spool_fd, spool_write_off, SEEK_SET) != spool_write_off) ||
+	    (_save_dbd_rec(spool_fd, buffer) != SLURM_SUCCESS)) {
+		/* Drop any partial record */
+		if (ftruncate(spool_fd, spool_write_off))
+			error("slurmdbd: ftruncate(%s): %m", "dbd.spool");
+		return SLURM_ERROR;
+	}
+	spool_write_off = lseek(spool_fd, 0, SEEK_CUR);
+	spool_cnt++;
+	free_buf(buffer);
+
+	return SLURM_SUCCESS;
+}
+
+/* Move up to max_cnt spooled messages to agent_list
+ * NOTE: agent_lock must be locked on entry */
+static void _spool_load(int max_cnt)
+{
+	Buf buffer;
+	int loaded = 0;
+
+	if (lseek(spool_fd, spool_read_off, SEEK_SET) != spool_read_off) {
+		error("slurmdbd: lseek(%s): %m", "dbd.spool");
+		return;
+	}
+	while (spool_cnt && (loaded < max_cnt)) {
+		if (!(buffer = _load_dbd_rec(spool_fd))) {
+			error("slurmdbd: discarding %u spooled requests",
+			      spool_cnt);
+			stat_dropped += spool_cnt;
+			spool_cnt = 0;
+			break;
+		}
+		if (list_enqueue(agent_list, buffer) == NULL)
+			fatal("list_enqueue: memory allocation failure");
+		spool_cnt--;
+		loaded++;
+	}
+	debug("slurmdbd: loaded %d spooled requests, %u remain",
+	      loaded, spool_cnt);
+
+	if (!spool_cnt) {
+		_spool_close(true);
+		return;
+	}
+	spool_read_off = lseek(spool_fd, 0, SEEK_CUR);
+	_spool_write_header();
+}
+
+/* Close the spool file, removing it or leaving the unread records in it */
+static void _spool_close(bool remove)
+{
+	char *spool_fname;
+
+	if (spool_fd >= 0) {
+		if (remove) {
+			spool_fname = _spool_file_name();
+			(void) unlink(spool_fname);
+			xfree(spool_fname);
+			spool_cnt = 0;
+		} else
+			_spool_write_header();
+		(void) close(spool_fd);
+		spool_fd = -1;
+	}
+	/* Nothing is left to read once the spool is closed */
+	spool_read_off = spool_write_off = 0;
+}
+
 static void _sig_handler(int signal)
 {
 }
@@ -2323,11 +2726,16 @@ static int _purge_job_start_req(void)
 	int purged = 0;
 	ListIterator iter;
 	uint16_t msg_type;
-	uint32_t offset;
+	uint32_t offset, skip = agent_skipped + agent_in_flight;
 	Buf buffer;
 
 	iter = list_iterator_create(agent_list);
 	while ((buffer = list_next(iter))) {
+		/* The agent is waiting for slurmdbd to acknowledge these */
+		if (skip) {
+			skip--;
+			continue;
+		}
 		offset = get_buf_offset(buffer);
 		if (offset < 2)
 			continue;
@@ -2346,6 +2754,35 @@ static int _purge_job_start_req(void)
 	return purged;
 }
 
+/* slurmdbd_agent_pack_stats - pack agent queue statistics, as reported by
+ *	sdiag */
+extern void slurmdbd_agent_pack_stats(Buf buffer, uint16_t protocol_version)
+{
+	slurm_mutex_lock(&agent_lock);
+	pack32(agent_list ? list_count(agent_list) : 0, buffer);
+	pack32(spool_cnt, buffer);
+	pack64(spool_cnt ? (uint64_t) (spool_write_off - spool_read_off) : 0,
+	       buffer);
+	pack32(stat_dropped, buffer);
+	pack32(stat_batch_cnt, buffer);
+	pack32(stat_msg_cnt, buffer);
+	pack64(stat_batch_time, buffer);
+	pack64(stat_batch_max, buffer);
+	slurm_mutex_unlock(&agent_lock);
+}
+
+/* slurmdbd_agent_reset_stats - clear agent queue statistics */
+extern void slurmdbd_agent_reset_stats(void)
+{
+	slurm_mutex_lock(&agent_lock);
+	stat_dropped = 0;
+	stat_batch_cnt = 0;
+	stat_msg_cnt = 0;
+	stat_batch_time = 0;
+	stat_batch_max = 0;
+	slurm_mutex_unlock(&agent_lock);
+}
+
 /****************************************************************************\
  * Free data structures
 \****************************************************************************/
@@ -439,6 +439,11 @@ extern char *slurmdbd_msg_type_2_str(slurmdbd_msg_type_t msg_type,
 
 extern void slurmdbd_free_buffer(void *x);
 
+/* Pack agent queue statistics, as reported by sdiag */
+extern void slurmdbd_agent_pack_stats(Buf buffer, uint16_t protocol_version);
+/* Clear agent queue statistics */
+extern void slurmdbd_agent_reset_stats(void);
+
 /*****************************************************************************\
  * Free various SlurmDBD message structures
 \*****************************************************************************/
@@ -880,6 +880,27 @@ fini:
 	return result;
 }
 
+extern MYSQL_RES *mysql_db_query_use(mysql_conn_t *mysql_conn, char *query)
+{
+	MYSQL_RES *result = NULL;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR) {
+		if (mysql_errno(mysql_conn->db_conn) == ER_NO_SUCH_TABLE)
+			goto fini;
+		if (!(result = mysql_use_result(mysql_conn->db_conn)) &&
+		    mysql_field_count(mysql_conn->db_conn)) {
+			/* should have returned data */
+			error("We should have gotten a result: '%m' '%s'",
+			      mysql_error(mysql_conn->db_conn));
+		}
+	}
+
+fini:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return result;
+}
+
 extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query)
 {
 	int rc = SLURM_SUCCESS;
@@ -100,6 +100,11 @@ extern int mysql_db_rollback(mysql_conn_t *mysql_conn);
 
 extern MYSQL_RES *mysql_db_query_ret(mysql_conn_t *mysql_conn,
 				     char *query, bool last);
+/* Like mysql_db_query_ret(), but rows are streamed from the server as they
+ * are fetched instead of being read into memory first. mysql_num_rows() is
+ * not valid until every row has been fetched, and nothing else may use the
+ * connection until the result is freed. */
+extern MYSQL_RES *mysql_db_query_use(mysql_conn_t *mysql_conn, char *query);
 extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query);
 
 extern uint64_t mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query);
@@ -36,11 +36,17 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include "config.h"
+
+#include <arpa/inet.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#if HAVE_LIBZ
+#  include <zlib.h>
+#endif
 
 #include "src/common/env.h"
 #include "src/common/slurmdbd_defs.h"
@@ -832,68 +838,202 @@ static char *_make_archive_name(time_t period_start, time_t period_end,
 			      start_char, end_char);
 }
 
-extern int archive_write_file(Buf buffer, char *cluster_name,
-			      time_t period_start, time_t period_end,
-			      char *arch_dir, char *arch_type,
-			      uint32_t archive_period)
+struct archive_file {
+	char *file_name;	/* NULL when reading */
+	char *new_file;
+	int fd;
+#if HAVE_LIBZ
+	gzFile gz;
+#endif
+};
+
+static int _archive_file_write_data(archive_file_t *arch_file, char *data,
+				    int size)
 {
-	int fd = 0;
-	int rc = SLURM_SUCCESS;
-	char *old_file = NULL, *new_file = NULL, *reg_file = NULL;
-	static int high_buffer_size = (1024 * 1024);
-	static pthread_mutex_t local_file_lock = PTHREAD_MUTEX_INITIALIZER;
+#if HAVE_LIBZ
+	/* gzwrite() consumes everything it is given or fails */
+	if (gzwrite(arch_file->gz, data, size) != size) {
+		int gz_err;
+		error("Error writing file %s, %s", arch_file->new_file,
+		      gzerror(arch_file->gz, &gz_err));
+		return SLURM_ERROR;
+	}
+#else
+	int amount;
+
+	while (size > 0) {
+		amount = write(arch_file->fd, data, size);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			error("Error writing file %s, %m", arch_file->new_file);
+			return SLURM_ERROR;
+		}
+		size -= amount;
+		data += amount;
+	}
+#endif
+	return SLURM_SUCCESS;
+}
 
-	xassert(buffer);
+extern archive_file_t *archive_file_create(char *cluster_name,
+					   time_t period_start,
+					   time_t period_end,
+					   char *arch_dir, char *arch_type,
+					   uint32_t archive_period)
+{
+	archive_file_t *arch_file = xmalloc(sizeof(archive_file_t));
+	uint32_t magic = htonl(ARCHIVE_STREAM_MAGIC);
 
-	slurm_mutex_lock(&local_file_lock);
+	arch_file->file_name = _make_archive_name(period_start, period_end,
+						  cluster_name, arch_dir,
+						  arch_type, archive_period);
+	debug("Storing %s archive for %s at %s",
+	      arch_type, cluster_name, arch_file->file_name);
+	arch_file->new_file = xstrdup_printf("%s.new", arch_file->file_name);
+
+	arch_file->fd = creat(arch_file->new_file, 0600);
+	if (arch_file->fd < 0) {
+		error("Can't save archive, create file %s error %m",
+		      arch_file->new_file);
+		goto fail;
+	}
+#if HAVE_LIBZ
+	/* gzclose() closes its descriptor, keep ours to fsync() after it */
+	if (!(arch_file->gz = gzdopen(dup(arch_file->fd), "wb"))) {
+		error("Can't save archive, gzdopen %s error %m",
+		      arch_file->new_file);
+		close(arch_file->fd);
+		(void) unlink(arch_file->new_file);
+		goto fail;
+	}
+#endif
+	if (_archive_file_write_data(arch_file, (char *) &magic,
+				     sizeof(magic)) != SLURM_SUCCESS) {
+		(void) archive_file_close(arch_file, false);
+		return NULL;
+	}
 
-	/* write the buffer to file */
-	reg_file = _make_archive_name(period_start, period_end,
-				      cluster_name, arch_dir,
-				      arch_type, archive_period);
+	return arch_file;
 
-	debug("Storing %s archive for %s at %s",
-	      arch_type, cluster_name, reg_file);
-	old_file = xstrdup_printf("%s.old", reg_file);
-	new_file = xstrdup_printf("%s.new", reg_file);
+fail:
+	xfree(arch_file->file_name);
+	xfree(arch_file->new_file);
+	xfree(arch_file);
+	return NULL;
+}
 
-	fd = creat(new_file, 0600);
-	if (fd < 0) {
-		error("Can't save archive, create file %s error %m", new_file);
-		rc = SLURM_ERROR;
-	} else {
-		int pos = 0, nwrite = get_buf_offset(buffer), amount;
-		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				rc = SLURM_ERROR;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-		fsync(fd);
+extern archive_file_t *archive_file_open(char *file_name)
+{
+	archive_file_t *arch_file;
+	int fd;
+
+	if ((fd = open(file_name, O_RDONLY)) < 0)
+		return NULL;
+
+	arch_file = xmalloc(sizeof(archive_file_t));
+	arch_file->fd = fd;
+#if HAVE_LIBZ
+	/* Reads uncompressed files transparently */
+	if (!(arch_file->gz = gzdopen(fd, "rb"))) {
+		error("gzdopen %s error %m", file_name);
 		close(fd);
+		xfree(arch_file);
+		return NULL;
 	}
+#endif
+	return arch_file;
+}
+
+extern int archive_file_write(archive_file_t *arch_file, Buf buffer)
+{
+	uint32_t size = get_buf_offset(buffer);
+	uint32_t nsize = htonl(size);
+
+	xassert(arch_file && arch_file->new_file);
+
+	if ((_archive_file_write_data(arch_file, (char *) &nsize,
+				      sizeof(nsize)) != SLURM_SUCCESS) ||
+	    (_archive_file_write_data(arch_file, get_buf_data(buffer),
+				      size) != SLURM_SUCCESS))
+		return SLURM_ERROR;
+	return SLURM_SUCCESS;
+}
+
+extern int archive_file_read(archive_file_t *arch_file, void *data,
+			     int size)
+{
+	char *ptr = data;
+	int amount, total = 0;
+
+	xassert(arch_file && !arch_file->new_file);
+
+	while (total < size) {
+#if HAVE_LIBZ
+		amount = gzread(arch_file->gz, ptr + total, size - total);
+#else
+		amount = read(arch_file->fd, ptr + total, size - total);
+#endif
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		} else if (amount == 0)	/* eof */
+			break;
+		total += amount;
+	}
+	return total;
+}
 
-	if (rc)
-		(void) unlink(new_file);
+extern int archive_file_close(archive_file_t *arch_file, bool commit)
+{
+	int rc = SLURM_SUCCESS;
+	char *old_file = NULL;
+	static pthread_mutex_t local_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
+	if (!arch_file)
+		return SLURM_ERROR;
+
+	if (!arch_file->new_file) {
+#if HAVE_LIBZ
+		gzclose(arch_file->gz);
+#else
+		close(arch_file->fd);
+#endif
+		xfree(arch_file);
+		return SLURM_SUCCESS;
+	}
+
+#if HAVE_LIBZ
+	if (gzclose(arch_file->gz) != Z_OK) {
+		error("Error writing file %s", arch_file->new_file);
+		rc = SLURM_ERROR;
+	}
+#endif
+	fsync(arch_file->fd);
+	close(arch_file->fd);
+
+	slurm_mutex_lock(&local_file_lock);
+	if (rc || !commit)
+		(void) unlink(arch_file->new_file);
 	else {			/* file shuffle */
+		old_file = xstrdup_printf("%s.old", arch_file->file_name);
 		(void) unlink(old_file);
-		if (link(reg_file, old_file))
-			debug4("Link(%s, %s): %m", reg_file, old_file);
-		(void) unlink(reg_file);
-		if (link(new_file, reg_file))
-			debug4("Link(%s, %s): %m", new_file, reg_file);
-		(void) unlink(new_file);
-	}
-	xfree(old_file);
-	xfree(reg_file);
-	xfree(new_file);
+		if (link(arch_file->file_name, old_file))
+			debug4("Link(%s, %s): %m",
+			       arch_file->file_name, old_file);
+		(void) unlink(arch_file->file_name);
+		if (link(arch_file->new_file, arch_file->file_name))
+			debug4("Link(%s, %s): %m",
+			       arch_file->new_file, arch_file->file_name);
+		(void) unlink(arch_file->new_file);
+		xfree(old_file);
+	}
 	slurm_mutex_unlock(&local_file_lock);
 
+	xfree(arch_file->file_name);
+	xfree(arch_file->new_file);
+	xfree(arch_file);
+
 	return rc;
 }
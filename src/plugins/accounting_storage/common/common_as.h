@@ -80,9 +80,56 @@ extern char* acct_get_db_name(void);
 extern time_t archive_setup_end_time(time_t last_submit, uint32_t purge);
 extern int archive_run_script(slurmdb_archive_cond_t *arch_cond,
 			      char *cluster_name, time_t last_submit);
-extern int archive_write_file(Buf buffer, char *cluster_name,
-			      time_t period_start, time_t period_end,
-			      char *arch_dir, char *arch_type,
-			      uint32_t archive_period);
+
+/*
+ * Archive files are written as a stream of segments so that an archive of
+ * any size can be written and loaded with bounded memory. A stream starts
+ * with ARCHIVE_STREAM_MAGIC, then each segment is a 32 bit length in network
+ * byte order followed by a packed buffer in the single buffer archive format
+ * (version, time, type, cluster, record count and records). The file is
+ * compressed with zlib when available. Files without the magic are single
+ * buffer (or plain SQL) archives from older versions.
+ */
+#define ARCHIVE_STREAM_MAGIC 0x534c4152	/* "SLAR" */
+
+typedef struct archive_file archive_file_t;
+
+/*
+ * archive_file_create - start writing an archive file, which is written to a
+ *	temporary name until archive_file_close() commits it
+ * RET: archive file or NULL on error
+ */
+extern archive_file_t *archive_file_create(char *cluster_name,
+					   time_t period_start,
+					   time_t period_end,
+					   char *arch_dir, char *arch_type,
+					   uint32_t archive_period);
+
+/*
+ * archive_file_open - open an archive file for reading
+ * RET: archive file or NULL on error
+ */
+extern archive_file_t *archive_file_open(char *file_name);
+
+/*
+ * archive_file_write - append a segment to an archive file
+ * IN buffer: segment, from offset 0 up to the buffer's offset
+ * RET: SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int archive_file_write(archive_file_t *arch_file, Buf buffer);
+
+/*
+ * archive_file_read - read exactly size bytes, less only at end of file
+ * RET: bytes read or -1 on error
+ */
+extern int archive_file_read(archive_file_t *arch_file, void *data,
+			     int size);
+
+/*
+ * archive_file_close - close an archive file. A file being written is moved
+ *	into place if commit is set, otherwise it is removed.
+ * RET: SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int archive_file_close(archive_file_t *arch_file, bool commit);
 
 #endif
@@ -37,6 +37,7 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <arpa/inet.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -63,6 +64,12 @@
 #define MAX_ARCHIVE_AGE (60 * 60 * 24 * 60) /* If archive data is older than
 					       this then archive by month to
 					       handle large datasets. */
+#define MAX_ARCHIVE_BATCH 50000 /* Number of records written to an archive
+				   file at a time so that memory use is
+				   bounded however many are archived. */
+#define MAX_ARCHIVE_BATCH_SIZE (32 * 1024 * 1024) /* Size at which a batch
+						     is written regardless of
+						     its record count. */
 
 typedef struct {
 	char *cluster_nodes;
@@ -1599,39 +1606,26 @@ static char *_get_archive_columns(purge_type_t type)
 }
 
 
-static Buf _pack_archive_events(MYSQL_RES *result, char *cluster_name,
-				uint32_t cnt, time_t *period_start)
+static void _pack_archive_events(MYSQL_ROW row, time_t *period_start,
+				 Buf buffer)
 {
-	MYSQL_ROW row;
-	Buf buffer;
 	local_event_t event;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_EVENTS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
-	while ((row = mysql_fetch_row(result))) {
-		if (period_start && !*period_start)
-			*period_start = slurm_atoul(row[EVENT_REQ_START]);
-
-		memset(&event, 0, sizeof(local_event_t));
+	if (period_start && !*period_start)
+		*period_start = slurm_atoul(row[EVENT_REQ_START]);
 
-		event.cluster_nodes = row[EVENT_REQ_CNODES];
-		event.node_name = row[EVENT_REQ_NODE];
-		event.period_end = row[EVENT_REQ_END];
-		event.period_start = row[EVENT_REQ_START];
-		event.reason = row[EVENT_REQ_REASON];
-		event.reason_uid = row[EVENT_REQ_REASON_UID];
-		event.state = row[EVENT_REQ_STATE];
-		event.tres_str = row[EVENT_REQ_TRES];
+	memset(&event, 0, sizeof(local_event_t));
 
-		_pack_local_event(&event, SLURM_PROTOCOL_VERSION, buffer);
-	}
+	event.cluster_nodes = row[EVENT_REQ_CNODES];
+	event.node_name = row[EVENT_REQ_NODE];
+	event.period_end = row[EVENT_REQ_END];
+	event.period_start = row[EVENT_REQ_START];
+	event.reason = row[EVENT_REQ_REASON];
+	event.reason_uid = row[EVENT_REQ_REASON_UID];
+	event.state = row[EVENT_REQ_STATE];
+	event.tres_str = row[EVENT_REQ_TRES];
 
-	return buffer;
+	_pack_local_event(&event, SLURM_PROTOCOL_VERSION, buffer);
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -1686,67 +1680,54 @@ _load_events(uint16_t rpc_version, Buf buffer, char *cluster_name,
 	return insert;
 }
 
-static Buf _pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
-			      uint32_t cnt, time_t *period_start)
+static void _pack_archive_jobs(MYSQL_ROW row, time_t *period_start,
+			       Buf buffer)
 {
-	MYSQL_ROW row;
-	Buf buffer;
 	local_job_t job;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_JOBS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
-	while ((row = mysql_fetch_row(result))) {
-		if (period_start && !*period_start)
-			*period_start = slurm_atoul(row[JOB_REQ_SUBMIT]);
-
-		memset(&job, 0, sizeof(local_job_t));
-
-		job.account = row[JOB_REQ_ACCOUNT];
-		job.alloc_nodes = row[JOB_REQ_ALLOC_NODES];
-		job.associd = row[JOB_REQ_ASSOCID];
-		job.array_jobid = row[JOB_REQ_ARRAYJOBID];
-		job.array_max_tasks = row[JOB_REQ_ARRAY_MAX];
-		job.array_taskid = row[JOB_REQ_ARRAYTASKID];
-		job.blockid = row[JOB_REQ_BLOCKID];
-		job.derived_ec = row[JOB_REQ_DERIVED_EC];
-		job.derived_es = row[JOB_REQ_DERIVED_ES];
-		job.exit_code = row[JOB_REQ_EXIT_CODE];
-		job.timelimit = row[JOB_REQ_TIMELIMIT];
-		job.eligible = row[JOB_REQ_ELIGIBLE];
-		job.end = row[JOB_REQ_END];
-		job.gid = row[JOB_REQ_GID];
-		job.job_db_inx = row[JOB_REQ_DB_INX];
-		job.jobid = row[JOB_REQ_JOBID];
-		job.kill_requid = row[JOB_REQ_KILL_REQUID];
-		job.name = row[JOB_REQ_NAME];
-		job.nodelist = row[JOB_REQ_NODELIST];
-		job.node_inx = row[JOB_REQ_NODE_INX];
-		job.partition = row[JOB_REQ_PARTITION];
-		job.priority = row[JOB_REQ_PRIORITY];
-		job.qos = row[JOB_REQ_QOS];
-		job.req_cpus = row[JOB_REQ_REQ_CPUS];
-		job.req_mem = row[JOB_REQ_REQ_MEM];
-		job.resvid = row[JOB_REQ_RESVID];
-		job.start = row[JOB_REQ_START];
-		job.state = row[JOB_REQ_STATE];
-		job.submit = row[JOB_REQ_SUBMIT];
-		job.suspended = row[JOB_REQ_SUSPENDED];
-		job.track_steps = row[JOB_REQ_TRACKSTEPS];
-		job.tres_alloc_str = row[JOB_REQ_TRESA];
-		job.tres_req_str = row[JOB_REQ_TRESR];
-		job.uid = row[JOB_REQ_UID];
-		job.wckey = row[JOB_REQ_WCKEY];
-		job.wckey_id = row[JOB_REQ_WCKEYID];
-
-		_pack_local_job(&job, SLURM_PROTOCOL_VERSION, buffer);
-	}
-
-	return buffer;
+	if (period_start && !*period_start)
+		*period_start = slurm_atoul(row[JOB_REQ_SUBMIT]);
+
+	memset(&job, 0, sizeof(local_job_t));
+
+	job.account = row[JOB_REQ_ACCOUNT];
+	job.alloc_nodes = row[JOB_REQ_ALLOC_NODES];
+	job.associd = row[JOB_REQ_ASSOCID];
+	job.array_jobid = row[JOB_REQ_ARRAYJOBID];
+	job.array_max_tasks = row[JOB_REQ_ARRAY_MAX];
+	job.array_taskid = row[JOB_REQ_ARRAYTASKID];
+	job.blockid = row[JOB_REQ_BLOCKID];
+	job.derived_ec = row[JOB_REQ_DERIVED_EC];
+	job.derived_es = row[JOB_REQ_DERIVED_ES];
+	job.exit_code = row[JOB_REQ_EXIT_CODE];
+	job.timelimit = row[JOB_REQ_TIMELIMIT];
+	job.eligible = row[JOB_REQ_ELIGIBLE];
+	job.end = row[JOB_REQ_END];
+	job.gid = row[JOB_REQ_GID];
+	job.job_db_inx = row[JOB_REQ_DB_INX];
+	job.jobid = row[JOB_REQ_JOBID];
+	job.kill_requid = row[JOB_REQ_KILL_REQUID];
+	job.name = row[JOB_REQ_NAME];
+	job.nodelist = row[JOB_REQ_NODELIST];
+	job.node_inx = row[JOB_REQ_NODE_INX];
+	job.partition = row[JOB_REQ_PARTITION];
+	job.priority = row[JOB_REQ_PRIORITY];
+	job.qos = row[JOB_REQ_QOS];
+	job.req_cpus = row[JOB_REQ_REQ_CPUS];
+	job.req_mem = row[JOB_REQ_REQ_MEM];
+	job.resvid = row[JOB_REQ_RESVID];
+	job.start = row[JOB_REQ_START];
+	job.state = row[JOB_REQ_STATE];
+	job.submit = row[JOB_REQ_SUBMIT];
+	job.suspended = row[JOB_REQ_SUSPENDED];
+	job.track_steps = row[JOB_REQ_TRACKSTEPS];
+	job.tres_alloc_str = row[JOB_REQ_TRESA];
+	job.tres_req_str = row[JOB_REQ_TRESR];
+	job.uid = row[JOB_REQ_UID];
+	job.wckey = row[JOB_REQ_WCKEY];
+	job.wckey_id = row[JOB_REQ_WCKEYID];
+
+	_pack_local_job(&job, SLURM_PROTOCOL_VERSION, buffer);
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -1841,40 +1822,27 @@ _init_local_job(local_job_t *job)
 	xstrcat(job->array_taskid, "4294967294");
 }
 
-static Buf _pack_archive_resvs(MYSQL_RES *result, char *cluster_name,
-			       uint32_t cnt, time_t *period_start)
+static void _pack_archive_resvs(MYSQL_ROW row, time_t *period_start,
+				Buf buffer)
 {
-	MYSQL_ROW row;
-	Buf buffer;
 	local_resv_t resv;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_RESVS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	if (period_start && !*period_start)
+		*period_start = slurm_atoul(row[RESV_REQ_START]);
 
-	while ((row = mysql_fetch_row(result))) {
-		if (period_start && !*period_start)
-			*period_start = slurm_atoul(row[RESV_REQ_START]);
-
-		memset(&resv, 0, sizeof(local_resv_t));
-
-		resv.assocs = row[RESV_REQ_ASSOCS];
-		resv.flags = row[RESV_REQ_FLAGS];
-		resv.id = row[RESV_REQ_ID];
-		resv.name = row[RESV_REQ_NAME];
-		resv.nodes = row[RESV_REQ_NODES];
-		resv.node_inx = row[RESV_REQ_NODE_INX];
-		resv.time_end = row[RESV_REQ_END];
-		resv.time_start = row[RESV_REQ_START];
-		resv.tres_str = row[RESV_REQ_TRES];
-
-		_pack_local_resv(&resv, SLURM_PROTOCOL_VERSION, buffer);
-	}
+	memset(&resv, 0, sizeof(local_resv_t));
+
+	resv.assocs = row[RESV_REQ_ASSOCS];
+	resv.flags = row[RESV_REQ_FLAGS];
+	resv.id = row[RESV_REQ_ID];
+	resv.name = row[RESV_REQ_NAME];
+	resv.nodes = row[RESV_REQ_NODES];
+	resv.node_inx = row[RESV_REQ_NODE_INX];
+	resv.time_end = row[RESV_REQ_END];
+	resv.time_start = row[RESV_REQ_START];
+	resv.tres_str = row[RESV_REQ_TRES];
 
-	return buffer;
+	_pack_local_resv(&resv, SLURM_PROTOCOL_VERSION, buffer);
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -1928,79 +1896,66 @@ static char *_load_resvs(uint16_t rpc_version, Buf buffer,
 	return insert;
 }
 
-static Buf _pack_archive_steps(MYSQL_RES *result, char *cluster_name,
-			       uint32_t cnt, time_t *period_start)
+static void _pack_archive_steps(MYSQL_ROW row, time_t *period_start,
+				Buf buffer)
 {
-	MYSQL_ROW row;
-	Buf buffer;
 	local_step_t step;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_STEP_START, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
-	while ((row = mysql_fetch_row(result))) {
-		if (period_start && !*period_start)
-			*period_start = slurm_atoul(row[STEP_REQ_START]);
-
-		memset(&step, 0, sizeof(local_step_t));
-
-		step.ave_cpu = row[STEP_REQ_AVE_CPU];
-		step.act_cpufreq = row[STEP_REQ_ACT_CPUFREQ];
-		step.consumed_energy = row[STEP_REQ_CONSUMED_ENERGY];
-		step.ave_disk_read = row[STEP_REQ_AVE_DISK_READ];
-		step.ave_disk_write = row[STEP_REQ_AVE_DISK_WRITE];
-		step.ave_pages = row[STEP_REQ_AVE_PAGES];
-		step.ave_rss = row[STEP_REQ_AVE_RSS];
-		step.ave_vsize = row[STEP_REQ_AVE_VSIZE];
-		step.exit_code = row[STEP_REQ_EXIT_CODE];
-		step.job_db_inx = row[STEP_REQ_DB_INX];
-		step.kill_requid = row[STEP_REQ_KILL_REQUID];
-		step.max_disk_read = row[STEP_REQ_MAX_DISK_READ];
-		step.max_disk_read_node = row[STEP_REQ_MAX_DISK_READ_NODE];
-		step.max_disk_read_task = row[STEP_REQ_MAX_DISK_READ_TASK];
-		step.max_disk_write = row[STEP_REQ_MAX_DISK_WRITE];
-		step.max_disk_write_node = row[STEP_REQ_MAX_DISK_WRITE_NODE];
-		step.max_disk_write_task = row[STEP_REQ_MAX_DISK_WRITE_TASK];
-		step.max_pages = row[STEP_REQ_MAX_PAGES];
-		step.max_pages_node = row[STEP_REQ_MAX_PAGES_NODE];
-		step.max_pages_task = row[STEP_REQ_MAX_PAGES_TASK];
-		step.max_rss = row[STEP_REQ_MAX_RSS];
-		step.max_rss_node = row[STEP_REQ_MAX_RSS_NODE];
-		step.max_rss_task = row[STEP_REQ_MAX_RSS_TASK];
-		step.max_vsize = row[STEP_REQ_MAX_VSIZE];
-		step.max_vsize_node = row[STEP_REQ_MAX_VSIZE_NODE];
-		step.max_vsize_task = row[STEP_REQ_MAX_VSIZE_TASK];
-		step.min_cpu = row[STEP_REQ_MIN_CPU];
-		step.min_cpu_node = row[STEP_REQ_MIN_CPU_NODE];
-		step.min_cpu_task = row[STEP_REQ_MIN_CPU_TASK];
-		step.name = row[STEP_REQ_NAME];
-		step.nodelist = row[STEP_REQ_NODELIST];
-		step.nodes = row[STEP_REQ_NODES];
-		step.node_inx = row[STEP_REQ_NODE_INX];
-		step.period_end = row[STEP_REQ_END];
-		step.period_start = row[STEP_REQ_START];
-		step.period_suspended = row[STEP_REQ_SUSPENDED];
-		step.req_cpufreq_min = row[STEP_REQ_REQ_CPUFREQ_MIN];
-		step.req_cpufreq_max = row[STEP_REQ_REQ_CPUFREQ_MAX];
-		step.req_cpufreq_gov = row[STEP_REQ_REQ_CPUFREQ_GOV];
-		step.state = row[STEP_REQ_STATE];
-		step.stepid = row[STEP_REQ_STEPID];
-		step.sys_sec = row[STEP_REQ_SYS_SEC];
-		step.sys_usec = row[STEP_REQ_SYS_USEC];
-		step.tasks = row[STEP_REQ_TASKS];
-		step.task_dist = row[STEP_REQ_TASKDIST];
-		step.tres_alloc_str = row[STEP_REQ_TRES];
-		step.user_sec = row[STEP_REQ_USER_SEC];
-		step.user_usec = row[STEP_REQ_USER_USEC];
-
-		_pack_local_step(&step, SLURM_PROTOCOL_VERSION, buffer);
-	}
-
-	return buffer;
+	if (period_start && !*period_start)
+		*period_start = slurm_atoul(row[STEP_REQ_START]);
+
+	memset(&step, 0, sizeof(local_step_t));
+
+	step.ave_cpu = row[STEP_REQ_AVE_CPU];
+	step.act_cpufreq = row[STEP_REQ_ACT_CPUFREQ];
+	step.consumed_energy = row[STEP_REQ_CONSUMED_ENERGY];
+	step.ave_disk_read = row[STEP_REQ_AVE_DISK_READ];
+	step.ave_disk_write = row[STEP_REQ_AVE_DISK_WRITE];
+	step.ave_pages = row[STEP_REQ_AVE_PAGES];
+	step.ave_rss = row[STEP_REQ_AVE_RSS];
+	step.ave_vsize = row[STEP_REQ_AVE_VSIZE];
+	step.exit_code = row[STEP_REQ_EXIT_CODE];
+	step.job_db_inx = row[STEP_REQ_DB_INX];
+	step.kill_requid = row[STEP_REQ_KILL_REQUID];
+	step.max_disk_read = row[STEP_REQ_MAX_DISK_READ];
+	step.max_disk_read_node = row[STEP_REQ_MAX_DISK_READ_NODE];
+	step.max_disk_read_task = row[STEP_REQ_MAX_DISK_READ_TASK];
+	step.max_disk_write = row[STEP_REQ_MAX_DISK_WRITE];
+	step.max_disk_write_node = row[STEP_REQ_MAX_DISK_WRITE_NODE];
+	step.max_disk_write_task = row[STEP_REQ_MAX_DISK_WRITE_TASK];
+	step.max_pages = row[STEP_REQ_MAX_PAGES];
+	step.max_pages_node = row[STEP_REQ_MAX_PAGES_NODE];
+	step.max_pages_task = row[STEP_REQ_MAX_PAGES_TASK];
+	step.max_rss = row[STEP_REQ_MAX_RSS];
+	step.max_rss_node = row[STEP_REQ_MAX_RSS_NODE];
+	step.max_rss_task = row[STEP_REQ_MAX_RSS_TASK];
+	step.max_vsize = row[STEP_REQ_MAX_VSIZE];
+	step.max_vsize_node = row[STEP_REQ_MAX_VSIZE_NODE];
+	step.max_vsize_task = row[STEP_REQ_MAX_VSIZE_TASK];
+	step.min_cpu = row[STEP_REQ_MIN_CPU];
+	step.min_cpu_node = row[STEP_REQ_MIN_CPU_NODE];
+	step.min_cpu_task = row[STEP_REQ_MIN_CPU_TASK];
+	step.name = row[STEP_REQ_NAME];
+	step.nodelist = row[STEP_REQ_NODELIST];
+	step.nodes = row[STEP_REQ_NODES];
+	step.node_inx = row[STEP_REQ_NODE_INX];
+	step.period_end = row[STEP_REQ_END];
+	step.period_start = row[STEP_REQ_START];
+	step.period_suspended = row[STEP_REQ_SUSPENDED];
+	step.req_cpufreq_min = row[STEP_REQ_REQ_CPUFREQ_MIN];
+	step.req_cpufreq_max = row[STEP_REQ_REQ_CPUFREQ_MAX];
+	step.req_cpufreq_gov = row[STEP_REQ_REQ_CPUFREQ_GOV];
+	step.state = row[STEP_REQ_STATE];
+	step.stepid = row[STEP_REQ_STEPID];
+	step.sys_sec = row[STEP_REQ_SYS_SEC];
+	step.sys_usec = row[STEP_REQ_SYS_USEC];
+	step.tasks = row[STEP_REQ_TASKS];
+	step.task_dist = row[STEP_REQ_TASKDIST];
+	step.tres_alloc_str = row[STEP_REQ_TRES];
+	step.user_sec = row[STEP_REQ_USER_SEC];
+	step.user_usec = row[STEP_REQ_USER_USEC];
+
+	_pack_local_step(&step, SLURM_PROTOCOL_VERSION, buffer);
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -2093,35 +2048,22 @@ static char *_load_steps(uint16_t rpc_version, Buf buffer,
 	return insert;
 }
 
-static Buf _pack_archive_suspends(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, time_t *period_start)
+static void _pack_archive_suspends(MYSQL_ROW row, time_t *period_start,
+				   Buf buffer)
 {
-	MYSQL_ROW row;
-	Buf buffer;
 	local_suspend_t suspend;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_JOB_SUSPEND, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
-	while ((row = mysql_fetch_row(result))) {
-		if (period_start && !*period_start)
-			*period_start = slurm_atoul(row[SUSPEND_REQ_START]);
+	if (period_start && !*period_start)
+		*period_start = slurm_atoul(row[SUSPEND_REQ_START]);
 
-		memset(&suspend, 0, sizeof(local_suspend_t));
+	memset(&suspend, 0, sizeof(local_suspend_t));
 
-		suspend.job_db_inx = row[SUSPEND_REQ_DB_INX];
-		suspend.associd = row[SUSPEND_REQ_ASSOCID];
-		suspend.period_start = row[SUSPEND_REQ_START];
-		suspend.period_end = row[SUSPEND_REQ_END];
+	suspend.job_db_inx = row[SUSPEND_REQ_DB_INX];
+	suspend.associd = row[SUSPEND_REQ_ASSOCID];
+	suspend.period_start = row[SUSPEND_REQ_START];
+	suspend.period_end = row[SUSPEND_REQ_END];
 
-		_pack_local_suspend(&suspend, SLURM_PROTOCOL_VERSION, buffer);
-	}
-
-	return buffer;
+	_pack_local_suspend(&suspend, SLURM_PROTOCOL_VERSION, buffer);
 }
 
 
@@ -2168,6 +2110,37 @@ static char *_load_suspend(uint16_t rpc_version, Buf buffer,
 	return insert;
 }
 
+/* Start a new batch of records in buffer, returns the offset of its record
+ * count for _archive_batch_write() to fill in. */
+static uint32_t _archive_batch_start(Buf buffer, uint16_t msg_type,
+				     char *cluster_name)
+{
+	uint32_t cnt_offset;
+
+	set_buf_offset(buffer, 0);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(time(NULL), buffer);
+	pack16(msg_type, buffer);
+	packstr(cluster_name, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(0, buffer);
+
+	return cnt_offset;
+}
+
+static int _archive_batch_write(archive_file_t *arch_file, Buf buffer,
+				uint32_t cnt_offset, uint32_t batch_cnt)
+{
+	uint32_t offset = get_buf_offset(buffer);
+
+	set_buf_offset(buffer, cnt_offset);
+	pack32(batch_cnt, buffer);
+	set_buf_offset(buffer, offset);
+	high_buffer_size = MAX(offset, high_buffer_size);
+
+	return archive_file_write(arch_file, buffer);
+}
+
 /* returns count of events archived or SLURM_ERROR on error */
 static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 			       char *cluster_name, time_t period_end,
@@ -2176,17 +2149,20 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 	MYSQL_RES *result = NULL;
 	char *cols = NULL, *query = NULL;
 	time_t period_start = 0;
-	uint32_t cnt = 0;
+	MYSQL_ROW row;
+	archive_file_t *arch_file = NULL;
+	uint32_t cnt = 0, batch_cnt = 0, cnt_offset = 0;
+	uint16_t msg_type;
 	Buf buffer;
-	int error_code = 0;
-	Buf (*pack_func)(MYSQL_RES *result, char *cluster_name,
-			 uint32_t cnt, time_t *period_start);
+	int error_code = SLURM_SUCCESS;
+	void (*pack_func)(MYSQL_ROW row, time_t *period_start, Buf buffer);
 
 	cols = _get_archive_columns(type);
 
 	switch (type) {
 	case PURGE_EVENT:
 		pack_func = &_pack_archive_events;
+		msg_type = DBD_GOT_EVENTS;
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "time_start <= %ld && time_end != 0 "
 				       "order by time_start asc "
@@ -2196,6 +2172,7 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 		break;
 	case PURGE_SUSPEND:
 		pack_func = &_pack_archive_suspends;
+		msg_type = DBD_JOB_SUSPEND;
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "time_start <= %ld && time_end != 0 "
 				       "order by time_start asc "
@@ -2205,6 +2182,7 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 		break;
 	case PURGE_RESV:
 		pack_func = &_pack_archive_resvs;
+		msg_type = DBD_GOT_RESVS;
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "time_start <= %ld && time_end != 0 "
 				       "order by time_start asc "
@@ -2214,6 +2192,7 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 		break;
 	case PURGE_JOB:
 		pack_func = &_pack_archive_jobs;
+		msg_type = DBD_GOT_JOBS;
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "time_submit < %ld && time_end != 0 "
 				       "&& !deleted order by time_submit asc "
@@ -2223,6 +2202,7 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 		break;
 	case PURGE_STEP:
 		pack_func = &_pack_archive_steps;
+		msg_type = DBD_STEP_START;
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "time_start <= %ld && time_end != 0 "
 				       "&& !deleted order by time_start asc "
@@ -2239,26 +2219,67 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 
 	if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
 		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
+	/* Stream the rows rather than reading them all into memory, a
+	 * month of steps can be many millions of rows. */
+	if (!(result = mysql_db_query_use(mysql_conn, query))) {
 		xfree(query);
 		return SLURM_ERROR;
 	}
 	xfree(query);
 
-	if (!(cnt = mysql_num_rows(result))) {
-		mysql_free_result(result);
-		return 0;
-	}
+	buffer = init_buf(high_buffer_size);
+	while ((row = mysql_fetch_row(result))) {
+		if (!batch_cnt)
+			cnt_offset = _archive_batch_start(buffer, msg_type,
+							  cluster_name);
+		(*pack_func)(row, &period_start, buffer);
+		cnt++;
+		if ((++batch_cnt < MAX_ARCHIVE_BATCH) &&
+		    (get_buf_offset(buffer) < MAX_ARCHIVE_BATCH_SIZE))
+			continue;
 
-	buffer = (*pack_func)(result, cluster_name, cnt, &period_start);
+		/* The file is named after the first record's time */
+		if (!arch_file &&
+		    !(arch_file = archive_file_create(cluster_name,
+						      period_start, period_end,
+						      arch_dir,
+						      purge_type_str[type],
+						      archive_period))) {
+			error_code = SLURM_ERROR;
+			break;
+		}
+		if ((error_code = _archive_batch_write(arch_file, buffer,
+						       cnt_offset, batch_cnt)))
+			break;
+		batch_cnt = 0;
+	}
+	if (!error_code && mysql_errno(mysql_conn->db_conn)) {
+		error("Couldn't fetch %s records to archive: %s",
+		      purge_type_str[type], mysql_error(mysql_conn->db_conn));
+		error_code = SLURM_ERROR;
+	}
+	/* Discards any rows not fetched */
 	mysql_free_result(result);
 
-	error_code = archive_write_file(buffer, cluster_name,
-					period_start, period_end,
-					arch_dir, purge_type_str[type],
-					archive_period);
+	if (!error_code && batch_cnt) {
+		if (!arch_file &&
+		    !(arch_file = archive_file_create(cluster_name,
+						      period_start, period_end,
+						      arch_dir,
+						      purge_type_str[type],
+						      archive_period)))
+			error_code = SLURM_ERROR;
+		else
+			error_code = _archive_batch_write(arch_file, buffer,
+							  cnt_offset,
+							  batch_cnt);
+	}
 	free_buf(buffer);
 
+	if (arch_file &&
+	    (archive_file_close(arch_file, !error_code) != SLURM_SUCCESS))
+		error_code = SLURM_ERROR;
+
 	if (error_code != SLURM_SUCCESS)
 		return error_code;
 
@@ -2543,79 +2564,14 @@ extern int as_mysql_jobacct_process_archive(mysql_conn_t *mysql_conn,
 	return rc;
 }
 
-extern int as_mysql_jobacct_process_archive_load(
-	mysql_conn_t *mysql_conn, slurmdb_archive_rec_t *arch_rec)
+/* Load the records in a single archive buffer */
+static int _load_archive_buffer(mysql_conn_t *mysql_conn, Buf buffer)
 {
 	char *data = NULL, *cluster_name = NULL;
-	int error_code = SLURM_SUCCESS;
-	Buf buffer;
+	int error_code;
 	time_t buf_time;
 	uint16_t type = 0, ver = 0;
-	uint32_t data_size = 0, rec_cnt = 0, tmp32 = 0;
-
-	if (!arch_rec) {
-		error("We need a slurmdb_archive_rec to load anything.");
-		return SLURM_ERROR;
-	}
-
-	if (arch_rec->insert) {
-		data = xstrdup(arch_rec->insert);
-	} else if (arch_rec->archive_file) {
-		int data_allocated, data_read = 0;
-		int state_fd = open(arch_rec->archive_file, O_RDONLY);
-		if (state_fd < 0) {
-			info("No archive file (%s) to recover",
-			     arch_rec->archive_file);
-			error_code = ENOENT;
-		} else {
-			data_allocated = BUF_SIZE;
-			data = xmalloc(data_allocated);
-			while (1) {
-				data_read = read(state_fd, &data[data_size],
-						 BUF_SIZE);
-				if (data_read < 0) {
-					if (errno == EINTR)
-						continue;
-					else {
-						error("Read error on %s: %m",
-						      arch_rec->archive_file);
-						break;
-					}
-				} else if (data_read == 0)	/* eof */
-					break;
-				data_size      += data_read;
-				data_allocated += data_read;
-				xrealloc(data, data_allocated);
-			}
-			close(state_fd);
-		}
-		if (error_code != SLURM_SUCCESS) {
-			xfree(data);
-			return error_code;
-		}
-	} else {
-		error("Nothing was set in your "
-		      "slurmdb_archive_rec so I am unable to process.");
-		return SLURM_ERROR;
-	}
-
-	if (!data) {
-		error("It doesn't appear we have anything to load.");
-		return SLURM_ERROR;
-	}
-
-	/* this is the old version of an archive file where the file
-	   was straight sql. */
-	if ((strlen(data) >= 12)
-	    && (!xstrncmp("insert into ", data, 12)
-		|| !xstrncmp("delete from ", data, 12)
-		|| !xstrncmp("drop table ", data, 11)
-		|| !xstrncmp("truncate table ", data, 15))) {
-		_process_old_sql(&data);
-		goto got_sql;
-	}
-
-	buffer = create_buf(data, data_size);
+	uint32_t rec_cnt = 0, tmp32 = 0;
 
 	safe_unpack16(&ver, buffer);
 	if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
@@ -2632,7 +2588,6 @@ extern int as_mysql_jobacct_process_archive_load(
 		      "got %u need <= %u", ver,
 		      SLURM_PROTOCOL_VERSION);
 		error("***********************************************");
-		free_buf(buffer);
 		return EFAULT;
 	}
 	safe_unpack_time(&buf_time, buffer);
@@ -2643,8 +2598,7 @@ extern int as_mysql_jobacct_process_archive_load(
 	if (!rec_cnt) {
 		error("we didn't get any records from this file of type '%s'",
 		      slurmdbd_msg_type_2_str(type, 0));
-		free_buf(buffer);
-		goto got_sql;
+		goto unpack_error;
 	}
 
 	switch(type) {
@@ -2667,9 +2621,7 @@ extern int as_mysql_jobacct_process_archive_load(
 		error("Unknown type '%u' to load from archive", type);
 		break;
 	}
-	free_buf(buffer);
 
-got_sql:
 	if (!data) {
 		error("No data to load");
 		return SLURM_ERROR;
@@ -2678,11 +2630,149 @@ got_sql:
 		DB_DEBUG(mysql_conn->conn, "query\n%s", data);
 	error_code = mysql_db_query_check_after(mysql_conn, data);
 	xfree(data);
-	if (error_code != SLURM_SUCCESS) {
-	unpack_error:
-		error("Couldn't load old data");
+	if (error_code != SLURM_SUCCESS)
+		goto unpack_error;
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("Couldn't load old data");
+	return SLURM_ERROR;
+}
+
+/* Load an archive written as a stream of buffers, one buffer at a time so
+ * that archives of any size can be loaded. */
+static int _load_archive_stream(mysql_conn_t *mysql_conn,
+				archive_file_t *arch_file, char *file_name)
+{
+	char *data;
+	uint32_t size;
+	int amount, rc;
+	Buf buffer;
+
+	while ((amount = archive_file_read(arch_file, &size, sizeof(size)))
+	       == sizeof(size)) {
+		size = ntohl(size);
+		if (size > MAX_BUF_SIZE) {
+			error("Bad record size %u in archive file %s",
+			      size, file_name);
+			return SLURM_ERROR;
+		}
+		data = xmalloc_nz(size);
+		if (archive_file_read(arch_file, data, size) != size) {
+			error("Archive file %s is truncated", file_name);
+			xfree(data);
+			return SLURM_ERROR;
+		}
+		buffer = create_buf(data, size);
+		rc = _load_archive_buffer(mysql_conn, buffer);
+		free_buf(buffer);
+		if (rc != SLURM_SUCCESS)
+			return rc;
+	}
+
+	if (amount != 0) {
+		error("Archive file %s is truncated", file_name);
 		return SLURM_ERROR;
 	}
 
 	return SLURM_SUCCESS;
 }
+
+extern int as_mysql_jobacct_process_archive_load(
+	mysql_conn_t *mysql_conn, slurmdb_archive_rec_t *arch_rec)
+{
+	char *data = NULL;
+	int error_code = SLURM_SUCCESS;
+	Buf buffer;
+	uint32_t data_size = 0;
+
+	if (!arch_rec) {
+		error("We need a slurmdb_archive_rec to load anything.");
+		return SLURM_ERROR;
+	}
+
+	if (arch_rec->insert) {
+		data = xstrdup(arch_rec->insert);
+	} else if (arch_rec->archive_file) {
+		archive_file_t *arch_file;
+		int data_allocated, data_read = 0;
+		uint32_t magic = 0;
+
+		if (!(arch_file = archive_file_open(arch_rec->archive_file))) {
+			info("No archive file (%s) to recover",
+			     arch_rec->archive_file);
+			return ENOENT;
+		}
+
+		data_read = archive_file_read(arch_file, &magic,
+					      sizeof(magic));
+		if ((data_read == sizeof(magic)) &&
+		    (ntohl(magic) == ARCHIVE_STREAM_MAGIC)) {
+			error_code = _load_archive_stream(
+				mysql_conn, arch_file, arch_rec->archive_file);
+			archive_file_close(arch_file, false);
+			return error_code;
+		}
+
+		/* An older archive, which is read whole */
+		if (data_read > 0)
+			data_size = data_read;
+		data_allocated = BUF_SIZE + data_size;
+		data = xmalloc(data_allocated);
+		memcpy(data, &magic, data_size);
+		while (1) {
+			data_read = archive_file_read(arch_file,
+						      &data[data_size],
+						      BUF_SIZE);
+			if (data_read < 0) {
+				error("Read error on %s: %m",
+				      arch_rec->archive_file);
+				break;
+			} else if (data_read == 0)	/* eof */
+				break;
+			data_size      += data_read;
+			data_allocated += data_read;
+			xrealloc(data, data_allocated);
+		}
+		archive_file_close(arch_file, false);
+	} else {
+		error("Nothing was set in your "
+		      "slurmdb_archive_rec so I am unable to process.");
+		return SLURM_ERROR;
+	}
+
+	if (!data) {
+		error("It doesn't appear we have anything to load.");
+		return SLURM_ERROR;
+	}
+
+	/* this is the old version of an archive file where the file
+	   was straight sql. */
+	if ((strlen(data) >= 12)
+	    && (!xstrncmp("insert into ", data, 12)
+		|| !xstrncmp("delete from ", data, 12)
+		|| !xstrncmp("drop table ", data, 11)
+		|| !xstrncmp("truncate table ", data, 15))) {
+		_process_old_sql(&data);
+		if (!data) {
+			error("No data to load");
+			return SLURM_ERROR;
+		}
+		if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
+			DB_DEBUG(mysql_conn->conn, "query\n%s", data);
+		error_code = mysql_db_query_check_after(mysql_conn, data);
+		xfree(data);
+		if (error_code != SLURM_SUCCESS) {
+			error("Couldn't load old data");
+			return SLURM_ERROR;
+		}
+		return SLURM_SUCCESS;
+	}
+
+	buffer = create_buf(data, data_size);
+	error_code = _load_archive_buffer(mysql_conn, buffer);
+	free_buf(buffer);
+
+	return error_code;
+}
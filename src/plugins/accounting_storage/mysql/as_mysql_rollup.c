@@ -40,8 +40,10 @@
 
 #include "as_mysql_rollup.h"
 #include "as_mysql_archive.h"
+#include "src/common/id_hash.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_time.h"
+#include "src/common/timers.h"
 
 enum {
 	TIME_ALLOC,
@@ -88,6 +90,17 @@ typedef struct {
 	time_t start;
 } local_resv_usage_t;
 
+/* A range of hours rolled up by one thread with its own connection */
+typedef struct {
+	char *cluster_name;
+	time_t end;
+	mysql_conn_t *mysql_conn;	/* parent thread's connection */
+	int rc;
+	rollup_stats_t rollup_stats;
+	time_t start;
+	pthread_t thread_id;
+} local_hour_range_t;
+
 static void _destroy_local_tres_usage(void *object)
 {
 	local_tres_usage_t *a_usage = (local_tres_usage_t *)object;
@@ -134,16 +147,6 @@ static int _find_loc_tres(void *x, void *key)
 	return 0;
 }
 
-static int _find_id_usage(void *x, void *key)
-{
-	local_id_usage_t *loc = (local_id_usage_t *)x;
-	uint32_t id = *(uint32_t *)key;
-
-	if (loc->id == id)
-		return 1;
-	return 0;
-}
-
 static void _remove_job_tres_time_from_cluster(List c_tres, List j_tres,
 					       int seconds)
 {
@@ -877,10 +880,21 @@ static local_cluster_usage_t *_setup_cluster_usage(mysql_conn_t *mysql_conn,
 	return c_usage;
 }
 
-extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
-				  char *cluster_name,
-				  time_t start, time_t end,
-				  uint16_t archive_data)
+/* Record the time taken to roll up one hour, day or month */
+static void _add_unit_time(rollup_stats_t *rollup_stats, int type,
+			   long usec)
+{
+	if (!rollup_stats)
+		return;
+	rollup_stats->rollup_units[type]++;
+	rollup_stats->rollup_max_unit_time[type] =
+		MAX(rollup_stats->rollup_max_unit_time[type], usec);
+}
+
+/* Roll up each hour from start to end, without committing */
+static int _hourly_rollup(mysql_conn_t *mysql_conn, char *cluster_name,
+			  time_t start, time_t end,
+			  rollup_stats_t *rollup_stats)
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
@@ -905,6 +919,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	local_resv_usage_t *r_usage = NULL;
 	local_id_usage_t *a_usage = NULL;
 	local_id_usage_t *w_usage = NULL;
+	id_hash_t *assoc_hash = NULL;	/* a_usage by id */
+	id_hash_t *wckey_hash = NULL;	/* w_usage by id */
+	DEF_TIMERS;
 	/* char start_char[20], end_char[20]; */
 
 	char *job_req_inx[] = {
@@ -998,6 +1015,10 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		int last_id = -1;
 		int last_wckeyid = -1;
 
+		START_TIMER;
+		assoc_hash = id_hash_init(0);
+		wckey_hash = id_hash_init(0);
+
 		if (debug_flags & DEBUG_FLAG_DB_USAGE)
 			DB_DEBUG(mysql_conn->conn,
 				 "%s curr hour is now %ld-%ld",
@@ -1224,15 +1245,17 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 				mysql_free_result(result2);
 			}
 
-			if (last_id != assoc_id) {
+			if ((last_id != assoc_id) &&
+			    !(a_usage = id_hash_find(assoc_hash, assoc_id))) {
 				a_usage = xmalloc(sizeof(local_id_usage_t));
 				a_usage->id = assoc_id;
 				list_append(assoc_usage_list, a_usage);
-				last_id = assoc_id;
+				id_hash_add(assoc_hash, assoc_id, a_usage);
 				/* a_usage->loc_tres is made later,
 				   don't do it here.
 				*/
 			}
+			last_id = assoc_id;
 
 			/* Short circuit this so so we don't get a pointer. */
 			if (!track_wckey)
@@ -1240,17 +1263,15 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 			/* do the wckey calculation */
 			if (last_wckeyid != wckey_id) {
-				list_iterator_reset(w_itr);
-				while ((w_usage = list_next(w_itr)))
-					if (w_usage->id == wckey_id)
-						break;
-
+				w_usage = id_hash_find(wckey_hash, wckey_id);
 				if (!w_usage) {
 					w_usage = xmalloc(
 						sizeof(local_id_usage_t));
 					w_usage->id = wckey_id;
 					list_append(wckey_usage_list,
 						    w_usage);
+					id_hash_add(wckey_hash, wckey_id,
+						    w_usage);
 					w_usage->loc_tres = list_create(
 						_destroy_local_tres_usage);
 				}
@@ -1475,15 +1496,15 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 				while ((assoc = list_next(tmp_itr))) {
 					uint32_t associd = slurm_atoul(assoc);
 					if ((last_id != associd) &&
-					    !(a_usage = list_find_first(
-						      assoc_usage_list,
-						      _find_id_usage,
-						      &associd))) {
+					    !(a_usage = id_hash_find(
+						      assoc_hash, associd))) {
 						a_usage = xmalloc(
 							sizeof(local_id_usage_t));
 						a_usage->id = associd;
 						list_append(assoc_usage_list,
 							    a_usage);
+						id_hash_add(assoc_hash, associd,
+							    a_usage);
 						last_id = associd;
 						a_usage->loc_tres = list_create(
 							_destroy_local_tres_usage);
@@ -1558,6 +1579,15 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		}
 
 	end_loop:
+		END_TIMER;
+		_add_unit_time(rollup_stats, ROLLUP_HOUR, DELTA_TIMER);
+		if (debug_flags & DEBUG_FLAG_DB_USAGE)
+			DB_DEBUG(mysql_conn->conn,
+				 "%s hour %ld rolled up in %s",
+				 cluster_name, curr_start, TIME_STR);
+		id_hash_free(assoc_hash);
+		id_hash_free(wckey_hash);
+		assoc_hash = wckey_hash = NULL;
 		_destroy_local_cluster_usage(c_usage);
 		_destroy_local_id_usage(a_usage);
 		_destroy_local_id_usage(w_usage);
@@ -1592,6 +1622,11 @@ end_it:
 	if (r_itr)
 		list_iterator_destroy(r_itr);
 
+	if (assoc_hash)
+		id_hash_free(assoc_hash);
+	if (wckey_hash)
+		id_hash_free(wckey_hash);
+
 	FREE_NULL_LIST(assoc_usage_list);
 	FREE_NULL_LIST(cluster_down_list);
 	FREE_NULL_LIST(wckey_usage_list);
@@ -1600,15 +1635,125 @@ end_it:
 /* 	info("stop start %s", slurm_ctime2(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime2(&curr_end)); */
 
+	return rc;
+}
+
+static void *_hourly_rollup_thread(void *arg)
+{
+	local_hour_range_t *range = (local_hour_range_t *) arg;
+	mysql_conn_t mysql_conn;
+
+	/* Each thread needs it's own connection, as in
+	 * _cluster_rollup_usage() */
+	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
+	mysql_conn.rollback = 1;
+	mysql_conn.conn = range->mysql_conn->conn;
+	slurm_mutex_init(&mysql_conn.lock);
+
+	range->rc = check_connection(&mysql_conn);
+	if (range->rc == SLURM_SUCCESS)
+		range->rc = _hourly_rollup(&mysql_conn, range->cluster_name,
+					   range->start, range->end,
+					   &range->rollup_stats);
+	if (range->rc == SLURM_SUCCESS) {
+		if (mysql_db_commit(&mysql_conn))
+			range->rc = SLURM_ERROR;
+	} else if (mysql_db_rollback(&mysql_conn))
+		error("rollback failed");
+
+	mysql_db_close_db_connection(&mysql_conn);
+	slurm_mutex_destroy(&mysql_conn.lock);
+
+	return NULL;
+}
+
+/*
+ * Roll up the hours in ranges, each on its own connection. Every hour is
+ * independent of the others and rerunning an hour replaces its usage, so
+ * a failed range is simply rolled up again next time.
+ */
+static int _hourly_rollup_parallel(mysql_conn_t *mysql_conn,
+				   char *cluster_name,
+				   time_t start, time_t end, int thread_cnt,
+				   rollup_stats_t *rollup_stats)
+{
+	local_hour_range_t *ranges;
+	int hours = (end - start + 3599) / 3600;
+	int i, j, range_hours, rc = SLURM_SUCCESS;
+	time_t range_start = start;
+	pthread_attr_t attr;
+
+	ranges = xmalloc(sizeof(local_hour_range_t) * thread_cnt);
+	for (i = 0; i < thread_cnt; i++) {
+		/* The first ranges take any remainder */
+		range_hours = (hours / thread_cnt) +
+			      ((i < (hours % thread_cnt)) ? 1 : 0);
+		ranges[i].cluster_name = cluster_name;
+		ranges[i].mysql_conn = mysql_conn;
+		ranges[i].start = range_start;
+		ranges[i].end = MIN(end, range_start + (range_hours * 3600));
+		range_start = ranges[i].end;
+
+		slurm_attr_init(&attr);
+		if (pthread_create(&ranges[i].thread_id, &attr,
+				   _hourly_rollup_thread, &ranges[i]))
+			fatal("pthread_create: %m");
+		slurm_attr_destroy(&attr);
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		pthread_join(ranges[i].thread_id, NULL);
+		if ((ranges[i].rc != SLURM_SUCCESS) && (rc == SLURM_SUCCESS))
+			rc = ranges[i].rc;
+		if (!rollup_stats)
+			continue;
+		for (j = 0; j < ROLLUP_COUNT; j++) {
+			rollup_stats->rollup_units[j] +=
+				ranges[i].rollup_stats.rollup_units[j];
+			rollup_stats->rollup_max_unit_time[j] = MAX(
+				rollup_stats->rollup_max_unit_time[j],
+				ranges[i].rollup_stats.rollup_max_unit_time[j]);
+		}
+	}
+	xfree(ranges);
+
+	return rc;
+}
+
+extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end,
+				  uint16_t archive_data,
+				  rollup_stats_t *rollup_stats)
+{
+	int rc, thread_cnt = 1;
+	int hours = (end - start + 3599) / 3600;
+
+	if (slurmdbd_conf && slurmdbd_conf->rollup_threads)
+		thread_cnt = slurmdbd_conf->rollup_threads;
+	thread_cnt = MIN(thread_cnt, hours);
+
+	if (thread_cnt > 1) {
+		if (debug_flags & DEBUG_FLAG_DB_USAGE)
+			DB_DEBUG(mysql_conn->conn,
+				 "%s rolling up %d hours with %d threads",
+				 cluster_name, hours, thread_cnt);
+		rc = _hourly_rollup_parallel(mysql_conn, cluster_name,
+					     start, end, thread_cnt,
+					     rollup_stats);
+	} else
+		rc = _hourly_rollup(mysql_conn, cluster_name, start, end,
+				    rollup_stats);
+
 	/* go check to see if we archive and purge */
 
 	if (rc == SLURM_SUCCESS) {
 		if (mysql_db_commit(mysql_conn)) {
-			char start[25], end[25];
+			char start_str[25], end_str[25];
 			error("Couldn't commit cluster (%s) "
 			      "hour rollup for %s - %s",
-			      cluster_name, slurm_ctime2_r(&curr_start, start),
-			      slurm_ctime2_r(&curr_end, end));
+			      cluster_name, slurm_ctime2_r(&start, start_str),
+			      slurm_ctime2_r(&end, end_str));
 			rc = SLURM_ERROR;
 		} else
 			rc = _process_purge(mysql_conn, cluster_name,
@@ -1621,7 +1766,8 @@ extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
 				   bool run_month,
 				   char *cluster_name,
 				   time_t start, time_t end,
-				   uint16_t archive_data)
+				   uint16_t archive_data,
+				   rollup_stats_t *rollup_stats)
 {
 	/* can't just add 86400 since daylight savings starts and ends every
 	 * once in a while
@@ -1634,8 +1780,10 @@ extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
 	char *query = NULL;
 	uint16_t track_wckey = slurm_get_track_wckey();
 	char *unit_name;
+	DEF_TIMERS;
 
 	while (curr_start < end) {
+		START_TIMER;
 		if (!slurm_localtime_r(&curr_start, &start_tm)) {
 			error("Couldn't get localtime from start %ld",
 			      curr_start);
@@ -1736,6 +1884,10 @@ extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
 			error("Couldn't add %s rollup", unit_name);
 			return SLURM_ERROR;
 		}
+		END_TIMER;
+		_add_unit_time(rollup_stats,
+			       run_month ? ROLLUP_MONTH : ROLLUP_DAY,
+			       DELTA_TIMER);
 
 		curr_start = curr_end;
 	}
@@ -82,6 +82,7 @@ static void *_cluster_rollup_usage(void *arg)
 	time_t month_start;
 	time_t month_end;
 	long rollup_time[ROLLUP_COUNT];
+	rollup_stats_t unit_stats;
 	DEF_TIMERS;
 
 	char *update_req_inx[] = {
@@ -92,6 +93,7 @@ static void *_cluster_rollup_usage(void *arg)
 
 	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
 	memset(rollup_time, 0, sizeof(long) * ROLLUP_COUNT);
+	memset(&unit_stats, 0, sizeof(rollup_stats_t));
 	mysql_conn.rollback = 1;
 	mysql_conn.conn = local_rollup->mysql_conn->conn;
 	slurm_mutex_init(&mysql_conn.lock);
@@ -296,7 +298,8 @@ static void *_cluster_rollup_usage(void *arg)
 					    local_rollup->cluster_name,
 					    hour_start,
 					    hour_end,
-					    local_rollup->archive_data);
+					    local_rollup->archive_data,
+					    &unit_stats);
 		snprintf(timer_str, sizeof(timer_str),
 			 "hourly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -311,7 +314,8 @@ static void *_cluster_rollup_usage(void *arg)
 					     local_rollup->cluster_name,
 					     day_start,
 					     day_end,
-					     local_rollup->archive_data);
+					     local_rollup->archive_data,
+					     &unit_stats);
 		snprintf(timer_str, sizeof(timer_str),
 			 "daily_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -326,7 +330,8 @@ static void *_cluster_rollup_usage(void *arg)
 					     local_rollup->cluster_name,
 					     month_start,
 					     month_end,
-					     local_rollup->archive_data);
+					     local_rollup->archive_data,
+					     &unit_stats);
 		snprintf(timer_str, sizeof(timer_str),
 			 "monthly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -398,6 +403,12 @@ end_it:
 		for (i = 0; i < ROLLUP_COUNT; i++) {
 			local_rollup->rollup_stats->rollup_time[i] +=
 				rollup_time[i];
+			local_rollup->rollup_stats->rollup_units[i] +=
+				unit_stats.rollup_units[i];
+			local_rollup->rollup_stats->rollup_max_unit_time[i] =
+				MAX(local_rollup->rollup_stats->
+				    rollup_max_unit_time[i],
+				    unit_stats.rollup_max_unit_time[i]);
 		}
 	}
 	if ((rc != SLURM_SUCCESS) && ((*local_rollup->rc) == SLURM_SUCCESS))
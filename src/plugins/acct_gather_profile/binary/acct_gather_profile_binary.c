@@ -0,0 +1,698 @@
+/*****************************************************************************\
+ *  acct_gather_profile_binary.c - slurm accounting plugin for profiling
+ *                                 into memory mapped binary files.
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "src/common/slurm_xlator.h"
+#include "src/common/fd.h"
+#include "src/common/slurm_acct_gather_profile.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/slurmd/common/proctrack.h"
+#include "profile_binary.h"
+
+/*
+ * These variables are required by the generic plugin interface.  If they
+ * are not found in the plugin, the plugin loader will ignore it.
+ *
+ * plugin_name - a string giving a human-readable description of the
+ * plugin.  There is no maximum length, but the symbol must refer to
+ * a valid string.
+ *
+ * plugin_type - a string suggesting the type of the plugin or its
+ * applicability to a particular form of data or method of data handling.
+ * If the low-level plugin API is used, the contents of this string are
+ * unimportant and may be anything.  SLURM uses the higher-level plugin
+ * interface which requires this string to be of the form
+ *
+ *	<application>/<method>
+ *
+ * where <application> is a description of the intended application of
+ * the plugin (e.g., "jobacct" for SLURM job completion logging) and <method>
+ * is a description of how this plugin satisfies that application.  SLURM will
+ * only load job completion logging plugins if the plugin_type string has a
+ * prefix of "jobacct/".
+ *
+ * plugin_version - an unsigned 32-bit integer containing the Slurm version
+ * (major.minor.micro combined into a single number).
+ */
+const char plugin_name[] = "AcctGatherProfile binary plugin";
+const char plugin_type[] = "acct_gather_profile/binary";
+const uint32_t plugin_version = SLURM_VERSION_NUMBER;
+
+typedef struct {
+	char *dir;
+	uint32_t def;
+} slurm_binary_conf_t;
+
+/* A dataset and the data block currently being filled */
+typedef struct {
+	uint32_t field_cnt;
+	pbin_block_t *block;		/* NULL until the first sample */
+	uint64_t *columns;		/* First column of block */
+	void *map_addr;			/* Mapping holding block */
+	size_t map_len;
+} table_t;
+
+/*
+ * The file stays open for the duration of the step. Static variables are ok
+ * as the add functions are called under the plugin's profile_mutex.
+ */
+static int       file_fd = -1;
+static uint64_t  file_size = 0;		/* End of the last block */
+static slurm_binary_conf_t binary_conf;
+static uint64_t debug_flags = 0;
+static uint32_t g_profile_running = ACCT_GATHER_PROFILE_NOT_SET;
+static stepd_step_rec_t *g_job = NULL;
+static time_t step_start_time;
+static long sys_page_size = PBIN_PAGE_SIZE;
+
+static char **groups = NULL;
+static size_t groups_len = 0;
+static table_t *tables = NULL;
+static size_t   tables_max_len = 0;
+static size_t   tables_cur_len = 0;
+
+static void _reset_slurm_profile_conf(void)
+{
+	xfree(binary_conf.dir);
+	binary_conf.def = ACCT_GATHER_PROFILE_NONE;
+}
+
+static uint32_t _determine_profile(void)
+{
+	uint32_t profile;
+	xassert(g_job);
+
+	if (g_profile_running != ACCT_GATHER_PROFILE_NOT_SET)
+		profile = g_profile_running;
+	else if (g_job->profile >= ACCT_GATHER_PROFILE_NONE)
+		profile = g_job->profile;
+	else
+		profile = binary_conf.def;
+
+	return profile;
+}
+
+static int _create_directories(void)
+{
+	int rc;
+	struct stat st;
+	char   *user_dir = NULL;
+
+	xassert(g_job);
+	xassert(binary_conf.dir);
+	/*
+	 * If profile director does not exist, try to create it.
+	 *  Otherwise, ensure path is a directory as expected, and that
+	 *  we have permission to write to it.
+	 */
+
+	if (((rc = stat(binary_conf.dir, &st)) < 0) && (errno == ENOENT)) {
+		if (mkdir(binary_conf.dir, 0755) < 0)
+			fatal("mkdir(%s): %m", binary_conf.dir);
+	} else if (rc < 0)
+		fatal("Unable to stat acct_gather_profile_dir: %s: %m",
+		      binary_conf.dir);
+	else if (!S_ISDIR(st.st_mode))
+		fatal("acct_gather_profile_dir: %s: Not a directory!",
+		      binary_conf.dir);
+	else if (access(binary_conf.dir, R_OK|W_OK|X_OK) < 0)
+		fatal("Incorrect permissions on acct_gather_profile_dir: %s",
+		      binary_conf.dir);
+	chmod(binary_conf.dir, 0755);
+
+	user_dir = xstrdup_printf("%s/%s", binary_conf.dir, g_job->user_name);
+	if (((rc = stat(user_dir, &st)) < 0) && (errno == ENOENT)) {
+		if (mkdir(user_dir, 0700) < 0)
+			fatal("mkdir(%s): %m", user_dir);
+	}
+	chmod(user_dir, 0700);
+	if (chown(user_dir, (uid_t)g_job->uid,
+		  (gid_t)g_job->gid) < 0)
+		error("chown(%s): %m", user_dir);
+
+	xfree(user_dir);
+
+	return SLURM_SUCCESS;
+}
+
+static bool _run_in_daemon(void)
+{
+	static bool set = false;
+	static bool run = false;
+
+	if (!set) {
+		set = 1;
+		run = run_in_daemon("slurmstepd");
+	}
+
+	return run;
+}
+
+/* Write a block of len bytes (header included) at the end of the file */
+static int _append_block(pbin_block_t *block, uint64_t len)
+{
+	uint64_t off = file_size;
+	char *ptr = (char *) block;
+	ssize_t wrote;
+
+	block->magic = PBIN_BLOCK_MAGIC;
+	block->length = len;
+	if (ftruncate(file_fd, off + len) < 0) {
+		error("PROFILE: ftruncate: %m");
+		return SLURM_ERROR;
+	}
+	while (len > 0) {
+		wrote = pwrite(file_fd, ptr, len, off);
+		if (wrote < 0) {
+			if (errno == EINTR)
+				continue;
+			error("PROFILE: write: %m");
+			return SLURM_ERROR;
+		}
+		ptr += wrote;
+		off += wrote;
+		len -= wrote;
+	}
+	file_size = off;
+
+	return SLURM_SUCCESS;
+}
+
+static void _unmap_table(table_t *table)
+{
+	if (table->map_addr)
+		(void) munmap(table->map_addr, table->map_len);
+	table->map_addr = NULL;
+	table->block = NULL;
+	table->columns = NULL;
+}
+
+/* Add an empty data block for table to the end of the file and map it */
+static int _new_data_block(int table_id)
+{
+	table_t *table = &tables[table_id];
+	uint64_t len = PBIN_DATA_BLOCK_LEN(table->field_cnt,
+					   PBIN_BLOCK_RECORDS);
+	uint64_t off = file_size, map_off;
+	void *addr;
+
+	_unmap_table(table);
+
+	if (ftruncate(file_fd, off + len) < 0) {
+		error("PROFILE: ftruncate: %m");
+		return SLURM_ERROR;
+	}
+
+	/* Blocks are aligned to PBIN_PAGE_SIZE, which may be smaller than the
+	 * system's page size */
+	map_off = off - (off % sys_page_size);
+	addr = mmap(NULL, len + (off - map_off), PROT_READ | PROT_WRITE,
+		    MAP_SHARED, file_fd, map_off);
+	if (addr == MAP_FAILED) {
+		error("PROFILE: mmap: %m");
+		return SLURM_ERROR;
+	}
+	file_size = off + len;
+
+	table->map_addr = addr;
+	table->map_len = len + (off - map_off);
+	table->block = (pbin_block_t *) ((char *) addr + (off - map_off));
+	table->block->magic = PBIN_BLOCK_MAGIC;
+	table->block->type = PBIN_BLOCK_DATA;
+	table->block->dataset = table_id;
+	table->block->capacity = PBIN_BLOCK_RECORDS;
+	table->block->count = 0;
+	table->block->length = len;
+	table->columns = (uint64_t *) (table->block + 1);
+
+	return SLURM_SUCCESS;
+}
+
+static void _close_file(void)
+{
+	size_t i;
+
+	for (i = 0; i < tables_cur_len; i++)
+		_unmap_table(&tables[i]);
+	tables_cur_len = 0;
+	for (i = 0; i < groups_len; i++)
+		xfree(groups[i]);
+	groups_len = 0;
+	if (file_fd >= 0) {
+		/* Nothing is mapped any more, the user may have the file */
+		if (fchown(file_fd, (uid_t)g_job->uid, (gid_t)g_job->gid) < 0)
+			error("PROFILE: fchown: %m");
+		close(file_fd);
+	}
+	file_fd = -1;
+	file_size = 0;
+}
+
+/*
+ * init() is called when the plugin is loaded, before any other functions
+ * are called.  Put global initialization here.
+ */
+extern int init(void)
+{
+	if (!_run_in_daemon())
+		return SLURM_SUCCESS;
+
+	debug_flags = slurm_get_debug_flags();
+	sys_page_size = sysconf(_SC_PAGESIZE);
+	if (sys_page_size < 1)
+		sys_page_size = PBIN_PAGE_SIZE;
+
+	return SLURM_SUCCESS;
+}
+
+extern int fini(void)
+{
+	_close_file();
+	xfree(tables);
+	xfree(groups);
+	xfree(binary_conf.dir);
+	return SLURM_SUCCESS;
+}
+
+extern void acct_gather_profile_p_conf_options(s_p_options_t **full_options,
+					       int *full_options_cnt)
+{
+	s_p_options_t options[] = {
+		{"ProfileBinaryDir", S_P_STRING},
+		{"ProfileBinaryDefault", S_P_STRING},
+		{NULL} };
+
+	transfer_s_p_options(full_options, options, full_options_cnt);
+	return;
+}
+
+extern void acct_gather_profile_p_conf_set(s_p_hashtbl_t *tbl)
+{
+	char *tmp = NULL;
+	_reset_slurm_profile_conf();
+	if (tbl) {
+		s_p_get_string(&binary_conf.dir, "ProfileBinaryDir", tbl);
+
+		if (s_p_get_string(&tmp, "ProfileBinaryDefault", tbl)) {
+			binary_conf.def = acct_gather_profile_from_string(tmp);
+			if (binary_conf.def == ACCT_GATHER_PROFILE_NOT_SET) {
+				fatal("ProfileBinaryDefault can not be "
+				      "set to %s, please specify a valid "
+				      "option", tmp);
+			}
+			xfree(tmp);
+		}
+	}
+
+	if (!binary_conf.dir)
+		fatal("No ProfileBinaryDir in your acct_gather.conf file.  "
+		      "This is required to use the %s plugin", plugin_type);
+
+	debug("%s loaded", plugin_name);
+}
+
+extern void acct_gather_profile_p_get(enum acct_gather_profile_info info_type,
+				      void *data)
+{
+	uint32_t *uint32 = (uint32_t *) data;
+	char **tmp_char = (char **) data;
+
+	switch (info_type) {
+	case ACCT_GATHER_PROFILE_DIR:
+		*tmp_char = xstrdup(binary_conf.dir);
+		break;
+	case ACCT_GATHER_PROFILE_DEFAULT:
+		*uint32 = binary_conf.def;
+		break;
+	case ACCT_GATHER_PROFILE_RUNNING:
+		*uint32 = g_profile_running;
+		break;
+	default:
+		debug2("acct_gather_profile_p_get info_type %d invalid",
+		       info_type);
+	}
+}
+
+extern int acct_gather_profile_p_node_step_start(stepd_step_rec_t* job)
+{
+	int rc = SLURM_SUCCESS;
+	char *profile_file_name;
+	char *profile_str;
+	pbin_header_t *header;
+
+	xassert(_run_in_daemon());
+
+	g_job = job;
+
+	xassert(binary_conf.dir);
+
+	if (debug_flags & DEBUG_FLAG_PROFILE) {
+		profile_str = acct_gather_profile_to_string(g_job->profile);
+		info("PROFILE: option --profile=%s", profile_str);
+	}
+
+	if (g_profile_running == ACCT_GATHER_PROFILE_NOT_SET)
+		g_profile_running = _determine_profile();
+
+	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
+		return rc;
+
+	_create_directories();
+
+	/* Use a more user friendly string "batch" rather
+	 * then 4294967294.
+	 */
+	if (g_job->stepid == NO_VAL) {
+		profile_file_name = xstrdup_printf("%s/%s/%u_%s_%s.%s",
+						   binary_conf.dir,
+						   g_job->user_name,
+						   g_job->jobid,
+						   "batch",
+						   g_job->node_name,
+						   PBIN_SUFFIX);
+	} else {
+		profile_file_name = xstrdup_printf(
+			"%s/%s/%u_%u_%s.%s",
+			binary_conf.dir, g_job->user_name,
+			g_job->jobid, g_job->stepid, g_job->node_name,
+			PBIN_SUFFIX);
+	}
+
+	if (debug_flags & DEBUG_FLAG_PROFILE) {
+		profile_str = acct_gather_profile_to_string(g_profile_running);
+		info("PROFILE: node_step_start, opt=%s file=%s",
+		     profile_str, profile_file_name);
+	}
+
+	/* The directory belongs to the user, so never follow or reuse what
+	 * is already there. The file stays owned by root while it is mapped,
+	 * so that the user can not truncate it under the mapping, and is
+	 * given to the user by _close_file(). */
+	if ((unlink(profile_file_name) < 0) && (errno != ENOENT))
+		error("PROFILE: unlink(%s): %m", profile_file_name);
+	file_fd = open(profile_file_name,
+		       O_CREAT | O_EXCL | O_NOFOLLOW | O_RDWR, 0600);
+	if (file_fd < 0) {
+		error("PROFILE: open(%s): %m", profile_file_name);
+		xfree(profile_file_name);
+		return SLURM_FAILURE;
+	}
+	fd_set_close_on_exec(file_fd);
+	xfree(profile_file_name);
+
+	step_start_time = time(NULL);
+
+	header = xmalloc(PBIN_PAGE_SIZE);
+	header->magic = PBIN_MAGIC;
+	header->version = PBIN_VERSION;
+	header->endian = PBIN_ENDIAN;
+	header->kind = PBIN_KIND_NODE;
+	header->job_id = g_job->jobid;
+	header->step_id = g_job->stepid;
+	header->node_inx = g_job->nodeid;
+	header->ntasks = g_job->node_tasks;
+	header->cpus_per_task = g_job->cpus_per_task;
+	header->block_records = PBIN_BLOCK_RECORDS;
+	header->start_time = step_start_time;
+	strncpy(header->node_name, g_job->node_name,
+		sizeof(header->node_name) - 1);
+	file_size = 0;
+	if ((ftruncate(file_fd, PBIN_PAGE_SIZE) < 0) ||
+	    (pwrite(file_fd, header, PBIN_PAGE_SIZE, 0) != PBIN_PAGE_SIZE)) {
+		error("PROFILE: Failed to write file header: %m");
+		_close_file();
+		rc = SLURM_FAILURE;
+	} else
+		file_size = PBIN_PAGE_SIZE;
+	xfree(header);
+
+	return rc;
+}
+
+extern int acct_gather_profile_p_child_forked(void)
+{
+	size_t i;
+
+	/* Leave the parent's mappings alone, just drop the child's copies */
+	for (i = 0; i < tables_cur_len; i++)
+		_unmap_table(&tables[i]);
+	if (file_fd >= 0)
+		close(file_fd);
+	file_fd = -1;
+
+	return SLURM_SUCCESS;
+}
+
+extern int acct_gather_profile_p_node_step_end(void)
+{
+	int rc = SLURM_SUCCESS;
+
+	xassert(_run_in_daemon());
+
+	xassert(g_profile_running != ACCT_GATHER_PROFILE_NOT_SET);
+
+	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
+		return rc;
+
+	if (debug_flags & DEBUG_FLAG_PROFILE)
+		info("PROFILE: node_step_end (shutdown)");
+
+	/* The samples are already in the page cache, munmap() and close()
+	 * leave writing them back to the kernel */
+	_close_file();
+
+	return rc;
+}
+
+extern int acct_gather_profile_p_task_start(uint32_t taskid)
+{
+	int rc = SLURM_SUCCESS;
+
+	xassert(_run_in_daemon());
+	xassert(g_job);
+
+	xassert(g_profile_running != ACCT_GATHER_PROFILE_NOT_SET);
+
+	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
+		return rc;
+
+	if (debug_flags & DEBUG_FLAG_PROFILE)
+		info("PROFILE: task_start");
+
+	return rc;
+}
+
+extern int acct_gather_profile_p_task_end(pid_t taskpid)
+{
+	if (debug_flags & DEBUG_FLAG_PROFILE)
+		info("PROFILE: task_end");
+	return SLURM_SUCCESS;
+}
+
+extern int acct_gather_profile_p_create_group(const char* name)
+{
+	if (file_fd < 0)
+		return SLURM_ERROR;
+
+	/* Groups only name the datasets created in them */
+	groups = xrealloc(groups, (groups_len + 1) * sizeof(char *));
+	groups[groups_len] = xstrdup(name);
+
+	return groups_len++;
+}
+
+extern int acct_gather_profile_p_create_dataset(
+	const char* name, int parent, acct_gather_profile_dataset_t *dataset)
+{
+	acct_gather_profile_dataset_t *dataset_loc = dataset;
+	pbin_block_t *block;
+	pbin_dataset_t *desc;
+	uint32_t field_cnt = 0;
+	uint64_t len;
+	int rc;
+
+	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
+		return SLURM_ERROR;
+	if (file_fd < 0)
+		return SLURM_ERROR;
+
+	debug("acct_gather_profile_p_create_dataset %s", name);
+
+	while (dataset_loc && (dataset_loc->type != PROFILE_FIELD_NOT_SET)) {
+		field_cnt++;
+		dataset_loc++;
+	}
+	if (field_cnt > PBIN_MAX_FIELDS) {
+		error("PROFILE: Too many fields (%u) in table %s",
+		      field_cnt, name);
+		return SLURM_ERROR;
+	}
+	if ((parent >= (int) groups_len) || (tables_cur_len > UINT16_MAX)) {
+		error("PROFILE: Impossible to create the table %s", name);
+		return SLURM_ERROR;
+	}
+
+	len = PBIN_PAGE_ROUND(sizeof(pbin_block_t) + sizeof(pbin_dataset_t) +
+			      (field_cnt * sizeof(pbin_field_t)));
+	block = xmalloc(len);
+	block->type = PBIN_BLOCK_DATASET;
+	block->dataset = tables_cur_len;
+	desc = (pbin_dataset_t *) (block + 1);
+	strncpy(desc->name, name, sizeof(desc->name) - 1);
+	if (parent >= 0) {
+		strncpy(desc->group, groups[parent],
+			sizeof(desc->group) - 1);
+	}
+	desc->field_cnt = field_cnt;
+	for (dataset_loc = dataset, field_cnt = 0;
+	     field_cnt < desc->field_cnt; dataset_loc++, field_cnt++) {
+		strncpy(desc->fields[field_cnt].name, dataset_loc->name,
+			sizeof(desc->fields[field_cnt].name) - 1);
+		if (dataset_loc->type == PROFILE_FIELD_DOUBLE)
+			desc->fields[field_cnt].type = PBIN_FIELD_DOUBLE;
+		else
+			desc->fields[field_cnt].type = PBIN_FIELD_UINT64;
+	}
+	rc = _append_block(block, len);
+	xfree(block);
+	if (rc != SLURM_SUCCESS) {
+		error("PROFILE: Impossible to create the table %s", name);
+		return SLURM_ERROR;
+	}
+
+	/* resize the tables array if full */
+	if (tables_cur_len == tables_max_len) {
+		if (tables_max_len == 0)
+			++tables_max_len;
+		tables_max_len *= 2;
+		tables = xrealloc(tables, tables_max_len * sizeof(table_t));
+	}
+
+	/* reserve a new table, its first data block is added with its
+	 * first sample */
+	memset(&tables[tables_cur_len], 0, sizeof(table_t));
+	tables[tables_cur_len].field_cnt = desc->field_cnt;
+	++tables_cur_len;
+
+	return tables_cur_len - 1;
+}
+
+extern int acct_gather_profile_p_add_sample_data(int table_id, void *data,
+						 time_t sample_time)
+{
+	table_t *ds;
+	uint64_t *col, *values = (uint64_t *) data;
+	uint32_t i, inx;
+
+	if (file_fd < 0) {
+		debug("PROFILE: Trying to add data but profiling is over");
+		return SLURM_SUCCESS;
+	}
+
+	if (table_id < 0 || table_id >= tables_cur_len) {
+		error("PROFILE: trying to add samples to an invalid table %d",
+		      table_id);
+		return SLURM_ERROR;
+	}
+
+	/* ensure that we have to record something */
+	xassert(_run_in_daemon());
+	xassert(g_job);
+	xassert(g_profile_running != ACCT_GATHER_PROFILE_NOT_SET);
+
+	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
+		return SLURM_ERROR;
+
+	ds = &tables[table_id];
+	if ((!ds->block || (ds->block->count >= ds->block->capacity)) &&
+	    (_new_data_block(table_id) != SLURM_SUCCESS)) {
+		error("PROFILE: Impossible to add data to the table %d",
+		      table_id);
+		return SLURM_ERROR;
+	}
+
+	/* store one value in each column, then publish the sample */
+	inx = ds->block->count;
+	col = ds->columns + inx;
+	*col = difftime(sample_time, step_start_time);
+	col += PBIN_BLOCK_RECORDS;
+	*col = sample_time;
+	for (i = 0; i < ds->field_cnt; i++) {
+		col += PBIN_BLOCK_RECORDS;
+		memcpy(col, &values[i], sizeof(uint64_t));
+	}
+	ds->block->count = inx + 1;
+
+	return SLURM_SUCCESS;
+}
+
+extern void acct_gather_profile_p_conf_values(List *data)
+{
+	config_key_pair_t *key_pair;
+
+	xassert(*data);
+
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("ProfileBinaryDir");
+	key_pair->value = xstrdup(binary_conf.dir);
+	list_append(*data, key_pair);
+
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("ProfileBinaryDefault");
+	key_pair->value =
+		xstrdup(acct_gather_profile_to_string(binary_conf.def));
+	list_append(*data, key_pair);
+
+	return;
+
+}
+
+extern bool acct_gather_profile_p_is_active(uint32_t type)
+{
+	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
+		return false;
+	return (type == ACCT_GATHER_PROFILE_NOT_SET)
+		|| (g_profile_running & type);
+}
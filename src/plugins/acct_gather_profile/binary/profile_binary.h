@@ -0,0 +1,146 @@
+/*****************************************************************************\
+ *  profile_binary.h - file format of the acct_gather_profile/binary plugin
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef __ACCT_GATHER_PROFILE_BINARY_H__
+#define __ACCT_GATHER_PROFILE_BINARY_H__
+
+#include <inttypes.h>
+
+/*
+ * A node-step file is a header page followed by blocks, each a multiple of
+ * the page size and only ever appended to the file:
+ *
+ *   PBIN_BLOCK_DATASET - describes one dataset (series), its group and the
+ *                        names and types of its fields.
+ *   PBIN_BLOCK_DATA    - holds up to "capacity" samples of one dataset in
+ *                        columns: capacity ElapsedTime values, then capacity
+ *                        EpochTime values, then capacity values of each
+ *                        field. Every value is 8 bytes (uint64_t or double).
+ *
+ * The plugin maps the data block being filled and stores each sample into
+ * its columns, then increments "count". Readers only use the first "count"
+ * entries of each column; the rest of the last block of a dataset is unused.
+ *
+ * A merged job file has kind PBIN_KIND_JOB. Its header page is followed by
+ * node_cnt pbin_node_t entries and then each node-step file copied in
+ * unchanged, starting on a page boundary.
+ *
+ * All values are in the byte order of the node that wrote them, which
+ * readers check with the "endian" field.
+ */
+
+#define PBIN_MAGIC		0x4e494250	/* "PBIN" */
+#define PBIN_BLOCK_MAGIC	0x4b4c4250	/* "PBLK" */
+#define PBIN_VERSION		1
+#define PBIN_ENDIAN		0x0102
+#define PBIN_PAGE_SIZE		4096
+#define PBIN_SUFFIX		"pbin"
+
+#define PBIN_KIND_NODE		1
+#define PBIN_KIND_JOB		2
+
+#define PBIN_BLOCK_DATASET	1
+#define PBIN_BLOCK_DATA		2
+
+#define PBIN_NAME_LEN		32
+#define PBIN_NODE_NAME_LEN	64
+#define PBIN_MAX_FIELDS		64
+/* Samples per data block, 4 minutes of samples at the usual 1 per second */
+#define PBIN_BLOCK_RECORDS	256
+/* Columns ahead of the dataset's fields in a data block */
+#define PBIN_TIME_COLUMNS	2
+
+#define PBIN_FIELD_UINT64	1
+#define PBIN_FIELD_DOUBLE	2
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t endian;
+	uint32_t kind;			/* PBIN_KIND_* */
+	uint32_t job_id;
+	uint32_t step_id;		/* NO_VAL for the batch step */
+	uint32_t node_inx;
+	uint32_t node_cnt;		/* Entries following a job header */
+	uint32_t ntasks;
+	uint32_t cpus_per_task;
+	uint32_t block_records;
+	uint64_t start_time;
+	char node_name[PBIN_NODE_NAME_LEN];
+} pbin_header_t;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t type;			/* PBIN_BLOCK_* */
+	uint16_t dataset;		/* Dataset (block order) index */
+	uint32_t capacity;		/* Samples a data block can hold */
+	uint32_t count;			/* Samples stored so far */
+	uint64_t length;		/* Block length including this header */
+	uint64_t reserved[5];
+} pbin_block_t;
+
+typedef struct {
+	char name[PBIN_NAME_LEN];
+	uint32_t type;			/* PBIN_FIELD_* */
+	uint32_t reserved;
+} pbin_field_t;
+
+/* Body of a PBIN_BLOCK_DATASET block */
+typedef struct {
+	char name[PBIN_NAME_LEN];
+	char group[PBIN_NAME_LEN];	/* Empty for node level datasets */
+	uint32_t field_cnt;
+	uint32_t reserved;
+	pbin_field_t fields[];
+} pbin_dataset_t;
+
+/* Index of the node-step files copied into a job file */
+typedef struct {
+	char node_name[PBIN_NODE_NAME_LEN];
+	uint32_t step_id;
+	uint32_t reserved;
+	uint64_t offset;		/* Offset of the node-step file */
+	uint64_t length;
+} pbin_node_t;
+
+/* Round a byte count up to whole pages */
+#define PBIN_PAGE_ROUND(_len) \
+	(((_len) + PBIN_PAGE_SIZE - 1) & ~((uint64_t) PBIN_PAGE_SIZE - 1))
+
+/* Length of a data block of capacity samples of field_cnt fields */
+#define PBIN_DATA_BLOCK_LEN(_field_cnt, _capacity)			\
+	PBIN_PAGE_ROUND(sizeof(pbin_block_t) +				\
+			((uint64_t) ((_field_cnt) + PBIN_TIME_COLUMNS) *	\
+			 (_capacity) * sizeof(uint64_t)))
+
+#endif /*__ACCT_GATHER_PROFILE_BINARY_H__*/
@@ -0,0 +1,944 @@
+/*****************************************************************************\
+ *  sprofutil.c - Tool for merging and extracting the node-step files written
+ *                by the acct_gather_profile/binary plugin.
+ *****************************************************************************
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/common/uid.h"
+#include "src/common/read_config.h"
+#include "src/common/proc_args.h"
+#include "src/common/xstring.h"
+#include "src/common/slurm_acct_gather_profile.h"
+#include "../profile_binary.h"
+
+#define SPROFUTIL_MODE_MERGE	1
+#define SPROFUTIL_MODE_EXTRACT	2
+#define SPROFUTIL_MODE_LIST	3
+
+/* Default count of node-step files copied at once */
+#define MERGE_THREADS		8
+/* Bytes copied per read() while merging */
+#define MERGE_BUF_SIZE		(1024 * 1024)
+
+typedef struct {
+	char *dir;
+	char *input;
+	int job_id;
+	bool keepfiles;
+	int mode;
+	char *node;
+	char *output;
+	char *series;
+	int step_id;
+	int threads;
+	char *user;
+	int verbose;
+} sprofutil_opts_t;
+
+/* One node-step file being merged */
+typedef struct {
+	char *file_name;
+	uint64_t length;
+	uint64_t offset;		/* Offset in the job file */
+	pbin_header_t header;
+	int rc;
+} merge_file_t;
+
+typedef struct {
+	merge_file_t *files;
+	int file_cnt;
+	int next_file;
+	int out_fd;
+	pthread_mutex_t mutex;
+} merge_state_t;
+
+/* A mapped node-step image, either a file or part of a job file */
+typedef struct {
+	char *base;
+	uint64_t length;
+	pbin_dataset_t **datasets;	/* Indexed by block dataset index */
+	int dataset_cnt;
+} node_image_t;
+
+static sprofutil_opts_t params;
+static FILE *output_file = NULL;
+static char *last_csv_header = NULL;
+
+static void _help_msg(void)
+{
+	printf("Usage sprofutil [<OPTION>] -j <job[.stepid]>\n\n"
+	       "Valid <OPTION> values are:\n"
+	       " -L, --list           List the series in a job or node-step file.\n"
+	       "     -i, --input      file to list (default ./job_$jobid.pbin)\n"
+	       " -E, --extract        Extract data series from a job or node-step file.\n"
+	       "     -i, --input      file to extract from (default ./job_$jobid.pbin)\n"
+	       "     -N, --node       Node name to extract (default is all)\n"
+	       "     -s, --series     Name of series: Energy | Lustre | Network |\n"
+	       "                      Tasks | Task_# (default is all)\n"
+	       " -j, --jobs           Format is <job(.step)>. Merge this job/step.\n"
+	       "                      Not specifying a step will result in all\n"
+	       "                      steps found to be processed.\n"
+	       " -h, --help           Print this description of use.\n"
+	       " -o, --output         Path to a file into which to write.\n"
+	       "                      Default for merge is ./job_$jobid.pbin\n"
+	       "                      Default for extract is ./extract_$jobid.csv\n"
+	       " -p, --profiledir     Profile directory location where node-step files exist\n"
+	       "		               default is what is set in acct_gather.conf\n"
+	       " -S, --savefiles      Don't remove node-step files after merging them \n"
+	       " -T, --threads        Number of node-step files to merge at once\n"
+	       "                      (default %d)\n"
+	       " --user               User who profiled job. (Handy for root user, defaults to \n"
+	       "		               user running this command.)\n"
+	       " --usage              Display brief usage message\n",
+	       MERGE_THREADS);
+}
+
+static void _init_opts(void)
+{
+	memset(&params, 0, sizeof(sprofutil_opts_t));
+	params.job_id = -1;
+	params.mode = SPROFUTIL_MODE_MERGE;
+	params.step_id = -1;
+	params.threads = MERGE_THREADS;
+}
+
+static void _free_options(void)
+{
+	xfree(params.dir);
+	xfree(params.input);
+	xfree(params.node);
+	xfree(params.output);
+	xfree(params.series);
+	xfree(params.user);
+}
+
+static int _set_options(const int argc, char **argv)
+{
+	int option_index = 0;
+	int cc;
+	log_options_t logopt = LOG_OPTS_STDERR_ONLY;
+	char *next_str = NULL;
+	uid_t u;
+
+	static struct option long_options[] = {
+		{"extract", no_argument, 0, 'E'},
+		{"help", no_argument, 0, 'h'},
+		{"jobs", required_argument, 0, 'j'},
+		{"input", required_argument, 0, 'i'},
+		{"list", no_argument, 0, 'L'},
+		{"node", required_argument, 0, 'N'},
+		{"output", required_argument, 0, 'o'},
+		{"profiledir", required_argument, 0, 'p'},
+		{"series", required_argument, 0, 's'},
+		{"savefiles", no_argument, 0, 'S'},
+		{"threads", required_argument, 0, 'T'},
+		{"usage", no_argument, 0, 'U'},
+		{"user", required_argument, 0, 'u'},
+		{"verbose", no_argument, 0, 'v'},
+		{"version", no_argument, 0, 'V'},
+		{0, 0, 0, 0}};
+
+	log_init(xbasename(argv[0]), logopt, 0, NULL);
+
+	_init_opts();
+
+	while ((cc = getopt_long(argc, argv, "Ehi:j:LN:o:p:s:ST:u:UvV",
+	                         long_options, &option_index)) != EOF) {
+		switch (cc) {
+		case 'E':
+			params.mode = SPROFUTIL_MODE_EXTRACT;
+			break;
+		case 'L':
+			params.mode = SPROFUTIL_MODE_LIST;
+			break;
+		case 'h':
+			_help_msg();
+			return -1;
+			break;
+		case 'i':
+			params.input = xstrdup(optarg);
+			break;
+		case 'j':
+			params.job_id = strtol(optarg, &next_str, 10);
+			if (next_str[0] == '.')
+				params.step_id =
+					strtol(next_str + 1, NULL, 10);
+			break;
+		case 'N':
+			params.node = xstrdup(optarg);
+			break;
+		case 'o':
+			params.output = xstrdup(optarg);
+			break;
+		case 'p':
+			params.dir = xstrdup(optarg);
+			break;
+		case 's':
+			params.series = xstrdup(optarg);
+			break;
+		case 'S':
+			params.keepfiles = true;
+			break;
+		case 'T':
+			params.threads = strtol(optarg, NULL, 10);
+			if (params.threads < 1) {
+				error("Bad value for --threads=\"%s\"",
+				      optarg);
+				return -1;
+			}
+			break;
+		case 'u':
+			if (uid_from_string(optarg, &u) < 0) {
+				error("No such user --uid=\"%s\"",
+				      optarg);
+				return -1;
+			}
+			params.user = uid_to_string(u);
+			break;
+		case 'U':
+			_help_msg();
+			return -1;
+			break;
+		case 'v':
+			params.verbose++;
+			break;
+		case 'V':
+			print_slurm_version();
+			return -1;
+			break;
+		case ':':
+		case '?': /* getopt() has explained it */
+			return -1;
+		}
+	}
+
+	if (params.verbose) {
+		logopt.stderr_level += params.verbose;
+		log_alter(logopt, SYSLOG_FACILITY_USER, NULL);
+	}
+
+	return 0;
+}
+
+static int _check_params(void)
+{
+	if (params.job_id == -1) {
+		error("JobID must be specified.");
+		return -1;
+	}
+
+	if (params.user == NULL)
+		params.user = uid_to_string(getuid());
+
+	if (params.mode == SPROFUTIL_MODE_MERGE) {
+		if (!params.dir)
+			acct_gather_profile_g_get(ACCT_GATHER_PROFILE_DIR,
+						  &params.dir);
+		if (!params.dir) {
+			error("Cannot read/parse acct_gather.conf");
+			return -1;
+		}
+		if (!params.output)
+			params.output = xstrdup_printf("./job_%d.%s",
+						       params.job_id,
+						       PBIN_SUFFIX);
+	} else {
+		if (!params.input)
+			params.input = xstrdup_printf("./job_%d.%s",
+						      params.job_id,
+						      PBIN_SUFFIX);
+		if (!params.output && (params.mode == SPROFUTIL_MODE_EXTRACT))
+			params.output = xstrdup_printf("./extract_%d.csv",
+						       params.job_id);
+	}
+
+	return 0;
+}
+
+static int _read_full(int fd, void *buf, size_t len, off_t off)
+{
+	char *ptr = buf;
+	ssize_t got;
+
+	while (len > 0) {
+		got = pread(fd, ptr, len, off);
+		if (got < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (got == 0)
+			return -1;
+		ptr += got;
+		off += got;
+		len -= got;
+	}
+	return 0;
+}
+
+static int _write_full(int fd, void *buf, size_t len, off_t off)
+{
+	char *ptr = buf;
+	ssize_t wrote;
+
+	while (len > 0) {
+		wrote = pwrite(fd, ptr, len, off);
+		if (wrote < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		ptr += wrote;
+		off += wrote;
+		len -= wrote;
+	}
+	return 0;
+}
+
+static int _check_header(pbin_header_t *header, char *file_name)
+{
+	if (header->magic != PBIN_MAGIC) {
+		error("%s is not a profile file", file_name);
+		return -1;
+	}
+	if (header->endian != PBIN_ENDIAN) {
+		error("%s was written with a different byte order",
+		      file_name);
+		return -1;
+	}
+	if (header->version != PBIN_VERSION) {
+		error("%s has unsupported version %u",
+		      file_name, header->version);
+		return -1;
+	}
+	return 0;
+}
+
+static int _merge_file_cmp(const void *x, const void *y)
+{
+	const merge_file_t *a = x, *b = y;
+
+	if (a->header.step_id != b->header.step_id)
+		return (a->header.step_id < b->header.step_id) ? -1 : 1;
+	if (a->header.node_inx != b->header.node_inx)
+		return (a->header.node_inx < b->header.node_inx) ? -1 : 1;
+	return 0;
+}
+
+/* Find this job's node-step files and read their headers */
+static int _find_step_files(merge_file_t **files_ptr)
+{
+	DIR *dir;
+	struct dirent *de;
+	struct stat sb;
+	char *user_dir, *prefix, *step_str = NULL, *name;
+	merge_file_t *files = NULL, *file;
+	int file_cnt = 0, fd;
+
+	user_dir = xstrdup_printf("%s/%s", params.dir, params.user);
+	if (!(dir = opendir(user_dir))) {
+		error("opendir(%s): %m", user_dir);
+		xfree(user_dir);
+		return -1;
+	}
+	prefix = xstrdup_printf("%d_", params.job_id);
+	if (params.step_id >= 0)
+		step_str = xstrdup_printf("%d_", params.step_id);
+
+	while ((de = readdir(dir))) {
+		name = de->d_name;
+		if (xstrncmp(name, prefix, strlen(prefix)))
+			continue;
+		if (step_str &&
+		    xstrncmp(name + strlen(prefix), step_str,
+			     strlen(step_str)))
+			continue;
+		if ((strlen(name) <= strlen(PBIN_SUFFIX) + 1) ||
+		    xstrcmp(name + strlen(name) - strlen(PBIN_SUFFIX),
+			    PBIN_SUFFIX))
+			continue;
+
+		xrealloc(files, sizeof(merge_file_t) * (file_cnt + 1));
+		file = &files[file_cnt];
+		memset(file, 0, sizeof(merge_file_t));
+		file->file_name = xstrdup_printf("%s/%s", user_dir, name);
+		if (((fd = open(file->file_name, O_RDONLY)) < 0) ||
+		    (fstat(fd, &sb) < 0) ||
+		    (_read_full(fd, &file->header, sizeof(pbin_header_t),
+				0) < 0)) {
+			error("Unable to read %s: %m", file->file_name);
+			if (fd >= 0)
+				close(fd);
+			xfree(file->file_name);
+			continue;
+		}
+		close(fd);
+		if (_check_header(&file->header, file->file_name) ||
+		    (file->header.kind != PBIN_KIND_NODE)) {
+			xfree(file->file_name);
+			continue;
+		}
+		file->length = PBIN_PAGE_ROUND((uint64_t) sb.st_size);
+		file_cnt++;
+	}
+	closedir(dir);
+	xfree(prefix);
+	xfree(step_str);
+	xfree(user_dir);
+
+	if (file_cnt)
+		qsort(files, file_cnt, sizeof(merge_file_t), _merge_file_cmp);
+	*files_ptr = files;
+	return file_cnt;
+}
+
+/* Copy node-step files into the job file until none are left. Each file
+ * has its own place in the job file, so the threads need not coordinate
+ * beyond picking the next file. */
+static void *_merge_thread(void *arg)
+{
+	merge_state_t *state = arg;
+	merge_file_t *file;
+	char *buf = xmalloc(MERGE_BUF_SIZE);
+	uint64_t off;
+	ssize_t got = 0;
+	int fd, inx;
+
+	while (1) {
+		slurm_mutex_lock(&state->mutex);
+		inx = state->next_file++;
+		slurm_mutex_unlock(&state->mutex);
+		if (inx >= state->file_cnt)
+			break;
+		file = &state->files[inx];
+
+		if ((fd = open(file->file_name, O_RDONLY)) < 0) {
+			error("open(%s): %m", file->file_name);
+			file->rc = -1;
+			continue;
+		}
+		(void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		/* Never read past the length the file's place was sized
+		 * for, as a file still being written may have grown */
+		for (off = 0; off < file->length; off += got) {
+			got = read(fd, buf, MIN(MERGE_BUF_SIZE,
+						file->length - off));
+			if ((got < 0) && (errno == EINTR)) {
+				got = 0;
+				continue;
+			}
+			if (got <= 0)
+				break;
+			if (_write_full(state->out_fd, buf, got,
+					file->offset + off) < 0) {
+				error("write(%s): %m", params.output);
+				file->rc = -1;
+				break;
+			}
+		}
+		if ((got < 0) && !file->rc) {
+			error("read(%s): %m", file->file_name);
+			file->rc = -1;
+		} else if ((off < file->length) && !file->rc) {
+			error("%s: file truncated while merging",
+			      file->file_name);
+			file->rc = -1;
+		}
+		/* Done with the pages of both files */
+		(void) posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+	xfree(buf);
+
+	return NULL;
+}
+
+static int _merge_step_files(void)
+{
+	merge_state_t state;
+	merge_file_t *files = NULL;
+	pbin_header_t *header;
+	pbin_node_t *nodes;
+	pthread_t *threads;
+	pthread_attr_t attr;
+	uint64_t offset, index_len;
+	int file_cnt, i, thread_cnt, rc = SLURM_SUCCESS;
+
+	file_cnt = _find_step_files(&files);
+	if (file_cnt < 0)
+		return SLURM_ERROR;
+	if (file_cnt == 0) {
+		error("No node-step files found for job %d", params.job_id);
+		return SLURM_ERROR;
+	}
+
+	/* Lay out the job file: header page, node index, node-step files */
+	index_len = PBIN_PAGE_ROUND(sizeof(pbin_node_t) * file_cnt);
+	offset = PBIN_PAGE_SIZE + index_len;
+	for (i = 0; i < file_cnt; i++) {
+		files[i].offset = offset;
+		offset += files[i].length;
+	}
+
+	memset(&state, 0, sizeof(merge_state_t));
+	state.files = files;
+	state.file_cnt = file_cnt;
+	slurm_mutex_init(&state.mutex);
+	state.out_fd = open(params.output, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+	if (state.out_fd < 0) {
+		error("open(%s): %m", params.output);
+		rc = SLURM_ERROR;
+		goto fini;
+	}
+	if (ftruncate(state.out_fd, offset) < 0) {
+		error("ftruncate(%s): %m", params.output);
+		rc = SLURM_ERROR;
+		goto fini;
+	}
+
+	thread_cnt = MIN(params.threads, file_cnt);
+	threads = xmalloc(sizeof(pthread_t) * thread_cnt);
+	slurm_attr_init(&attr);
+	for (i = 0; i < thread_cnt; i++) {
+		if (pthread_create(&threads[i], &attr, _merge_thread, &state))
+			fatal("pthread_create: %m");
+	}
+	slurm_attr_destroy(&attr);
+	for (i = 0; i < thread_cnt; i++)
+		pthread_join(threads[i], NULL);
+	xfree(threads);
+
+	header = xmalloc(PBIN_PAGE_SIZE + index_len);
+	header->magic = PBIN_MAGIC;
+	header->version = PBIN_VERSION;
+	header->endian = PBIN_ENDIAN;
+	header->kind = PBIN_KIND_JOB;
+	header->job_id = params.job_id;
+	header->step_id = (params.step_id >= 0) ? params.step_id : NO_VAL;
+	header->node_cnt = file_cnt;
+	header->block_records = files[0].header.block_records;
+	header->start_time = files[0].header.start_time;
+	nodes = (pbin_node_t *) ((char *) header + PBIN_PAGE_SIZE);
+	for (i = 0; i < file_cnt; i++) {
+		if (files[i].rc)
+			rc = SLURM_ERROR;
+		memcpy(nodes[i].node_name, files[i].header.node_name,
+		       sizeof(nodes[i].node_name));
+		nodes[i].node_name[PBIN_NODE_NAME_LEN - 1] = '\0';
+		nodes[i].step_id = files[i].header.step_id;
+		nodes[i].offset = files[i].offset;
+		nodes[i].length = files[i].length;
+		if (files[i].header.start_time < header->start_time)
+			header->start_time = files[i].header.start_time;
+	}
+	if (_write_full(state.out_fd, header, PBIN_PAGE_SIZE + index_len,
+			0) < 0) {
+		error("write(%s): %m", params.output);
+		rc = SLURM_ERROR;
+	}
+	xfree(header);
+	if ((close(state.out_fd) < 0) && (rc == SLURM_SUCCESS)) {
+		error("close(%s): %m", params.output);
+		rc = SLURM_ERROR;
+	}
+	state.out_fd = -1;
+
+	if (rc == SLURM_SUCCESS) {
+		info("Merged %d node-step files", file_cnt);
+		for (i = 0; (i < file_cnt) && !params.keepfiles; i++)
+			(void) unlink(files[i].file_name);
+	} else {
+		(void) unlink(params.output);
+	}
+
+fini:
+	if (state.out_fd >= 0)
+		close(state.out_fd);
+	slurm_mutex_destroy(&state.mutex);
+	for (i = 0; i < file_cnt; i++)
+		xfree(files[i].file_name);
+	xfree(files);
+
+	return rc;
+}
+
+/* Read the dataset descriptions of a node-step image */
+static int _load_image(node_image_t *image)
+{
+	pbin_block_t *block;
+	pbin_dataset_t *desc;
+	uint64_t off;
+
+	image->datasets = NULL;
+	image->dataset_cnt = 0;
+	for (off = PBIN_PAGE_SIZE;
+	     off + sizeof(pbin_block_t) <= image->length;
+	     off += block->length) {
+		block = (pbin_block_t *) (image->base + off);
+		if ((block->magic != PBIN_BLOCK_MAGIC) ||
+		    (block->length < sizeof(pbin_block_t)) ||
+		    (block->length > image->length - off))
+			break;	/* Step ended while adding a block */
+		if (block->type != PBIN_BLOCK_DATASET)
+			continue;
+		desc = (pbin_dataset_t *) (block + 1);
+		if ((desc->field_cnt > PBIN_MAX_FIELDS) ||
+		    (sizeof(pbin_block_t) + sizeof(pbin_dataset_t) +
+		     desc->field_cnt * sizeof(pbin_field_t) > block->length))
+			return -1;
+		if (block->dataset >= image->dataset_cnt) {
+			xrealloc(image->datasets, sizeof(pbin_dataset_t *) *
+				 (block->dataset + 1));
+			image->dataset_cnt = block->dataset + 1;
+		}
+		image->datasets[block->dataset] = desc;
+	}
+	return 0;
+}
+
+static void _series_name(pbin_dataset_t *desc, char *buf, size_t len)
+{
+	char name[PBIN_NAME_LEN + 1], group[PBIN_NAME_LEN + 1];
+
+	snprintf(name, sizeof(name), "%.*s", PBIN_NAME_LEN, desc->name);
+	snprintf(group, sizeof(group), "%.*s", PBIN_NAME_LEN, desc->group);
+	if (!group[0])
+		snprintf(buf, len, "%s", name);
+	else if (!xstrcmp(group, "Tasks"))
+		snprintf(buf, len, "Task_%s", name);	/* as sh5util */
+	else
+		snprintf(buf, len, "%s_%s", group, name);
+}
+
+static bool _series_match(pbin_dataset_t *desc)
+{
+	char series[PBIN_NAME_LEN * 2 + 2];
+
+	if (!params.series)
+		return true;
+	if (!strncmp(params.series, desc->group, PBIN_NAME_LEN) ||
+	    !strncmp(params.series, desc->name, PBIN_NAME_LEN))
+		return true;
+	_series_name(desc, series, sizeof(series));
+	return !xstrcmp(params.series, series);
+}
+
+static void _print_csv_header(pbin_dataset_t *desc)
+{
+	char *csv_header = NULL;
+	uint32_t i;
+
+	xstrcat(csv_header, "Job,Step,Node,Series,ElapsedTime,EpochTime");
+	for (i = 0; i < desc->field_cnt; i++) {
+		xstrfmtcat(csv_header, ",%.*s", PBIN_NAME_LEN,
+			   desc->fields[i].name);
+	}
+	if (xstrcmp(csv_header, last_csv_header)) {
+		fprintf(output_file, "%s\n", csv_header);
+		xfree(last_csv_header);
+		last_csv_header = csv_header;
+	} else
+		xfree(csv_header);
+}
+
+static void _extract_image(node_image_t *image, pbin_header_t *header,
+			   int *sample_cnt)
+{
+	pbin_block_t *block;
+	pbin_dataset_t *desc;
+	uint64_t *columns, value;
+	char series[PBIN_NAME_LEN * 2 + 2];
+	char node_name[PBIN_NODE_NAME_LEN + 1], step[16];
+	uint64_t off;
+	uint32_t i, j, cap;
+	double d;
+
+	snprintf(node_name, sizeof(node_name), "%.*s", PBIN_NODE_NAME_LEN,
+		 header->node_name);
+	if (header->step_id == NO_VAL)
+		snprintf(step, sizeof(step), "batch");
+	else
+		snprintf(step, sizeof(step), "%u", header->step_id);
+
+	for (off = PBIN_PAGE_SIZE;
+	     off + sizeof(pbin_block_t) <= image->length;
+	     off += block->length) {
+		block = (pbin_block_t *) (image->base + off);
+		if ((block->magic != PBIN_BLOCK_MAGIC) ||
+		    (block->length < sizeof(pbin_block_t)) ||
+		    (block->length > image->length - off))
+			break;
+		if ((block->type != PBIN_BLOCK_DATA) ||
+		    (block->dataset >= image->dataset_cnt) ||
+		    !(desc = image->datasets[block->dataset]) ||
+		    !_series_match(desc))
+			continue;
+		cap = block->capacity;
+		if (PBIN_DATA_BLOCK_LEN(desc->field_cnt, cap) > block->length)
+			continue;	/* corrupt */
+
+		_series_name(desc, series, sizeof(series));
+		_print_csv_header(desc);
+		columns = (uint64_t *) (block + 1);
+		for (i = 0; (i < block->count) && (i < cap); i++) {
+			fprintf(output_file, "%u,%s,%s,%s,%"PRIu64",%"PRIu64,
+				header->job_id, step, node_name, series,
+				columns[i], columns[cap + i]);
+			for (j = 0; j < desc->field_cnt; j++) {
+				value = columns[(PBIN_TIME_COLUMNS + j) * cap +
+						i];
+				if (desc->fields[j].type ==
+				    PBIN_FIELD_DOUBLE) {
+					memcpy(&d, &value, sizeof(double));
+					fprintf(output_file, ",%f", d);
+				} else {
+					fprintf(output_file, ",%"PRIu64,
+						value);
+				}
+			}
+			fputc('\n', output_file);
+		}
+		*sample_cnt += i;
+	}
+}
+
+static void _list_image(node_image_t *image, pbin_header_t *header)
+{
+	pbin_block_t *block;
+	pbin_dataset_t *desc;
+	uint64_t off, *counts;
+	char series[PBIN_NAME_LEN * 2 + 2];
+	char node_name[PBIN_NODE_NAME_LEN + 1], step[16];
+	int i;
+	uint32_t j;
+
+	counts = xmalloc(sizeof(uint64_t) * (image->dataset_cnt + 1));
+	for (off = PBIN_PAGE_SIZE;
+	     off + sizeof(pbin_block_t) <= image->length;
+	     off += block->length) {
+		block = (pbin_block_t *) (image->base + off);
+		if ((block->magic != PBIN_BLOCK_MAGIC) ||
+		    (block->length < sizeof(pbin_block_t)) ||
+		    (block->length > image->length - off))
+			break;
+		if ((block->type == PBIN_BLOCK_DATA) &&
+		    (block->dataset < image->dataset_cnt))
+			counts[block->dataset] += block->count;
+	}
+
+	snprintf(node_name, sizeof(node_name), "%.*s", PBIN_NODE_NAME_LEN,
+		 header->node_name);
+	if (header->step_id == NO_VAL)
+		snprintf(step, sizeof(step), "batch");
+	else
+		snprintf(step, sizeof(step), "%u", header->step_id);
+	for (i = 0; i < image->dataset_cnt; i++) {
+		if (!(desc = image->datasets[i]) || !_series_match(desc))
+			continue;
+		_series_name(desc, series, sizeof(series));
+		printf("%s step %s %s: %"PRIu64" samples\n   ",
+		       node_name, step, series, counts[i]);
+		for (j = 0; j < desc->field_cnt; j++)
+			printf(" %.*s", PBIN_NAME_LEN, desc->fields[j].name);
+		printf("\n");
+	}
+	xfree(counts);
+}
+
+/* Walk each node-step image of the input, which is a job file or a single
+ * node-step file */
+static int _process_input(void)
+{
+	struct stat sb;
+	pbin_header_t *header, *node_header;
+	pbin_node_t *nodes;
+	node_image_t image;
+	char *base, node_name[PBIN_NODE_NAME_LEN + 1];
+	uint32_t node_cnt, i;
+	int fd, sample_cnt = 0, rc = SLURM_SUCCESS;
+
+	if ((fd = open(params.input, O_RDONLY)) < 0) {
+		error("open(%s): %m", params.input);
+		return SLURM_ERROR;
+	}
+	if ((fstat(fd, &sb) < 0) || (sb.st_size < PBIN_PAGE_SIZE)) {
+		error("%s is not a profile file", params.input);
+		close(fd);
+		return SLURM_ERROR;
+	}
+	base = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		error("mmap(%s): %m", params.input);
+		return SLURM_ERROR;
+	}
+	header = (pbin_header_t *) base;
+	if (_check_header(header, params.input)) {
+		munmap(base, sb.st_size);
+		return SLURM_ERROR;
+	}
+
+	if (params.mode == SPROFUTIL_MODE_EXTRACT) {
+		if (!(output_file = fopen(params.output, "w"))) {
+			error("fopen(%s): %m", params.output);
+			munmap(base, sb.st_size);
+			return SLURM_ERROR;
+		}
+	}
+
+	node_cnt = (header->kind == PBIN_KIND_JOB) ? header->node_cnt : 1;
+	nodes = (pbin_node_t *) (base + PBIN_PAGE_SIZE);
+	if ((header->kind == PBIN_KIND_JOB) &&
+	    (PBIN_PAGE_SIZE + (uint64_t) node_cnt * sizeof(pbin_node_t) >
+	     sb.st_size)) {
+		error("%s is truncated", params.input);
+		node_cnt = 0;
+		rc = SLURM_ERROR;
+	}
+	for (i = 0; i < node_cnt; i++) {
+		if (header->kind == PBIN_KIND_JOB) {
+			if ((nodes[i].offset > sb.st_size) ||
+			    (nodes[i].length < PBIN_PAGE_SIZE) ||
+			    (nodes[i].length > sb.st_size - nodes[i].offset)) {
+				error("%s is truncated", params.input);
+				rc = SLURM_ERROR;
+				break;
+			}
+			image.base = base + nodes[i].offset;
+			image.length = nodes[i].length;
+		} else {
+			image.base = base;
+			image.length = sb.st_size;
+		}
+		node_header = (pbin_header_t *) image.base;
+		if (_check_header(node_header, params.input)) {
+			rc = SLURM_ERROR;
+			continue;
+		}
+		snprintf(node_name, sizeof(node_name), "%.*s",
+			 PBIN_NODE_NAME_LEN, node_header->node_name);
+		if (params.node && xstrcmp(params.node, node_name))
+			continue;
+		if ((params.step_id >= 0) &&
+		    (node_header->step_id != params.step_id))
+			continue;
+		if (_load_image(&image)) {
+			error("%s: bad dataset on node %s",
+			      params.input, node_name);
+			rc = SLURM_ERROR;
+			xfree(image.datasets);
+			continue;
+		}
+		if (params.mode == SPROFUTIL_MODE_EXTRACT)
+			_extract_image(&image, node_header, &sample_cnt);
+		else
+			_list_image(&image, node_header);
+		xfree(image.datasets);
+	}
+
+	if (output_file) {
+		if (fclose(output_file)) {
+			error("fclose(%s): %m", params.output);
+			rc = SLURM_ERROR;
+		}
+		output_file = NULL;
+		info("Extracted %d samples", sample_cnt);
+	}
+	xfree(last_csv_header);
+	munmap(base, sb.st_size);
+
+	return rc;
+}
+
+static void _cleanup(void)
+{
+	_free_options();
+	log_fini();
+	slurm_conf_destroy();
+	acct_gather_profile_fini();
+	acct_gather_conf_destroy();
+}
+
+int
+main(int argc, char **argv)
+{
+	int cc;
+
+	cc = _set_options(argc, argv);
+	if (cc < 0)
+		goto ouch;
+
+	cc = _check_params();
+	if (cc < 0)
+		goto ouch;
+
+	switch (params.mode) {
+	case SPROFUTIL_MODE_MERGE:
+		info("Merging node-step files into %s", params.output);
+		cc = _merge_step_files();
+		break;
+	case SPROFUTIL_MODE_EXTRACT:
+		info("Extracting job data from %s into %s",
+		     params.input, params.output);
+		cc = _process_input();
+		break;
+	case SPROFUTIL_MODE_LIST:
+		cc = _process_input();
+		break;
+	default:
+		error("Unknown type %d", params.mode);
+		break;
+	}
+
+ouch:
+	_cleanup();
+
+	return (cc == SLURM_SUCCESS) ? 0 : 1;
+}
@@ -3658,7 +3658,7 @@ extern int bb_p_job_begin(struct job_record *job_ptr)
 /* Kill job from CONFIGURING state */
 static void _kill_job(struct job_record *job_ptr, bool hold_job)
 {
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 	job_ptr->end_time = last_job_update;
 	job_ptr->job_state = JOB_PENDING | JOB_COMPLETING;
 	if (hold_job)
@@ -50,10 +50,36 @@
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_acct_gather_energy.h"
 #include "src/common/slurm_acct_gather_infiniband.h"
+#include "src/common/id_hash.h"
+#include "src/common/timers.h"
 #include "src/slurmd/common/proctrack.h"
 
 #include "common_jag.h"
 
+/*
+ * Most processes to keep /proc files open for between polls. Files for
+ * further processes are opened and closed on every poll.
+ */
+#ifndef JAG_MAX_OPEN_PIDS
+#define JAG_MAX_OPEN_PIDS 256
+#endif
+
+/*
+ * Per-process state kept between polls. The /proc/<pid> files stay open
+ * and are re-read from the start on each poll. Once the process exits,
+ * reads fail and the record is discarded, so a reused pid is never
+ * confused with the process that had it before.
+ */
+typedef struct {
+	pid_t pid;
+	int stat_fd;		/* /proc/<pid>/stat */
+	int statm_fd;		/* /proc/<pid>/statm, if NoShare */
+	int io_fd;		/* /proc/<pid>/io */
+	bool is_lwp;		/* a thread, not accounted for */
+	bool keep_open;		/* files stay open between polls */
+	uint32_t poll_cnt;	/* last poll to find the process */
+} jag_pid_t;
+
 static int cpunfo_frequency = 0;
 static long hertz = 0;
 
@@ -62,16 +88,10 @@ static DIR  *slash_proc = NULL;
 static int energy_profile = ENERGY_DATA_NODE_ENERGY_UP;
 static uint64_t debug_flags = 0;
 
-static int _find_prec(void *x, void *key)
-{
-	jag_prec_t *prec = (jag_prec_t *) x;
-	struct jobacctinfo *jobacct = (struct jobacctinfo *) key;
-
-	if (prec->pid == jobacct->pid)
-		return 1;
-
-	return 0;
-}
+static id_hash_t *pid_hash = NULL;	/* jag_pid_t records by pid */
+static jag_pid_t **pid_recs = NULL;	/* the same records, to scan */
+static int pid_rec_cnt = 0, pid_rec_size = 0, pid_open_cnt = 0;
+static uint32_t poll_cnt = 0;
 
 /* return weighted frequency in mhz */
 static uint32_t _update_weighted_freq(struct jobacctinfo *jobacct,
@@ -296,7 +316,7 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	long unsigned f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13;
 	int exit_signal, last_cpu;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
+	num_read = pread(in, sbuf, (sizeof(sbuf) - 1), 0);
 	if (num_read <= 0)
 		return 0;
 	sbuf[num_read] = '\0';
@@ -326,11 +346,6 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	if ((nvals < 37) || (rss < 0))
 		return 0;
 
-	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
-	/* skip it, we will only account the original process (pid==tgid) */
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->ppid  = ppid;
 	prec->pages = majflt;
@@ -361,7 +376,7 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	int num_read, nvals;
 	long int size, rss, share, text, lib, data, dt;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
+	num_read = pread(in, sbuf, (sizeof(sbuf) - 1), 0);
 	if (num_read <= 0)
 		return 0;
 	sbuf[num_read] = '\0';
@@ -384,23 +399,6 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	return 1;
 }
 
-static int _remove_share_data(char *proc_stat_file, jag_prec_t *prec)
-{
-	FILE *statm_fp = NULL;
-	char proc_statm_file[256];	/* Allow ~20x extra length */
-	int rc = 0, fd;
-
-	snprintf(proc_statm_file, sizeof(proc_statm_file), "%sm",
-		 proc_stat_file);
-	if (!(statm_fp = fopen(proc_statm_file, "r")))
-		return rc;  /* Assume the process went away */
-	fd = fileno(statm_fp);
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
-	rc = _get_process_memory_line(fd, prec);
-	fclose(statm_fp);
-	return rc;
-}
-
 /* _get_process_io_data_line() - get line of data from /proc/<pid>/io
  *
  * IN:	in - input file descriptor
@@ -420,7 +418,7 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	int num_read, nvals;
 	uint64_t rchar, wchar;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
+	num_read = pread(in, sbuf, (sizeof(sbuf) - 1), 0);
 	if (num_read <= 0)
 		return 0;
 	sbuf[num_read] = '\0';
@@ -430,9 +428,6 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	if (nvals < 4)
 		return 0;
 
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->disk_read = (double)rchar / (double)1048576;
 	prec->disk_write = (double)wchar / (double)1048576;
@@ -440,15 +435,93 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	return 1;
 }
 
-static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_file,
-			  char *proc_smaps_file, jag_callbacks_t *callbacks)
+/* Open a file of /proc/<pid>, closed on exec() of user tasks */
+static int _open_proc_file(pid_t pid, char *name)
+{
+	char path[64];
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%d/%s", (int) pid, name);
+	if ((fd = open(path, O_RDONLY)) >= 0)
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+}
+
+static void _close_pid_files(jag_pid_t *rec)
+{
+	if (rec->stat_fd >= 0)
+		close(rec->stat_fd);
+	if (rec->statm_fd >= 0)
+		close(rec->statm_fd);
+	if (rec->io_fd >= 0)
+		close(rec->io_fd);
+	rec->stat_fd = rec->statm_fd = rec->io_fd = -1;
+}
+
+static void _free_pid_rec(jag_pid_t *rec)
+{
+	_close_pid_files(rec);
+	if (rec->keep_open)
+		pid_open_cnt--;
+	id_hash_remove(pid_hash, rec->pid);
+	xfree(rec);
+}
+
+/* Find the record of a process, creating one if the process is new */
+static jag_pid_t *_get_pid_rec(pid_t pid)
+{
+	jag_pid_t *rec;
+
+	if (!pid_hash)
+		pid_hash = id_hash_init(0);
+	if ((rec = id_hash_find(pid_hash, pid)))
+		return rec;
+
+	rec = xmalloc(sizeof(jag_pid_t));
+	rec->pid = pid;
+	rec->stat_fd = rec->statm_fd = rec->io_fd = -1;
+	/* A process whose status can not be read is not a known thread */
+	rec->is_lwp = (_is_a_lwp(pid) > 0);
+	if (!rec->is_lwp && (pid_open_cnt < JAG_MAX_OPEN_PIDS)) {
+		rec->keep_open = true;
+		pid_open_cnt++;
+	}
+	id_hash_add(pid_hash, pid, rec);
+	if (pid_rec_cnt >= pid_rec_size) {
+		pid_rec_size = MAX(pid_rec_size * 2, 64);
+		xrealloc(pid_recs, sizeof(jag_pid_t *) * pid_rec_size);
+	}
+	pid_recs[pid_rec_cnt++] = rec;
+
+	return rec;
+}
+
+/* Discard the records of processes not found by this poll */
+static void _purge_pid_recs(void)
+{
+	int i, j;
+
+	for (i = 0, j = 0; i < pid_rec_cnt; i++) {
+		if (pid_recs[i]->poll_cnt == poll_cnt)
+			pid_recs[j++] = pid_recs[i];
+		else
+			_free_pid_rec(pid_recs[i]);
+	}
+	pid_rec_cnt = j;
+}
+
+/*
+ * Sample one process, reusing the files left open by earlier polls.
+ * RET number of files opened
+ */
+static int _handle_stats(List prec_list, pid_t pid, jag_callbacks_t *callbacks)
 {
 	static int no_share_data = -1;
 	static int use_pss = -1;
-	FILE *stat_fp = NULL;
-	FILE *io_fp = NULL;
-	int fd, fd2;
+	jag_pid_t *rec;
 	jag_prec_t *prec = NULL;
+	char proc_smaps_file[64];
+	int opened = 0;
 
 	if (no_share_data == -1) {
 		char *acct_params = slurm_get_jobacct_gather_params();
@@ -464,67 +537,75 @@ static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_fi
 		xfree(acct_params);
 	}
 
-	if (!(stat_fp = fopen(proc_stat_file, "r")))
-		return;  /* Assume the process went away */
-	/*
-	 * Close the file on exec() of user tasks.
-	 *
-	 * NOTE: If we fork() slurmstepd after the
-	 * fopen() above and before the fcntl() below,
-	 * then the user task may have this extra file
-	 * open, which can cause problems for
-	 * checkpoint/restart, but this should be a very rare
-	 * problem in practice.
-	 */
-	fd = fileno(stat_fp);
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	rec = _get_pid_rec(pid);
+	rec->poll_cnt = poll_cnt;
 
-	prec = try_xmalloc(sizeof(jag_prec_t));
-	if (prec == NULL) {	/* Avoid killing slurmstepd on malloc failure */
-		fclose(stat_fp);
-		return;
+	/* If pid corresponds to a Light Weight Process (Thread POSIX)
+	 * skip it, we will only account the original process (pid==tgid) */
+	if (rec->is_lwp)
+		return opened;
+
+	if (rec->stat_fd < 0) {
+		if ((rec->stat_fd = _open_proc_file(pid, "stat")) < 0)
+			goto fini;  /* Assume the process went away */
+		opened++;
 	}
-	if (!_get_process_data_line(fd, prec)) {
+
+	prec = try_xmalloc(sizeof(jag_prec_t));
+	if (prec == NULL)	/* Avoid killing slurmstepd on malloc failure */
+		goto fini;
+	if (!_get_process_data_line(rec->stat_fd, prec)) {
+		/* The process went away, forget it now */
 		xfree(prec);
-		fclose(stat_fp);
-		return;
+		rec->poll_cnt = poll_cnt - 1;
+		goto fini;
 	}
-	fclose(stat_fp);
 
 	/* Remove shared data from rss */
-	if (no_share_data)
-		_remove_share_data(proc_stat_file, prec);
+	if (no_share_data) {
+		if ((rec->statm_fd < 0) &&
+		    ((rec->statm_fd = _open_proc_file(pid, "statm")) >= 0))
+			opened++;
+		if (rec->statm_fd >= 0)
+			_get_process_memory_line(rec->statm_fd, prec);
+	}
 
 	/* Use PSS instead if RSS */
 	if (use_pss) {
+		snprintf(proc_smaps_file, sizeof(proc_smaps_file),
+			 "/proc/%d/smaps", (int) pid);
 		if (_get_pss(proc_smaps_file, prec) == -1) {
 			xfree(prec);
-			return;
+			goto fini;
 		}
 	}
 
 	list_append(prec_list, prec);
 
-	if ((io_fp = fopen(proc_io_file, "r"))) {
-		fd2 = fileno(io_fp);
-		fcntl(fd2, F_SETFD, FD_CLOEXEC);
-		_get_process_io_data_line(fd2, prec);
-		fclose(io_fp);
-	}
+	if ((rec->io_fd < 0) &&
+	    ((rec->io_fd = _open_proc_file(pid, "io")) >= 0))
+		opened++;
+	if (rec->io_fd >= 0)
+		_get_process_io_data_line(rec->io_fd, prec);
 	if (callbacks->prec_extra)
 		(*(callbacks->prec_extra))(prec);
+
+fini:
+	if (!rec->keep_open)
+		_close_pid_files(rec);
+	return opened;
 }
 
 static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 		       jag_callbacks_t *callbacks)
 {
 	List prec_list = list_create(destroy_jag_prec);
-	char	proc_stat_file[256];	/* Allow ~20x extra length */
-	char	proc_io_file[256];	/* Allow ~20x extra length */
-	char	proc_smaps_file[256];	/* Allow ~20x extra length */
 	static	int	slash_proc_open = 0;
-	int i;
+	int i, pid_cnt = 0, opened = 0;
+	DEF_TIMERS;
 
+	START_TIMER;
+	poll_cnt++;
 	if (!pgid_plugin) {
 		pid_t *pids = NULL;
 		int npids = 0;
@@ -544,17 +625,14 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			debug4("no pids in this container %"PRIu64"", cont_id);
 			goto finished;
 		}
-		for (i = 0; i < npids; i++) {
-			snprintf(proc_stat_file, 256, "/proc/%d/stat", pids[i]);
-			snprintf(proc_io_file, 256, "/proc/%d/io", pids[i]);
-			snprintf(proc_smaps_file, 256, "/proc/%d/smaps", pids[i]);
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file, callbacks);
-		}
+		for (i = 0; i < npids; i++)
+			opened += _handle_stats(prec_list, pids[i], callbacks);
+		pid_cnt = npids;
 		xfree(pids);
 	} else {
 		struct dirent *slash_proc_entry;
-		char  *iptr = NULL, *optr = NULL, *optr2 = NULL;
+		char *iptr;
+		pid_t pid;
 
 		if (slash_proc_open) {
 			rewinddir(slash_proc);
@@ -566,83 +644,33 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			}
 			slash_proc_open=1;
 		}
-		strcpy(proc_stat_file, "/proc/");
-		strcpy(proc_io_file, "/proc/");
-		strcpy(proc_smaps_file, "/proc/");
 
 		while ((slash_proc_entry = readdir(slash_proc))) {
-
-			/* Save a few cyles by simulating
-			 * strcat(statFileName, slash_proc_entry->d_name);
-			 * strcat(statFileName, "/stat");
-			 * while checking for a numeric filename (which really
-			 * should be a pid). Then do the same for the
-			 * /proc/<pid>/io file name.
-			 */
-			optr = proc_stat_file + sizeof("/proc");
+			/* Only numeric file names, which really should be
+			 * pids, are of interest */
 			iptr = slash_proc_entry->d_name;
-			i = 0;
+			pid = 0;
 			do {
-				if ((*iptr < '0') ||
-				    ((*optr++ = *iptr++) > '9')) {
-					i = -1;
+				if ((*iptr < '0') || (*iptr > '9')) {
+					pid = -1;
 					break;
 				}
+				pid = (pid * 10) + (*iptr++ - '0');
 			} while (*iptr);
-
-			if (i == -1)
+			if (pid <= 0)
 				continue;
-			iptr = (char*)"/stat";
 
-			do {
-				*optr++ = *iptr++;
-			} while (*iptr);
-			*optr = 0;
-
-			optr2 = proc_io_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/io";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			optr2 = proc_smaps_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/smaps";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file,callbacks);
+			opened += _handle_stats(prec_list, pid, callbacks);
+			pid_cnt++;
 		}
 	}
 
 finished:
+	_purge_pid_recs();
+	END_TIMER;
+	debug2("%s: sampled %d of %d processes, %d files opened, %d "
+	       "processes cached, %s", __func__, list_count(prec_list),
+	       pid_cnt, opened, pid_rec_cnt, TIME_STR);
 
 	return prec_list;
 }
@@ -772,6 +800,13 @@ extern void jag_common_fini(void)
 {
 	if (slash_proc)
 		(void) closedir(slash_proc);
+
+	while (pid_rec_cnt)
+		_free_pid_rec(pid_recs[--pid_rec_cnt]);
+	xfree(pid_recs);
+	pid_rec_size = 0;
+	id_hash_free(pid_hash);
+	pid_hash = NULL;
 }
 
 extern void destroy_jag_prec(void *object)
@@ -804,6 +839,7 @@ extern void jag_common_poll_data(
 	ListIterator itr;
 	jag_prec_t *prec = NULL;
 	struct jobacctinfo *jobacct = NULL;
+	id_hash_t *prec_hash = NULL;
 	static int processing = 0;
 	char sbuf[72];
 	int energy_counted = 0;
@@ -842,11 +878,17 @@ extern void jag_common_poll_data(
 	if (!list_count(prec_list) || !task_list || !list_count(task_list))
 		goto finished;	/* We have no business being here! */
 
+	prec_hash = id_hash_init(list_count(prec_list));
+	itr = list_iterator_create(prec_list);
+	while ((prec = list_next(itr)))
+		id_hash_add(prec_hash, prec->pid, prec);
+	list_iterator_destroy(itr);
+
 	itr = list_iterator_create(task_list);
 	while ((jobacct = list_next(itr))) {
 		double cpu_calc;
 		double last_total_cputime;
-		if (!(prec = list_find_first(prec_list, _find_prec, jobacct)))
+		if (!(prec = id_hash_find(prec_hash, jobacct->pid)))
 			continue;
 
 #if _DEBUG
@@ -942,6 +984,7 @@ extern void jag_common_poll_data(
 		jobacct_gather_handle_mem_limit(total_job_mem, total_job_vsize);
 
 finished:
+	id_hash_free(prec_hash);
 	FREE_NULL_LIST(prec_list);
 	processing = 0;
 }
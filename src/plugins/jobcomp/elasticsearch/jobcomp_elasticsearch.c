@@ -51,6 +51,7 @@
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/fd.h"
+#include "src/common/id_hash.h"
 #include "src/common/list.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_jobcomp.h"
@@ -100,6 +101,14 @@ const char plugin_type[] = "jobcomp/elasticsearch";
 const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 #define INDEX_RETRY_INTERVAL 30
+#define BULK_MAX_JOBS 1000	/* Jobs indexed by one _bulk request */
+#define BULK_MAX_SIZE (4 * 1024 * 1024)	/* and their bytes */
+#define BULK_INTERVAL 1		/* Seconds jobs wait for a full batch */
+#define BULK_TIMEOUT 120	/* Seconds to complete a _bulk request */
+#define STATS_INTERVAL 300	/* Seconds between statistics messages */
+#define JOURNAL_COMPACT_MIN 1000 /* Indexed jobs before journal rewrite */
+#define JOURNAL_ADD 1		/* Journal record types */
+#define JOURNAL_DEL 2
 #define JOBCOMP_DATA_FORMAT "{\"jobid\":%u,\"username\":\"%s\","	\
 	"\"user_id\":%u,\"groupname\":\"%s\",\"group_id\":%u,"  	\
 	"\"@start\":\"%s\",\"@end\":\"%s\",\"elapsed\":%ld,"		\
@@ -139,19 +148,34 @@ struct http_response {
 
 struct job_node {
 	time_t last_index_retry;
+	time_t log_time;	/* when logged, for latency statistics */
+	uint64_t seq;		/* journal record ID */
+	bool indexed;
 	char * serialized_job;
 };
 
 char *save_state_file = "elasticsearch_state";
+char *journal_file = "elasticsearch_journal";
 char *index_type = "/slurm/jobcomp";
 char *log_url = NULL;
 
 static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t pend_jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pend_jobs_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t pend_new_cnt = 0;	/* jobs logged since last batch */
 static pthread_t job_handler_thread;
 static List jobslist = NULL;
 static bool thread_shutdown = false;
 
+/* Pending jobs are recorded in an append-only journal in StateSaveLocation,
+ * with a record added for each job logged and another once it is indexed.
+ * The journal is rewritten with only the pending jobs once enough of them
+ * have been indexed. Protected by save_lock */
+static int journal_fd = -1;
+static off_t journal_size = 0;
+static uint64_t journal_seq = 0;
+static uint32_t journal_dead = 0;	/* records of indexed jobs */
+
 /* A plugin-global errno. */
 static int plugin_errno = SLURM_SUCCESS;
 
@@ -252,7 +276,24 @@ static uint32_t _read_file(const char *file, char **data)
 	return data_size;
 }
 
-/* Load jobcomp data from save state file */
+/* Build the path of a file in StateSaveLocation */
+static char *_state_file_name(const char *name)
+{
+	char *state_file = slurm_get_state_save_location();
+
+	if (state_file == NULL || state_file[0] == '\0') {
+		error("%s: Could not retrieve StateSaveLocation from conf",
+		      plugin_type);
+		xfree(state_file);
+		return NULL;
+	}
+	if (state_file[strlen(state_file) - 1] != '/')
+		xstrcat(state_file, "/");
+	xstrcat(state_file, name);
+	return state_file;
+}
+
+/* Load jobcomp data from the save state file of older versions */
 static int _load_pending_jobs(void)
 {
 	int i, rc = SLURM_SUCCESS;
@@ -261,26 +302,15 @@ static int _load_pending_jobs(void)
 	Buf buffer;
 	struct job_node *jnode;
 
-	state_file = slurm_get_state_save_location();
-	if (state_file == NULL) {
-		error("%s: Could not retrieve StateSaveLocation from conf",
-		      plugin_type);
+	if (!(state_file = _state_file_name(save_state_file)))
 		return SLURM_ERROR;
-	}
 
-	if (state_file[strlen(state_file) - 1] != '/')
-		xstrcat(state_file, "/");
-	xstrcat(state_file, save_state_file);
-
-	slurm_mutex_lock(&save_lock);
 	data_size = _read_file(state_file, &saved_data);
 	if ((data_size <= 0) || (saved_data == NULL)) {
-		slurm_mutex_unlock(&save_lock);
 		xfree(saved_data);
 		xfree(state_file);
 		return rc;
 	}
-	slurm_mutex_unlock(&save_lock);
 
 	buffer = create_buf(saved_data, data_size);
 	safe_unpack32(&job_cnt, buffer);
@@ -288,6 +318,8 @@ static int _load_pending_jobs(void)
 		safe_unpackstr_xmalloc(&job_data, &tmp32, buffer);
 		jnode = xmalloc(sizeof(struct job_node));
 		jnode->serialized_job = job_data;
+		jnode->log_time = time(NULL);
+		jnode->seq = ++journal_seq;
 		list_enqueue(jobslist, jnode);
 	}
 	if (job_cnt > 0) {
@@ -307,6 +339,12 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static int _find_indexed(void *x, void *key)
+{
+	struct job_node *jnode = (struct job_node *) x;
+	return jnode->indexed;
+}
+
 /* Callback to handle the HTTP response */
 static size_t _write_callback(void *contents, size_t size, size_t nmemb,
 			      void *userp)
@@ -323,102 +361,6 @@ static size_t _write_callback(void *contents, size_t size, size_t nmemb,
 	return realsize;
 }
 
-/* Try to index job into elasticsearch */
-static int _index_job(const char *jobcomp)
-{
-	CURL *curl_handle = NULL;
-	CURLcode res;
-	struct http_response chunk;
-	int rc = SLURM_SUCCESS;
-
-	if (log_url == NULL) {
-		error("%s: JobCompLoc parameter not configured", plugin_type);
-		return SLURM_ERROR;
-	}
-
-	if (curl_global_init(CURL_GLOBAL_ALL) != 0) {
-		error("%s: curl_global_init: %m", plugin_type);
-		rc = SLURM_ERROR;
-	} else if ((curl_handle = curl_easy_init()) == NULL) {
-		error("%s: curl_easy_init: %m", plugin_type);
-		rc = SLURM_ERROR;
-	}
-
-	if (curl_handle) {
-		char *url = xstrdup(log_url);
-		xstrcat(url, index_type);
-
-		chunk.message = xmalloc(1);
-		chunk.size = 0;
-
-		curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-		curl_easy_setopt(curl_handle, CURLOPT_POST, 1);
-		curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, jobcomp);
-		curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE,
-				 strlen(jobcomp));
-		curl_easy_setopt(curl_handle, CURLOPT_HEADER, 1);
-		curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION,
-				 _write_callback);
-		curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA,
-				 (void *) &chunk);
-
-		res = curl_easy_perform(curl_handle);
-		if (res != CURLE_OK) {
-			if (slurm_get_debug_flags() & DEBUG_FLAG_ESEARCH)
-				info("%s: Could not connect to: %s , reason: %s"
-				     , plugin_type, url,
-				     curl_easy_strerror(res));
-			rc = SLURM_ERROR;
-		} else {
-			char *token, *response;
-			response = xstrdup(chunk.message);
-			token = strtok(chunk.message, " ");
-			if (token == NULL) {
-				error("%s: Could not receive the HTTP response"
-				      " status code from %s", plugin_type, 
-					url);
-				rc = SLURM_ERROR;
-			} else {
-				token = strtok(NULL, " ");
-				if ((xstrcmp(token, "100") == 0)) {
-					(void)  strtok(NULL, " ");
-					token = strtok(NULL, " ");
-				}
-				if ((xstrcmp(token, "200") != 0)
-				    && (xstrcmp(token, "201") != 0)) {
-					if (slurm_get_debug_flags() &
-					    DEBUG_FLAG_ESEARCH) {
-						info("%s: HTTP status code %s "
-						     "received from %s",
-						     plugin_type, token, url);
-						info("%s: HTTP response:\n%s",
-						     plugin_type, response);
-					}
-					rc = SLURM_ERROR;
-				} else {
-					token = strtok((char *)jobcomp, ",");
-					(void)  strtok(token, ":");
-					token = strtok(NULL, ":");
-					if (slurm_get_debug_flags() &
-					    DEBUG_FLAG_ESEARCH) {
-						info("%s: Job with jobid %s "
- 						     "indexed into "
-						     "elasticsearch",
-						     plugin_type, token);
-					}
-				}
-				xfree(response);
-			}
-		}
-		xfree(chunk.message);
-		curl_easy_cleanup(curl_handle);
-		xfree(url);
-	}
-	curl_global_cleanup();
-
-	return rc;
-}
-
 /* Escape characters according to RFC7159 */
 static char *_json_escape(const char *str)
 {
@@ -482,95 +424,420 @@ static char *_json_escape(const char *str)
 	return ret;
 }
 
-/* Saves the state of all jobcomp data for further indexing retries */
-static int _save_state(void)
+/* Skip JSON white space */
+static const char *_json_ws(const char *str)
+{
+	while ((*str == ' ') || (*str == '\t') || (*str == '\n') ||
+	       (*str == '\r'))
+		str++;
+	return str;
+}
+
+/* RET the end of the JSON string, number, literal, object or array at str,
+ * or NULL if it is incomplete */
+static const char *_json_skip(const char *str)
+{
+	int depth = 0;
+
+	str = _json_ws(str);
+	do {
+		switch (*str) {
+		case '\0':
+			return NULL;
+		case '"':
+			for (str++; *str != '"'; str++) {
+				if (*str == '\0')
+					return NULL;
+				if ((*str == '\\') && (*++str == '\0'))
+					return NULL;
+			}
+			str++;
+			break;
+		case '{':
+		case '[':
+			depth++;
+			str++;
+			break;
+		case '}':
+		case ']':
+			if (--depth < 0)
+				return NULL;
+			str++;
+			break;
+		case ',':
+		case ':':
+			if (depth == 0)
+				return NULL;
+			str++;
+			break;
+		default:
+			str++;
+			/* Numbers and literals end at the next delimiter */
+			while ((depth == 0) && *str && !strchr(",:{}[]\" \t\n\r",
+							       *str))
+				str++;
+		}
+		if (depth)
+			str = _json_ws(str);
+	} while (depth);
+	return str;
+}
+
+/* Find a member of the JSON object at obj, only among its own members and not
+ * those of nested objects
+ * IN key - member name, or NULL for the first member
+ * RET the member's value, or NULL if not found */
+static const char *_json_member(const char *obj, const char *key)
+{
+	const char *name;
+	bool match;
+
+	obj = _json_ws(obj);
+	if (*obj++ != '{')
+		return NULL;
+	while (1) {
+		obj = _json_ws(obj);
+		if (*obj != '"')
+			return NULL;
+		name = obj + 1;
+		if (!(obj = _json_skip(obj)))
+			return NULL;
+		match = !key || ((strlen(key) == (obj - name - 1)) &&
+				 !strncmp(name, key, obj - name - 1));
+		obj = _json_ws(obj);
+		if (*obj++ != ':')
+			return NULL;
+		obj = _json_ws(obj);
+		if (match)
+			return obj;
+		if (!(obj = _json_skip(obj)))
+			return NULL;
+		obj = _json_ws(obj);
+		if (*obj++ != ',')
+			return NULL;
+	}
+}
+
+/* Index a batch of jobs with one _bulk request, setting indexed for each job
+ * elasticsearch accepted
+ * IN curl_handle - reused by each request, so its connection stays open
+ * IN body - the request, an action and document line per job
+ * RET SLURM_SUCCESS if the request was processed, although some jobs may
+ *     have failed, or SLURM_ERROR if elasticsearch could not process it */
+static int _index_bulk(CURL *curl_handle, struct curl_slist *headers,
+		       struct job_node **jobs, int job_cnt, char *body,
+		       size_t body_size)
+{
+	CURLcode res;
+	struct http_response chunk;
+	long status = 0;
+	char *url;
+	const char *errors, *item, *value;
+	int i, rc = SLURM_SUCCESS;
+	bool debug = slurm_get_debug_flags() & DEBUG_FLAG_ESEARCH;
+
+	if (log_url == NULL) {
+		error("%s: JobCompLoc parameter not configured", plugin_type);
+		return SLURM_ERROR;
+	}
+
+	url = xstrdup_printf("%s%s/_bulk", log_url, index_type);
+	chunk.message = xmalloc(1);
+	chunk.size = 0;
+
+	curl_easy_setopt(curl_handle, CURLOPT_URL, url);
+	curl_easy_setopt(curl_handle, CURLOPT_POST, 1L);
+	curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+	curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, body);
+	curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, (long) body_size);
+	curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, (long) BULK_TIMEOUT);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, _write_callback);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *) &chunk);
+
+	res = curl_easy_perform(curl_handle);
+	if (res != CURLE_OK) {
+		if (debug)
+			info("%s: Could not connect to: %s , reason: %s",
+			     plugin_type, url, curl_easy_strerror(res));
+		rc = SLURM_ERROR;
+		goto fini;
+	}
+	curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &status);
+	if (status != 200) {
+		if (debug) {
+			info("%s: HTTP status code %ld received from %s",
+			     plugin_type, status, url);
+			info("%s: HTTP response:\n%s", plugin_type,
+			     chunk.message);
+		}
+		rc = SLURM_ERROR;
+		goto fini;
+	}
+
+	errors = _json_member(chunk.message, "errors");
+	if (errors && !strncmp(errors, "false", 5)) {
+		for (i = 0; i < job_cnt; i++)
+			jobs[i]->indexed = true;
+		goto fini;
+	}
+
+	/* Each item in the response has the status of one job, in the order
+	 * they were sent, as {"index":{...,"status":201}}. Errors are objects
+	 * of their own which may include a status, so only the status member
+	 * of the action is used. */
+	item = _json_member(chunk.message, "items");
+	if (item && (*item++ != '['))
+		item = NULL;
+	for (i = 0; item && (i < job_cnt); i++) {
+		value = _json_member(item, NULL);
+		if (value)
+			value = _json_member(value, "status");
+		status = value ? strtol(value, NULL, 10) : 0;
+		if ((status == 200) || (status == 201))
+			jobs[i]->indexed = true;
+		else if (debug)
+			info("%s: HTTP status code %ld indexing %.40s",
+			     plugin_type, status, jobs[i]->serialized_job);
+		if ((item = _json_skip(item))) {
+			item = _json_ws(item);
+			if (*item++ != ',')
+				item = NULL;
+		}
+	}
+	if ((i < job_cnt) && debug)
+		info("%s: Response to _bulk request has %d of %d items",
+		     plugin_type, i, job_cnt);
+
+fini:
+	xfree(chunk.message);
+	xfree(url);
+	return rc;
+}
+
+/* Add a record to a journal buffer */
+static void _journal_pack(Buf buffer, uint16_t type, struct job_node *jnode)
+{
+	uint32_t start = get_buf_offset(buffer), end;
+
+	pack32(0, buffer);	/* record size, set below */
+	pack16(type, buffer);
+	pack64(jnode->seq, buffer);
+	if (type == JOURNAL_ADD)
+		packstr(jnode->serialized_job, buffer);
+	end = get_buf_offset(buffer);
+	set_buf_offset(buffer, start);
+	pack32(end - start - sizeof(uint32_t), buffer);
+	set_buf_offset(buffer, end);
+}
+
+static int _write_buf(int fd, Buf buffer, const char *file)
+{
+	char *data = get_buf_data(buffer);
+	uint32_t pos = 0, nwrite = get_buf_offset(buffer);
+	ssize_t amount;
+
+	while (nwrite > 0) {
+		amount = write(fd, &data[pos], nwrite);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			error("%s: Error writing file %s, %m",
+			      plugin_type, file);
+			return SLURM_ERROR;
+		}
+		nwrite -= amount;
+		pos += amount;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Append records to the journal
+ * NOTE: save_lock must be locked on entry */
+static void _journal_write(Buf buffer)
+{
+	if (journal_fd < 0)
+		return;
+	if (_write_buf(journal_fd, buffer, journal_file) != SLURM_SUCCESS) {
+		/* Remove any partial record */
+		if (ftruncate(journal_fd, journal_size))
+			error("%s: ftruncate(%s): %m", plugin_type,
+			      journal_file);
+		return;
+	}
+	journal_size += get_buf_offset(buffer);
+}
+
+/* Recover pending jobs from the journal */
+static void _load_journal(void)
+{
+	char *state_file, *data = NULL, *job_data;
+	uint32_t data_size, rec_size, end, tmp32, job_cnt = 0;
+	uint16_t type;
+	uint64_t seq;
+	id_hash_t *jobs_hash;
+	struct job_node *jnode;
+	Buf buffer;
+
+	if (!(state_file = _state_file_name(journal_file)))
+		return;
+	data_size = _read_file(state_file, &data);
+	if ((data_size <= 0) || (data == NULL)) {
+		xfree(data);
+		xfree(state_file);
+		return;
+	}
+
+	jobs_hash = id_hash_init(0);
+	buffer = create_buf(data, data_size);
+	while (remaining_buf(buffer) >= sizeof(uint32_t)) {
+		safe_unpack32(&rec_size, buffer);
+		/* A record being written when slurmctld died is lost */
+		if (remaining_buf(buffer) < rec_size)
+			break;
+		end = get_buf_offset(buffer) + rec_size;
+		safe_unpack16(&type, buffer);
+		safe_unpack64(&seq, buffer);
+		if (type == JOURNAL_ADD) {
+			safe_unpackstr_xmalloc(&job_data, &tmp32, buffer);
+			jnode = xmalloc(sizeof(struct job_node));
+			jnode->serialized_job = job_data;
+			jnode->log_time = time(NULL);
+			jnode->seq = seq;
+			list_enqueue(jobslist, jnode);
+			id_hash_add(jobs_hash, seq, jnode);
+			job_cnt++;
+		} else if ((type == JOURNAL_DEL) &&
+			   (jnode = id_hash_remove(jobs_hash, seq))) {
+			jnode->indexed = true;
+			job_cnt--;
+		}
+		journal_seq = MAX(journal_seq, seq);
+		set_buf_offset(buffer, end);
+	}
+	goto fini;
+
+unpack_error:
+	error("%s: Error unpacking file %s", plugin_type, state_file);
+fini:
+	list_delete_all(jobslist, _find_indexed, NULL);
+	if (job_cnt && (slurm_get_debug_flags() & DEBUG_FLAG_ESEARCH))
+		info("%s: Loaded %u jobs from journal", plugin_type, job_cnt);
+	id_hash_free(jobs_hash);
+	free_buf(buffer);
+	xfree(state_file);
+}
+
+/* Rewrite the journal with only the pending jobs. Jobs logged while the new
+ * journal is written are copied from the end of the old one. */
+static int _journal_compact(void)
 {
 	int fd, rc = SLURM_SUCCESS;
-	char *state_file, *new_file, *old_file;
+	char *state_file, *new_file, buf[4096];
 	ListIterator iter;
 	static int high_buffer_size = (1024 * 1024);
-	Buf buffer = init_buf(high_buffer_size);
-	uint32_t job_cnt;
+	Buf buffer;
 	struct job_node *jnode;
+	off_t copy_off, new_size;
+	uint32_t dead;
+	ssize_t amount;
 
-	job_cnt = list_count(jobslist);
-	pack32(job_cnt, buffer);
+	if (!(state_file = _state_file_name(journal_file)))
+		return SLURM_ERROR;
+	new_file = xstrdup_printf("%s.new", state_file);
+
+	buffer = init_buf(high_buffer_size);
+	slurm_mutex_lock(&save_lock);
 	iter = list_iterator_create(jobslist);
 	while ((jnode = (struct job_node *)list_next(iter))) {
-		packstr(jnode->serialized_job, buffer);
+		if (!jnode->indexed)
+			_journal_pack(buffer, JOURNAL_ADD, jnode);
 	}
 	list_iterator_destroy(iter);
+	copy_off = journal_size;
+	dead = journal_dead;
+	slurm_mutex_unlock(&save_lock);
+	high_buffer_size = MAX(get_buf_offset(buffer), high_buffer_size);
 
-	state_file = slurm_get_state_save_location();
-	if (state_file == NULL || state_file[0] == '\0') {
-		error("%s: Could not retrieve StateSaveLocation from conf",
-		      plugin_type);
-		return SLURM_ERROR;
-	}
-
-	if (state_file[strlen(state_file) - 1] != '/')
-		xstrcat(state_file, "/");
-
-	xstrcat(state_file, save_state_file);
-	old_file = xstrdup(state_file);
-	new_file = xstrdup(state_file);
-	xstrcat(new_file, ".new");
-	xstrcat(old_file, ".old");
-
-	slurm_mutex_lock(&save_lock);
 	fd = open(new_file, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
 	if (fd < 0) {
 		error("%s: Can't save jobcomp state, open file %s error %m",
 		      plugin_type, new_file);
+		free_buf(buffer);
+		xfree(new_file);
+		xfree(state_file);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(fd);
+	rc = _write_buf(fd, buffer, new_file);
+	new_size = get_buf_offset(buffer);
+	free_buf(buffer);
+	if ((rc == SLURM_SUCCESS) && fsync(fd)) {
+		error("%s: fsync(%s): %m", plugin_type, new_file);
 		rc = SLURM_ERROR;
-	} else {
-		int pos = 0, nwrite, amount, rc2;
-		char *data;
-		fd_set_close_on_exec(fd);
-		nwrite = get_buf_offset(buffer);
-		data = (char *) get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("%s: Error writing file %s, %m",
-				      plugin_type, new_file);
-				rc = SLURM_ERROR;
-				break;
-			}
-			nwrite -= amount;
-			pos += amount;
-		}
-		if ((rc2 = fsync_and_close(fd, save_state_file)))
-			rc = rc2;
 	}
 
-	if (rc == SLURM_ERROR)
-		(void) unlink(new_file);
-	else {
-		(void) unlink(old_file);
-		if (link(state_file, old_file)) {
-			error("%s: Unable to create link for %s -> %s: %m",
-			      plugin_type, state_file, old_file);
-			rc = SLURM_ERROR;
-		}
-		(void) unlink(state_file);
-		if (link(new_file, state_file)) {
-			error("%s: Unable to create link for %s -> %s: %m",
-			      plugin_type, new_file, state_file);
+	slurm_mutex_lock(&save_lock);
+	while ((rc == SLURM_SUCCESS) && (journal_fd >= 0) &&
+	       (copy_off < journal_size)) {
+		amount = pread(journal_fd, buf,
+			       MIN(sizeof(buf), journal_size - copy_off),
+			       copy_off);
+		if ((amount < 0) && (errno == EINTR))
+			continue;
+		if ((amount <= 0) || (write(fd, buf, amount) != amount)) {
+			error("%s: Error copying %s: %m", plugin_type,
+			      journal_file);
 			rc = SLURM_ERROR;
+			break;
 		}
-		(void) unlink(new_file);
+		copy_off += amount;
+		new_size += amount;
 	}
+	if (fsync_and_close(fd, journal_file))
+		rc = SLURM_ERROR;
+	if ((rc == SLURM_SUCCESS) && rename(new_file, state_file)) {
+		error("%s: Unable to rename %s to %s: %m",
+		      plugin_type, new_file, state_file);
+		rc = SLURM_ERROR;
+	}
+	if (rc == SLURM_SUCCESS) {
+		if (journal_fd >= 0)
+			(void) close(journal_fd);
+		/* Read too, for the next rewrite to copy its tail */
+		journal_fd = open(state_file, O_RDWR | O_APPEND);
+		if (journal_fd < 0)
+			error("%s: Can't open %s: %m", plugin_type,
+			      state_file);
+		else
+			fd_set_close_on_exec(journal_fd);
+		journal_size = new_size;
+		journal_dead -= dead;
+	} else
+		(void) unlink(new_file);
+	slurm_mutex_unlock(&save_lock);
 
-	xfree(old_file);
-	xfree(state_file);
 	xfree(new_file);
-	slurm_mutex_unlock(&save_lock);
+	xfree(state_file);
+	return rc;
+}
+
+/* Queue a job to be indexed and record it in the journal */
+static void _pend_job(struct job_node *jnode)
+{
+	Buf buffer = init_buf(strlen(jnode->serialized_job) + 64);
 
+	slurm_mutex_lock(&save_lock);
+	jnode->seq = ++journal_seq;
+	list_enqueue(jobslist, jnode);
+	_journal_pack(buffer, JOURNAL_ADD, jnode);
+	_journal_write(buffer);
+	slurm_mutex_unlock(&save_lock);
 	free_buf(buffer);
 
-	return rc;
+	slurm_mutex_lock(&pend_jobs_lock);
+	if (++pend_new_cnt >= BULK_MAX_JOBS)
+		slurm_cond_signal(&pend_jobs_cond);
+	slurm_mutex_unlock(&pend_jobs_lock);
 }
 
 /* This is a variation of slurm_make_time_str() in src/common/parse_time.h
@@ -840,49 +1107,197 @@ extern int slurm_jobcomp_log_record(struct job_record *job_ptr)
 
 	xstrcat(buffer, "}");
 	jnode = xmalloc(sizeof(struct job_node));
-	jnode->serialized_job = xstrdup(buffer);
-	list_enqueue(jobslist, jnode);
+	jnode->serialized_job = buffer;
+	jnode->log_time = time(NULL);
+	_pend_job(jnode);
 
 	return SLURM_SUCCESS;
 }
 
 
+/* Index statistics, only used by the indexing thread */
+static uint32_t stat_bulk_cnt = 0;	/* _bulk requests */
+static uint32_t stat_bulk_fail = 0;	/* _bulk requests which failed */
+static uint32_t stat_job_cnt = 0;	/* jobs indexed */
+static uint32_t stat_job_fail = 0;	/* jobs elasticsearch rejected */
+static uint64_t stat_bulk_time = 0;	/* usec in _bulk requests */
+static uint64_t stat_bulk_max = 0;
+static uint64_t stat_latency = 0;	/* sec from logging jobs to indexing */
+static uint64_t stat_latency_max = 0;
 
-extern void *_process_jobs(void *x)
+static void _log_stats(void)
 {
+	uint32_t backlog = list_count(jobslist);
+	uint32_t bulk_cnt = MAX(stat_bulk_cnt, 1);
+	uint32_t job_cnt = MAX(stat_job_cnt, 1);
+
+	info("%s: backlog:%u bulk_requests:%u failed:%u "
+	     "ave_usec:%"PRIu64" max_usec:%"PRIu64" jobs_indexed:%u "
+	     "rejected:%u ave_latency:%"PRIu64" max_latency:%"PRIu64,
+	     plugin_type, backlog, stat_bulk_cnt, stat_bulk_fail,
+	     stat_bulk_time / bulk_cnt, stat_bulk_max, stat_job_cnt,
+	     stat_job_fail, stat_latency / job_cnt, stat_latency_max);
+	stat_bulk_cnt = stat_bulk_fail = stat_job_cnt = stat_job_fail = 0;
+	stat_bulk_time = stat_bulk_max = stat_latency = stat_latency_max = 0;
+}
+
+/* Index pending jobs in batches of up to BULK_MAX_JOBS jobs or
+ * BULK_MAX_SIZE bytes, removing those indexed from jobslist and the journal
+ * RET SLURM_ERROR if elasticsearch could not be reached */
+static int _index_pending(CURL *curl_handle, struct curl_slist *headers)
+{
+	static const char action[] = "{\"index\":{}}\n";
+	const size_t action_len = sizeof(action) - 1;
+	struct job_node *jobs[BULK_MAX_JOBS], *jnode;
 	ListIterator iter;
-	struct job_node *jnode = NULL;
+	struct timeval tv1, tv2;
+	uint64_t usec, latency;
+	char *body = NULL, *pos;
+	size_t body_size, len;
+	int i, job_cnt, success_cnt = 0, fail_cnt = 0, wait_retry_cnt = 0;
+	int rc = SLURM_SUCCESS;
 	time_t now;
+	Buf buffer;
 
+	iter = list_iterator_create(jobslist);
 	while (!thread_shutdown) {
-		int success_cnt = 0, fail_cnt = 0, wait_retry_cnt = 0;
-		sleep(1);
-		iter = list_iterator_create(jobslist);
-		while ((jnode = (struct job_node *)list_next(iter)) &&
-		       !thread_shutdown) {
-			now = time(NULL);
-			if ((jnode->last_index_retry == 0) ||
-			    (difftime(now, jnode->last_index_retry) >=
-					INDEX_RETRY_INTERVAL)) {
-				if ((_index_job(jnode->serialized_job) ==
-				     SLURM_SUCCESS)) {
-					list_delete_item(iter);
-					success_cnt++;
-				} else {
-					jnode->last_index_retry = now;
-					fail_cnt++;
-				}
-			} else
+		now = time(NULL);
+		job_cnt = 0;
+		body_size = 0;
+		while ((job_cnt < BULK_MAX_JOBS) &&
+		       (body_size < BULK_MAX_SIZE) &&
+		       (jnode = (struct job_node *)list_next(iter))) {
+			if (jnode->last_index_retry &&
+			    (difftime(now, jnode->last_index_retry) <
+			     INDEX_RETRY_INTERVAL)) {
 				wait_retry_cnt++;
+				continue;
+			}
+			jobs[job_cnt++] = jnode;
+			body_size += action_len +
+				     strlen(jnode->serialized_job) + 1;
+		}
+		if (!job_cnt)
+			break;
+
+		body = xrealloc_nz(body, body_size + 1);
+		for (i = 0, pos = body; i < job_cnt; i++) {
+			memcpy(pos, action, action_len);
+			pos += action_len;
+			len = strlen(jobs[i]->serialized_job);
+			memcpy(pos, jobs[i]->serialized_job, len);
+			pos += len;
+			*pos++ = '\n';
+		}
+		*pos = '\0';
+
+		gettimeofday(&tv1, NULL);
+		rc = _index_bulk(curl_handle, headers, jobs, job_cnt,
+				 body, body_size);
+		gettimeofday(&tv2, NULL);
+		usec = ((tv2.tv_sec - tv1.tv_sec) * 1000000) +
+		       (tv2.tv_usec - tv1.tv_usec);
+		stat_bulk_cnt++;
+		stat_bulk_time += usec;
+		stat_bulk_max = MAX(stat_bulk_max, usec);
+
+		now = time(NULL);
+		for (i = 0; i < job_cnt; i++) {
+			if (jobs[i]->indexed) {
+				latency = difftime(now, jobs[i]->log_time);
+				stat_latency += latency;
+				stat_latency_max = MAX(stat_latency_max,
+						       latency);
+				success_cnt++;
+			} else {
+				jobs[i]->last_index_retry = now;
+				fail_cnt++;
+			}
+		}
+		if (rc != SLURM_SUCCESS) {
+			stat_bulk_fail++;
+			break;
+		}
+	}
+	list_iterator_destroy(iter);
+	xfree(body);
+	stat_job_cnt += success_cnt;
+	if (rc == SLURM_SUCCESS)
+		stat_job_fail += fail_cnt;
+
+	if (success_cnt) {
+		buffer = init_buf(success_cnt * 20);
+		slurm_mutex_lock(&save_lock);
+		iter = list_iterator_create(jobslist);
+		while ((jnode = (struct job_node *)list_next(iter))) {
+			if (jnode->indexed)
+				_journal_pack(buffer, JOURNAL_DEL, jnode);
 		}
 		list_iterator_destroy(iter);
-		if ((success_cnt || fail_cnt) &&
-		    (slurm_get_debug_flags() & DEBUG_FLAG_ESEARCH)) {
-			info("%s: index success:%d fail:%d wait_retry:%d",
-			     plugin_type, success_cnt, fail_cnt,
-			     wait_retry_cnt);
+		_journal_write(buffer);
+		journal_dead += success_cnt;
+		slurm_mutex_unlock(&save_lock);
+		free_buf(buffer);
+		list_delete_all(jobslist, _find_indexed, NULL);
+	}
+
+	if ((success_cnt || fail_cnt) &&
+	    (slurm_get_debug_flags() & DEBUG_FLAG_ESEARCH)) {
+		info("%s: index success:%d fail:%d wait_retry:%d",
+		     plugin_type, success_cnt, fail_cnt,
+		     wait_retry_cnt);
+	}
+	return rc;
+}
+
+extern void *_process_jobs(void *x)
+{
+	CURL *curl_handle;
+	struct curl_slist *headers = NULL;
+	struct timespec ts;
+	time_t now, hold_until = 0, stats_time = time(NULL);
+
+	if ((curl_handle = curl_easy_init()) == NULL) {
+		error("%s: curl_easy_init: %m", plugin_type);
+		return NULL;
+	}
+	headers = curl_slist_append(headers,
+				    "Content-Type: application/x-ndjson");
+
+	while (!thread_shutdown) {
+		/* Wait for a full batch, or index what there is after
+		 * BULK_INTERVAL */
+		slurm_mutex_lock(&pend_jobs_lock);
+		if (!thread_shutdown && (pend_new_cnt < BULK_MAX_JOBS)) {
+			ts.tv_sec = time(NULL) + BULK_INTERVAL;
+			ts.tv_nsec = 0;
+			slurm_cond_timedwait(&pend_jobs_cond, &pend_jobs_lock,
+					     &ts);
+		}
+		pend_new_cnt = 0;
+		slurm_mutex_unlock(&pend_jobs_lock);
+		if (thread_shutdown)
+			break;
+
+		now = time(NULL);
+		/* If elasticsearch is down, wait before trying again */
+		if ((now >= hold_until) &&
+		    (_index_pending(curl_handle, headers) != SLURM_SUCCESS))
+			hold_until = now + INDEX_RETRY_INTERVAL;
+
+		if (journal_dead >= MAX(JOURNAL_COMPACT_MIN,
+					list_count(jobslist)))
+			(void) _journal_compact();
+
+		if (difftime(now, stats_time) >= STATS_INTERVAL) {
+			if (slurm_get_debug_flags() & DEBUG_FLAG_ESEARCH)
+				_log_stats();
+			stats_time = now;
 		}
 	}
+
+	curl_slist_free_all(headers);
+	curl_easy_cleanup(curl_handle);
 	return NULL;
 }
 
@@ -901,26 +1316,46 @@ extern int init(void)
 {
 	pthread_attr_t thread_attr;
 	int rc = SLURM_SUCCESS;
+	char *state_file;
+
+	if (curl_global_init(CURL_GLOBAL_ALL) != 0)
+		error("%s: curl_global_init: %m", plugin_type);
 
 	jobslist = list_create(_jobslist_del);
+	_load_journal();
+	(void) _load_pending_jobs();
+	/* Start a new journal, including any jobs from an older version's
+	 * state file */
+	if ((_journal_compact() == SLURM_SUCCESS) &&
+	    (state_file = _state_file_name(save_state_file))) {
+		(void) unlink(state_file);
+		xfree(state_file);
+	}
+
 	slurm_attr_init(&thread_attr);
 	if (pthread_create(&job_handler_thread, &thread_attr,
 			   _process_jobs, NULL))
 		fatal("pthread_create error %m");
-	slurm_mutex_lock(&pend_jobs_lock);
-	(void) _load_pending_jobs();
-	slurm_mutex_unlock(&pend_jobs_lock);
+	slurm_attr_destroy(&thread_attr);
 
 	return rc;
 }
 
 extern int fini(void)
 {
+	slurm_mutex_lock(&pend_jobs_lock);
 	thread_shutdown = true;
+	slurm_cond_signal(&pend_jobs_cond);
+	slurm_mutex_unlock(&pend_jobs_lock);
 	pthread_join(job_handler_thread, NULL);
 
-	_save_state();
+	(void) _journal_compact();
+	if (journal_fd >= 0) {
+		(void) close(journal_fd);
+		journal_fd = -1;
+	}
 	list_destroy(jobslist);
+	curl_global_cleanup();
 	xfree(log_url);
 	return SLURM_SUCCESS;
 }
@@ -35,13 +35,17 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include "kvs.h"
 #include "setup.h"
 #include "tree.h"
 #include "pmi.h"
+#include "client.h"
 
 #define MAX_RETRIES 5
 
@@ -61,6 +65,7 @@ typedef struct kvs_bucket {
 
 static kvs_bucket_t *kvs_hash = NULL;
 static uint32_t hash_size = 0;
+static uint32_t kvs_count = 0;
 
 static char *temp_kvs_buf = NULL;
 static int temp_kvs_cnt = 0;
@@ -69,27 +74,467 @@ static int temp_kvs_size = 0;
 static int no_dup_keys = 0;
 
 #define TASKS_PER_BUCKET 8
+#define PAIRS_PER_BUCKET 4	/* average, before the hash is grown */
 #define TEMP_KVS_SIZE_INC 2048
 
 #define KEY_INDEX(i) (i * 2)
 #define VAL_INDEX(i) (i * 2 + 1)
 #define HASH(key) ( _hash(key) % hash_size)
 
+/* FNV-1a, the hash is local to each process */
 inline static uint32_t
 _hash(char *key)
 {
-	int len, i;
-	uint32_t hash = 0;
-	uint8_t shift;
-
-	len = strlen(key);
-	for (i = 0; i < len; i ++) {
-		shift = (uint8_t)(hash >> 24);
-		hash = (hash << 8) | (uint32_t)(shift ^ (uint8_t)key[i]);
+	uint32_t hash = 2166136261U;
+
+	while (*key) {
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619;
 	}
 	return hash;
 }
 
+/*
+ * Fence timing, from when all local tasks entered the fence until the
+ * KVS of all nodes is in the local hash.
+ */
+static struct timeval fence_tv;
+static uint32_t fence_cnt = 0;
+static uint64_t fence_usec_sum = 0;
+static uint64_t fence_usec_max = 0;
+
+static void
+_fence_start(void)
+{
+	gettimeofday(&fence_tv, NULL);
+}
+
+extern void
+kvs_fence_done(uint32_t size)
+{
+	struct timeval now;
+	uint64_t usec;
+
+	gettimeofday(&now, NULL);
+	usec = (now.tv_sec - fence_tv.tv_sec) * 1000000 +
+		now.tv_usec - fence_tv.tv_usec;
+	fence_cnt++;
+	fence_usec_sum += usec;
+	if (usec > fence_usec_max)
+		fence_usec_max = usec;
+	debug("mpi/pmi2: kvs fence %u done by %s in %"PRIu64" usec, "
+	      "%u bytes of kvs", fence_cnt,
+	      job_info.fence_allgather ? "allgather" : "tree", usec, size);
+}
+
+/*
+ * Fence by allgather among the stepds, bypassing srun. This is the Bruck
+ * algorithm: in round r each stepd sends the KVS blocks it holds to the
+ * stepd 2^r below it and gets as many from the stepd 2^r above it, so every
+ * stepd holds the KVS of all nodes after ceil(log2(nnodes)) rounds. Blocks
+ * are kept in node order starting from this node, so the ones to send are
+ * always at the start. Data for a round (or fence) not reached yet is kept
+ * in ag_early_list until then.
+ *
+ * Sends go through the slurmd of the peer, which blocks until the peer
+ * stepd reads the data. Since every stepd sends in the same round, they
+ * are done by a separate thread so the agent can keep reading.
+ */
+typedef struct {
+	uint32_t seq;
+	uint32_t round;
+	Buf buf;
+} ag_msg_t;
+
+typedef struct {
+	char *host;
+	uint32_t len;
+	char *data;
+} ag_send_t;
+
+static bool ag_active = false;
+static uint32_t ag_round = 0;		/* round waiting for data */
+static uint32_t ag_rounds = 0;
+static char *ag_data = NULL;		/* gathered blocks */
+static uint32_t ag_size = 0;
+static uint32_t ag_alloc = 0;
+static uint32_t *ag_blk_size = NULL;
+static uint32_t ag_blk_cnt = 0;
+static List ag_early_list = NULL;
+static hostlist_t ag_hl = NULL;
+
+static List ag_send_list = NULL;
+static bool ag_send_fini = false;
+static pthread_t ag_send_tid = 0;
+static pthread_mutex_t ag_send_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ag_send_cond = PTHREAD_COND_INITIALIZER;
+
+static void
+_ag_msg_free(void *x)
+{
+	ag_msg_t *msg = (ag_msg_t *)x;
+
+	free_buf(msg->buf);
+	xfree(msg);
+}
+
+static void
+_ag_send_free(void *x)
+{
+	ag_send_t *send = (ag_send_t *)x;
+
+	xfree(send->host);
+	xfree(send->data);
+	xfree(send);
+}
+
+static void *
+_ag_send_thread(void *arg)
+{
+	ag_send_t *send;
+	int rc = SLURM_ERROR, retry;
+	unsigned int delay;
+
+	while (1) {
+		slurm_mutex_lock(&ag_send_mutex);
+		while (!ag_send_fini && (list_count(ag_send_list) == 0))
+			pthread_cond_wait(&ag_send_cond, &ag_send_mutex);
+		send = list_dequeue(ag_send_list);
+		slurm_mutex_unlock(&ag_send_mutex);
+		if (!send)
+			break;
+
+		for (retry = 0, delay = 1; ; delay *= 2) {
+			rc = slurm_forward_data(&send->host, tree_sock_addr,
+						send->len, send->data);
+			if ((rc == SLURM_SUCCESS) || (++retry >= MAX_RETRIES))
+				break;
+			verbose("failed to send kvs allgather data to %s, "
+				"rc=%d, retrying", send->host, rc);
+			/* wait, in case the stepd there is not ready */
+			sleep(delay);
+		}
+		if (rc != SLURM_SUCCESS) {
+			error("mpi/pmi2: failed to send kvs allgather data "
+			      "to %s", send->host);
+			/* cancel the step to avoid tasks hang */
+			slurm_kill_job_step(job_info.jobid, job_info.stepid,
+					    SIGKILL);
+		}
+		_ag_send_free(send);
+	}
+	return NULL;
+}
+
+static int
+_ag_queue_send(uint32_t nodeid, Buf buf)
+{
+	pthread_attr_t attr;
+	ag_send_t *send;
+	char *host;
+	int retries = 0;
+
+	if (!ag_send_list) {
+		ag_send_list = list_create(_ag_send_free);
+		slurm_attr_init(&attr);
+		while ((errno = pthread_create(&ag_send_tid, &attr,
+					       _ag_send_thread, NULL))) {
+			if (++retries > MAX_RETRIES) {
+				error("mpi/pmi2: pthread_create error %m");
+				slurm_attr_destroy(&attr);
+				FREE_NULL_LIST(ag_send_list);
+				free_buf(buf);
+				return SLURM_ERROR;
+			}
+			sleep(1);
+		}
+		slurm_attr_destroy(&attr);
+	}
+
+	host = hostlist_nth(ag_hl, nodeid); /* strdup-ed */
+	send = xmalloc(sizeof(ag_send_t));
+	send->host = xstrdup(host);
+	free(host);
+	send->len = get_buf_offset(buf);
+	send->data = xfer_buf_data(buf);
+
+	slurm_mutex_lock(&ag_send_mutex);
+	list_enqueue(ag_send_list, send);
+	pthread_cond_signal(&ag_send_cond);
+	slurm_mutex_unlock(&ag_send_mutex);
+
+	return SLURM_SUCCESS;
+}
+
+/* send the blocks of round ag_round */
+static int
+_ag_send(void)
+{
+	uint32_t dist = 1 << ag_round, cnt, size = 0, i;
+	uint32_t nnodes = job_info.nnodes;
+	Buf buf;
+
+	cnt = MIN(dist, nnodes - dist);
+	for (i = 0; i < cnt; i ++)
+		size += ag_blk_size[i];
+
+	buf = init_buf(size + (cnt + 5) * sizeof(uint32_t) + 2);
+	pack16(TREE_CMD_KVS_ALLGATHER, buf);
+	pack32(kvs_seq, buf);
+	pack32(ag_round, buf);
+	pack32(job_info.nodeid, buf);
+	pack32(cnt, buf);
+	for (i = 0; i < cnt; i ++)
+		pack32(ag_blk_size[i], buf);
+	packmem(ag_data, size, buf);
+
+	return _ag_queue_send((job_info.nodeid + nnodes - dist) % nnodes, buf);
+}
+
+/* merge the blocks of round ag_round */
+static int
+_ag_merge(Buf buf)
+{
+	uint32_t dist = 1 << ag_round, nnodes = job_info.nnodes;
+	uint32_t from_nodeid, cnt, size = 0, len, i;
+	char *data;
+
+	safe_unpack32(&from_nodeid, buf);
+	safe_unpack32(&cnt, buf);
+	if ((from_nodeid != (job_info.nodeid + dist) % nnodes) ||
+	    (cnt != MIN(dist, nnodes - dist))) {
+		error("mpi/pmi2: unexpected kvs allgather data from node %u "
+		      "in round %u", from_nodeid, ag_round);
+		return SLURM_ERROR;
+	}
+	for (i = 0; i < cnt; i ++) {
+		safe_unpack32(&ag_blk_size[ag_blk_cnt + i], buf);
+		size += ag_blk_size[ag_blk_cnt + i];
+	}
+	safe_unpackmem_ptr(&data, &len, buf);
+	if (len != size) {
+		error("mpi/pmi2: bad kvs allgather data from node %u",
+		      from_nodeid);
+		return SLURM_ERROR;
+	}
+
+	if (ag_size + len > ag_alloc) {
+		ag_alloc = MAX(ag_alloc * 2, ag_size + len);
+		xrealloc(ag_data, ag_alloc);
+	}
+	memcpy(&ag_data[ag_size], data, len);
+	ag_size += len;
+	ag_blk_cnt += cnt;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("mpi/pmi2: failed to unpack kvs allgather message");
+	return SLURM_ERROR;
+}
+
+/* all blocks gathered, put them into the local hash */
+static void
+_ag_done(void)
+{
+	char *key, *val, *errmsg = NULL;
+	uint32_t temp32;
+	int rc = SLURM_SUCCESS;
+	Buf buf;
+
+	buf = create_buf(ag_data, ag_size); /* ag_data taken by buf */
+	ag_data = NULL;
+	ag_size = ag_alloc = 0;
+	ag_blk_cnt = 0;
+	ag_active = false;
+	kvs_seq++;
+
+	while (remaining_buf(buf) > 0) {
+		safe_unpackstr_xmalloc(&key, &temp32, buf);
+		safe_unpackstr_xmalloc(&val, &temp32, buf);
+		kvs_put(key, val);
+		xfree(key);
+		xfree(val);
+	}
+	kvs_fence_done(size_buf(buf));
+
+resp:
+	free_buf(buf);
+	send_kvs_fence_resp_to_clients(rc, errmsg);
+	if (rc != SLURM_SUCCESS)
+		slurm_kill_job_step(job_info.jobid, job_info.stepid, SIGKILL);
+	return;
+
+unpack_error:
+	error("mpi/pmi2: unpack kvs error in allgather");
+	rc = SLURM_ERROR;
+	errmsg = "mpi/pmi2: unpack kvs error in allgather";
+	goto resp;
+}
+
+/* take early data of rounds from ag_round on, until some is missing */
+static int
+_ag_progress(void)
+{
+	ListIterator iter;
+	ag_msg_t *msg;
+	int rc;
+
+	while (ag_round < ag_rounds) {
+		msg = NULL;
+		if (ag_early_list) {
+			iter = list_iterator_create(ag_early_list);
+			while ((msg = list_next(iter))) {
+				if ((msg->seq == kvs_seq) &&
+				    (msg->round == ag_round)) {
+					list_remove(iter);
+					break;
+				}
+			}
+			list_iterator_destroy(iter);
+		}
+		if (!msg)
+			return SLURM_SUCCESS;
+
+		rc = _ag_merge(msg->buf);
+		_ag_msg_free(msg);
+		if (rc != SLURM_SUCCESS)
+			return rc;
+		if ((++ag_round < ag_rounds) &&
+		    ((rc = _ag_send()) != SLURM_SUCCESS))
+			return rc;
+	}
+	_ag_done();
+	return SLURM_SUCCESS;
+}
+
+static void
+_ag_init(void)
+{
+	if (ag_hl)
+		return;
+	ag_hl = hostlist_create(job_info.step_nodelist);
+	ag_blk_size = xmalloc(job_info.nnodes * sizeof(uint32_t));
+	while ((1 << ag_rounds) < job_info.nnodes)
+		ag_rounds ++;
+}
+
+/* all local tasks entered the fence */
+static int
+_ag_start(void)
+{
+	int rc = SLURM_SUCCESS;
+
+	_ag_init();
+	/* the local block, which temp_kvs_init() left without header */
+	ag_data = temp_kvs_buf;
+	ag_size = temp_kvs_cnt;
+	ag_alloc = temp_kvs_size;
+	temp_kvs_buf = NULL;
+	temp_kvs_init();
+	ag_blk_size[0] = ag_size;
+	ag_blk_cnt = 1;
+	ag_round = 0;
+	ag_active = true;
+
+	if ((ag_rounds > 0) && ((rc = _ag_send()) != SLURM_SUCCESS))
+		return rc;
+	return _ag_progress();
+}
+
+extern int
+kvs_allgather_recv(Buf buf)
+{
+	uint32_t seq, round;
+	ag_msg_t *msg;
+	char *data;
+	int rc = SLURM_SUCCESS;
+
+	_ag_init();
+	safe_unpack32(&seq, buf);
+	safe_unpack32(&round, buf);
+	debug3("mpi/pmi2: in kvs_allgather_recv, seq=%u, round=%u",
+	       seq, round);
+
+	/* peers may be one fence ahead, but no more */
+	if (((seq != kvs_seq) && (seq != kvs_seq + 1)) ||
+	    (round >= ag_rounds)) {
+		error("mpi/pmi2: invalid kvs allgather seq %u round %u "
+		      "ignored, expect seq %u", seq, round, kvs_seq);
+		return SLURM_ERROR;
+	}
+
+	if (ag_active && (seq == kvs_seq) && (round == ag_round)) {
+		rc = _ag_merge(buf);
+		if ((rc == SLURM_SUCCESS) && (++ag_round < ag_rounds))
+			rc = _ag_send();
+		if (rc == SLURM_SUCCESS)
+			rc = _ag_progress();
+	} else {
+		/* the tree buf is freed on return, keep a copy */
+		msg = xmalloc(sizeof(ag_msg_t));
+		msg->seq = seq;
+		msg->round = round;
+		data = xmalloc(remaining_buf(buf));
+		memcpy(data, &get_buf_data(buf)[get_buf_offset(buf)],
+		       remaining_buf(buf));
+		msg->buf = create_buf(data, remaining_buf(buf));
+		if (!ag_early_list)
+			ag_early_list = list_create(_ag_msg_free);
+		list_append(ag_early_list, msg);
+	}
+
+	if (rc != SLURM_SUCCESS) {
+		send_kvs_fence_resp_to_clients(
+			rc, "mpi/pmi2: kvs allgather failed");
+		/* cancel the step to avoid tasks hang */
+		slurm_kill_job_step(job_info.jobid, job_info.stepid, SIGKILL);
+	}
+	return rc;
+
+unpack_error:
+	error("mpi/pmi2: failed to unpack kvs allgather message");
+	return SLURM_ERROR;
+}
+
+extern void
+kvs_fence_fini(void)
+{
+	if (!in_stepd())
+		return;
+
+	if (ag_send_list) {
+		/* let the last sends go out, peers may still need them */
+		slurm_mutex_lock(&ag_send_mutex);
+		ag_send_fini = true;
+		pthread_cond_signal(&ag_send_cond);
+		slurm_mutex_unlock(&ag_send_mutex);
+		pthread_join(ag_send_tid, NULL);
+		FREE_NULL_LIST(ag_send_list);
+	}
+	FREE_NULL_LIST(ag_early_list);
+	if (ag_hl) {
+		hostlist_destroy(ag_hl);
+		ag_hl = NULL;
+	}
+	xfree(ag_blk_size);
+	xfree(ag_data);
+
+	if (fence_cnt == 0)
+		return;
+	/* one line per step is enough at info level */
+	if (job_info.nodeid == 0) {
+		info("mpi/pmi2: %u kvs fences by %s, %"PRIu64" usec average, "
+		     "%"PRIu64" usec max", fence_cnt,
+		     job_info.fence_allgather ? "allgather" : "tree",
+		     fence_usec_sum / fence_cnt, fence_usec_max);
+	} else {
+		debug("mpi/pmi2: %u kvs fences by %s, %"PRIu64" usec "
+		      "average, %"PRIu64" usec max", fence_cnt,
+		      job_info.fence_allgather ? "allgather" : "tree",
+		      fence_usec_sum / fence_cnt, fence_usec_max);
+	}
+}
+
 extern int
 temp_kvs_init(void)
 {
@@ -102,6 +547,13 @@ temp_kvs_init(void)
 	temp_kvs_size = TEMP_KVS_SIZE_INC;
 	temp_kvs_buf = xmalloc(temp_kvs_size);
 
+	tasks_to_wait = 0;
+	children_to_wait = 0;
+
+	/* allgather messages get their header when sent, see _ag_send() */
+	if (in_stepd() && job_info.fence_allgather)
+		return SLURM_SUCCESS;
+
 	/* put the tree cmd here to simplify message sending */
 	if (in_stepd()) {
 		cmd = TREE_CMD_KVS_FENCE;
@@ -132,9 +584,6 @@ temp_kvs_init(void)
 	temp_kvs_cnt += size;
 	free_buf(buf);
 
-	tasks_to_wait = 0;
-	children_to_wait = 0;
-
 	return SLURM_SUCCESS;
 }
 
@@ -192,6 +641,12 @@ temp_kvs_send(void)
 	unsigned int delay = 1;
 	char *nodelist = NULL;
 
+	if (in_stepd()) {
+		_fence_start();
+		if (job_info.fence_allgather)
+			return _ag_start();
+	}
+
 	if (!in_stepd())	/* srun */
 		nodelist = xstrdup(job_info.step_nodelist);
 	else if (tree_info.parent_node)
@@ -231,6 +686,36 @@ temp_kvs_send(void)
 
 /**************************************************************/
 
+/* double the hash when buckets get long, kvs_get() scans them */
+static void
+_kvs_grow(void)
+{
+	kvs_bucket_t *old_hash = kvs_hash, *bucket;
+	uint32_t old_size = hash_size, i, j;
+
+	hash_size *= 2;
+	kvs_hash = xmalloc(hash_size * sizeof(kvs_bucket_t));
+	for (i = 0; i < old_size; i ++) {
+		for (j = 0; j < old_hash[i].count; j ++) {
+			bucket = &kvs_hash[HASH(old_hash[i].pairs[KEY_INDEX(j)])];
+			if (bucket->count * 2 >= bucket->size) {
+				bucket->size += (PAIRS_PER_BUCKET * 2);
+				xrealloc(bucket->pairs,
+					 bucket->size * sizeof(char *));
+			}
+			bucket->pairs[KEY_INDEX(bucket->count)] =
+				old_hash[i].pairs[KEY_INDEX(j)];
+			bucket->pairs[VAL_INDEX(bucket->count)] =
+				old_hash[i].pairs[VAL_INDEX(j)];
+			bucket->count ++;
+		}
+		xfree(old_hash[i].pairs);
+	}
+	xfree(old_hash);
+	debug2("mpi/pmi2: kvs hash grown to %u buckets for %u pairs",
+	       hash_size, kvs_count);
+}
+
 extern int
 kvs_init(void)
 {
@@ -304,6 +789,9 @@ kvs_put(char *key, char *val)
 	bucket->pairs[VAL_INDEX(i)] = xstrdup(val);
 	bucket->count ++;
 
+	if (++kvs_count > hash_size * PAIRS_PER_BUCKET)
+		_kvs_grow();
+
 	debug3("mpi/pmi2: put kvs %s=%s", key, val);
 	return SLURM_SUCCESS;
 }
@@ -320,8 +808,10 @@ kvs_clear(void)
 			xfree (bucket->pairs[KEY_INDEX(j)]);
 			xfree (bucket->pairs[VAL_INDEX(j)]);
 		}
+		xfree(bucket->pairs);
 	}
 	xfree(kvs_hash);
+	kvs_count = 0;
 
 	return SLURM_SUCCESS;
 }
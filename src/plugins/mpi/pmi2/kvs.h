@@ -54,6 +54,10 @@ extern int   temp_kvs_add(char *key, char *val);
 extern int   temp_kvs_merge(Buf buf);
 extern int   temp_kvs_send(void);
 
+extern int   kvs_allgather_recv(Buf buf);
+extern void  kvs_fence_done(uint32_t size);
+extern void  kvs_fence_fini(void);
+
 extern int   kvs_init(void);
 extern char *kvs_get(char *key);
 extern int   kvs_put(char *key, char *val);
@@ -48,6 +48,7 @@
 
 #include "setup.h"
 #include "agent.h"
+#include "kvs.h"
 #include "spawn.h"
 
 /*
@@ -180,6 +181,7 @@ extern int fini()
 {
 	/* cleanup after ourself */
 	pmi2_stop_agent();
+	kvs_fence_fini();
 	pmi2_cleanup_stepd();
 	return 0;
 }
@@ -292,7 +292,9 @@ _handle_kvs_fence(int fd, int lrank, client_req_t *req)
 	       job_info.gtids[lrank]);
 	if (tasks_to_wait == 0 && children_to_wait == 0) {
 		tasks_to_wait = job_info.ltasks;
-		children_to_wait = tree_info.num_children;
+		/* no stepd children report to us with allgather */
+		children_to_wait = job_info.fence_allgather ?
+			0 : tree_info.num_children;
 	}
 	tasks_to_wait --;
 
@@ -118,6 +118,13 @@ _setup_stepd_job_info(const stepd_step_rec_t *job, char ***env)
 	} else {
 		job_info.pmi_debugged = 0;
 	}
+	p = getenvp(*env, PMI2_FENCE_ENV);
+	if (p && !xstrcasecmp(p, "allgather")) {
+		job_info.fence_allgather = true;
+	} else if (p && xstrcasecmp(p, "tree")) {
+		info("invalid PMI2 fence mode (%s) detected. "
+		     "fallback to tree.", p);
+	}
 	p = getenvp(*env, PMI2_SPAWN_SEQ_ENV);
 	if (p) { 		/* spawned */
 		job_info.spawn_seq = atoi(p);
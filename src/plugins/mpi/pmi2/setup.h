@@ -66,6 +66,7 @@ typedef struct pmi2_job_info {
 	uint32_t spawn_seq;	/* seq of spawn. 0 if not spawned */
 
 	int pmi_debugged;    /* whether output verbose PMI messages */
+	bool fence_allgather; /* fence by allgather among stepds, not srun */
 	char *step_nodelist; /* list of nodes in this job step */
 	char *proc_mapping;  /* processor mapping */
 	char *pmi_jobid;     /* PMI job id */
@@ -68,6 +68,7 @@ static int _handle_name_unpublish(int fd, Buf buf);
 static int _handle_name_lookup(int fd, Buf buf);
 static int _handle_ring(int fd, Buf buf);
 static int _handle_ring_resp(int fd, Buf buf);
+static int _handle_kvs_allgather(int fd, Buf buf);
 
 static uint32_t  spawned_srun_ports_size = 0;
 static uint16_t *spawned_srun_ports = NULL;
@@ -83,6 +84,7 @@ static int (*tree_cmd_handlers[]) (int fd, Buf buf) = {
 	_handle_name_lookup,
 	_handle_ring,
 	_handle_ring_resp,
+	_handle_kvs_allgather,
 	NULL
 };
 
@@ -96,6 +98,7 @@ static char *tree_cmd_names[] = {
 	"TREE_CMD_NAME_LOOKUP",
 	"TREE_CMD_RING",
 	"TREE_CMD_RING_RESP",
+	"TREE_CMD_KVS_ALLGATHER",
 	NULL,
 };
 
@@ -174,7 +177,7 @@ _handle_kvs_fence_resp(int fd, Buf buf)
 {
 	char *key, *val, *errmsg = NULL;
 	int rc = SLURM_SUCCESS;
-	uint32_t temp32, seq;
+	uint32_t temp32, seq, size;
 
 	debug3("mpi/pmi2: in _handle_kvs_fence_resp");
 
@@ -197,8 +200,8 @@ _handle_kvs_fence_resp(int fd, Buf buf)
 		waiting_kvs_resp = 0;
 	}
 
-	temp32 = remaining_buf(buf);
-	debug3("mpi/pmi2: buf length: %u", temp32);
+	size = remaining_buf(buf);
+	debug3("mpi/pmi2: buf length: %u", size);
 	/* put kvs into local hash */
 	while (remaining_buf(buf) > 0) {
 		safe_unpackstr_xmalloc(&key, &temp32, buf);
@@ -208,6 +211,7 @@ _handle_kvs_fence_resp(int fd, Buf buf)
 		xfree(key);
 		xfree(val);
 	}
+	kvs_fence_done(size);
 
 resp:
 	send_kvs_fence_resp_to_clients(rc, errmsg);
@@ -558,6 +562,14 @@ unpack_error:
 	goto out;
 }
 
+/* only called in stepd, with fence by allgather */
+static int
+_handle_kvs_allgather(int fd, Buf buf)
+{
+	debug3("mpi/pmi2: in _handle_kvs_allgather");
+	return kvs_allgather_recv(buf);
+}
+
 /* handles ring_out messages coming in from parent in stepd tree */
 static int
 _handle_ring_resp(int fd, Buf buf)
@@ -48,6 +48,7 @@ enum {
 	TREE_CMD_NAME_LOOKUP,
 	TREE_CMD_RING,
 	TREE_CMD_RING_RESP,
+	TREE_CMD_KVS_ALLGATHER,
 	TREE_CMD_COUNT
 };
 
@@ -1873,6 +1873,8 @@ extern bool decay_apply_new_usage(struct job_record *job_ptr,
 extern int decay_apply_weighted_factors(struct job_record *job_ptr,
 					 time_t *start_time_ptr)
 {
+	uint32_t new_prio;
+
 	/* Always return SUCCESS so that list_for_each will
 	 * continue processing list of jobs. */
 
@@ -1886,8 +1888,12 @@ extern int decay_apply_weighted_factors(struct job_record *job_ptr,
 	     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
 		return SLURM_SUCCESS;
 
-	job_ptr->priority = _get_priority_internal(*start_time_ptr, job_ptr);
-	last_job_update = time(NULL);
+	new_prio = _get_priority_internal(*start_time_ptr, job_ptr);
+	if (new_prio != job_ptr->priority) {
+		job_ptr->priority = new_prio;
+		job_modified(job_ptr, time(NULL));
+	} else
+		last_job_update = time(NULL);
 	debug2("priority for job %u is now %u",
 	       job_ptr->job_id, job_ptr->priority);
 
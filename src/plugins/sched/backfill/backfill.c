@@ -92,23 +92,48 @@
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
 #include "backfill.h"
+#include "node_space.h"
 
 #define BACKFILL_INTERVAL	30
 #define BACKFILL_RESOLUTION	60
 #define BACKFILL_WINDOW		(24 * 60 * 60)
 #define BF_MAX_USERS		1000
 #define BF_MAX_JOB_ARRAY_RESV	20
+#define BF_MAX_THREADS		64
 
 #define SLURMCTLD_THREAD_LIMIT	5
 #define SCHED_TIMEOUT		2000000	/* time in micro-seconds */
 #define YIELD_SLEEP		500000;	/* time in micro-seconds */
 
-typedef struct node_space_map {
-	time_t begin_time;
-	time_t end_time;
-	bitstr_t *avail_bitmap;
-	int next;	/* next record, by time, zero termination */
-} node_space_map_t;
+/* Placement test of a pending job run by a worker thread ahead of the main
+ * backfill loop. The result is only used if the job reaches the head of the
+ * queue with identical inputs and no intervening change in select plugin
+ * state (job started or locks released). */
+typedef struct bf_spec {
+	struct job_record *job_ptr;
+	uint32_t job_id;
+	struct part_record *part_ptr;
+	uint32_t priority;
+	uint32_t time_limit;		/* job time limit during the test */
+	uint32_t min_nodes;
+	uint32_t max_nodes;
+	uint32_t req_nodes;
+	uint32_t job_no_reserve;
+	bitstr_t *in_bitmap;		/* nodes available to the job */
+	bitstr_t *exc_core_bitmap;	/* cores which can not be used */
+	bitstr_t *out_bitmap;		/* nodes selected for the job */
+	int rc;
+	time_t start_time;		/* expected start time */
+	uint32_t total_cpus;
+	bool best_switch;
+	/* Job fields changed by the test, restored once it completes */
+	struct part_record *save_part_ptr;
+	uint32_t save_priority;
+	uint32_t save_time_limit;
+	time_t save_start_time;
+	uint32_t save_total_cpus;
+	bool save_best_switch;
+} bf_spec_t;
 
 /* Diag statistics */
 extern diag_stats_t slurmctld_diag_stats;
@@ -128,6 +153,10 @@ static int backfill_window = BACKFILL_WINDOW;
 static int bf_max_job_array_resv = BF_MAX_JOB_ARRAY_RESV;
 static int bf_min_age_reserve = 0;
 static uint32_t bf_min_prio_reserve = 0;
+static int bf_threads = 1;
+static bf_spec_t *bf_spec = NULL;
+static int bf_spec_cnt = 0;
+static uint32_t bf_spec_hits = 0, bf_spec_misses = 0;
 static int max_backfill_job_cnt = 100;
 static int max_backfill_job_per_part = 0;
 static int max_backfill_job_per_user = 0;
@@ -140,9 +169,29 @@ static int yield_sleep   = YIELD_SLEEP;
 /*********************** local functions *********************/
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs);
+			     node_space_map_t *node_space);
 static int  _attempt_backfill(void);
+static time_t _bf_avail_nodes(struct job_record *job_ptr,
+			      struct part_record *part_ptr, int mcs_select,
+			      time_t start_res, uint32_t end_time,
+			      node_space_map_t *node_space,
+			      bitstr_t *avail_bitmap);
+static uint32_t _bf_job_no_reserve(struct job_record *job_ptr);
+static uint32_t _bf_job_time_limit(struct job_record *job_ptr,
+				   struct part_record *part_ptr);
+static bool _bf_node_counts(struct job_record *job_ptr,
+			    struct part_record *part_ptr, uint32_t *min_nodes,
+			    uint32_t *max_nodes, uint32_t *req_nodes);
+static void _bf_spec_clear(void);
+static int  _bf_spec_test(struct job_record *job_ptr, bitstr_t **avail_bitmap,
+			  uint32_t min_nodes, uint32_t max_nodes,
+			  uint32_t req_nodes, bitstr_t *exc_core_bitmap,
+			  uint32_t job_no_reserve, List job_queue,
+			  node_space_map_t *node_space, bool filter_root);
+static int  _bf_test_job(struct job_record *job_ptr, bitstr_t **avail_bitmap,
+			 uint32_t min_nodes, uint32_t max_nodes,
+			 uint32_t req_nodes, bitstr_t *exc_core_bitmap,
+			 uint32_t job_no_reserve);
 static void _clear_job_start_times(void);
 static int  _delta_tv(struct timeval *tv);
 static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2);
@@ -152,6 +201,7 @@ static void _load_config(void);
 static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static uint32_t _my_sleep(int usec);
+static uint64_t _nsec_now(void);
 static int  _num_feature_count(struct job_record *job_ptr, bool *has_xor);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space);
@@ -193,23 +243,22 @@ static void _dump_job_test(struct job_record *job_ptr, bitstr_t *avail_bitmap,
 }
 
 /* Log resource allocate table */
-static void _dump_node_space_table(node_space_map_t *node_space_ptr)
+static void _dump_node_space_table(node_space_map_t *node_space)
 {
-	int i = 0;
+	node_space_rec_t *rec;
 	char begin_buf[32], end_buf[32], *node_list;
 
 	info("=========================================");
-	while (1) {
-		slurm_make_time_str(&node_space_ptr[i].begin_time,
+	for (rec = node_space_first(node_space); rec;
+	     rec = node_space_next(rec)) {
+		slurm_make_time_str(&rec->begin_time,
 				    begin_buf, sizeof(begin_buf));
-		slurm_make_time_str(&node_space_ptr[i].end_time,
+		slurm_make_time_str(&rec->end_time,
 				    end_buf, sizeof(end_buf));
-		node_list = bitmap2node_name(node_space_ptr[i].avail_bitmap);
+		node_list = bitmap2node_name(rec->avail_bitmap);
 		info("Begin:%s End:%s Nodes:%s",
 		     begin_buf, end_buf, node_list);
 		xfree(node_list);
-		if ((i = node_space_ptr[i].next) == 0)
-			break;
 	}
 	info("=========================================");
 }
@@ -442,6 +491,387 @@ static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 	return rc;
 }
 
+/* Determine a job's minimum, maximum and requested node counts in the
+ * specified partition. RET false if the job can not run there */
+static bool _bf_node_counts(struct job_record *job_ptr,
+			    struct part_record *part_ptr, uint32_t *min_nodes,
+			    uint32_t *max_nodes, uint32_t *req_nodes)
+{
+	*min_nodes = MAX(job_ptr->details->min_nodes, part_ptr->min_nodes);
+	if (job_ptr->details->max_nodes == 0)
+		*max_nodes = part_ptr->max_nodes;
+	else
+		*max_nodes = MIN(job_ptr->details->max_nodes,
+				 part_ptr->max_nodes);
+	*max_nodes = MIN(*max_nodes, 500000);	/* prevent overflows */
+	if (job_ptr->details->max_nodes)
+		*req_nodes = *max_nodes;
+	else
+		*req_nodes = *min_nodes;
+	if (*min_nodes > *max_nodes)
+		return false;
+	return true;
+}
+
+/* Return a job's time limit in minutes, as constrained by its partition */
+static uint32_t _bf_job_time_limit(struct job_record *job_ptr,
+				   struct part_record *part_ptr)
+{
+	uint32_t part_time_limit;
+
+	if (part_ptr->max_time == INFINITE)
+		part_time_limit = YEAR_MINUTES;
+	else
+		part_time_limit = part_ptr->max_time;
+	if ((job_ptr->time_limit == NO_VAL) ||
+	    (job_ptr->time_limit == INFINITE))
+		return part_time_limit;
+	if (part_ptr->max_time == INFINITE)
+		return job_ptr->time_limit;
+	return MIN(job_ptr->time_limit, part_time_limit);
+}
+
+/* Return TEST_NOW_ONLY if no resources should be reserved for this job
+ * based upon its priority and age, otherwise zero */
+static uint32_t _bf_job_no_reserve(struct job_record *job_ptr)
+{
+	int pend_time;
+
+	if (bf_min_prio_reserve && (job_ptr->priority < bf_min_prio_reserve))
+		return TEST_NOW_ONLY;
+	if (bf_min_age_reserve && job_ptr->details->begin_time) {
+		pend_time = difftime(time(NULL), job_ptr->details->begin_time);
+		if (pend_time < bf_min_age_reserve)
+			return TEST_NOW_ONLY;
+	}
+	return 0;
+}
+
+/* Remove from avail_bitmap nodes which the job can not use between
+ * start_res and end_time, including nodes reserved for higher priority
+ * pending jobs in the node_space table.
+ * RET time at which some of those reserved nodes become free, or zero */
+static time_t _bf_avail_nodes(struct job_record *job_ptr,
+			      struct part_record *part_ptr, int mcs_select,
+			      time_t start_res, uint32_t end_time,
+			      node_space_map_t *node_space,
+			      bitstr_t *avail_bitmap)
+{
+	node_space_rec_t *rec;
+	time_t later_start = 0;
+	uint64_t start_nsec;
+
+	bit_and(avail_bitmap, part_ptr->node_bitmap);
+	bit_and(avail_bitmap, up_node_bitmap);
+	filter_by_node_owner(job_ptr, avail_bitmap);
+	filter_by_node_mcs(job_ptr, mcs_select, avail_bitmap);
+
+	start_nsec = _nsec_now();
+	for (rec = node_space_find(node_space, start_res); rec;
+	     rec = node_space_next(rec)) {
+		if ((rec->end_time > start_res) && node_space_next(rec) &&
+		    (later_start == 0))
+			later_start = rec->end_time;
+		if (rec->end_time <= start_res)
+			;
+		else if (rec->begin_time <= end_time)
+			bit_and(avail_bitmap, rec->avail_bitmap);
+		else
+			break;
+	}
+	slurmctld_diag_stats.bf_table_find_cnt++;
+	slurmctld_diag_stats.bf_table_find_time += _nsec_now() - start_nsec;
+
+	if (job_ptr->details->exc_node_bitmap) {
+		bit_not(job_ptr->details->exc_node_bitmap);
+		bit_and(avail_bitmap, job_ptr->details->exc_node_bitmap);
+		bit_not(job_ptr->details->exc_node_bitmap);
+	}
+
+	return later_start;
+}
+
+/* Test when and where a job could start, trying nodes with the job's
+ * required features currently active first.
+ * IN job_ptr - job to test
+ * IN/OUT avail_bitmap - nodes available/selected to use
+ * IN exc_core_bitmap - cores which can not be used
+ * IN job_no_reserve - 0 or TEST_NOW_ONLY
+ * RET SLURM_SUCCESS on success, otherwise an error code
+ */
+static int _bf_test_job(struct job_record *job_ptr, bitstr_t **avail_bitmap,
+			uint32_t min_nodes, uint32_t max_nodes,
+			uint32_t req_nodes, bitstr_t *exc_core_bitmap,
+			uint32_t job_no_reserve)
+{
+	bitstr_t *active_bitmap = NULL;
+	uint8_t save_share_res = 0, save_whole_node = 0;
+	int rc = SLURM_SUCCESS, test_fini = -1;
+
+	build_active_feature_bitmap(job_ptr, *avail_bitmap, &active_bitmap);
+	job_ptr->bit_flags |= BACKFILL_TEST;
+	job_ptr->bit_flags |= job_no_reserve;	/* 0 or TEST_NOW_ONLY */
+	if (active_bitmap) {
+		rc = _try_sched(job_ptr, &active_bitmap, min_nodes,
+				max_nodes, req_nodes, exc_core_bitmap);
+		if (rc != SLURM_SUCCESS) {
+			FREE_NULL_BITMAP(*avail_bitmap);
+			*avail_bitmap = active_bitmap;
+			active_bitmap = NULL;
+			test_fini = 1;
+		} else {
+			FREE_NULL_BITMAP(active_bitmap);
+			save_share_res  = job_ptr->details->share_res;
+			save_whole_node = job_ptr->details->whole_node;
+			job_ptr->details->share_res = 0;
+			job_ptr->details->whole_node = 1;
+			test_fini = 0;
+		}
+	}
+	if (test_fini != 1) {
+		rc = _try_sched(job_ptr, avail_bitmap, min_nodes,
+				max_nodes, req_nodes, exc_core_bitmap);
+		if (test_fini == 0) {
+			job_ptr->details->share_res = save_share_res;
+			job_ptr->details->whole_node = save_whole_node;
+		}
+	}
+	job_ptr->bit_flags &= ~BACKFILL_TEST;
+	job_ptr->bit_flags &= ~TEST_NOW_ONLY;
+
+	return rc;
+}
+
+/* Restore job fields changed to perform a speculative test */
+static void _bf_spec_restore(bf_spec_t *spec)
+{
+	struct job_record *job_ptr = spec->job_ptr;
+
+	job_ptr->part_ptr    = spec->save_part_ptr;
+	job_ptr->priority    = spec->save_priority;
+	job_ptr->time_limit  = spec->save_time_limit;
+	job_ptr->start_time  = spec->save_start_time;
+	job_ptr->total_cpus  = spec->save_total_cpus;
+	job_ptr->best_switch = spec->save_best_switch;
+}
+
+/* Discard all speculative test results */
+static void _bf_spec_clear(void)
+{
+	int i;
+
+	for (i = 0; i < bf_spec_cnt; i++) {
+		FREE_NULL_BITMAP(bf_spec[i].in_bitmap);
+		FREE_NULL_BITMAP(bf_spec[i].exc_core_bitmap);
+		FREE_NULL_BITMAP(bf_spec[i].out_bitmap);
+	}
+	bf_spec_cnt = 0;
+}
+
+/* Set up a speculative test of a queued job, replicating the work of the
+ * main backfill loop for a job which could start now. Jobs needing work
+ * with side effects (e.g. advanced reservations or deadlines) are skipped.
+ * Job fields are set as for the test, restore with _bf_spec_restore().
+ * RET true if the job should be tested */
+static bool _bf_spec_prepare(bf_spec_t *spec, job_queue_rec_t *job_queue_rec,
+			     node_space_map_t *node_space, bool filter_root)
+{
+	struct job_record *job_ptr = job_queue_rec->job_ptr;
+	struct part_record *part_ptr = job_queue_rec->part_ptr;
+	slurmdb_qos_rec_t *qos_ptr;
+	bitstr_t *avail_bitmap = NULL, *exc_core_bitmap = NULL;
+	time_t now = time(NULL), start_res = now;
+	uint32_t time_limit, end_time;
+	bool resv_overlap = false;
+
+	if ((job_ptr->magic  != JOB_MAGIC) ||
+	    (job_ptr->job_id != job_queue_rec->job_id) ||
+	    (job_ptr->array_task_id != job_queue_rec->array_task_id) ||
+	    !IS_JOB_PENDING(job_ptr) || (job_ptr->priority == 0) ||
+	    (job_queue_rec->priority == 0) ||
+	    job_ptr->preempt_in_progress || job_ptr->resv_name ||
+	    !job_ptr->details ||
+	    (job_ptr->deadline && (job_ptr->deadline != NO_VAL)) ||
+	    (job_ptr->state_reason == FAIL_ACCOUNT))
+		return false;
+	if (((part_ptr->state_up & PARTITION_SCHED) == 0) ||
+	    (part_ptr->node_bitmap == NULL) ||
+	    ((part_ptr->flags & PART_FLAG_ROOT_ONLY) && filter_root) ||
+	    !_job_part_valid(job_ptr, part_ptr))
+		return false;
+	if (!_bf_node_counts(job_ptr, part_ptr, &spec->min_nodes,
+			     &spec->max_nodes, &spec->req_nodes))
+		return false;
+
+	spec->job_ptr          = job_ptr;
+	spec->job_id           = job_ptr->job_id;
+	spec->save_part_ptr    = job_ptr->part_ptr;
+	spec->save_priority    = job_ptr->priority;
+	spec->save_time_limit  = job_ptr->time_limit;
+	spec->save_start_time  = job_ptr->start_time;
+	spec->save_total_cpus  = job_ptr->total_cpus;
+	spec->save_best_switch = job_ptr->best_switch;
+
+	job_ptr->part_ptr = spec->part_ptr = part_ptr;
+	job_ptr->priority = spec->priority = job_queue_rec->priority;
+	time_limit = _bf_job_time_limit(job_ptr, part_ptr);
+	qos_ptr = job_ptr->qos_ptr;
+	if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE) &&
+	    slurm_get_preempt_mode())
+		time_limit = job_ptr->time_limit = 1;
+	else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
+		time_limit = job_ptr->time_limit = job_ptr->time_min;
+	spec->time_limit = job_ptr->time_limit;
+	spec->job_no_reserve = _bf_job_no_reserve(job_ptr);
+
+	if ((job_test_resv(job_ptr, &start_res, true, &avail_bitmap,
+			   &exc_core_bitmap, &resv_overlap) != SLURM_SUCCESS) ||
+	    (start_res > now))
+		goto fail;
+	end_time = (time_limit * 60) + now;
+	if (end_time < now)	/* Overflow 32-bits */
+		end_time = INFINITE;
+	(void) _bf_avail_nodes(job_ptr, part_ptr,
+			       slurm_mcs_get_select(job_ptr), start_res,
+			       end_time, node_space, avail_bitmap);
+	if ((bit_set_count(avail_bitmap) < spec->min_nodes) ||
+	    ((job_ptr->details->req_node_bitmap) &&
+	     (!bit_super_set(job_ptr->details->req_node_bitmap,
+			     avail_bitmap))) ||
+	    (job_req_node_filter(job_ptr, avail_bitmap, true)))
+		goto fail;
+
+	spec->in_bitmap = avail_bitmap;
+	spec->exc_core_bitmap = exc_core_bitmap;
+	return true;
+
+fail:	FREE_NULL_BITMAP(avail_bitmap);
+	FREE_NULL_BITMAP(exc_core_bitmap);
+	_bf_spec_restore(spec);
+	return false;
+}
+
+/* Worker thread performing one speculative test */
+static void *_bf_spec_agent(void *arg)
+{
+	bf_spec_t *spec = (bf_spec_t *) arg;
+	struct job_record *job_ptr = spec->job_ptr;
+
+	spec->out_bitmap = bit_copy(spec->in_bitmap);
+	spec->rc = _bf_test_job(job_ptr, &spec->out_bitmap, spec->min_nodes,
+				spec->max_nodes, spec->req_nodes,
+				spec->exc_core_bitmap, spec->job_no_reserve);
+	spec->start_time  = job_ptr->start_time;
+	spec->total_cpus  = job_ptr->total_cpus;
+	spec->best_switch = job_ptr->best_switch;
+
+	return NULL;
+}
+
+/* Test if a speculative result applies to a job about to be tested */
+static bool _bf_spec_valid(bf_spec_t *spec, struct job_record *job_ptr,
+			   bitstr_t *avail_bitmap, uint32_t min_nodes,
+			   uint32_t max_nodes, uint32_t req_nodes,
+			   bitstr_t *exc_core_bitmap, uint32_t job_no_reserve)
+{
+	if ((spec->job_id     != job_ptr->job_id)     ||
+	    (spec->part_ptr   != job_ptr->part_ptr)   ||
+	    (spec->priority   != job_ptr->priority)   ||
+	    (spec->time_limit != job_ptr->time_limit) ||
+	    (spec->min_nodes  != min_nodes) ||
+	    (spec->max_nodes  != max_nodes) ||
+	    (spec->req_nodes  != req_nodes) ||
+	    (spec->job_no_reserve != job_no_reserve) ||
+	    !bit_equal(spec->in_bitmap, avail_bitmap))
+		return false;
+	if (!spec->exc_core_bitmap || !exc_core_bitmap)
+		return (spec->exc_core_bitmap == exc_core_bitmap);
+	return bit_equal(spec->exc_core_bitmap, exc_core_bitmap);
+}
+
+/* Equivalent to _bf_test_job(), but with bf_threads configured use a result
+ * from an earlier speculative test if still valid. Otherwise test the job
+ * while worker threads test the next jobs in the queue which could start
+ * now, each against the current node_space table. Results are used in
+ * priority order as the main loop reaches each job, so the schedule is the
+ * same as when testing jobs one at a time. */
+static int _bf_spec_test(struct job_record *job_ptr, bitstr_t **avail_bitmap,
+			 uint32_t min_nodes, uint32_t max_nodes,
+			 uint32_t req_nodes, bitstr_t *exc_core_bitmap,
+			 uint32_t job_no_reserve, List job_queue,
+			 node_space_map_t *node_space, bool filter_root)
+{
+	pthread_t thread_id[BF_MAX_THREADS];
+	pthread_attr_t attr;
+	job_queue_rec_t *job_queue_rec;
+	ListIterator iter;
+	bf_spec_t *spec;
+	int i, k, max_scan, rc;
+
+	for (i = 0; i < bf_spec_cnt; i++) {
+		spec = &bf_spec[i];
+		if (spec->job_ptr != job_ptr)
+			continue;
+		if (!_bf_spec_valid(spec, job_ptr, *avail_bitmap, min_nodes,
+				    max_nodes, req_nodes, exc_core_bitmap,
+				    job_no_reserve))
+			break;
+		bf_spec_hits++;
+		FREE_NULL_BITMAP(*avail_bitmap);
+		*avail_bitmap = spec->out_bitmap;
+		spec->out_bitmap = NULL;
+		job_ptr->start_time  = spec->start_time;
+		job_ptr->total_cpus  = spec->total_cpus;
+		job_ptr->best_switch = spec->best_switch;
+		spec->job_ptr = NULL;	/* Each result is used once */
+		return spec->rc;
+	}
+	bf_spec_misses++;
+	_bf_spec_clear();
+
+	if (!bf_spec)
+		bf_spec = xmalloc(sizeof(bf_spec_t) * BF_MAX_THREADS);
+	max_scan = bf_threads * 4;
+	iter = list_iterator_create(job_queue);
+	while ((bf_spec_cnt < (bf_threads - 1)) && (max_scan-- > 0) &&
+	       (job_queue_rec = (job_queue_rec_t *) list_next(iter))) {
+		if (job_queue_rec->job_ptr == job_ptr)
+			continue;
+		for (k = 0; k < bf_spec_cnt; k++) {
+			if (bf_spec[k].job_ptr == job_queue_rec->job_ptr)
+				break;
+		}
+		if (k < bf_spec_cnt)
+			continue;	/* Same job in another partition */
+		spec = &bf_spec[bf_spec_cnt];
+		memset(spec, 0, sizeof(bf_spec_t));
+		if (_bf_spec_prepare(spec, job_queue_rec, node_space,
+				     filter_root))
+			bf_spec_cnt++;
+	}
+	list_iterator_destroy(iter);
+
+	for (i = 0; i < bf_spec_cnt; i++) {
+		slurm_attr_init(&attr);
+		if (pthread_create(&thread_id[i], &attr, _bf_spec_agent,
+				   &bf_spec[i])) {
+			error("backfill: pthread_create error %m");
+			thread_id[i] = 0;
+			_bf_spec_agent(&bf_spec[i]);
+		}
+		slurm_attr_destroy(&attr);
+	}
+	rc = _bf_test_job(job_ptr, avail_bitmap, min_nodes, max_nodes,
+			  req_nodes, exc_core_bitmap, job_no_reserve);
+	for (i = 0; i < bf_spec_cnt; i++) {
+		if (thread_id[i])
+			pthread_join(thread_id[i], NULL);
+		_bf_spec_restore(&bf_spec[i]);
+	}
+
+	return rc;
+}
+
 /* Terminate backfill_agent */
 extern void stop_backfill_agent(void)
 {
@@ -465,6 +895,15 @@ static int _delta_tv(struct timeval *tv)
 	return delta_t;
 }
 
+/* Return a monotonic time in nano-seconds, for timing operations */
+static uint64_t _nsec_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
 /* Sleep for at least specified time, returns actual sleep time in usec */
 static uint32_t _my_sleep(int usec)
 {
@@ -637,6 +1076,17 @@ static void _load_config(void)
 		backfill_continue = false;
 	}
 
+	if (sched_params && (tmp_ptr = strstr(sched_params, "bf_threads="))) {
+		bf_threads = atoi(tmp_ptr + 11);
+		if ((bf_threads < 1) || (bf_threads > BF_MAX_THREADS)) {
+			error("Invalid SchedulerParameters bf_threads: %d",
+			      bf_threads);
+			bf_threads = 1;
+		}
+	} else {
+		bf_threads = 1;
+	}
+
 	if (sched_params &&
 	    (tmp_ptr = strstr(sched_params, "bf_yield_interval="))) {
 		sched_timeout = atoi(tmp_ptr + 18);
@@ -705,6 +1155,8 @@ static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2)
 	slurmctld_diag_stats.bf_depth_sum += slurmctld_diag_stats.bf_last_depth;
 	slurmctld_diag_stats.bf_depth_try_sum +=
 		slurmctld_diag_stats.bf_last_depth_try;
+	slurmctld_diag_stats.bf_table_size_sum +=
+		slurmctld_diag_stats.bf_table_size;
 	if (slurmctld_diag_stats.bf_cycle_last >
 	    slurmctld_diag_stats.bf_cycle_max) {
 		slurmctld_diag_stats.bf_cycle_max = slurmctld_diag_stats.
@@ -795,6 +1247,7 @@ static int _yield_locks(int usec)
 	bool load_config = false;
 	int max_rpc_cnt;
 
+	_bf_spec_clear();	/* State may change while locks released */
 	max_rpc_cnt = MAX((defer_rpc_cnt / 10), 20);
 	job_update  = last_job_update;
 	node_update = last_node_update;
@@ -857,20 +1310,20 @@ static int _attempt_backfill(void)
 	List job_queue;
 	job_queue_rec_t *job_queue_rec;
 	slurmdb_qos_rec_t *qos_ptr = NULL;
-	int bb, i, j, node_space_recs, mcs_select = 0;
+	int bb, i, j, mcs_select = 0;
 	struct job_record *job_ptr;
 	struct part_record *part_ptr, **bf_part_ptr = NULL;
 	uint32_t end_time, end_reserve, deadline_time_limit;
-	uint32_t time_limit, comp_time_limit, orig_time_limit, part_time_limit;
+	uint32_t time_limit, comp_time_limit, orig_time_limit;
 	uint32_t min_nodes, max_nodes, req_nodes;
-	bitstr_t *active_bitmap = NULL, *avail_bitmap = NULL;
+	bitstr_t *avail_bitmap = NULL;
 	bitstr_t *exc_core_bitmap = NULL, *resv_bitmap = NULL;
 	time_t now, sched_start, later_start, start_res, resv_end, window_end;
 	time_t orig_sched_start, orig_start_time = (time_t) 0;
 	node_space_map_t *node_space;
 	struct timeval bf_time1, bf_time2;
 	int rc = 0;
-	int job_test_count = 0, test_time_count = 0, pend_time;
+	int job_test_count = 0, test_time_count = 0;
 	uint32_t *uid = NULL, nuser = 0, bf_parts = 0, *bf_part_jobs = NULL;
 	uint16_t *njobs = NULL;
 	bool already_counted;
@@ -884,10 +1337,9 @@ static int _attempt_backfill(void)
 	uint32_t test_array_count = 0;
 	uint32_t acct_max_nodes, wait_reason = 0, job_no_reserve;
 	bool resv_overlap = false;
-	uint8_t save_share_res, save_whole_node;
-	int test_fini;
 
 	bf_sleep_usec = 0;
+	bf_spec_hits = bf_spec_misses = 0;
 #ifdef HAVE_ALPS_CRAY
 	/*
 	 * Run a Basil Inventory immediately before setting up the schedule
@@ -947,14 +1399,9 @@ static int _attempt_backfill(void)
 	slurmctld_diag_stats.bf_when_last_cycle = now;
 	slurmctld_diag_stats.bf_active = 1;
 
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt * 2 + 1));
-	node_space[0].begin_time = sched_start;
 	window_end = sched_start + backfill_window;
-	node_space[0].end_time = window_end;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
-	node_space_recs = 1;
+	node_space = node_space_create(sched_start, window_end,
+				       avail_node_bitmap);
 	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 		_dump_node_space_table(node_space);
 
@@ -1063,7 +1510,7 @@ static int _attempt_backfill(void)
 				job_ptr->state_reason = WAIT_NO_REASON;
 				xfree(job_ptr->state_desc);
 				job_ptr->assoc_id = assoc_rec.id;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 			} else {
 				debug("backfill: JobId=%u has invalid association",
 				      job_ptr->job_id);
@@ -1086,12 +1533,12 @@ static int _attempt_backfill(void)
 				      job_ptr->job_id);
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = FAIL_QOS;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				continue;
 			} else if (job_ptr->state_reason == FAIL_QOS) {
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = WAIT_NO_REASON;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 			}
 		}
 
@@ -1100,7 +1547,7 @@ static int _attempt_backfill(void)
 		    SLURM_SUCCESS) {
 			xfree(job_ptr->state_desc);
 			job_ptr->state_reason = WAIT_QOS;
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			continue;
 		}
 
@@ -1108,16 +1555,7 @@ static int _attempt_backfill(void)
 		    !acct_policy_job_runnable_pre_select(job_ptr))
 			continue;
 
-		job_no_reserve = 0;
-		if (bf_min_prio_reserve &&
-		    (job_ptr->priority < bf_min_prio_reserve)) {
-			job_no_reserve = TEST_NOW_ONLY;
-		} else if (bf_min_age_reserve && job_ptr->details->begin_time) {
-			pend_time = difftime(time(NULL),
-					     job_ptr->details->begin_time);
-			if (pend_time < bf_min_age_reserve)
-				job_no_reserve = TEST_NOW_ONLY;
-		}
+		job_no_reserve = _bf_job_no_reserve(job_ptr);
 
 		orig_start_time = job_ptr->start_time;
 		orig_time_limit = job_ptr->time_limit;
@@ -1240,19 +1678,8 @@ next_task:
 		}
 
 		/* Determine minimum and maximum node counts */
-		min_nodes = MAX(job_ptr->details->min_nodes,
-				part_ptr->min_nodes);
-		if (job_ptr->details->max_nodes == 0)
-			max_nodes = part_ptr->max_nodes;
-		else
-			max_nodes = MIN(job_ptr->details->max_nodes,
-					part_ptr->max_nodes);
-		max_nodes = MIN(max_nodes, 500000);     /* prevent overflows */
-		if (job_ptr->details->max_nodes)
-			req_nodes = max_nodes;
-		else
-			req_nodes = min_nodes;
-		if (min_nodes > max_nodes) {
+		if (!_bf_node_counts(job_ptr, part_ptr, &min_nodes,
+				     &max_nodes, &req_nodes)) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL)
 				info("backfill: job %u node count too high",
 				     job_ptr->job_id);
@@ -1279,21 +1706,10 @@ next_task:
 		}
 
 		/* Determine job's expected completion time */
-		if (part_ptr->max_time == INFINITE)
-			part_time_limit = YEAR_MINUTES;
-		else
-			part_time_limit = part_ptr->max_time;
+		time_limit = _bf_job_time_limit(job_ptr, part_ptr);
 		if ((job_ptr->time_limit == NO_VAL) ||
-		    (job_ptr->time_limit == INFINITE)) {
-			time_limit = part_time_limit;
+		    (job_ptr->time_limit == INFINITE))
 			job_ptr->limit_set.time = 1;
-		} else {
-			if (part_ptr->max_time == INFINITE)
-				time_limit = job_ptr->time_limit;
-			else
-				time_limit = MIN(job_ptr->time_limit,
-						 part_time_limit);
-		}
 		if (deadline_time_limit)
 			comp_time_limit = MIN(time_limit, deadline_time_limit);
 		else
@@ -1390,36 +1806,14 @@ next_task:
 			end_time = INFINITE;
 		resv_end = find_resv_end(start_res);
 		/* Identify usable nodes for this job */
-		bit_and(avail_bitmap, part_ptr->node_bitmap);
-		bit_and(avail_bitmap, up_node_bitmap);
-		filter_by_node_owner(job_ptr, avail_bitmap);
-		filter_by_node_mcs(job_ptr, mcs_select, avail_bitmap);
-		for (j=0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
-				break;
-		}
+		later_start = _bf_avail_nodes(job_ptr, part_ptr, mcs_select,
+					      start_res, end_time, node_space,
+					      avail_bitmap);
 		if (resv_end && (++resv_end < window_end) &&
 		    ((later_start == 0) || (resv_end < later_start))) {
 			later_start = resv_end;
 		}
 
-		if (job_ptr->details->exc_node_bitmap) {
-			bit_not(job_ptr->details->exc_node_bitmap);
-			bit_and(avail_bitmap,
-				job_ptr->details->exc_node_bitmap);
-			bit_not(job_ptr->details->exc_node_bitmap);
-		}
-
 		/* Test if insufficient nodes remain OR
 		 *	required nodes missing OR
 		 *	nodes lack features OR
@@ -1461,38 +1855,16 @@ next_task:
 		}
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_job_test(job_ptr, avail_bitmap, start_res);
-		test_fini = -1;
-		build_active_feature_bitmap(job_ptr, avail_bitmap,
-					    &active_bitmap);
-		job_ptr->bit_flags |= BACKFILL_TEST;
-		job_ptr->bit_flags |= job_no_reserve;	/* 0 or TEST_NOW_ONLY */
-		if (active_bitmap) {
-			j = _try_sched(job_ptr, &active_bitmap, min_nodes,
-				       max_nodes, req_nodes, exc_core_bitmap);
-			if (j != SLURM_SUCCESS) {
-				FREE_NULL_BITMAP(avail_bitmap);
-				avail_bitmap = active_bitmap;
-				active_bitmap = NULL;
-				test_fini = 1;
-			} else {
-				FREE_NULL_BITMAP(active_bitmap);
-				save_share_res  = job_ptr->details->share_res;
-				save_whole_node = job_ptr->details->whole_node;
-				job_ptr->details->share_res = 0;
-				job_ptr->details->whole_node = 1;
-				test_fini = 0;
-			}
-		}
-		if (test_fini != 1) {
-			j = _try_sched(job_ptr, &avail_bitmap, min_nodes,
-				       max_nodes, req_nodes, exc_core_bitmap);
-			if (test_fini == 0) {
-				job_ptr->details->share_res = save_share_res;
-				job_ptr->details->whole_node = save_whole_node;
-			}
+		if (bf_threads > 1) {
+			j = _bf_spec_test(job_ptr, &avail_bitmap, min_nodes,
+					  max_nodes, req_nodes,
+					  exc_core_bitmap, job_no_reserve,
+					  job_queue, node_space, filter_root);
+		} else {
+			j = _bf_test_job(job_ptr, &avail_bitmap, min_nodes,
+					 max_nodes, req_nodes,
+					 exc_core_bitmap, job_no_reserve);
 		}
-		job_ptr->bit_flags &= ~BACKFILL_TEST;
-		job_ptr->bit_flags &= ~TEST_NOW_ONLY;
 
 		now = time(NULL);
 		if (j != SLURM_SUCCESS) {
@@ -1506,7 +1878,7 @@ next_task:
 
 		if (start_res > job_ptr->start_time) {
 			job_ptr->start_time = start_res;
-			last_job_update = now;
+			job_modified(job_ptr, now);
 		}
 		if ((job_ptr->start_time <= now) &&
 		    (bit_overlap(avail_bitmap, cg_node_bitmap) > 0)) {
@@ -1535,7 +1907,7 @@ next_task:
 			       job_state_string(job_ptr->job_state),
 			       job_reason_string(job_ptr->state_reason),
 			       job_ptr->priority);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			_set_job_time_limit(job_ptr, orig_time_limit);
 			later_start = 0;
 			if (bb == -1)
@@ -1678,7 +2050,8 @@ next_task:
 			continue;
 		}
 
-		if (node_space_recs >= max_backfill_job_cnt) {
+		/* Counts current records, merged ones are not included */
+		if (node_space_count(node_space) >= max_backfill_job_cnt) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
 				info("backfill: table size limit of %u reached",
 				     max_backfill_job_cnt);
@@ -1725,7 +2098,7 @@ next_task:
 		job_ptr->sched_nodes = bitmap2node_name(avail_bitmap);
 		bit_not(avail_bitmap);
 		_add_reservation(start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
+				 avail_bitmap, node_space);
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_node_space_table(node_space);
 		if ((orig_start_time != 0) &&
@@ -1754,13 +2127,10 @@ next_task:
 	FREE_NULL_BITMAP(exc_core_bitmap);
 	FREE_NULL_BITMAP(resv_bitmap);
 
-	for (i=0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
+	slurmctld_diag_stats.bf_table_size = node_space_count(node_space);
+	node_space_destroy(node_space);
 	FREE_NULL_LIST(job_queue);
+	_bf_spec_clear();
 	gettimeofday(&bf_time2, NULL);
 	_do_diag_stats(&bf_time1, &bf_time2);
 	if (debug_flags & DEBUG_FLAG_BACKFILL) {
@@ -1768,6 +2138,12 @@ next_task:
 		info("backfill: completed testing %u(%d) jobs, %s",
 		     slurmctld_diag_stats.bf_last_depth,
 		     job_test_count, TIME_STR);
+		if (bf_threads > 1) {
+			info("backfill: %u of %u job tests used results "
+			     "from %d threads",
+			     bf_spec_hits, bf_spec_hits + bf_spec_misses,
+			     bf_threads);
+		}
 	}
 	if (slurmctld_config.server_thread_count >= 150) {
 		info("backfill: %d pending RPCs at cycle end, consider "
@@ -1785,6 +2161,7 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
 	bool is_job_array_head = false;
 	static uint32_t fail_jobid = 0;
 
+	_bf_spec_clear();	/* Select plugin state changes */
 	if (job_ptr->details->exc_node_bitmap) {
 		orig_exc_nodes = bit_copy(job_ptr->details->exc_node_bitmap);
 		bit_or(job_ptr->details->exc_node_bitmap, resv_bitmap);
@@ -1812,7 +2189,7 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
 		FREE_NULL_BITMAP(orig_exc_nodes);
 	if (rc == SLURM_SUCCESS) {
 		/* job initiated */
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 		if (job_ptr->array_task_id == NO_VAL) {
 			info("backfill: Started JobId=%u in %s on %s",
 			     job_ptr->job_id, job_ptr->part_ptr->name,
@@ -1862,23 +2239,23 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space)
 {
-	int32_t j, resv_delay;
+	node_space_rec_t *rec;
+	int32_t resv_delay;
 	uint32_t orig_time_limit = job_ptr->time_limit;
 	uint32_t new_time_limit;
 
-	for (j=0; ; ) {
-		if ((node_space[j].begin_time != now) &&
-		    (node_space[j].begin_time < job_ptr->end_time) &&
+	for (rec = node_space_first(node_space);
+	     rec && (rec->begin_time < job_ptr->end_time);
+	     rec = node_space_next(rec)) {
+		if ((rec->begin_time != now) &&
 		    (!bit_super_set(job_ptr->node_bitmap,
-				    node_space[j].avail_bitmap))) {
+				    rec->avail_bitmap))) {
 			/* Job overlaps pending job's resource reservation */
-			resv_delay = difftime(node_space[j].begin_time, now);
+			resv_delay = difftime(rec->begin_time, now);
 			resv_delay /= 60;	/* seconds to minutes */
 			if (resv_delay < job_ptr->time_limit)
 				job_ptr->time_limit = resv_delay;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
 	new_time_limit = MAX(job_ptr->time_min, job_ptr->time_limit);
 	acct_policy_alter_job(job_ptr, new_time_limit);
@@ -1911,93 +2288,13 @@ static bool _more_work (time_t last_backfill_time)
 /* Create a reservation for a job in the future */
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs)
+			     node_space_map_t *node_space)
 {
-	bool placed = false;
-	int i, j;
-
-#if 0	
-	info("add job start:%u end:%u", start_time, end_reserve);
-	for (j = 0; ; ) {
-		info("node start:%u end:%u",
-		     (uint32_t) node_space[j].begin_time,
-		     (uint32_t) node_space[j].end_time);
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-#endif
-
-	start_time = MAX(start_time, node_space[0].begin_time);
-	for (j = 0; ; ) {
-		if (node_space[j].end_time > start_time) {
-			/* insert start entry record */
-			i = *node_space_recs;
-			node_space[i].begin_time = start_time;
-			node_space[i].end_time = node_space[j].end_time;
-			node_space[j].end_time = start_time;
-			node_space[i].avail_bitmap =
-				bit_copy(node_space[j].avail_bitmap);
-			node_space[i].next = node_space[j].next;
-			node_space[j].next = i;
-			(*node_space_recs)++;
-			placed = true;
-		}
-		if (node_space[j].end_time == start_time) {
-			/* no need to insert new start entry record */
-			placed = true;
-		}
-		if (placed == true) {
-			while ((j = node_space[j].next)) {
-				if (end_reserve < node_space[j].end_time) {
-					/* insert end entry record */
-					i = *node_space_recs;
-					node_space[i].begin_time = end_reserve;
-					node_space[i].end_time = node_space[j].
-								 end_time;
-					node_space[j].end_time = end_reserve;
-					node_space[i].avail_bitmap =
-						bit_copy(node_space[j].
-							 avail_bitmap);
-					node_space[i].next = node_space[j].next;
-					node_space[j].next = i;
-					(*node_space_recs)++;
-					break;
-				}
-				if (end_reserve == node_space[j].end_time) {
-					break;
-				}
-			}
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
+	uint64_t start_nsec = _nsec_now();
 
-	for (j = 0; ; ) {
-		if ((node_space[j].begin_time >= start_time) &&
-		    (node_space[j].end_time <= end_reserve))
-			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
-			break;
-	}
-
-	/* Drop records with identical bitmaps (up to one record).
-	 * This can significantly improve performance of the backfill tests. */
-	for (i = 0; ; ) {
-		if ((j = node_space[i].next) == 0)
-			break;
-		if (!bit_equal(node_space[i].avail_bitmap,
-			       node_space[j].avail_bitmap)) {
-			i = j;
-			continue;
-		}
-		node_space[i].end_time = node_space[j].end_time;
-		node_space[i].next = node_space[j].next;
-		FREE_NULL_BITMAP(node_space[j].avail_bitmap);
-		break;
-	}
+	node_space_reserve(node_space, start_time, end_reserve, res_bitmap);
+	slurmctld_diag_stats.bf_table_add_cnt++;
+	slurmctld_diag_stats.bf_table_add_time += _nsec_now() - start_nsec;
 }
 
 /*
@@ -2012,18 +2309,20 @@ static bool _test_resv_overlap(node_space_map_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
 			       uint32_t end_reserve)
 {
+	node_space_rec_t *rec;
 	bool overlap = false;
-	int j;
+	uint64_t start_nsec = _nsec_now();
 
-	for (j=0; ; ) {
-		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
-		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
+	for (rec = node_space_find(node_space, start_time);
+	     rec && (rec->begin_time < end_reserve);
+	     rec = node_space_next(rec)) {
+		if ((rec->end_time > start_time) &&
+		    (!bit_super_set(use_bitmap, rec->avail_bitmap))) {
 			overlap = true;
 			break;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
+	slurmctld_diag_stats.bf_table_find_cnt++;
+	slurmctld_diag_stats.bf_table_find_time += _nsec_now() - start_nsec;
 	return overlap;
 }
@@ -0,0 +1,304 @@
+/*****************************************************************************\
+ *  node_space.c - time-indexed map of nodes available to backfill
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <stdbool.h>
+
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+
+#include "node_space.h"
+
+#define NODE_SPACE_MAX_LEVEL	16
+
+struct node_space_bitmap {
+	bitstr_t *bitmap;
+	int ref_cnt;
+};
+
+struct node_space_map {
+	node_space_rec_t head;	/* sentinel, head.next[] starts each level */
+	int level;		/* highest level in use */
+	int rec_cnt;
+	uint32_t seed;		/* for random record levels */
+};
+
+static node_space_bitmap_t *_bitmap_alloc(bitstr_t *bitmap)
+{
+	node_space_bitmap_t *shared = xmalloc(sizeof(node_space_bitmap_t));
+
+	shared->bitmap = bitmap;
+	shared->ref_cnt = 1;
+	return shared;
+}
+
+static void _bitmap_release(node_space_bitmap_t *shared)
+{
+	if (--shared->ref_cnt > 0)
+		return;
+	FREE_NULL_BITMAP(shared->bitmap);
+	xfree(shared);
+}
+
+static void _set_bitmap(node_space_rec_t *rec, node_space_bitmap_t *shared)
+{
+	rec->shared = shared;
+	rec->avail_bitmap = shared->bitmap;
+}
+
+/* Pick a level for a new record, each level holding 1/4 of the records
+ * of the level below */
+static int _random_level(node_space_map_t *node_space)
+{
+	uint32_t r;
+	int level = 1;
+
+	/* xorshift32 */
+	r = node_space->seed;
+	r ^= r << 13;
+	r ^= r >> 17;
+	r ^= r << 5;
+	node_space->seed = r;
+
+	while (((r & 3) == 0) && (level < NODE_SPACE_MAX_LEVEL)) {
+		level++;
+		r >>= 2;
+	}
+	return level;
+}
+
+/* Find the last record with a begin_time before "when" (or at "when" if
+ * inclusive is set), recording the last record visited at each level in
+ * update[]. RET the record found or &node_space->head */
+static node_space_rec_t *_search(node_space_map_t *node_space, time_t when,
+				 bool inclusive, node_space_rec_t **update)
+{
+	node_space_rec_t *rec = &node_space->head, *next;
+	int i;
+
+	for (i = node_space->level - 1; i >= 0; i--) {
+		while ((next = rec->next[i]) &&
+		       ((next->begin_time < when) ||
+			(inclusive && (next->begin_time == when))))
+			rec = next;
+		if (update)
+			update[i] = rec;
+	}
+	return rec;
+}
+
+static node_space_rec_t *_rec_alloc(node_space_map_t *node_space)
+{
+	node_space_rec_t *rec = xmalloc(sizeof(node_space_rec_t));
+
+	rec->level = _random_level(node_space);
+	rec->next = xmalloc(sizeof(node_space_rec_t *) * rec->level);
+	return rec;
+}
+
+static void _rec_free(node_space_rec_t *rec)
+{
+	_bitmap_release(rec->shared);
+	xfree(rec->next);
+	xfree(rec);
+}
+
+/* Split the record covering "when" so that a record begins at that time.
+ * Both records share the original bitmap. */
+static void _split(node_space_map_t *node_space, time_t when)
+{
+	node_space_rec_t *update[NODE_SPACE_MAX_LEVEL];
+	node_space_rec_t *rec, *new_rec;
+	int i;
+
+	rec = _search(node_space, when, true, update);
+	if ((rec == &node_space->head) || (rec->begin_time == when) ||
+	    (rec->end_time <= when))
+		return;		/* Already split or outside of map */
+
+	new_rec = _rec_alloc(node_space);
+	new_rec->begin_time = when;
+	new_rec->end_time = rec->end_time;
+	rec->end_time = when;
+	rec->shared->ref_cnt++;
+	_set_bitmap(new_rec, rec->shared);
+
+	for (i = node_space->level; i < new_rec->level; i++)
+		update[i] = &node_space->head;
+	if (new_rec->level > node_space->level)
+		node_space->level = new_rec->level;
+	for (i = 0; i < new_rec->level; i++) {
+		new_rec->next[i] = update[i]->next[i];
+		update[i]->next[i] = new_rec;
+	}
+	node_space->rec_cnt++;
+}
+
+/* Merge a record into the previous one, which has the same bitmap */
+static void _merge(node_space_map_t *node_space, node_space_rec_t *prev,
+		   node_space_rec_t *rec)
+{
+	node_space_rec_t *update[NODE_SPACE_MAX_LEVEL];
+	int i;
+
+	(void) _search(node_space, rec->begin_time, false, update);
+	for (i = 0; i < rec->level; i++)
+		update[i]->next[i] = rec->next[i];
+	while ((node_space->level > 1) &&
+	       !node_space->head.next[node_space->level - 1])
+		node_space->level--;
+
+	prev->end_time = rec->end_time;
+	_rec_free(rec);
+	node_space->rec_cnt--;
+}
+
+extern node_space_map_t *node_space_create(time_t begin_time, time_t end_time,
+					   bitstr_t *avail_bitmap)
+{
+	node_space_map_t *node_space = xmalloc(sizeof(node_space_map_t));
+	node_space_rec_t *rec;
+	int i;
+
+	node_space->head.level = NODE_SPACE_MAX_LEVEL;
+	node_space->head.next = xmalloc(sizeof(node_space_rec_t *) *
+					NODE_SPACE_MAX_LEVEL);
+	node_space->seed = 2463534242U;
+
+	rec = _rec_alloc(node_space);
+	rec->begin_time = begin_time;
+	rec->end_time = end_time;
+	_set_bitmap(rec, _bitmap_alloc(bit_copy(avail_bitmap)));
+	node_space->level = rec->level;
+	for (i = 0; i < rec->level; i++)
+		node_space->head.next[i] = rec;
+	node_space->rec_cnt = 1;
+
+	return node_space;
+}
+
+extern void node_space_destroy(node_space_map_t *node_space)
+{
+	node_space_rec_t *rec, *next;
+
+	if (!node_space)
+		return;
+	for (rec = node_space->head.next[0]; rec; rec = next) {
+		next = rec->next[0];
+		_rec_free(rec);
+	}
+	xfree(node_space->head.next);
+	xfree(node_space);
+}
+
+extern int node_space_count(node_space_map_t *node_space)
+{
+	return node_space->rec_cnt;
+}
+
+extern node_space_rec_t *node_space_first(node_space_map_t *node_space)
+{
+	return node_space->head.next[0];
+}
+
+extern node_space_rec_t *node_space_next(node_space_rec_t *rec)
+{
+	return rec->next[0];
+}
+
+extern node_space_rec_t *node_space_find(node_space_map_t *node_space,
+					 time_t when)
+{
+	node_space_rec_t *rec = _search(node_space, when, true, NULL);
+
+	if (rec == &node_space->head)
+		return node_space->head.next[0];
+	return rec;
+}
+
+extern void node_space_reserve(node_space_map_t *node_space,
+			       time_t start_time, time_t end_time,
+			       bitstr_t *res_bitmap)
+{
+	node_space_bitmap_t *old_bitmap, *prev_old = NULL, *prev_new = NULL;
+	node_space_rec_t *rec, *prev, *next;
+
+	rec = node_space_first(node_space);
+	start_time = MAX(start_time, rec->begin_time);
+	if (end_time <= start_time)
+		return;
+	_split(node_space, start_time);
+	_split(node_space, end_time);
+
+	/* Remove reserved nodes from each record within the reservation.
+	 * Records sharing a bitmap continue to share the result. */
+	prev = _search(node_space, start_time, false, NULL);
+	for (rec = node_space_find(node_space, start_time);
+	     rec && (rec->begin_time < end_time); rec = rec->next[0]) {
+		if (rec->end_time <= start_time)
+			continue;	/* Reservation follows map */
+		old_bitmap = rec->shared;
+		if (old_bitmap == prev_old) {
+			prev_new->ref_cnt++;
+			_set_bitmap(rec, prev_new);
+			_bitmap_release(old_bitmap);
+			continue;
+		}
+		prev_old = old_bitmap;
+		if (bit_super_set(old_bitmap->bitmap, res_bitmap)) {
+			prev_new = old_bitmap;	/* No change */
+		} else if (old_bitmap->ref_cnt == 1) {
+			bit_and(old_bitmap->bitmap, res_bitmap);
+			prev_new = old_bitmap;
+		} else {
+			prev_new = _bitmap_alloc(bit_copy(old_bitmap->bitmap));
+			bit_and(prev_new->bitmap, res_bitmap);
+			_set_bitmap(rec, prev_new);
+			_bitmap_release(old_bitmap);
+		}
+	}
+
+	/* Merge adjacent records with identical bitmaps, from the record
+	 * preceding the reservation through the one following it */
+	if (prev == &node_space->head)
+		prev = node_space_first(node_space);
+	while ((prev->begin_time < end_time) && (next = prev->next[0])) {
+		if ((next->shared == prev->shared) ||
+		    bit_equal(next->avail_bitmap, prev->avail_bitmap)) {
+			_merge(node_space, prev, next);
+			continue;
+		}
+		prev = next;
+	}
+}
@@ -0,0 +1,108 @@
+/*****************************************************************************\
+ *  node_space.h - time-indexed map of nodes available to backfill
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * The backfill scheduler's record of which nodes are available over time,
+ * after making resource reservations for higher priority pending jobs.
+ * The scheduling window is divided into contiguous records, each holding
+ * the bitmap of nodes available from its begin_time until its end_time.
+ *
+ * Records are kept in a skip list ordered by time, so the record covering
+ * a given time is found in O(log n). Splitting a record shares its bitmap
+ * between both halves; a bitmap is only copied when a reservation changes
+ * one record using it. Adjacent records left with identical bitmaps are
+ * merged.
+ */
+
+#ifndef _BACKFILL_NODE_SPACE_H
+#define _BACKFILL_NODE_SPACE_H
+
+#include <time.h>
+
+#include "src/common/bitstring.h"
+
+typedef struct node_space_bitmap node_space_bitmap_t;
+
+typedef struct node_space_rec {
+	time_t begin_time;
+	time_t end_time;
+	bitstr_t *avail_bitmap;		/* available nodes, do not modify */
+	node_space_bitmap_t *shared;	/* reference counted avail_bitmap */
+	int level;			/* skip list levels */
+	struct node_space_rec **next;	/* next record at each level */
+} node_space_rec_t;
+
+typedef struct node_space_map node_space_map_t;
+
+/*
+ * node_space_create - create a map with a single record
+ * IN begin_time - start of the scheduling window
+ * IN end_time - end of the scheduling window
+ * IN avail_bitmap - nodes available, copied
+ * RET the map, free with node_space_destroy()
+ */
+extern node_space_map_t *node_space_create(time_t begin_time, time_t end_time,
+					   bitstr_t *avail_bitmap);
+
+extern void node_space_destroy(node_space_map_t *node_space);
+
+/* node_space_count - return the number of records in a map */
+extern int node_space_count(node_space_map_t *node_space);
+
+/* node_space_first - return the earliest record in a map */
+extern node_space_rec_t *node_space_first(node_space_map_t *node_space);
+
+/*
+ * node_space_find - return the record covering a given time, the earliest
+ *	record if the time precedes the map, or the last record if the time
+ *	follows it
+ */
+extern node_space_rec_t *node_space_find(node_space_map_t *node_space,
+					 time_t when);
+
+/* node_space_next - return the following record or NULL if the last */
+extern node_space_rec_t *node_space_next(node_space_rec_t *rec);
+
+/*
+ * node_space_reserve - reserve nodes for a pending job
+ * IN start_time - start of the reservation, advanced to the start of the
+ *	map if earlier
+ * IN end_time - end of the reservation
+ * IN res_bitmap - nodes remaining available during the reservation (i.e.
+ *	the complement of the nodes reserved)
+ */
+extern void node_space_reserve(node_space_map_t *node_space,
+			       time_t start_time, time_t end_time,
+			       bitstr_t *res_bitmap);
+
+#endif /* !_BACKFILL_NODE_SPACE_H */
@@ -96,7 +96,7 @@ static int	_job_modify(uint32_t jobid, char *bank_ptr,
 		job_ptr->end_time = job_ptr->end_time +
 				((job_ptr->time_limit -
 				  old_time) * 60);
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 
 	if (bank_ptr) {
@@ -182,7 +182,7 @@ host_fini:	if (rc) {
 		xfree(job_ptr->partition);
 		job_ptr->partition = xstrdup(part_name_ptr);
 		job_ptr->part_ptr = part_ptr;
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 		update_accounting = true;
 	}
 	if (new_node_cnt) {
@@ -193,7 +193,7 @@ host_fini:	if (rc) {
 				job_ptr->details->max_nodes = new_node_cnt;
 			info("wiki: change job %u min_nodes to %u",
 				jobid, new_node_cnt);
-			last_job_update = time(NULL);
+			job_modified(job_ptr, time(NULL));
 			update_accounting = true;
 		} else {
 			error("wiki: MODIFYJOB node count of non-pending "
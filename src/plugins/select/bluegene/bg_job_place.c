@@ -2221,7 +2221,7 @@ extern int submit_job(struct job_record *job_ptr, bitstr_t *slurm_block_bitmap,
 			}
 			blocks_added = 0;
 		}
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 
 	if (bg_conf->layout_mode == LAYOUT_DYNAMIC) {
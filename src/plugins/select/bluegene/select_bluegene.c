@@ -1702,7 +1702,8 @@ extern int select_p_job_ready(struct job_record *job_ptr)
 				/* Clear the state just incase we
 				 * missed it somehow. */
 				job_ptr->job_state &= (~JOB_CONFIGURING);
-				last_job_update = time(NULL);
+				/* Called with only the job read lock */
+				job_modified_all(time(NULL));
 				rc = 1;
 			} else if (uid != job_ptr->user_id)
 				rc = 0;
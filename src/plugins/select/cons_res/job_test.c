@@ -769,9 +769,9 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 			      bitstr_t *exc_core_bitmap, bool qos_preemptor)
 {
 	struct node_record *node_ptr;
-	uint32_t i, j, gres_cpus, gres_cores;
+	uint32_t i, j;
 	uint64_t free_mem, min_mem;
-	int core_start_bit, core_end_bit, cpus_per_core;
+	int core_start_bit, core_end_bit;
 	List gres_list;
 	int i_first, i_last;
 
@@ -797,8 +797,6 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 		node_ptr = select_node_record[i].node_ptr;
 		core_start_bit = cr_get_coremap_offset(i);
 		core_end_bit   = cr_get_coremap_offset(i+1) - 1;
-		cpus_per_core  = select_node_record[i].cpus /
-				 (core_end_bit - core_start_bit + 1);
 		/* node-level memory check */
 		if ((job_ptr->details->pn_min_memory) &&
 		    (cr_type & CR_MEMORY)) {
@@ -841,14 +839,8 @@ static int _verify_node_state(struct part_res_record *cr_part_ptr,
 			gres_list = node_usage[i].gres_list;
 		else
 			gres_list = node_ptr->gres_list;
-		gres_cores = gres_plugin_job_test(job_ptr->gres_list,
-						  gres_list, true,
-						  NULL, 0, 0, job_ptr->job_id,
-						  node_ptr->name);
-		gres_cpus = gres_cores;
-		if (gres_cpus != NO_VAL)
-			gres_cpus *= cpus_per_core;
-		if (gres_cpus == 0) {
+		if (!gres_plugin_job_node_avail(job_ptr->gres_list, gres_list,
+						true)) {
 			debug3("cons_res: _vns: node %s lacks gres",
 			       node_ptr->name);
 			goto clear_bit;
@@ -171,7 +171,7 @@ extern int sacctmgr_list_stats(int argc, char *argv[])
 	int error_code, i, j;
 	uint16_t type_id;
 	uint32_t type_ave, type_cnt, user_ave, user_cnt, user_id;
-	uint64_t roll_ave, type_time, user_time;
+	uint64_t roll_ave, unit_ave, type_time, user_time;
 	bool sort_by_ave_time = false, sort_by_total_time = false;
 	char *rollup_type;
 
@@ -190,10 +190,17 @@ extern int sacctmgr_list_stats(int argc, char *argv[])
 		roll_ave = buf->rollup_time[i];
 		if (buf->rollup_count[i] > 1)
 			roll_ave /= buf->rollup_count[i];
+		unit_ave = buf->rollup_time[i];
+		if (buf->rollup_units[i] > 1)
+			unit_ave /= buf->rollup_units[i];
 		printf("\t%-10s count:%-6u ave_time:%-6"PRIu64
 		       " max_time:%-12"PRIu64" total_time:%-12"PRIu64"\n",
 		       rollup_type, buf->rollup_count[i], roll_ave,
 		       buf->rollup_max_time[i], buf->rollup_time[i]);
+		printf("\t%-10s units:%-6"PRIu64" ave_unit_time:%-6"PRIu64
+		       " max_unit_time:%-12"PRIu64"\n",
+		       "", buf->rollup_units[i], unit_ave,
+		       buf->rollup_max_unit_time[i]);
 	}
 
 	if (argc) {
@@ -56,6 +56,7 @@
 
 #define OPT_LONG_HELP   0x100
 #define OPT_LONG_USAGE  0x101
+#define OPT_LONG_PIPELINE 0x102
 
 /* getopt_long options, integers but not characters */
 
@@ -79,6 +80,7 @@ extern void parse_command_line(int argc, char *argv[])
 		{"fanout",    required_argument, 0, 'F'},
 		{"force",     no_argument,       0, 'f'},
 		{"jobid",     required_argument, 0, 'j'},
+		{"pipeline",  required_argument, 0, OPT_LONG_PIPELINE},
 		{"preserve",  no_argument,       0, 'p'},
 		{"size",      required_argument, 0, 's'},
 		{"timeout",   required_argument, 0, 't'},
@@ -99,6 +101,9 @@ extern void parse_command_line(int argc, char *argv[])
 		if (sep)
 			sep[0] = ',';
 	}
+	if (sbcast_parameters &&
+	    (tmp = strcasestr(sbcast_parameters, "Pipeline=")))
+		params.pipeline = atoi(tmp + 9);
 
 	if (getenv("SBCAST_COMPRESS"))
 		params.compress = parse_compress_type(env_val);
@@ -110,6 +115,8 @@ extern void parse_command_line(int argc, char *argv[])
 	params.job_id  = NO_VAL;
 	params.step_id = NO_VAL;
 
+	if ( ( env_val = getenv("SBCAST_PIPELINE") ) )
+		params.pipeline = atoi(env_val);
 	if (getenv("SBCAST_PRESERVE"))
 		params.preserve = true;
 	if ( ( env_val = getenv("SBCAST_SIZE") ) )
@@ -145,6 +152,9 @@ extern void parse_command_line(int argc, char *argv[])
 		case (int)'p':
 			params.preserve = true;
 			break;
+		case (int) OPT_LONG_PIPELINE:
+			params.pipeline = atoi(optarg);
+			break;
 		case (int) 's':
 			params.block_size = _map_size(optarg);
 			break;
@@ -251,6 +261,7 @@ static void _print_options( void )
 		info("jobid      = %u", params.job_id);
 	else
 		info("jobid      = %u.%u", params.job_id, params.step_id);
+	info("pipeline   = %d", params.pipeline);
 	info("preserve   = %s", params.preserve ? "true" : "false");
 	info("timeout    = %d", params.timeout);
 	info("verbose    = %d", params.verbose);
@@ -275,6 +286,7 @@ Usage: sbcast [OPTIONS] SOURCE DEST\n\
   -j, --jobid=#[.#]    specify job ID and optional step ID, unneeded if run\n\
                        inside allocation\n\
   -p, --preserve       preserve modes and times of source file\n\
+      --pipeline=num   number of blocks to send at once\n\
   -s, --size=num       block size in bytes (rounded off)\n\
   -t, --timeout=secs   specify message timeout (seconds)\n\
   -v, --verbose        provide detailed event logging\n\
@@ -59,8 +59,14 @@ bool sort_by_time2 = false;
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
+static void _print_agent_rpc_stats(void);
+static void _print_dbd_agent_stats(void);
+static void _print_cred_stats(void);
+static void _print_lock_stats(void);
+static void _print_state_save_stats(void);
 static int  _print_stats(void);
 static void _sort_rpc(void);
+static void _swap_rpc_type_queue(int i, int j);
 
 stats_info_request_msg_t req;
 
@@ -169,6 +175,29 @@ static int _print_stats(void)
 		printf("\tQueue length mean: %u\n",
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
+	printf("\tLast table size: %u\n", buf->bf_table_size);
+	if (buf->bf_cycle_counter > 0) {
+		printf("\tMean table size: %u\n",
+		       buf->bf_table_size_sum / buf->bf_cycle_counter);
+	}
+	printf("\tTable reservations: %u", buf->bf_table_add_cnt);
+	if (buf->bf_table_add_cnt > 0) {
+		printf(" (mean time %.2f usec)",
+		       (double) buf->bf_table_add_time /
+		       (buf->bf_table_add_cnt * 1000.0));
+	}
+	printf("\n\tTable searches: %u", buf->bf_table_find_cnt);
+	if (buf->bf_table_find_cnt > 0) {
+		printf(" (mean time %.2f usec)",
+		       (double) buf->bf_table_find_time /
+		       (buf->bf_table_find_cnt * 1000.0));
+	}
+	printf("\n");
+
+	printf("\nRemote Procedure Call worker pool\n");
+	printf("\tWorker threads:   %u\n", buf->rpc_worker_cnt);
+	printf("\tQueue length:     %u\n", buf->rpc_queue_len);
+	printf("\tMax queue length: %u\n", buf->rpc_queue_max);
 
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
@@ -179,6 +208,24 @@ static int _print_stats(void)
 		       rpc_type_ave_time[i], buf->rpc_type_time[i]);
 	}
 
+	if (buf->rpc_type_queue_time) {
+		printf("\nRemote Procedure Call queue statistics by "
+		       "message type\n");
+		for (i = 0; i < buf->rpc_type_size; i++) {
+			uint32_t queue_ave = 0;
+			if (buf->rpc_type_cnt[i]) {
+				queue_ave = buf->rpc_type_queue_time[i] /
+					    buf->rpc_type_cnt[i];
+			}
+			printf("\t%-40s(%5u) max_depth:%-6u "
+			       "ave_wait:%-6u total_wait:%"PRIu64"\n",
+			       rpc_num2string(buf->rpc_type_id[i]),
+			       buf->rpc_type_id[i],
+			       buf->rpc_type_queue_depth[i], queue_ave,
+			       buf->rpc_type_queue_time[i]);
+		}
+	}
+
 	printf("\nRemote Procedure Call statistics by user\n");
 	for (i = 0; i < buf->rpc_user_size; i++) {
 		printf("\t%-16s(%8u) count:%-6u "
@@ -188,9 +235,172 @@ static int _print_stats(void)
 		       rpc_user_ave_time[i], buf->rpc_user_time[i]);
 	}
 
+	_print_lock_stats();
+	_print_state_save_stats();
+	_print_agent_rpc_stats();
+	_print_dbd_agent_stats();
+	_print_cred_stats();
+
 	return 0;
 }
 
+/* Print lock statistics by data structure, then by the functions taking
+ * the locks in order of time spent waiting (not available from older
+ * slurmctld) */
+static void _print_lock_stats(void)
+{
+	char *mode[2] = { "read", "write" };
+	uint32_t *site_inx, tmp_inx;
+	uint64_t ave_wait, ave_hold;
+	int i, j, k;
+
+	if (!buf->lock_size || !buf->lock_cnt)
+		return;
+
+	printf("\nslurmctld lock statistics (microseconds)\n");
+	for (i = 0; i < buf->lock_size; i++) {
+		for (j = 0; j < 2; j++) {
+			k = (i * 2) + j;
+			ave_wait = ave_hold = 0;
+			if (buf->lock_cnt[k]) {
+				ave_wait = buf->lock_wait_time[k] /
+					   buf->lock_cnt[k];
+				ave_hold = buf->lock_hold_time[k] /
+					   buf->lock_cnt[k];
+			}
+			printf("	%-10s %-5s count:%-8u waited:%-8u "
+			       "ave_wait:%-8"PRIu64" ave_hold:%-8"PRIu64
+			       " total_wait:%"PRIu64"\n",
+			       buf->lock_name[i], mode[j], buf->lock_cnt[k],
+			       buf->lock_wait_cnt[k], ave_wait, ave_hold,
+			       buf->lock_wait_time[k]);
+		}
+	}
+
+	if (!buf->lock_site_size)
+		return;
+	site_inx = xmalloc(sizeof(uint32_t) * buf->lock_site_size);
+	for (i = 0; i < buf->lock_site_size; i++)
+		site_inx[i] = i;
+	for (i = 0; i < buf->lock_site_size; i++) {
+		for (j = i + 1; j < buf->lock_site_size; j++) {
+			if (buf->lock_site_wait_time[site_inx[i]] >=
+			    buf->lock_site_wait_time[site_inx[j]])
+				continue;
+			tmp_inx = site_inx[i];
+			site_inx[i] = site_inx[j];
+			site_inx[j] = tmp_inx;
+		}
+	}
+	printf("\nslurmctld lock statistics by function (microseconds)\n");
+	for (i = 0; i < buf->lock_site_size; i++) {
+		k = site_inx[i];
+		if (!buf->lock_site_cnt[k])
+			continue;
+		printf("	%-32s count:%-8u ave_wait:%-8"PRIu64
+		       " max_wait:%-8"PRIu64" ave_hold:%-8"PRIu64
+		       " max_hold:%"PRIu64"\n",
+		       buf->lock_site_name[k], buf->lock_site_cnt[k],
+		       buf->lock_site_wait_time[k] / buf->lock_site_cnt[k],
+		       buf->lock_site_wait_max[k],
+		       buf->lock_site_hold_time[k] / buf->lock_site_cnt[k],
+		       buf->lock_site_hold_max[k]);
+	}
+	xfree(site_inx);
+}
+
+/* Print state save file statistics (not available from older slurmctld) */
+static void _print_state_save_stats(void)
+{
+	int i;
+
+	if (!buf->state_file_size || !buf->state_file_cnt)
+		return;
+
+	printf("\nState save file statistics (microseconds)\n");
+	for (i = 0; i < buf->state_file_size; i++) {
+		if (!buf->state_file_cnt[i])
+			continue;
+		printf("	%-16s count:%-8u last_bytes:%-10u "
+		       "ave_time:%-8"PRIu64" max_time:%"PRIu64"\n",
+		       buf->state_file_name[i], buf->state_file_cnt[i],
+		       buf->state_file_bytes[i],
+		       buf->state_file_time[i] / buf->state_file_cnt[i],
+		       buf->state_file_max[i]);
+	}
+}
+
+/* Print agent RPC engine statistics (not available from older slurmctld) */
+static void _print_agent_rpc_stats(void)
+{
+	int i;
+
+	if (!buf->agent_rpc_hist_size || !buf->agent_rpc_hist)
+		return;
+
+	printf("\nAgent RPCs to nodes\n");
+	printf("\tIn progress:      %u\n", buf->agent_rpc_active);
+	printf("\tQueued:           %u\n", buf->agent_rpc_queued);
+	printf("\tMax in progress:  %u\n", buf->agent_rpc_max);
+	printf("\tCompleted:        %u\n", buf->agent_rpc_cnt);
+	printf("\tFailed:           %u\n", buf->agent_rpc_fail);
+	printf("\tTimed out:        %u\n", buf->agent_rpc_timeout);
+	printf("\tConnect retries:  %u\n", buf->agent_rpc_retry);
+	printf("\tLatency (milliseconds):\n");
+	for (i = 0; i < buf->agent_rpc_hist_size; i++) {
+		if (!buf->agent_rpc_hist[i])
+			continue;
+		if (i == (buf->agent_rpc_hist_size - 1)) {
+			printf("\t\t>= %-8u count:%u\n",
+			       1U << (i - 1), buf->agent_rpc_hist[i]);
+		} else {
+			printf("\t\t<  %-8u count:%u\n",
+			       1U << i, buf->agent_rpc_hist[i]);
+		}
+	}
+}
+
+/* Print slurmdbd agent statistics (not available from older slurmctld) */
+static void _print_dbd_agent_stats(void)
+{
+	if (!buf->agent_rpc_hist_size)
+		return;
+
+	printf("\nSlurmDBD agent\n");
+	printf("\tQueued:           %u\n", buf->dbd_agent_queue_size);
+	printf("\tSpooled:          %u (%"PRIu64" bytes)\n",
+	       buf->dbd_agent_spool_cnt, buf->dbd_agent_spool_bytes);
+	printf("\tDiscarded:        %u\n", buf->dbd_agent_dropped);
+	printf("\tBatches sent:     %u\n", buf->dbd_agent_batch_cnt);
+	printf("\tMessages sent:    %u\n", buf->dbd_agent_msg_cnt);
+	if (buf->dbd_agent_batch_cnt) {
+		printf("\tBatch latency (microseconds): ave:%"PRIu64
+		       " max:%"PRIu64"\n",
+		       buf->dbd_agent_batch_time / buf->dbd_agent_batch_cnt,
+		       buf->dbd_agent_batch_max);
+	}
+}
+
+/* Print job credential signing statistics (not available from older
+ * slurmctld) */
+static void _print_cred_stats(void)
+{
+	if (!buf->agent_rpc_hist_size)
+		return;
+
+	printf("\nJob credentials\n");
+	printf("\tSigned:           %u\n", buf->cred_sign_cnt);
+	printf("\tWaiting to sign:  %u\n", buf->cred_sign_queue);
+	if (buf->cred_sign_cnt) {
+		printf("\tSign time (microseconds): ave:%"PRIu64
+		       " max:%"PRIu64"\n",
+		       buf->cred_sign_time / buf->cred_sign_cnt,
+		       buf->cred_sign_max);
+		printf("\tCreate to signed (microseconds): ave:%"PRIu64"\n",
+		       buf->cred_sign_wait / buf->cred_sign_cnt);
+	}
+}
+
 static void _sort_rpc(void)
 {
 	int i, j;
@@ -215,6 +425,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_queue(i, j);
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -254,6 +465,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_queue(i, j);
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -302,6 +514,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_queue(i, j);
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
@@ -342,6 +555,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_queue(i, j);
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -369,3 +583,21 @@ static void _sort_rpc(void)
 		}
 	}
 }
+
+/* Keep the RPC queue statistics in step with the rest of the RPC type
+ * information when sorting (not available from older slurmctld) */
+static void _swap_rpc_type_queue(int i, int j)
+{
+	uint32_t queue_depth;
+	uint64_t queue_time;
+
+	if (!buf->rpc_type_queue_time || !buf->rpc_type_queue_depth)
+		return;
+
+	queue_depth = buf->rpc_type_queue_depth[i];
+	queue_time  = buf->rpc_type_queue_time[i];
+	buf->rpc_type_queue_depth[i] = buf->rpc_type_queue_depth[j];
+	buf->rpc_type_queue_time[i]  = buf->rpc_type_queue_time[j];
+	buf->rpc_type_queue_depth[j] = queue_depth;
+	buf->rpc_type_queue_time[j]  = queue_time;
+}
@@ -2175,7 +2175,7 @@ static int _qos_job_time_out(struct job_record *job_ptr,
 		NULL, tres_usage_mins, NULL, 0);
 	switch (i) {
 	case 1:
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		info("Job %u timed out, "
 		     "the job is at or exceeds QOS %s's "
 		     "group max tres(%s) minutes of %"PRIu64" "
@@ -2204,7 +2204,7 @@ static int _qos_job_time_out(struct job_record *job_ptr,
 		qos_out_ptr->grp_wall = qos_ptr->grp_wall;
 
 		if (wall_mins >= qos_ptr->grp_wall) {
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			info("Job %u timed out, "
 			     "the job is at or exceeds QOS %s's "
 			     "group wall limit of %u with %u",
@@ -2226,7 +2226,7 @@ static int _qos_job_time_out(struct job_record *job_ptr,
 		/* not possible curr_usage is NULL */
 		break;
 	case 2:
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		info("Job %u timed out, "
 		     "the job is at or exceeds QOS %s's "
 		     "max tres(%s) minutes of %"PRIu64" with %"PRIu64,
@@ -3516,7 +3516,7 @@ extern int acct_policy_update_pending_job(struct job_record *job_ptr)
 	}
 
 	if (update_accounting) {
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 		debug("limits changed for job %u: updating accounting",
 		      job_ptr->job_id);
 		/* Update job record in accounting to reflect changes */
@@ -3604,7 +3604,7 @@ extern bool acct_policy_job_time_out(struct job_record *job_ptr)
 			NULL, tres_usage_mins, NULL, 0);
 		switch (i) {
 		case 1:
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			info("Job %u timed out, "
 			     "the job is at or exceeds assoc %u(%s/%s/%s) "
 			     "group max tres(%s) minutes of %"PRIu64
@@ -3650,7 +3650,7 @@ extern bool acct_policy_job_time_out(struct job_record *job_ptr)
 			/* not possible curr_usage is NULL */
 			break;
 		case 2:
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			info("Job %u timed out, "
 			     "the job is at or exceeds assoc %u(%s/%s/%s) "
 			     "max tres(%s) minutes of %"PRIu64
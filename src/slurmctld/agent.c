@@ -51,15 +51,18 @@
  *  be possible to execute the agent as an pthread, process, or even a daemon
  *  on some other computer.
  *
- *  The main agent thread creates a separate thread for each node to be
- *  communicated with up to AGENT_THREAD_COUNT. A special watchdog thread
- *  sends SIGLARM to any threads that have been active (in DSH_ACTIVE state)
- *  for more than MessageTimeout seconds.
+ *  The agent thread splits the nodes to be communicated with into groups,
+ *  normally a single group which slurmd forwards the message through as a
+ *  tree, and hands one RPC per message tree head to the agent_mux engine.
+ *  The engine drives the socket I/O of every agent's RPCs from a single
+ *  thread, with per-message timeouts and connect retries (see agent_mux.c).
+ *  As RPCs complete the agent thread unpacks their responses, re-sends to
+ *  each node of a tree whose head failed to forward the message, and once
+ *  all of a group's responses are in processes them under slurmctld locks.
  *  The agent responds to slurmctld via a function call or an RPC as required.
  *  For example, informing slurmctld that some node is not responding.
  *
- *  All the state for each thread is maintained in thd_t struct, which is
- *  used by the watchdog thread as well as the communication threads.
+ *  All the state for each group is maintained in a thd_t struct.
 \*****************************************************************************/
 
 #include "config.h"
@@ -86,12 +89,13 @@
 #include "src/common/parse_time.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/slurm_route.h"
 #include "src/common/uid.h"
-#include "src/common/xsignal.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/agent_mux.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
@@ -117,47 +121,42 @@ typedef struct thd_complete {
 	int no_resp_cnt;	/* assume all threads respond */
 	int retry_cnt;		/* assume no required retries */
 	int max_delay;
-	time_t now;
 } thd_complete_t;
 
 typedef struct thd {
-	pthread_t thread;		/* thread ID */
-	pthread_attr_t attr;		/* thread attributes */
-	state_t state;			/* thread state */
+	state_t state;			/* group state */
 	time_t start_time;		/* start time */
-	time_t end_time;		/* end time or delta time
-					 * upon termination */
+	time_t end_time;		/* delta time upon termination */
 	slurm_addr_t *addr;		/* specific addr to send to
 					 * will not do nodelist if set */
 	char *nodelist;			/* list of nodes to send to */
 	List ret_list;
+	int rpc_cnt;			/* RPCs in progress */
 } thd_t;
 
 typedef struct agent_info {
 	pthread_mutex_t thread_mutex;	/* agent specific mutex */
 	pthread_cond_t thread_cond;	/* agent specific condition */
-	uint32_t thread_count;		/* number of threads records */
-	uint32_t threads_active;	/* currently active threads */
+	uint32_t thread_count;		/* number of node groups */
+	uint32_t threads_active;	/* groups with RPCs in progress */
 	uint16_t retry;			/* if set, keep trying */
-	thd_t *thread_struct;		/* thread structures */
+	thd_t *thread_struct;		/* node group structures */
 	bool get_reply;			/* flag if reply expected */
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void **msg_args_pptr;		/* RPC data to be used */
 	uint16_t protocol_version;	/* if set, use this version */
+	List done_list;			/* agent_rpc_t completed by the
+					 * agent_mux engine */
 } agent_info_t;
 
-typedef struct task_info {
-	pthread_mutex_t *thread_mutex_ptr; /* pointer to agent specific
-					    * mutex */
-	pthread_cond_t *thread_cond_ptr;/* pointer to agent specific
-					 * condition */
-	uint32_t *threads_active_ptr;	/* currently active thread ptr */
-	thd_t *thread_struct_ptr;	/* thread structures ptr */
-	bool get_reply;			/* flag if reply expected */
-	slurm_msg_type_t msg_type;	/* RPC to be issued */
-	void *msg_args_ptr;		/* ptr to RPC data to be used */
-	uint16_t protocol_version;	/* if set, use this version */
-} task_info_t;
+typedef struct agent_rpc {
+	agent_mux_rpc_t mux;		/* request to the agent_mux engine */
+	agent_info_t *agent_ptr;
+	int thr_inx;			/* index into thread_struct */
+	char *name;			/* node sent to */
+	hostlist_t fwd_hl;		/* nodes it is to forward to */
+	int fwd_cnt;
+} agent_rpc_t;
 
 typedef struct queued_request {
 	agent_arg_t* agent_arg_ptr;	/* The queued request */
@@ -171,23 +170,23 @@ typedef struct mail_info {
 	char *message;
 } mail_info_t;
 
-static void _sig_handler(int dummy);
+static void _agent_tally(agent_info_t *agent_ptr);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
+static void _group_done(agent_info_t *agent_ptr, int inx);
 static void _list_delete_retry(void *retry_entry);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
-static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr);
 static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 		int no_resp_cnt, int retry_cnt);
 static void _purge_agent_args(agent_arg_t *agent_arg_ptr);
 static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
+static void _rpc_complete(agent_info_t *agent_ptr, agent_rpc_t *rpc);
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			  int *count, int *spot);
 static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr);
-static void *_thread_per_group_rpc(void *args);
+static void _start_group(agent_info_t *agent_ptr, int inx);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
-static void *_wdog(void *args);
 
 static mail_info_t *_mail_alloc(void);
 static void  _mail_free(void *arg);
@@ -203,7 +202,6 @@ static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cnt_cond  = PTHREAD_COND_INITIALIZER;
 static int agent_cnt = 0;
 static int agent_thread_cnt = 0;
-static uint16_t message_timeout = (uint16_t) NO_VAL;
 
 static bool run_scheduler    = false;
 static bool wiki2_sched      = false;
@@ -219,13 +217,10 @@ static bool wiki2_sched_test = false;
  */
 void *agent(void *args)
 {
-	int i, delay, rc, retries = 0;
-	pthread_attr_t attr_wdog;
-	pthread_t thread_wdog = 0;
+	int i, delay;
 	agent_arg_t *agent_arg_ptr = args;
 	agent_info_t *agent_info_ptr = NULL;
-	thd_t *thread_ptr;
-	task_info_t *task_specific_ptr;
+	agent_rpc_t *rpc;
 	time_t begin_time;
 	bool spawn_retry_agent = false;
 	int rpc_thread_cnt;
@@ -250,7 +245,9 @@ void *agent(void *args)
 		wiki2_sched_test = true;
 	}
 
-	rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count, AGENT_THREAD_COUNT);
+	/* Socket I/O is performed by the agent_mux engine thread, this
+	 * agent needs only its own thread */
+	rpc_thread_cnt = 1;
 	while (1) {
 		if (slurmctld_config.shutdown_time ||
 		    ((agent_thread_cnt+rpc_thread_cnt) <= MAX_SERVER_THREADS)) {
@@ -272,81 +269,36 @@ void *agent(void *args)
 
 	/* initialize the agent data structures */
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
-	thread_ptr = agent_info_ptr->thread_struct;
-
-	/* start the watchdog thread */
-	slurm_attr_init(&attr_wdog);
-	if (pthread_attr_setdetachstate
-	    (&attr_wdog, PTHREAD_CREATE_JOINABLE))
-		error("pthread_attr_setdetachstate error %m");
-	while (pthread_create(&thread_wdog, &attr_wdog, _wdog,
-			      (void *) agent_info_ptr)) {
-		error("pthread_create error %m");
-		if (++retries > MAX_RETRIES)
-			fatal("Can't create pthread");
-		usleep(10000);	/* sleep and retry */
-	}
-	slurm_attr_destroy(&attr_wdog);
 
-	debug2("got %d threads to send out", agent_info_ptr->thread_count);
-	/* start all the other threads (up to AGENT_THREAD_COUNT active) */
-	for (i = 0; i < agent_info_ptr->thread_count; i++) {
+	debug2("got %d groups to send out", agent_info_ptr->thread_count);
+	for (i = 0; i < agent_info_ptr->thread_count; i++)
+		_start_group(agent_info_ptr, i);
 
-		/* wait until "room" for another thread */
+	/* Process responses as the agent_mux engine completes RPCs */
+	while (agent_info_ptr->threads_active) {
 		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-		while (agent_info_ptr->threads_active >=
-		       AGENT_THREAD_COUNT) {
+		while (!(rpc = list_dequeue(agent_info_ptr->done_list))) {
 			slurm_cond_wait(&agent_info_ptr->thread_cond,
 					&agent_info_ptr->thread_mutex);
 		}
-
-		/* create thread specific data, NOTE: freed from
-		 *      _thread_per_group_rpc() */
-		task_specific_ptr = _make_task_data(agent_info_ptr, i);
-
-		slurm_attr_init(&thread_ptr[i].attr);
-		if (pthread_attr_setdetachstate(&thread_ptr[i].attr,
-						PTHREAD_CREATE_DETACHED))
-			error("pthread_attr_setdetachstate error %m");
-		while ((rc = pthread_create(&thread_ptr[i].thread,
-					    &thread_ptr[i].attr,
-					    _thread_per_group_rpc,
-					    (void *) task_specific_ptr))) {
-			error("pthread_create error %m");
-			if (agent_info_ptr->threads_active)
-				slurm_cond_wait(&agent_info_ptr->thread_cond,
-						&agent_info_ptr->thread_mutex);
-			else {
-				slurm_mutex_unlock(&agent_info_ptr->
-						     thread_mutex);
-				usleep(10000);	/* sleep and retry */
-				slurm_mutex_lock(&agent_info_ptr->
-						   thread_mutex);
-			}
-		}
-		slurm_attr_destroy(&thread_ptr[i].attr);
-		agent_info_ptr->threads_active++;
 		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+		_rpc_complete(agent_info_ptr, rpc);
 	}
 
-	/* Wait for termination of remaining threads */
-	pthread_join(thread_wdog, NULL);
 	delay = (int) difftime(time(NULL), begin_time);
 	if (delay > (slurm_get_msg_timeout() * 2)) {
 		info("agent msg_type=%u ran for %d seconds",
 			agent_arg_ptr->msg_type,  delay);
 	}
-	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-	while (agent_info_ptr->threads_active != 0) {
-		slurm_cond_wait(&agent_info_ptr->thread_cond,
-				&agent_info_ptr->thread_mutex);
-	}
-	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+	_agent_tally(agent_info_ptr);
 
       cleanup:
 	_purge_agent_args(agent_arg_ptr);
 
 	if (agent_info_ptr) {
+		FREE_NULL_LIST(agent_info_ptr->done_list);
+		slurm_mutex_destroy(&agent_info_ptr->thread_mutex);
+		slurm_cond_destroy(&agent_info_ptr->thread_cond);
 		xfree(agent_info_ptr->thread_struct);
 		xfree(agent_info_ptr);
 	}
@@ -365,7 +317,7 @@ void *agent(void *args)
 		agent_thread_cnt = 0;
 	}
 
-	if ((agent_thread_cnt + AGENT_THREAD_COUNT + 2) < MAX_SERVER_THREADS)
+	if ((agent_thread_cnt + 1) < MAX_SERVER_THREADS)
 		spawn_retry_agent = true;
 
 	slurm_cond_broadcast(&agent_cnt_cond);
@@ -418,6 +370,7 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	agent_info_ptr->msg_type       = agent_arg_ptr->msg_type;
 	agent_info_ptr->msg_args_pptr  = &agent_arg_ptr->msg_args;
 	agent_info_ptr->protocol_version = agent_arg_ptr->protocol_version;
+	agent_info_ptr->done_list      = list_create(NULL);
 
 	if ((agent_arg_ptr->msg_type != REQUEST_JOB_NOTIFY)	&&
 	    (agent_arg_ptr->msg_type != REQUEST_REBOOT_NODES)	&&
@@ -488,40 +441,12 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	return agent_info_ptr;
 }
 
-static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
+static void _tally_state(thd_t *thread_ptr, state_t state,
+			 thd_complete_t *thd_comp)
 {
-	task_info_t *task_info_ptr;
-	task_info_ptr = xmalloc(sizeof(task_info_t));
-
-	task_info_ptr->thread_mutex_ptr  = &agent_info_ptr->thread_mutex;
-	task_info_ptr->thread_cond_ptr   = &agent_info_ptr->thread_cond;
-	task_info_ptr->threads_active_ptr= &agent_info_ptr->threads_active;
-	task_info_ptr->thread_struct_ptr = &agent_info_ptr->thread_struct[inx];
-	task_info_ptr->get_reply         = agent_info_ptr->get_reply;
-	task_info_ptr->msg_type          = agent_info_ptr->msg_type;
-	task_info_ptr->msg_args_ptr      = *agent_info_ptr->msg_args_pptr;
-	task_info_ptr->protocol_version  = agent_info_ptr->protocol_version;
-
-	return task_info_ptr;
-}
-
-static void _update_wdog_state(thd_t *thread_ptr,
-			       state_t *state,
-			       thd_complete_t *thd_comp)
-{
-	switch (*state) {
-	case DSH_ACTIVE:
-		thd_comp->work_done = false;
-		if (thread_ptr->end_time <= thd_comp->now) {
-			debug3("agent thread %lu timed out",
-			       (unsigned long) thread_ptr->thread);
-			if (pthread_kill(thread_ptr->thread, SIGUSR1) == ESRCH)
-				*state = DSH_NO_RESP;
-			else
-				thread_ptr->end_time += message_timeout;
-		}
-		break;
+	switch (state) {
 	case DSH_NEW:
+	case DSH_ACTIVE:
 		thd_comp->work_done = false;
 		break;
 	case DSH_DONE:
@@ -540,18 +465,15 @@ static void _update_wdog_state(thd_t *thread_ptr,
 }
 
 /*
- * _wdog - Watchdog thread. Send SIGUSR1 to threads which have been active
- *	for too long.
- * IN args - pointer to agent_info_t with info on threads to watch
- * Sleep between polls with exponential times (from 0.125 to 1.0 second)
+ * _agent_tally - Tally the results of all node groups once complete and
+ *	notify slurmctld of them
+ * IN agent_ptr - pointer to agent_info_t with info on node groups
  */
-static void *_wdog(void *args)
+static void _agent_tally(agent_info_t *agent_ptr)
 {
 	bool srun_agent = false;
 	int i;
-	agent_info_t *agent_ptr = (agent_info_t *) args;
 	thd_t *thread_ptr = agent_ptr->thread_struct;
-	unsigned long usec = 5000;
 	ListIterator itr;
 	thd_complete_t thd_comp;
 	ret_data_info_t *ret_data_info = NULL;
@@ -568,41 +490,22 @@ static void *_wdog(void *args)
 	     (agent_ptr->msg_type == RESPONSE_RESOURCE_ALLOCATION) )
 		srun_agent = true;
 
-	thd_comp.max_delay = 0;
-
-	while (1) {
-		thd_comp.work_done   = true;/* assume all threads complete */
-		thd_comp.fail_cnt    = 0;   /* assume no threads failures */
-		thd_comp.no_resp_cnt = 0;   /* assume all threads respond */
-		thd_comp.retry_cnt   = 0;   /* assume no required retries */
-		thd_comp.now         = time(NULL);
-
-		usleep(usec);
-		usec = MIN((usec * 2), 1000000);
-
-		slurm_mutex_lock(&agent_ptr->thread_mutex);
-		for (i = 0; i < agent_ptr->thread_count; i++) {
-			//info("thread name %s",thread_ptr[i].node_name);
-			if (!thread_ptr[i].ret_list) {
-				_update_wdog_state(&thread_ptr[i],
-						   &thread_ptr[i].state,
-						   &thd_comp);
-			} else {
-				itr = list_iterator_create(
-					thread_ptr[i].ret_list);
-				while ((ret_data_info = list_next(itr))) {
-					_update_wdog_state(&thread_ptr[i],
-							   &ret_data_info->err,
-							   &thd_comp);
-				}
-				list_iterator_destroy(itr);
+	memset(&thd_comp, 0, sizeof(thd_comp));
+	thd_comp.work_done = true;
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		if (!thread_ptr[i].ret_list) {
+			_tally_state(&thread_ptr[i], thread_ptr[i].state,
+				     &thd_comp);
+		} else {
+			itr = list_iterator_create(thread_ptr[i].ret_list);
+			while ((ret_data_info = list_next(itr))) {
+				_tally_state(&thread_ptr[i],
+					     ret_data_info->err, &thd_comp);
 			}
+			list_iterator_destroy(itr);
 		}
-		if (thd_comp.work_done)
-			break;
-
-		slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	}
+	xassert(thd_comp.work_done);
 
 	if (srun_agent) {
 		_notify_slurmctld_jobs(agent_ptr);
@@ -619,9 +522,6 @@ static void *_wdog(void *args)
 
 	if (thd_comp.max_delay)
 		debug2("agent maximum delay %d seconds", thd_comp.max_delay);
-
-	slurm_mutex_unlock(&agent_ptr->thread_mutex);
-	return (void *) NULL;
 }
 
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr)
@@ -777,6 +677,20 @@ finished:	;
 		ping_end();
 }
 
+/* Return true if the message is sent to srun rather than slurmd */
+static bool _is_srun_msg(slurm_msg_type_t msg_type)
+{
+	return ((msg_type == SRUN_PING)			||
+		(msg_type == SRUN_EXEC)			||
+		(msg_type == SRUN_JOB_COMPLETE)		||
+		(msg_type == SRUN_STEP_MISSING)		||
+		(msg_type == SRUN_STEP_SIGNAL)		||
+		(msg_type == SRUN_TIMEOUT)		||
+		(msg_type == SRUN_USER_MSG)		||
+		(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
+		(msg_type == SRUN_NODE_FAIL));
+}
+
 /* Report a communications error for specified node
  * This also gets logged as a non-responsive node */
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type)
@@ -809,33 +723,267 @@ static int _wif_status(void)
 	return rc;
 }
 
+/* Called by the agent_mux engine thread as each RPC completes */
+static void _rpc_done(agent_mux_rpc_t *mux_rpc)
+{
+	agent_rpc_t *rpc = mux_rpc->arg;
+	agent_info_t *agent_ptr = rpc->agent_ptr;
+
+	slurm_mutex_lock(&agent_ptr->thread_mutex);
+	list_append(agent_ptr->done_list, rpc);
+	slurm_cond_signal(&agent_ptr->thread_cond);
+	slurm_mutex_unlock(&agent_ptr->thread_mutex);
+}
+
 /*
- * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
- *                         sending message out to one and forwarding it to
- *                         others if necessary.
- * IN/OUT args - pointer to task_info_t, xfree'd on completion
+ * _send_rpc - hand an RPC for one node, which is to forward it to any
+ *	others in fwd_hl, to the agent_mux engine
+ * IN agent_ptr - agent sending the RPC
+ * IN inx - index of the node group in agent_ptr->thread_struct
+ * IN name - node to send to
+ * IN addr - its address
+ * IN fwd_hl - nodes to forward to or NULL, consumed
  */
-static void *_thread_per_group_rpc(void *args)
+static void _send_rpc(agent_info_t *agent_ptr, int inx, char *name,
+		      slurm_addr_t *addr, hostlist_t fwd_hl)
 {
-	int rc = SLURM_SUCCESS;
+	agent_rpc_t *rpc = xmalloc(sizeof(agent_rpc_t));
+	uint16_t msg_timeout = slurm_get_msg_timeout();
 	slurm_msg_t msg;
-	task_info_t *task_ptr = (task_info_t *) args;
-	/* we cache some pointers from task_info_t because we need
-	 * to xfree args before being finished with their use. xfree
-	 * is required for timely termination of this pthread because
-	 * xfree could lock it at the end, preventing a timely
-	 * thread_exit */
-	pthread_mutex_t *thread_mutex_ptr   = task_ptr->thread_mutex_ptr;
-	pthread_cond_t  *thread_cond_ptr    = task_ptr->thread_cond_ptr;
-	uint32_t        *threads_active_ptr = task_ptr->threads_active_ptr;
-	thd_t           *thread_ptr         = task_ptr->thread_struct_ptr;
-	state_t thread_state = DSH_NO_RESP;
-	slurm_msg_type_t msg_type = task_ptr->msg_type;
-	bool is_kill_msg, srun_agent;
+	int steps;
+
+	rpc->agent_ptr = agent_ptr;
+	rpc->thr_inx   = inx;
+	rpc->name      = xstrdup(name);
+	rpc->fwd_hl    = fwd_hl;
+
+	slurm_msg_t_init(&msg);
+	if (agent_ptr->protocol_version)
+		msg.protocol_version = agent_ptr->protocol_version;
+	msg.msg_type = agent_ptr->msg_type;
+	msg.data     = *agent_ptr->msg_args_pptr;
+
+	rpc->mux.timeout = msg_timeout * 1000;
+	if (fwd_hl && (rpc->fwd_cnt = hostlist_count(fwd_hl))) {
+		msg.forward.nodelist = hostlist_ranged_string_xmalloc(fwd_hl);
+		msg.forward.cnt      = rpc->fwd_cnt;
+		msg.forward.timeout  = msg_timeout * 1000;
+		msg.forward.tree_width = slurm_get_tree_width();
+		debug3("Tree sending to %s along with %s",
+		       name, msg.forward.nodelist);
+		/* Allow message_timeout per step in the tree below us
+		 * plus forward.timeout per step for our children to time
+		 * out, as slurm_send_addr_recv_msgs() would */
+		steps = (rpc->fwd_cnt + 1) / MAX(msg.forward.tree_width, 1);
+		rpc->mux.timeout = (msg_timeout * 1000) * steps;
+		steps++;
+		rpc->mux.timeout += msg.forward.timeout * steps;
+	}
+
+	rpc->mux.addr      = *addr;
+	rpc->mux.buffer    = slurm_pack_node_msg(&msg);
+	rpc->mux.get_reply = agent_ptr->get_reply;
+	if (agent_ptr->get_reply)
+		rpc->mux.conn_retry = MIN(msg_timeout, 10);
+	rpc->mux.done      = _rpc_done;
+	rpc->mux.arg       = rpc;
+	xfree(msg.forward.nodelist);
+
+	agent_ptr->thread_struct[inx].rpc_cnt++;
+	if (rpc->mux.buffer) {
+		agent_mux_send(&rpc->mux);
+	} else {
+		rpc->mux.rc = errno;
+		_rpc_done(&rpc->mux);
+	}
+}
+
+/*
+ * _send_tree - send an RPC to the first node of tree_hl which has a known
+ *	address, for it to forward to the rest
+ * IN agent_ptr - agent sending the RPC
+ * IN inx - index of the node group in agent_ptr->thread_struct
+ * IN tree_hl - nodes to send to, consumed
+ */
+static void _send_tree(agent_info_t *agent_ptr, int inx, hostlist_t tree_hl)
+{
+	thd_t *thread_ptr = &agent_ptr->thread_struct[inx];
+	slurm_addr_t addr;
+	char *name;
+
+	while ((name = hostlist_shift(tree_hl))) {
+		if (slurm_conf_get_addr(name, &addr) == SLURM_SUCCESS) {
+			_send_rpc(agent_ptr, inx, name, &addr, tree_hl);
+			free(name);
+			return;
+		}
+		error("%s: can't find address for host %s, check slurm.conf",
+		      __func__, name);
+		mark_as_failed_forward(&thread_ptr->ret_list, name,
+				       SLURM_UNKNOWN_FORWARD_ADDR);
+		free(name);
+	}
+	hostlist_destroy(tree_hl);
+}
+
+/*
+ * _start_group - issue an RPC for a group of nodes, sending the message out
+ *	to one and forwarding it to others if necessary
+ * IN agent_ptr - agent sending the RPC
+ * IN inx - index of the node group in agent_ptr->thread_struct
+ */
+static void _start_group(agent_info_t *agent_ptr, int inx)
+{
+	thd_t *thread_ptr = &agent_ptr->thread_struct[inx];
+	hostlist_t hl, *sp_hl = NULL;
+	slurm_addr_t addr;
+	int i, hl_count = 0;
+
+	thread_ptr->start_time = time(NULL);
+	thread_ptr->state = DSH_ACTIVE;
+	agent_ptr->threads_active++;
+#if 0
+ 	info("sending message type %u to %s", agent_ptr->msg_type,
+	     thread_ptr->nodelist);
+#endif
+
+	if (thread_ptr->addr) {
+		_send_rpc(agent_ptr, inx, thread_ptr->nodelist,
+			  thread_ptr->addr, NULL);
+	} else if (!agent_ptr->get_reply) {
+		if (slurm_conf_get_addr(thread_ptr->nodelist, &addr) ==
+		    SLURM_ERROR) {
+			error("%s: can't find address for host %s, "
+			      "check slurm.conf",
+			      __func__, thread_ptr->nodelist);
+		} else {
+			_send_rpc(agent_ptr, inx, thread_ptr->nodelist,
+				  &addr, NULL);
+		}
+	} else {
+		hl = hostlist_create(thread_ptr->nodelist);
+		hostlist_uniq(hl);
+		if (route_g_split_hostlist(hl, &sp_hl, &hl_count, 0)) {
+			error("%s: unable to split forward hostlist",
+			      __func__);
+		}
+		for (i = 0; i < hl_count; i++)
+			_send_tree(agent_ptr, inx, sp_hl[i]);
+		xfree(sp_hl);
+		hostlist_destroy(hl);
+	}
+
+	if (thread_ptr->rpc_cnt == 0)
+		_group_done(agent_ptr, inx);
+}
+
+/*
+ * _rpc_complete - process an RPC completed by the agent_mux engine
+ * IN agent_ptr - agent which sent the RPC
+ * IN rpc - the RPC, xfree'd
+ */
+static void _rpc_complete(agent_info_t *agent_ptr, agent_rpc_t *rpc)
+{
+	thd_t *thread_ptr = &agent_ptr->thread_struct[rpc->thr_inx];
 	List ret_list = NULL;
 	ListIterator itr;
 	ret_data_info_t *ret_data_info = NULL;
-	int sig_array[2] = {SIGUSR1, 0};
+	int ret_cnt, rc = rpc->mux.rc;
+	char *name;
+	/* Lock: Read node */
+	slurmctld_lock_t node_read_lock = {
+		NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+
+	if (!agent_ptr->get_reply) {
+		if (rc == SLURM_SUCCESS) {
+			thread_ptr->state = DSH_DONE;
+		} else if (!_is_srun_msg(agent_ptr->msg_type)) {
+			errno = rc;
+			lock_slurmctld(node_read_lock);
+			_comm_err(rpc->name, agent_ptr->msg_type);
+			unlock_slurmctld(node_read_lock);
+		}
+		goto fini;
+	}
+
+	if (rc == SLURM_SUCCESS) {
+		ret_list = slurm_unpack_received_msgs(-1, rpc->mux.reply);
+		rpc->mux.reply = NULL;
+		if (!ret_list)
+			rc = errno;
+	}
+	if (!ret_list) {
+		mark_as_failed_forward(&ret_list, rpc->name, rc);
+		rc = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
+	} else {
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			if (!ret_data_info->node_name)
+				ret_data_info->node_name = xstrdup(rpc->name);
+		}
+		list_iterator_destroy(itr);
+	}
+
+	ret_cnt = list_count(ret_list);
+	if (ret_cnt <= rpc->fwd_cnt) {
+		/* This is most common if a slurmd is running an older
+		 * version of Slurm than the originator of the message */
+		if (rc != SLURM_COMMUNICATIONS_CONNECTION_ERROR) {
+			error("%s: %s failed to forward the message, "
+			      "expecting %d ret got only %d", __func__,
+			      rpc->name, rpc->fwd_cnt + 1, ret_cnt);
+			itr = list_iterator_create(ret_list);
+			while ((ret_data_info = list_next(itr))) {
+				if (xstrcmp(ret_data_info->node_name,
+					    rpc->name))
+					hostlist_delete_host(
+						rpc->fwd_hl,
+						ret_data_info->node_name);
+			}
+			list_iterator_destroy(itr);
+		}
+		/* Abandon tree. This way if all the nodes in the branch
+		 * are down we don't have to time out for each node
+		 * serially. */
+		while ((name = hostlist_shift(rpc->fwd_hl))) {
+			_send_tree(agent_ptr, rpc->thr_inx,
+				   hostlist_create(name));
+			free(name);
+		}
+	}
+
+	if (!thread_ptr->ret_list)
+		thread_ptr->ret_list = list_create(destroy_data_info);
+	list_transfer(thread_ptr->ret_list, ret_list);
+	FREE_NULL_LIST(ret_list);
+
+fini:
+	if (rpc->mux.reply)
+		free_buf(rpc->mux.reply);
+	if (rpc->fwd_hl)
+		hostlist_destroy(rpc->fwd_hl);
+	xfree(rpc->name);
+	if (--thread_ptr->rpc_cnt == 0)
+		_group_done(agent_ptr, rpc->thr_inx);
+	xfree(rpc);
+}
+
+/*
+ * _group_done - process the responses of a group of nodes once all of its
+ *	RPCs are complete
+ * IN agent_ptr - agent which sent the RPCs
+ * IN inx - index of the node group in agent_ptr->thread_struct
+ */
+static void _group_done(agent_info_t *agent_ptr, int inx)
+{
+	int rc = SLURM_SUCCESS;
+	thd_t *thread_ptr = &agent_ptr->thread_struct[inx];
+	state_t thread_state = thread_ptr->state;
+	slurm_msg_type_t msg_type = agent_ptr->msg_type;
+	bool is_kill_msg, srun_agent;
+	List ret_list = thread_ptr->ret_list;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info = NULL;
 	/* Locks: Write job, write node */
 	slurmctld_lock_t job_write_lock = {
 		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
@@ -846,88 +994,15 @@ static void *_thread_per_group_rpc(void *args)
 	slurmctld_lock_t node_write_lock = {
 		NO_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
 
-	xassert(args != NULL);
-	xsignal(SIGUSR1, _sig_handler);
-	xsignal_unblock(sig_array);
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_KILL_PREEMPTED)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
-	srun_agent = (	(msg_type == SRUN_PING)			||
-			(msg_type == SRUN_EXEC)			||
-			(msg_type == SRUN_JOB_COMPLETE)		||
-			(msg_type == SRUN_STEP_MISSING)		||
-			(msg_type == SRUN_STEP_SIGNAL)		||
-			(msg_type == SRUN_TIMEOUT)		||
-			(msg_type == SRUN_USER_MSG)		||
-			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
-			(msg_type == SRUN_NODE_FAIL) );
-
-	thread_ptr->start_time = time(NULL);
-
-	slurm_mutex_lock(thread_mutex_ptr);
-	thread_ptr->state = DSH_ACTIVE;
-	thread_ptr->end_time = thread_ptr->start_time + message_timeout;
-	slurm_mutex_unlock(thread_mutex_ptr);
-
-	/* send request message */
-	slurm_msg_t_init(&msg);
-
-	if (task_ptr->protocol_version)
-		msg.protocol_version = task_ptr->protocol_version;
-
-	msg.msg_type = msg_type;
-	msg.data     = task_ptr->msg_args_ptr;
-#if 0
- 	info("sending message type %u to %s", msg_type, thread_ptr->nodelist);
-#endif
-	if (task_ptr->get_reply) {
-		if (thread_ptr->addr) {
-			msg.address = *thread_ptr->addr;
-
-			if (!(ret_list = slurm_send_addr_recv_msgs(
-				     &msg, thread_ptr->nodelist, 0))) {
-				error("_thread_per_group_rpc: "
-				      "no ret_list given");
-				goto cleanup;
-			}
+	srun_agent = _is_srun_msg(msg_type);
 
-
-		} else {
-			if (!(ret_list = slurm_send_recv_msgs(
-				     thread_ptr->nodelist,
-				     &msg, 0, true))) {
-				error("_thread_per_group_rpc: "
-				      "no ret_list given");
-				goto cleanup;
-			}
-		}
-	} else {
-		if (thread_ptr->addr) {
-			//info("got the address");
-			msg.address = *thread_ptr->addr;
-		} else {
-			//info("no address given");
-			if (slurm_conf_get_addr(thread_ptr->nodelist,
-					       &msg.address) == SLURM_ERROR) {
-				error("_thread_per_group_rpc: "
-				      "can't find address for host %s, "
-				      "check slurm.conf",
-				      thread_ptr->nodelist);
-				goto cleanup;
-			}
-		}
-		//info("sending %u to %s", msg_type, thread_ptr->nodelist);
-		if (slurm_send_only_node_msg(&msg) == SLURM_SUCCESS) {
-			thread_state = DSH_DONE;
-		} else {
-			if (!srun_agent) {
-				lock_slurmctld(node_read_lock);
-				_comm_err(thread_ptr->nodelist, msg_type);
-				unlock_slurmctld(node_read_lock);
-			}
-		}
+	if (thread_state == DSH_ACTIVE)
+		thread_state = DSH_NO_RESP;
+	if (!agent_ptr->get_reply || !ret_list)
 		goto cleanup;
-	}
 
 	//info("got %d messages back", list_count(ret_list));
 	itr = list_iterator_create(ret_list);
@@ -951,7 +1026,7 @@ static void *_thread_per_group_rpc(void *args)
 		    (rc == ESLURMD_KILL_JOB_ALREADY_COMPLETE)) {
 			kill_job_msg_t *kill_job;
 			kill_job = (kill_job_msg_t *)
-				task_ptr->msg_args_ptr;
+				*agent_ptr->msg_args_pptr;
 			rc = SLURM_SUCCESS;
 			lock_slurmctld(job_write_lock);
 			if (job_epilog_complete(kill_job->job_id,
@@ -977,7 +1052,7 @@ static void *_thread_per_group_rpc(void *args)
 		    (rc != ESLURM_DUPLICATE_JOB_ID) &&
 		    (ret_data_info->type != RESPONSE_FORWARD_FAILED)) {
 			batch_job_launch_msg_t *launch_msg_ptr =
-				task_ptr->msg_args_ptr;
+				*agent_ptr->msg_args_pptr;
 			uint32_t job_id = launch_msg_ptr->job_id;
 			info("Killing non-startable batch job %u: %s",
 			     job_id, slurm_strerror(rc));
@@ -1061,28 +1136,10 @@ static void *_thread_per_group_rpc(void *args)
 	list_iterator_destroy(itr);
 
 cleanup:
-	xfree(args);
-
-	/* handled at end of thread just in case resend is needed */
-	destroy_forward(&msg.forward);
-	slurm_mutex_lock(thread_mutex_ptr);
-	thread_ptr->ret_list = ret_list;
 	thread_ptr->state = thread_state;
 	thread_ptr->end_time = (time_t) difftime(time(NULL),
 						 thread_ptr->start_time);
-	/* Signal completion so another thread can replace us */
-	(*threads_active_ptr)--;
-	slurm_cond_signal(thread_cond_ptr);
-	slurm_mutex_unlock(thread_mutex_ptr);
-	return (void *) NULL;
-}
-
-/*
- * Signal handler.  We are really interested in interrupting hung communictions
- * and causing them to return EINTR. Multiple interupts might be required.
- */
-static void _sig_handler(int dummy)
-{
+	agent_ptr->threads_active--;
 }
 
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
@@ -1285,7 +1342,7 @@ extern int agent_retry (int min_wait, bool mail_too)
 	}
 
 	slurm_mutex_lock(&agent_cnt_mutex);
-	if (agent_thread_cnt + AGENT_THREAD_COUNT + 2 > MAX_SERVER_THREADS) {
+	if (agent_thread_cnt + 1 > MAX_SERVER_THREADS) {
 		/* too much work already */
 		slurm_mutex_unlock(&agent_cnt_mutex);
 		slurm_mutex_unlock(&retry_mutex);
@@ -1396,13 +1453,6 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 {
 	queued_request_t *queued_req_ptr = NULL;
 
-	if ((AGENT_THREAD_COUNT + 2) >= MAX_SERVER_THREADS)
-		fatal("AGENT_THREAD_COUNT value is too low relative to MAX_SERVER_THREADS");
-
-	if (message_timeout == (uint16_t) NO_VAL) {
-		message_timeout = MAX(slurm_get_msg_timeout(), 30);
-	}
-
 	if (agent_arg_ptr->msg_type == REQUEST_SHUTDOWN) {
 		/* execute now */
 		pthread_attr_t attr_agent;
@@ -44,7 +44,6 @@
 
 #include "src/slurmctld/slurmctld.h"
 
-#define AGENT_THREAD_COUNT	10	/* maximum active threads per agent */
 #define COMMAND_TIMEOUT 	30	/* command requeue or error, seconds */
 
 #define LOTS_OF_AGENTS_CNT 50
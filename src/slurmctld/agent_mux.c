@@ -0,0 +1,661 @@
+/*****************************************************************************\
+ *  agent_mux.c - event driven engine for outbound slurmctld RPCs to nodes
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ *****************************************************************************
+ *  Theory of operation:
+ *
+ *  A single thread drives every outbound agent RPC through its connect,
+ *  send and (optional) response phases using non-blocking sockets and
+ *  poll(), so the number of RPCs in progress is not bound to the number of
+ *  threads. Each phase has its own deadline: TCPTimeout for connect,
+ *  MessageTimeout for send and the caller's timeout for the response.
+ *  Refused connections are retried once per second, which permits
+ *  communications to survive slurmd restarts. At most AGENT_MUX_MAX_CONN
+ *  connections are open at once, further RPCs wait in FIFO order. RPCs,
+ *  new or retrying, which wait MessageTimeout for a free connection fail.
+ *
+ *  The engine only moves bytes. Messages are packed and responses unpacked
+ *  by the agent threads, see agent.c.
+\*****************************************************************************/
+
+#include "config.h"
+
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/agent_mux.h"
+
+#ifndef AGENT_MUX_MAX_CONN
+#define AGENT_MUX_MAX_CONN	512	/* maximum open connections */
+#endif
+#define AGENT_MUX_MAX_MSG	(1024 * 1024 * 1024)
+#define AGENT_MUX_MAX_POLL	1000	/* msec, upper bound on poll() */
+
+typedef enum {
+	MUX_QUEUED,		/* waiting for a free connection */
+	MUX_RETRY,		/* waiting to retry a refused connection */
+	MUX_CONNECT,		/* non-blocking connect in progress */
+	MUX_SEND,		/* sending length prefix and message */
+	MUX_RECV_LEN,		/* reading response length prefix */
+	MUX_RECV,		/* reading response */
+	MUX_DONE		/* done() called, to be freed */
+} mux_state_t;
+
+typedef struct mux_conn {
+	agent_mux_rpc_t *rpc;
+	mux_state_t state;
+	int fd;
+	int retry_cnt;		/* refused connections retried */
+	uint32_t len;		/* length prefix, network byte order */
+	uint32_t xfer;		/* bytes of current phase transferred */
+	char *data;		/* response being read */
+	uint64_t start;		/* msec, time submitted */
+	uint64_t deadline;	/* msec, end of current phase */
+} mux_conn_t;
+
+static pthread_mutex_t mux_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t mux_thread = 0;
+static int mux_wake_fd[2] = { -1, -1 };
+static List mux_submit_list = NULL;	/* mux_conn_t not yet seen by engine */
+static bool mux_shutdown = false;
+
+/* Engine thread private state */
+static List mux_queue = NULL;		/* mux_conn_t waiting to connect */
+static mux_conn_t **mux_conns = NULL;	/* connections open or retrying */
+static int mux_conn_cnt = 0;
+static int mux_conn_size = 0;
+static int mux_open_cnt = 0;		/* connections with open sockets */
+static int mux_msg_timeout = 0;		/* msec */
+static int mux_tcp_timeout = 0;		/* msec */
+
+/* Statistics, protected by mux_mutex */
+static uint32_t stat_active = 0;	/* RPCs with open connections */
+static uint32_t stat_queued = 0;	/* RPCs waiting or retrying */
+static uint32_t stat_max = 0;		/* maximum of stat_active */
+static uint32_t stat_cnt = 0;		/* RPCs completed */
+static uint32_t stat_fail = 0;		/* RPCs failed, including timeouts */
+static uint32_t stat_timeout = 0;	/* RPCs timed out */
+static uint32_t stat_retry = 0;		/* refused connections retried */
+static uint32_t stat_hist[AGENT_MUX_HIST_SIZE];
+
+static uint64_t _now_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/* Wake the engine thread, call with mux_mutex locked */
+static void _wake_engine(void)
+{
+	char c = '\0';
+
+	if ((write(mux_wake_fd[1], &c, 1) < 0) &&
+	    (errno != EAGAIN) && (errno != EINTR))
+		error("%s: write: %m", __func__);
+}
+
+/* Close a connection's socket, if open */
+static void _conn_close(mux_conn_t *conn)
+{
+	if (conn->fd < 0)
+		return;
+	(void) close(conn->fd);
+	conn->fd = -1;
+	mux_open_cnt--;
+}
+
+/* Complete an RPC, record its statistics and notify its owner */
+static void _conn_done(mux_conn_t *conn, int rc)
+{
+	agent_mux_rpc_t *rpc = conn->rpc;
+	uint64_t msec = _now_msec() - conn->start;
+	int i;
+
+	_conn_close(conn);
+	xfree(conn->data);
+	if (rpc->buffer) {
+		free_buf(rpc->buffer);
+		rpc->buffer = NULL;
+	}
+	conn->state = MUX_DONE;
+
+	for (i = 0; (i < (AGENT_MUX_HIST_SIZE - 1)) && (msec >= (1 << i)); i++)
+		;
+	slurm_mutex_lock(&mux_mutex);
+	stat_cnt++;
+	stat_hist[i]++;
+	if (rc != SLURM_SUCCESS)
+		stat_fail++;
+	if (rc == SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT)
+		stat_timeout++;
+	slurm_mutex_unlock(&mux_mutex);
+
+	rpc->rc = rc;
+	rpc->done(rpc);
+}
+
+/* Add a connection to the set polled by the engine */
+static void _conn_add(mux_conn_t *conn)
+{
+	if (mux_conn_cnt >= mux_conn_size) {
+		mux_conn_size = MAX(64, mux_conn_size * 2);
+		xrealloc(mux_conns, sizeof(mux_conn_t *) * mux_conn_size);
+	}
+	mux_conns[mux_conn_cnt++] = conn;
+}
+
+/* Handle a failed connection attempt, retrying it later if refused */
+static void _conn_failed(mux_conn_t *conn, int err, uint64_t now)
+{
+	char addr_str[32];
+
+	_conn_close(conn);
+	if ((err == ECONNREFUSED) &&
+	    (conn->retry_cnt < conn->rpc->conn_retry)) {
+		if (conn->retry_cnt++ == 0)
+			debug3("connect refused, retrying");
+		conn->state = MUX_RETRY;
+		conn->deadline = now + 1000;
+		slurm_mutex_lock(&mux_mutex);
+		stat_retry++;
+		slurm_mutex_unlock(&mux_mutex);
+		return;
+	}
+
+	slurm_print_slurm_addr(&conn->rpc->addr, addr_str, sizeof(addr_str));
+	debug2("%s: connect to %s: %s", __func__, addr_str, strerror(err));
+	_conn_done(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+}
+
+/* Start a non-blocking connection */
+static void _conn_start(mux_conn_t *conn, uint64_t now)
+{
+	agent_mux_rpc_t *rpc = conn->rpc;
+	int rc;
+
+	conn->fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (conn->fd < 0) {
+		error("%s: socket: %m", __func__);
+		_conn_done(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+	mux_open_cnt++;
+	fd_set_nonblocking(conn->fd);
+	fd_set_close_on_exec(conn->fd);
+
+	conn->len = htonl(get_buf_offset(rpc->buffer));
+	conn->xfer = 0;
+	rc = connect(conn->fd, (struct sockaddr *) &rpc->addr,
+		     sizeof(rpc->addr));
+	if (rc == 0) {
+		conn->state = MUX_SEND;
+		conn->deadline = now + mux_msg_timeout;
+	} else if (errno == EINPROGRESS) {
+		conn->state = MUX_CONNECT;
+		conn->deadline = now + mux_tcp_timeout;
+	} else
+		_conn_failed(conn, errno, now);
+}
+
+/* Return the time by which a connection needs attention. A retry which is
+ * due but has not started is waiting for a free connection. */
+static uint64_t _conn_deadline(mux_conn_t *conn, uint64_t now)
+{
+	if ((conn->state == MUX_RETRY) && (conn->deadline <= now))
+		return conn->deadline + mux_msg_timeout;
+	return conn->deadline;
+}
+
+/* Start queued RPCs and connection retries while connections are free,
+ * then fail queued RPCs which have waited too long */
+static void _start_queued(uint64_t now)
+{
+	mux_conn_t *conn;
+	int i;
+
+	for (i = 0; (i < mux_conn_cnt) &&
+		    (mux_open_cnt < AGENT_MUX_MAX_CONN); i++) {
+		conn = mux_conns[i];
+		if ((conn->state == MUX_RETRY) && (conn->deadline <= now))
+			_conn_start(conn, now);
+	}
+	while ((mux_open_cnt < AGENT_MUX_MAX_CONN) &&
+	       (conn = list_dequeue(mux_queue))) {
+		_conn_add(conn);
+		_conn_start(conn, now);
+	}
+	while ((conn = list_peek(mux_queue)) &&
+	       ((conn->start + mux_msg_timeout) <= now)) {
+		(void) list_dequeue(mux_queue);
+		_conn_done(conn, SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+		xfree(conn);
+	}
+}
+
+/* Send as much of the length prefix and message as the socket will take */
+static void _conn_send(mux_conn_t *conn, uint64_t now)
+{
+	agent_mux_rpc_t *rpc = conn->rpc;
+	uint32_t size = get_buf_offset(rpc->buffer);
+	struct iovec iov[2];
+	struct msghdr msg;
+	ssize_t n;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	if (conn->xfer < sizeof(conn->len)) {
+		iov[0].iov_base = (char *) &conn->len + conn->xfer;
+		iov[0].iov_len  = sizeof(conn->len) - conn->xfer;
+		iov[1].iov_base = get_buf_data(rpc->buffer);
+		iov[1].iov_len  = size;
+		msg.msg_iovlen = 2;
+	} else {
+		iov[0].iov_base = get_buf_data(rpc->buffer) +
+				  (conn->xfer - sizeof(conn->len));
+		iov[0].iov_len  = size - (conn->xfer - sizeof(conn->len));
+		msg.msg_iovlen = 1;
+	}
+
+	n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+	if (n < 0) {
+		if ((errno == EAGAIN) || (errno == EINTR))
+			return;
+		debug2("%s: sendmsg: %m", __func__);
+		_conn_done(conn, SLURM_COMMUNICATIONS_SEND_ERROR);
+		return;
+	}
+	conn->xfer += n;
+	if (conn->xfer < (sizeof(conn->len) + size))
+		return;
+
+	if (!rpc->get_reply) {
+		_conn_done(conn, SLURM_SUCCESS);
+		return;
+	}
+	conn->state = MUX_RECV_LEN;
+	conn->xfer = 0;
+	conn->deadline = now + (rpc->timeout > 0 ? rpc->timeout :
+				mux_msg_timeout);
+}
+
+/* Read as much of the response length prefix and body as is available */
+static void _conn_recv(mux_conn_t *conn)
+{
+	char *ptr;
+	uint32_t want;
+	ssize_t n;
+
+	if (conn->state == MUX_RECV_LEN) {
+		ptr  = (char *) &conn->len + conn->xfer;
+		want = sizeof(conn->len) - conn->xfer;
+	} else {
+		ptr  = conn->data + conn->xfer;
+		want = conn->len - conn->xfer;
+	}
+
+	n = read(conn->fd, ptr, want);
+	if (n < 0) {
+		if ((errno == EAGAIN) || (errno == EINTR))
+			return;
+		debug2("%s: read: %m", __func__);
+		_conn_done(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+		return;
+	} else if (n == 0) {
+		debug2("%s: connection closed by peer", __func__);
+		_conn_done(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+		return;
+	}
+	conn->xfer += n;
+	if (n < (ssize_t) want)
+		return;
+
+	if (conn->state == MUX_RECV_LEN) {
+		conn->len = ntohl(conn->len);
+		if ((conn->len == 0) || (conn->len > AGENT_MUX_MAX_MSG)) {
+			error("%s: invalid message length %u",
+			      __func__, conn->len);
+			_conn_done(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+			return;
+		}
+		conn->data = xmalloc_nz(conn->len);
+		conn->xfer = 0;
+		conn->state = MUX_RECV;
+		return;
+	}
+
+	conn->rpc->reply = create_buf(conn->data, conn->len);
+	conn->data = NULL;
+	_conn_done(conn, SLURM_SUCCESS);
+}
+
+/* Advance a connection for which poll() reported events */
+static void _conn_io(mux_conn_t *conn, short revents, uint64_t now)
+{
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	switch (conn->state) {
+	case MUX_CONNECT:
+		if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+			err = errno;
+		if (err) {
+			_conn_failed(conn, err, now);
+			return;
+		}
+		conn->state = MUX_SEND;
+		conn->deadline = now + mux_msg_timeout;
+		/* fall through */
+	case MUX_SEND:
+		_conn_send(conn, now);
+		break;
+	case MUX_RECV_LEN:
+	case MUX_RECV:
+		if (revents & (POLLIN | POLLHUP | POLLERR))
+			_conn_recv(conn);
+		break;
+	default:
+		break;
+	}
+}
+
+static short _conn_events(mux_conn_t *conn)
+{
+	switch (conn->state) {
+	case MUX_CONNECT:
+	case MUX_SEND:
+		return POLLOUT;
+	case MUX_RECV_LEN:
+	case MUX_RECV:
+		return POLLIN;
+	default:
+		return 0;
+	}
+}
+
+/* Fail every RPC known to the engine, on shutdown */
+static void _fail_all(void)
+{
+	mux_conn_t *conn;
+	int i;
+
+	for (i = 0; i < mux_conn_cnt; i++) {
+		if (mux_conns[i]->state != MUX_DONE)
+			_conn_done(mux_conns[i],
+				   SLURM_COMMUNICATIONS_SHUTDOWN_ERROR);
+		xfree(mux_conns[i]);
+	}
+	mux_conn_cnt = 0;
+	while ((conn = list_dequeue(mux_queue))) {
+		_conn_done(conn, SLURM_COMMUNICATIONS_SHUTDOWN_ERROR);
+		xfree(conn);
+	}
+}
+
+static void *_mux_engine(void *arg)
+{
+	struct pollfd *pfds = NULL;
+	int pfd_size = 0;
+	mux_conn_t *conn;
+	uint64_t now, next;
+	int i, j, poll_msec;
+	char buf[64];
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "agent_mux", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "agent_mux");
+	}
+#endif
+	mux_queue = list_create(NULL);
+
+	while (1) {
+		mux_msg_timeout = slurm_get_msg_timeout() * 1000;
+		mux_tcp_timeout = slurm_get_tcp_timeout() * 1000;
+
+		slurm_mutex_lock(&mux_mutex);
+		list_transfer(mux_queue, mux_submit_list);
+		if (mux_shutdown) {
+			slurm_mutex_unlock(&mux_mutex);
+			break;
+		}
+		slurm_mutex_unlock(&mux_mutex);
+
+		now = _now_msec();
+		_start_queued(now);
+
+		/*
+		 * Drop completed connections, find the next deadline. RPCs
+		 * still waiting here can not start until a connection closes,
+		 * so only their limits on waiting count.
+		 */
+		next = now + AGENT_MUX_MAX_POLL;
+		for (i = 0, j = 0; i < mux_conn_cnt; i++) {
+			conn = mux_conns[i];
+			if (conn->state == MUX_DONE) {
+				xfree(conn);
+				continue;
+			}
+			if (_conn_deadline(conn, now) < next)
+				next = _conn_deadline(conn, now);
+			mux_conns[j++] = conn;
+		}
+		mux_conn_cnt = j;
+		if ((conn = list_peek(mux_queue)) &&
+		    ((conn->start + mux_msg_timeout) < next))
+			next = conn->start + mux_msg_timeout;
+
+		slurm_mutex_lock(&mux_mutex);
+		stat_active = mux_open_cnt;
+		stat_queued = list_count(mux_queue) + mux_conn_cnt -
+			      mux_open_cnt;
+		if (stat_active > stat_max)
+			stat_max = stat_active;
+		slurm_mutex_unlock(&mux_mutex);
+
+		if (pfd_size < (mux_conn_cnt + 1)) {
+			pfd_size = mux_conn_cnt + 64;
+			xrealloc(pfds, sizeof(struct pollfd) * pfd_size);
+		}
+		pfds[0].fd = mux_wake_fd[0];
+		pfds[0].events = POLLIN;
+		for (i = 0; i < mux_conn_cnt; i++) {
+			pfds[i + 1].fd = mux_conns[i]->fd;
+			pfds[i + 1].events = _conn_events(mux_conns[i]);
+			pfds[i + 1].revents = 0;
+		}
+		if (!mux_conn_cnt)
+			poll_msec = -1;
+		else if (next <= now)
+			poll_msec = 0;
+		else
+			poll_msec = next - now;
+
+		if (poll(pfds, mux_conn_cnt + 1, poll_msec) < 0) {
+			if (errno != EINTR)
+				error("%s: poll: %m", __func__);
+			continue;
+		}
+		if (pfds[0].revents & POLLIN) {
+			while (read(mux_wake_fd[0], buf, sizeof(buf)) > 0)
+				;
+		}
+
+		now = _now_msec();
+		for (i = 0; i < mux_conn_cnt; i++) {
+			conn = mux_conns[i];
+			if (pfds[i + 1].revents)
+				_conn_io(conn, pfds[i + 1].revents, now);
+			if ((conn->state == MUX_DONE) ||
+			    (_conn_deadline(conn, now) > now))
+				continue;
+			if (conn->state == MUX_CONNECT)
+				_conn_failed(conn, ETIMEDOUT, now);
+			else
+				_conn_done(conn,
+					   SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+		}
+	}
+
+	_fail_all();
+	xfree(pfds);
+	xfree(mux_conns);
+	mux_conn_size = 0;
+	FREE_NULL_LIST(mux_queue);
+
+	return NULL;
+}
+
+/* Start the engine thread, call with mux_mutex locked */
+static void _start_engine(void)
+{
+	pthread_attr_t attr;
+
+	if (pipe(mux_wake_fd) < 0)
+		fatal("%s: pipe: %m", __func__);
+	fd_set_nonblocking(mux_wake_fd[0]);
+	fd_set_nonblocking(mux_wake_fd[1]);
+	fd_set_close_on_exec(mux_wake_fd[0]);
+	fd_set_close_on_exec(mux_wake_fd[1]);
+	mux_submit_list = list_create(NULL);
+
+	slurm_attr_init(&attr);
+	if (pthread_create(&mux_thread, &attr, _mux_engine, NULL))
+		fatal("%s: pthread_create: %m", __func__);
+	slurm_attr_destroy(&attr);
+}
+
+/*
+ * agent_mux_send - queue an RPC for transmission, starting the engine thread
+ *	if needed
+ */
+extern void agent_mux_send(agent_mux_rpc_t *rpc)
+{
+	mux_conn_t *conn;
+
+	xassert(rpc->buffer);
+	xassert(rpc->done);
+
+	rpc->rc = SLURM_SUCCESS;
+	rpc->reply = NULL;
+	conn = xmalloc(sizeof(mux_conn_t));
+	conn->rpc = rpc;
+	conn->state = MUX_QUEUED;
+	conn->fd = -1;
+	conn->start = _now_msec();
+
+	slurm_mutex_lock(&mux_mutex);
+	if (mux_shutdown) {
+		slurm_mutex_unlock(&mux_mutex);
+		_conn_done(conn, SLURM_COMMUNICATIONS_SHUTDOWN_ERROR);
+		xfree(conn);
+		return;
+	}
+	if (!mux_thread)
+		_start_engine();
+	list_append(mux_submit_list, conn);
+	_wake_engine();
+	slurm_mutex_unlock(&mux_mutex);
+}
+
+/* agent_mux_fini - stop the engine thread, failing any RPCs in progress */
+extern void agent_mux_fini(void)
+{
+	mux_conn_t *conn;
+	pthread_t thread;
+
+	slurm_mutex_lock(&mux_mutex);
+	mux_shutdown = true;
+	thread = mux_thread;
+	if (thread)
+		_wake_engine();
+	slurm_mutex_unlock(&mux_mutex);
+	if (!thread)
+		return;
+
+	pthread_join(thread, NULL);
+
+	while ((conn = list_dequeue(mux_submit_list))) {
+		_conn_done(conn, SLURM_COMMUNICATIONS_SHUTDOWN_ERROR);
+		xfree(conn);
+	}
+	FREE_NULL_LIST(mux_submit_list);
+	(void) close(mux_wake_fd[0]);
+	(void) close(mux_wake_fd[1]);
+	mux_wake_fd[0] = mux_wake_fd[1] = -1;
+}
+
+/* agent_mux_pack_stats - pack engine statistics, as reported by sdiag */
+extern void agent_mux_pack_stats(Buf buffer, uint16_t protocol_version)
+{
+	slurm_mutex_lock(&mux_mutex);
+	pack32(stat_active,  buffer);
+	pack32(stat_queued,  buffer);
+	pack32(stat_max,     buffer);
+	pack32(stat_cnt,     buffer);
+	pack32(stat_fail,    buffer);
+	pack32(stat_timeout, buffer);
+	pack32(stat_retry,   buffer);
+	pack32_array(stat_hist, AGENT_MUX_HIST_SIZE, buffer);
+	slurm_mutex_unlock(&mux_mutex);
+}
+
+/* agent_mux_reset_stats - clear engine statistics */
+extern void agent_mux_reset_stats(void)
+{
+	slurm_mutex_lock(&mux_mutex);
+	stat_max = stat_active;
+	stat_cnt = 0;
+	stat_fail = 0;
+	stat_timeout = 0;
+	stat_retry = 0;
+	memset(stat_hist, 0, sizeof(stat_hist));
+	slurm_mutex_unlock(&mux_mutex);
+}
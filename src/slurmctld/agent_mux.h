@@ -0,0 +1,84 @@
+/*****************************************************************************\
+ *  agent_mux.h - event driven engine for outbound slurmctld RPCs to nodes
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _AGENT_MUX_H
+#define _AGENT_MUX_H
+
+#include <stdbool.h>
+
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_defs.h"
+
+/* Latency histogram buckets: bucket i counts RPCs taking under 2^i msec,
+ * the last bucket counts all slower RPCs */
+#define AGENT_MUX_HIST_SIZE	16
+
+typedef struct agent_mux_rpc {
+	/* Set by the caller */
+	slurm_addr_t addr;		/* node to send to */
+	Buf buffer;			/* message from slurm_pack_node_msg(),
+					 * freed by the engine */
+	bool get_reply;			/* wait for a response */
+	int timeout;			/* msec to wait for the response */
+	int conn_retry;			/* seconds to retry refused
+					 * connections */
+	void (*done)(struct agent_mux_rpc *rpc); /* called by the engine
+					 * thread on completion */
+	void *arg;			/* for use by done() */
+
+	/* Set by the engine before calling done() */
+	int rc;				/* SLURM_SUCCESS or error number */
+	Buf reply;			/* response, without its length prefix,
+					 * to be freed by done() */
+} agent_mux_rpc_t;
+
+/*
+ * agent_mux_send - queue an RPC for transmission, starting the engine thread
+ *	if needed. The RPC is sent once fewer than AGENT_MUX_MAX_CONN others
+ *	are in progress, and times out if that takes MessageTimeout.
+ *	rpc->done() is called on completion, success or not, and must not
+ *	block.
+ * IN rpc - request, which must remain valid until rpc->done() is called
+ */
+extern void agent_mux_send(agent_mux_rpc_t *rpc);
+
+/* agent_mux_fini - stop the engine thread, failing any RPCs in progress */
+extern void agent_mux_fini(void);
+
+/* agent_mux_pack_stats - pack engine statistics, as reported by sdiag */
+extern void agent_mux_pack_stats(Buf buffer, uint16_t protocol_version);
+
+/* agent_mux_reset_stats - clear engine statistics */
+extern void agent_mux_reset_stats(void);
+
+#endif /* !_AGENT_MUX_H */
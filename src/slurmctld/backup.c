@@ -219,10 +219,12 @@ void run_backup(slurm_trigger_callbacks_t *callbacks)
 	lock_slurmctld(config_write_lock);
 	if (switch_g_restore(slurmctld_conf.state_save_location, true)) {
 		error("failed to restore switch state");
+		log_flush();
 		abort();
 	}
 	if (read_slurm_conf(2, false)) {	/* Recover all state */
 		error("Unable to recover slurm state");
+		log_flush();
 		abort();
 	}
 	slurmctld_config.shutdown_time = (time_t) 0;
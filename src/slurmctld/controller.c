@@ -44,6 +44,10 @@
 #  include <sys/prctl.h>
 #endif
 
+#if HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
 #include <errno.h>
 #include <grp.h>
 #include <pthread.h>
@@ -53,6 +57,7 @@
 #include <string.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include "slurm/slurm_errno.h"
@@ -64,6 +69,7 @@
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
 #include "src/common/layouts_mgr.h"
+#include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/node_features.h"
@@ -92,6 +98,7 @@
 
 #include "src/slurmctld/acct_policy.h"
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/agent_mux.h"
 #include "src/slurmctld/burst_buffer.h"
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
@@ -194,6 +201,19 @@ static pthread_cond_t server_thread_cond = PTHREAD_COND_INITIALIZER;
 static pid_t	slurmctld_pid;
 static char *	slurm_conf_filename;
 
+/* RPC worker pool. Connections accepted by _slurmctld_rpc_mgr() are queued
+ * on rpc_queue and serviced by up to rpc_worker_cnt persistent threads,
+ * which are started on demand and then reused rather than being created
+ * and destroyed for each RPC. */
+static List	rpc_queue = NULL;
+static pthread_mutex_t rpc_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rpc_queue_cond = PTHREAD_COND_INITIALIZER;
+static time_t	rpc_conf_update = (time_t) 0;
+static bool	rpc_queue_shutdown = false;
+static int	rpc_worker_alive = 0;	/* worker threads now running */
+static int	rpc_worker_cnt = MAX_SERVER_THREADS; /* worker thread limit */
+static int	rpc_worker_idle = 0;	/* workers waiting for work */
+
 /*
  * Static list of signals to block in this process
  * *Must be zero-terminated*
@@ -222,6 +242,10 @@ static int          _init_tres(void);
 static void         _update_cluster_tres(void);
 
 inline static int   _report_locks_set(void);
+static void         _rpc_queue_add(connection_arg_t *conn_arg);
+static void         _rpc_queue_fini(void);
+static void         _rpc_queue_init(void);
+static void *       _rpc_worker(void *no_data);
 static void *       _service_connection(void *arg);
 static void         _set_work_dir(void);
 static int          _shutdown_backup_controller(int wait_time);
@@ -401,6 +425,9 @@ int main(int argc, char *argv[])
 		fatal("slurm_cred_creator_ctx_create(%s): %m",
 			slurmctld_conf.job_credential_private_key);
 	}
+	/* Sign credentials outside of the job write lock */
+	slurm_cred_ctx_set(slurmctld_config.cred_ctx,
+			   SLURM_CRED_OPT_SIGN_ASYNC, 1);
 
 	/* Must set before plugins are loaded. */
 	if (slurmctld_conf.backup_controller &&
@@ -680,6 +707,7 @@ int main(int argc, char *argv[])
 	}
 	if (cnt)
 		error("Left %d agent threads active", cnt);
+	agent_mux_fini();	/* Fails any RPCs still in progress */
 
 	slurm_sched_fini();	/* Stop all scheduling */
 
@@ -925,11 +953,14 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	slurm_addr_t cli_addr, srv_addr;
 	uint16_t port;
 	char ip[32];
-	pthread_t thread_id_rpc_req;
-	pthread_attr_t thread_attr_rpc_req;
-	int no_thread;
-	int fd_next = 0, i, nports;
+	int i, nports;
+#if HAVE_SYS_EPOLL_H
+	int epoll_fd, ev_cnt = 0, ev_next = 0;
+	struct epoll_event ev, *events;
+#else
+	int fd_next = 0;
 	fd_set rfds;
+#endif
 	connection_arg_t *conn_arg = NULL;
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
@@ -947,11 +978,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 	debug3("_slurmctld_rpc_mgr pid = %u", getpid());
 
-	/* threads to process individual RPC's are detached */
-	slurm_attr_init(&thread_attr_rpc_req);
-	if (pthread_attr_setdetachstate
-	    (&thread_attr_rpc_req, PTHREAD_CREATE_DETACHED))
-		fatal("pthread_attr_setdetachstate %m");
+	_rpc_queue_init();
 
 	/* set node_addr to bind to (NULL means any) */
 	if (slurmctld_conf.backup_controller && slurmctld_conf.backup_addr &&
@@ -990,6 +1017,22 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	}
 	unlock_slurmctld(config_read_lock);
 
+#if HAVE_SYS_EPOLL_H
+	/* Register the listening sockets once rather than rebuilding the
+	 * descriptor set for every connection accepted */
+	if ((epoll_fd = epoll_create(nports)) < 0)
+		fatal("epoll_create: %m");
+	fd_set_close_on_exec(epoll_fd);
+	events = xmalloc(sizeof(struct epoll_event) * nports);
+	for (i = 0; i < nports; i++) {
+		memset(&ev, 0, sizeof(struct epoll_event));
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockfd[i], &ev) < 0)
+			fatal("epoll_ctl(%d): %m", sockfd[i]);
+	}
+#endif
+
 	/* Prepare to catch SIGUSR1 to interrupt accept().
 	 * This signal is generated by the slurmctld signal
 	 * handler thread upon receipt of SIGABRT, SIGINT,
@@ -1002,6 +1045,22 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	 * Process incoming RPCs until told to shutdown
 	 */
 	while (_wait_for_server_thread()) {
+#if HAVE_SYS_EPOLL_H
+		/* Work through every port reported ready by the last
+		 * epoll_wait() before waiting again */
+		if (ev_next >= ev_cnt) {
+			ev_next = 0;
+			ev_cnt = epoll_wait(epoll_fd, events, nports, -1);
+			if (ev_cnt <= 0) {
+				if ((ev_cnt < 0) && (errno != EINTR))
+					error("slurm_accept_msg_conn epoll_wait: %m");
+				ev_cnt = 0;
+				server_thread_decr();
+				continue;
+			}
+		}
+		i = events[ev_next++].data.u32;
+#else
 		int max_fd = -1;
 		FD_ZERO(&rfds);
 		for (i=0; i<nports; i++) {
@@ -1022,6 +1081,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 			}
 		}
 		fd_next = (i + 1) % nports;
+#endif
 
 		/*
 		 * accept needed for stream implementation is a no-op in
@@ -1049,28 +1109,22 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 			info("%s: accept() connection from %s", __func__, inetbuf);
 		}
 
-		if (slurmctld_config.shutdown_time)
-			no_thread = 1;
-		else if (pthread_create(&thread_id_rpc_req,
-					&thread_attr_rpc_req,
-					_service_connection,
-					(void *) conn_arg)) {
-			error("pthread_create: %m");
-			no_thread = 1;
-		} else
-			no_thread = 0;
-
-		if (no_thread) {
+		if (slurmctld_config.shutdown_time) {
 			slurmctld_diag_stats.proc_req_raw++;
-		       	_service_connection((void *) conn_arg);
-	       	}
+			_service_connection((void *) conn_arg);
+		} else
+			_rpc_queue_add(conn_arg);
 	}
 
 	debug3("_slurmctld_rpc_mgr shutting down");
-	slurm_attr_destroy(&thread_attr_rpc_req);
+#if HAVE_SYS_EPOLL_H
+	(void) close(epoll_fd);
+	xfree(events);
+#endif
 	for (i=0; i<nports; i++)
 		(void) slurm_shutdown_msg_engine(sockfd[i]);
 	xfree(sockfd);
+	_rpc_queue_fini();
 	server_thread_decr();
 	pthread_exit((void *) 0);
 	return NULL;
@@ -1088,11 +1142,6 @@ static void *_service_connection(void *arg)
 	void *return_code = NULL;
 	slurm_msg_t msg;
 
-#if HAVE_SYS_PRCTL_H
-	if (prctl(PR_SET_NAME, "srvcn", NULL, NULL, NULL) < 0) {
-		error("%s: cannot set my name to %s %m", __func__, "srvcn");
-	}
-#endif
 	slurm_msg_t_init(&msg);
 	msg.flags |= SLURM_MSG_KEEP_BUFFER;
 	/*
@@ -1131,6 +1180,177 @@ cleanup:
 	return return_code;
 }
 
+/* Read the RPC worker thread limit from SchedulerParameters=rpc_worker_cnt
+ * if the configuration has changed since it was last read.
+ * Call with rpc_queue_mutex locked. */
+static void _rpc_worker_cnt_update(void)
+{
+	char *sched_params, *tmp_ptr;
+	int cnt = max_server_threads;
+
+	if (rpc_conf_update == slurmctld_conf.last_update)
+		return;
+	rpc_conf_update = slurmctld_conf.last_update;
+
+	sched_params = slurm_get_sched_params();
+	if (sched_params &&
+	    (tmp_ptr = strstr(sched_params, "rpc_worker_cnt="))) {
+		cnt = atoi(tmp_ptr + 15);
+		if ((cnt < 1) || (cnt > max_server_threads)) {
+			error("Invalid SchedulerParameters rpc_worker_cnt: %d",
+			      cnt);
+			cnt = max_server_threads;
+		}
+	}
+	xfree(sched_params);
+
+	if (cnt != rpc_worker_cnt) {
+		debug("%s: RPC worker thread limit changed from %d to %d",
+		      __func__, rpc_worker_cnt, cnt);
+		rpc_worker_cnt = cnt;
+		/* Let excess idle workers exit */
+		slurm_cond_broadcast(&rpc_queue_cond);
+	}
+}
+
+/* Prepare the RPC worker pool for use by a new _slurmctld_rpc_mgr() */
+static void _rpc_queue_init(void)
+{
+	slurm_mutex_lock(&rpc_queue_mutex);
+	if (!rpc_queue)
+		rpc_queue = list_create(NULL);
+	rpc_queue_shutdown = false;
+	rpc_conf_update = (time_t) 0;
+	_rpc_worker_cnt_update();
+	slurmctld_diag_stats.rpc_worker_cnt = rpc_worker_cnt;
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+/* Tell the RPC workers to exit once the queue has been drained and give
+ * them up to CONTROL_TIMEOUT seconds to do so. Workers still running after
+ * that are inside an RPC, possibly holding slurmctld locks, so they are not
+ * cancelled. rpc_queue is kept for them rather than freed. A later
+ * _rpc_queue_init() reuses it and counts them as part of the new pool,
+ * otherwise it is released when the process exits. */
+static void _rpc_queue_fini(void)
+{
+	struct timespec ts = {0, 0};
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	ts.tv_sec = now.tv_sec + CONTROL_TIMEOUT;
+	ts.tv_nsec = now.tv_usec * 1000;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	rpc_queue_shutdown = true;
+	slurm_cond_broadcast(&rpc_queue_cond);
+	while ((rpc_worker_alive > 0) && (time(NULL) < ts.tv_sec)) {
+		slurm_cond_timedwait(&rpc_queue_cond, &rpc_queue_mutex, &ts);
+	}
+	if (rpc_worker_alive) {
+		info("shutdown rpc_worker_alive=%d, keeping their queue",
+		     rpc_worker_alive);
+	} else
+		FREE_NULL_LIST(rpc_queue);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+/* Queue an accepted connection for service by the RPC worker pool, starting
+ * another worker if none are idle and the pool is not yet full */
+static void _rpc_queue_add(connection_arg_t *conn_arg)
+{
+	pthread_attr_t thread_attr;
+	pthread_t thread_id;
+	bool new_worker = false;
+
+	gettimeofday(&conn_arg->queue_time, NULL);
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	_rpc_worker_cnt_update();
+	list_enqueue(rpc_queue, conn_arg);
+	conn_arg->queue_depth = list_count(rpc_queue);
+	slurmctld_diag_stats.rpc_queue_len = conn_arg->queue_depth;
+	if (conn_arg->queue_depth > slurmctld_diag_stats.rpc_queue_max)
+		slurmctld_diag_stats.rpc_queue_max = conn_arg->queue_depth;
+	if ((rpc_worker_idle < conn_arg->queue_depth) &&
+	    (rpc_worker_alive < rpc_worker_cnt)) {
+		rpc_worker_alive++;
+		new_worker = true;
+	}
+	slurmctld_diag_stats.rpc_worker_cnt = rpc_worker_alive;
+	slurm_cond_signal(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	if (!new_worker)
+		return;
+
+	slurm_attr_init(&thread_attr);
+	if (pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED))
+		fatal("pthread_attr_setdetachstate %m");
+	if (pthread_create(&thread_id, &thread_attr, _rpc_worker, NULL)) {
+		error("pthread_create: %m");
+		slurm_mutex_lock(&rpc_queue_mutex);
+		rpc_worker_alive--;
+		slurmctld_diag_stats.rpc_worker_cnt = rpc_worker_alive;
+		/* With no worker to pick it up, service the RPC here */
+		if (rpc_worker_alive == 0)
+			conn_arg = list_dequeue(rpc_queue);
+		else
+			conn_arg = NULL;
+		slurm_mutex_unlock(&rpc_queue_mutex);
+		if (conn_arg) {
+			slurmctld_diag_stats.proc_req_raw++;
+			_service_connection((void *) conn_arg);
+		}
+	}
+	slurm_attr_destroy(&thread_attr);
+}
+
+/* _rpc_worker - Service queued connections until told to shutdown or the
+ *	worker thread limit is reduced */
+static void *_rpc_worker(void *no_data)
+{
+	connection_arg_t *conn_arg;
+	struct timeval now;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "srvcn", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "srvcn");
+	}
+#endif
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	while (1) {
+		if ((conn_arg = list_dequeue(rpc_queue))) {
+			slurmctld_diag_stats.rpc_queue_len =
+				list_count(rpc_queue);
+			slurm_mutex_unlock(&rpc_queue_mutex);
+
+			gettimeofday(&now, NULL);
+			conn_arg->queue_wait =
+				(now.tv_sec - conn_arg->queue_time.tv_sec) *
+				1000000 +
+				(now.tv_usec - conn_arg->queue_time.tv_usec);
+			slurmctld_diag_stats.proc_req_threads++;
+			_service_connection((void *) conn_arg);
+
+			slurm_mutex_lock(&rpc_queue_mutex);
+			continue;
+		}
+		if (rpc_queue_shutdown || (rpc_worker_alive > rpc_worker_cnt))
+			break;
+		rpc_worker_idle++;
+		slurm_cond_wait(&rpc_queue_cond, &rpc_queue_mutex);
+		rpc_worker_idle--;
+	}
+	rpc_worker_alive--;
+	slurmctld_diag_stats.rpc_worker_cnt = rpc_worker_alive;
+	slurm_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	return NULL;
+}
+
 /* Increment slurmctld_config.server_thread_count and don't return
  * until its value is no larger than MAX_SERVER_THREADS,
  * RET true unless shutdown in progress */
@@ -2517,6 +2737,8 @@ void update_logging(void)
 			log_opts.syslog_level = LOG_LEVEL_FATAL;
 	} else
 		log_opts.syslog_level = LOG_LEVEL_QUIET;
+	/* RPC threads queue messages, a writer thread writes the log files */
+	log_opts.async = 1;
 
 	log_alter(log_opts, SYSLOG_FACILITY_DAEMON,
 		  slurmctld_conf.slurmctld_logfile);
@@ -710,7 +710,7 @@ extern int dump_all_front_end_state(void)
 	unlock_slurmctld (node_read_lock);
 
 	/* write the buffer to file */
-	lock_state_files();
+	lock_state_files_shared();
 	log_fd = creat (new_file, 0600);
 	if (log_fd < 0) {
 		error ("Can't save state, error creating file %s %m", new_file);
@@ -730,7 +730,7 @@ extern int dump_all_front_end_state(void)
 			pos    += amount;
 		}
 
-		rc = fsync_and_close(log_fd, "front_end");
+		rc = state_file_sync_close(log_fd, "front_end", pos);
 		if (rc && !error_code)
 			error_code = rc;
 	}
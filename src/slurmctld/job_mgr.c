@@ -67,6 +67,7 @@
 #include "src/common/forward.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_hash.h"
 #include "src/common/node_features.h"
 #include "src/common/node_select.h"
 #include "src/common/parse_time.h"
@@ -110,9 +111,6 @@
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 #define ONE_YEAR	(365 * 24 * 60 * 60)
 
-#define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
-#define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
-	((_job_id + _task_id) % hash_table_size)
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define JOB_STATE_VERSION       "PROTOCOL_VERSION"
@@ -126,26 +124,89 @@ typedef struct {
 	bitstr_t **resp_array_task_id;
 } resp_array_struct_t;
 
+/* Sorted set of job IDs, see _list_find_job_set() */
+typedef struct {
+	uint32_t cnt;
+	uint32_t *job_ids;
+} job_id_set_t;
+
+/* Job state journal record being built by _dump_job_journal_rec() */
+typedef struct {
+	Buf buffer;
+	uint32_t rec_cnt;
+} job_journal_rec_t;
+
+/* Location of one job's record within a job_info_cache_t buffer */
+typedef struct {
+	time_t change_time;		/* when packed record last changed */
+	uint64_t cksum;			/* checksum of packed record */
+	uint32_t job_id;
+	uint32_t offset;		/* offset of packed record in buffer */
+	uint32_t size;			/* size of packed record */
+	uint32_t user_id;
+} job_info_cache_rec_t;
+
+/* Packed job records for every job visible to an operator, as built by
+ * pack_all_jobs() for one protocol version and set of show_flags. Reused
+ * until the job, partition or configuration records change. */
+typedef struct {
+	Buf buffer;			/* packed job records, no header */
+	time_t cache_time;		/* when packed */
+	time_t delta_time;		/* changes known since this time */
+	time_t full_time;		/* when every record was last packed */
+	bool restricted_parts;		/* any partitions hidden from some users
+				 * when packed */
+	time_t last_conf_update;	/* slurmctld_conf.last_update */
+	time_t last_job_update;		/* last_job_update when packed */
+	time_t last_part_update;	/* last_part_update when packed */
+	uint64_t mod_seq;		/* job_mod_seq when packed */
+	bool private_jobs;		/* PrivateData=jobs when packed */
+	uint16_t protocol_version;
+	uid_t slurm_user_id;		/* SlurmUser when packed */
+	uint32_t purge_cnt;
+	uint32_t *purge_ids;		/* jobs removed since delta_time */
+	time_t *purge_times;		/* when each job was removed */
+	uint32_t rec_cnt;
+	job_info_cache_rec_t *recs;	/* one per job, in job_list order */
+	uint16_t show_flags;
+	Buf spare_buffer;		/* previous buffer, for reuse */
+} job_info_cache_t;
+
 /* Global variables */
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
+uint64_t job_mod_seq = 0;	/* sequence number of last job_modified() */
 
 /* Local variables */
+static uint64_t job_mod_all_seq = 0;	/* job_mod_seq at last
+					 * job_modified_all() */
 static int      bf_min_age_reserve = 0;
 static uint32_t delay_boot = 0;
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
-static struct   job_record **job_array_hash_j = NULL;
-static struct   job_record **job_array_hash_t = NULL;
+static id_hash_t *job_hash = NULL;		/* job_id to job */
+static id_hash_t *job_array_hash_j = NULL;	/* array_job_id to first task */
+static id_hash_t *job_array_hash_t = NULL;	/* array job and task ID to job */
+static job_info_cache_t job_info_cache[JOB_INFO_CACHE_CNT];
+static pthread_mutex_t job_info_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t job_journal_seq = 0;	/* job_id_sequence last journaled */
+static uint64_t job_journal_mod_seq = 0; /* job_mod_seq last journaled */
+static time_t   job_journal_sweep_time = 0; /* last check of every job */
+static uint64_t job_journal_size = 0;	/* size of job_state.journal */
+static bool     job_journal_valid = false; /* journal extends snapshot */
+static uint64_t job_snapshot_size = 0;	/* size of job_state snapshot */
 static bool     kill_invalid_dep;
 static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
+static struct job_record *job_mod_head = NULL;	/* least recently modified */
+static struct job_record *job_mod_tail = NULL;	/* most recently modified */
 static bool	purge_quit = false;
 static struct timeval purge_start_time = {0, 0};
+static uint32_t *purged_job_ids = NULL;	/* jobs purged since last save */
+static uint32_t purged_job_cnt = 0;
+static uint32_t purged_job_size = 0;
 static bitstr_t *requeue_exit = NULL;
 static bitstr_t *requeue_exit_hold = NULL;
 static int	select_serial = -1;
@@ -156,6 +217,7 @@ static bool     wiki_sched_test = false;
 /* Local functions */
 static void _add_job_hash(struct job_record *job_ptr);
 static void _add_job_array_hash(struct job_record *job_ptr);
+static uint64_t _buf_cksum(Buf buffer, uint32_t offset);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
 				    char *image_dir);
 static int  _copy_job_desc_files(uint32_t job_id_src, uint32_t job_id_dest);
@@ -176,23 +238,42 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 	char *resv_name, slurmdb_assoc_rec_t *assoc_ptr,
 	bool admin, slurmdb_qos_rec_t *qos_rec,	int *error_code, bool locked);
 static void _dump_job_details(struct job_details *detail_ptr, Buf buffer);
+static int  _dump_job_journal_rec(void *x, void *arg);
 static void _dump_job_state(struct job_record *dump_job_ptr, Buf buffer);
 static void _free_job_fed_details(job_fed_details_t **fed_details_pptr);
 static void _get_batch_job_dir_ids(List batch_dirs);
 static time_t _get_last_state_write_time(void);
 static void _job_array_comp(struct job_record *job_ptr, bool was_running);
+static int  _job_id_cmp(const void *x, const void *y);
+static job_info_cache_t *_job_info_cache_get(uint16_t show_flags,
+					     uint16_t protocol_version,
+					     time_t now);
+static void _job_info_cache_fini(void);
+static int  _job_info_cache_rec_cmp(const void *x, const void *y);
+static void _job_info_filter_set(uint16_t show_flags, uid_t uid,
+				 bool *filter_parts, bool *filter_private);
+static bool _job_info_rec_hidden(job_info_cache_rec_t *rec, uid_t uid,
+				 uint32_t filter_uid, uint16_t show_flags,
+				 bool filter_parts, bool filter_private);
 static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 			struct job_record **job_rec_ptr, uid_t submit_uid,
 			char **err_msg, uint16_t protocol_version);
 static void _job_purge_start(void);
+static bool _job_state_compact_needed(void);
+static int  _job_state_journal_create(time_t snap_time);
+static Buf  _job_state_journal_read(time_t snap_time,
+				    uint16_t *protocol_version);
+static void _job_mod_unlink(struct job_record *job_ptr);
 static void _job_timed_out(struct job_record *job_ptr);
 static void _kill_dependent(struct job_record *job_ptr);
 static void _list_delete_job(void *job_entry);
 static int  _list_find_job_id(void *job_entry, void *key);
 static int  _list_find_job_old(void *job_entry, void *key);
+static int  _list_find_job_set(void *job_entry, void *key);
 static int  _load_job_details(struct job_record *job_ptr, Buf buffer,
 			      uint16_t protocol_version);
 static int  _load_job_state(Buf buffer,	uint16_t protocol_version);
+static int  _load_job_state_journal(time_t snap_time, int *rec_cnt);
 static bitstr_t *_make_requeue_array(char *conf_buf);
 static uint32_t _max_switch_wait(uint32_t input_wait);
 static void _notify_srun_missing_step(struct job_record *job_ptr, int node_inx,
@@ -252,6 +333,7 @@ static bool _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
 static int  _write_data_to_file(char *file_name, char *data);
 static int  _write_data_array_to_file(char *file_name, char **data,
 				      uint32_t size);
+static int  _write_job_state_buf(char *file_name, int fd, Buf buffer);
 static void _xmit_new_end_time(struct job_record *job_ptr);
 
 /*
@@ -460,10 +542,10 @@ static struct job_record *_create_job_record(int *error_code, uint32_t num_jobs)
 
 	job_count += num_jobs;
 	*error_code = 0;
-	last_job_update = time(NULL);
 
 	job_ptr    = (struct job_record *) xmalloc(sizeof(struct job_record));
 	detail_ptr = (struct job_details *)xmalloc(sizeof(struct job_details));
+	job_modified(job_ptr, time(NULL));
 
 	job_ptr->magic = JOB_MAGIC;
 	job_ptr->array_task_id = NO_VAL;
@@ -649,6 +731,12 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 
 /*
  * dump_all_job_state - save the state of all jobs to file for checkpoint
+ *	The job_state file holds a snapshot of every job. Between snapshots
+ *	only the records of jobs which changed since the previous save, plus
+ *	the IDs of purged jobs, are appended to job_state.journal. The journal
+ *	is compacted into a new snapshot once it grows beyond
+ *	JOB_STATE_JOURNAL_PCT of the snapshot size, or on every save if
+ *	JOB_STATE_JOURNAL_PCT is zero.
  *	Changes here should be reflected in load_last_job_id() and
  *	load_all_job_state().
  * RET 0 or error code */
@@ -662,11 +750,18 @@ int dump_all_job_state(void)
 	/* Locks: Read config and job */
 	slurmctld_lock_t job_read_lock =
 		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
+	/* Locks: Write job */
+	slurmctld_lock_t job_write_lock =
+		{ NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer;
 	time_t now = time(NULL);
 	time_t last_state_file_time;
+	bool compact;
+	uint32_t cnt_offset = 0, purge_cnt, rec_cnt = 0, rec_offset;
+	uint32_t tmp_offset;
+	job_journal_rec_t journal_rec;
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -687,39 +782,137 @@ int dump_all_job_state(void)
 		}
 	}
 
-	/* write header: version, time */
-	packstr(JOB_STATE_VERSION, buffer);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(now, buffer);
+	compact = _job_state_compact_needed();
+	if (compact) {
+		buffer = init_buf(high_buffer_size);
 
-	/*
-	 * write header: job id
-	 * This is needed so that the job id remains persistent even after
-	 * slurmctld is restarted.
-	 */
-	pack32( job_id_sequence, buffer);
+		/* write header: version, time */
+		packstr(JOB_STATE_VERSION, buffer);
+		pack16(SLURM_PROTOCOL_VERSION, buffer);
+		pack_time(now, buffer);
+
+		/*
+		 * write header: job id
+		 * This is needed so that the job id remains persistent even
+		 * after slurmctld is restarted.
+		 */
+		pack32( job_id_sequence, buffer);
 
-	debug3("Writing job id %u to header record of job_state file",
-	       job_id_sequence);
+		debug3("Writing job id %u to header record of job_state file",
+		       job_id_sequence);
+	} else {
+		/* write journal record header: size (set below), time, job id */
+		buffer = init_buf(BUF_SIZE);
+		pack32(0, buffer);
+		pack_time(now, buffer);
+		pack32(job_id_sequence, buffer);
+	}
 
 	/* write individual job records */
 	lock_slurmctld(job_read_lock);
-	job_iterator = list_iterator_create(job_list);
-	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
-		xassert (job_ptr->magic == JOB_MAGIC);
-		_dump_job_state(job_ptr, buffer);
+	if (compact) {
+		job_iterator = list_iterator_create(job_list);
+		while ((job_ptr = (struct job_record *)
+				  list_next(job_iterator))) {
+			xassert (job_ptr->magic == JOB_MAGIC);
+			rec_offset = get_buf_offset(buffer);
+			_dump_job_state(job_ptr, buffer);
+			job_ptr->state_save_cksum =
+				_buf_cksum(buffer, rec_offset);
+		}
+		list_iterator_destroy(job_iterator);
+		job_journal_sweep_time = now;
+	} else {
+		pack32_array(purged_job_ids, purged_job_cnt, buffer);
+		cnt_offset = get_buf_offset(buffer);
+		pack32(rec_cnt, buffer);
+		journal_rec.buffer = buffer;
+		journal_rec.rec_cnt = 0;
+		/* Only jobs reported to job_modified() since the last save
+		 * normally need to be checked. Check every job after
+		 * job_modified_all() and periodically, in case any change
+		 * was not reported. */
+		if ((job_mod_all_seq > job_journal_mod_seq) ||
+		    (difftime(now, job_journal_sweep_time) >=
+		     JOB_STATE_SWEEP_AGE)) {
+			list_for_each(job_list, _dump_job_journal_rec,
+				      &journal_rec);
+			job_journal_sweep_time = now;
+		} else {
+			job_mod_for_each(job_journal_mod_seq,
+					 _dump_job_journal_rec, &journal_rec);
+		}
+		rec_cnt = journal_rec.rec_cnt;
 	}
-	list_iterator_destroy(job_iterator);
+	job_journal_mod_seq = job_mod_seq;
+	if (!compact && (rec_cnt == 0) && (purged_job_cnt == 0) &&
+	    (job_id_sequence == job_journal_seq)) {
+		/* Nothing changed since last save */
+		unlock_slurmctld(job_read_lock);
+		free_buf(buffer);
+		END_TIMER2("dump_all_job_state");
+		return error_code;
+	}
+	purge_cnt = purged_job_cnt;
+	job_journal_seq = job_id_sequence;
 
 	/* write the buffer to file */
 	old_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(old_file, "/job_state.old");
 	reg_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(reg_file, "/job_state");
-	new_file = xstrdup(slurmctld_conf.state_save_location);
-	xstrcat(new_file, "/job_state.new");
+	if (compact) {
+		new_file = xstrdup(slurmctld_conf.state_save_location);
+		xstrcat(new_file, "/job_state.new");
+	} else {
+		new_file = xstrdup(slurmctld_conf.state_save_location);
+		xstrcat(new_file, "/job_state.journal");
+	}
 	unlock_slurmctld(job_read_lock);
 
+	if (purge_cnt) {
+		/* Forget the purges saved, but not those made since */
+		lock_slurmctld(job_write_lock);
+		purged_job_cnt -= purge_cnt;
+		memmove(purged_job_ids, purged_job_ids + purge_cnt,
+			sizeof(uint32_t) * purged_job_cnt);
+		unlock_slurmctld(job_write_lock);
+	}
+
+	if (!compact) {
+		tmp_offset = get_buf_offset(buffer);
+		set_buf_offset(buffer, cnt_offset);
+		pack32(rec_cnt, buffer);
+		set_buf_offset(buffer, 0);
+		pack32(tmp_offset - 4, buffer);
+		set_buf_offset(buffer, tmp_offset);
+
+		lock_state_files_shared();
+		log_fd = open(new_file, O_WRONLY | O_APPEND);
+		if (log_fd < 0) {
+			error("Can't save state, open file %s error %m",
+			      new_file);
+			error_code = errno;
+		} else {
+			fd_set_close_on_exec(log_fd);
+			error_code = _write_job_state_buf(new_file, log_fd,
+							  buffer);
+		}
+		if (error_code)
+			job_journal_valid = false;
+		else
+			job_journal_size += get_buf_offset(buffer);
+		unlock_state_files();
+		debug3("Journaled %u job records and %u purged jobs, %u bytes",
+		       rec_cnt, purge_cnt, get_buf_offset(buffer));
+		xfree(old_file);
+		xfree(reg_file);
+		xfree(new_file);
+		free_buf(buffer);
+		END_TIMER2("dump_all_job_state");
+		return error_code;
+	}
+
 	if (stat(reg_file, &stat_buf) == 0) {
 		static time_t last_mtime = (time_t) 0;
 		int delta_t = difftime(stat_buf.st_mtime, last_mtime);
@@ -735,34 +928,17 @@ int dump_all_job_state(void)
 		last_mtime = time(NULL);
 	}
 
-	lock_state_files();
+	lock_state_files_shared();
 	log_fd = creat(new_file, 0600);
 	if (log_fd < 0) {
 		error("Can't save state, create file %s error %m",
 		      new_file);
 		error_code = errno;
 	} else {
-		int pos = 0, nwrite, amount, rc;
-		char *data;
-
 		fd_set_close_on_exec(log_fd);
-		nwrite = get_buf_offset(buffer);
-		data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-
-		rc = fsync_and_close(log_fd, "job");
-		if (rc && !error_code)
-			error_code = rc;
+		high_buffer_size = MAX(get_buf_offset(buffer),
+				       high_buffer_size);
+		error_code = _write_job_state_buf(new_file, log_fd, buffer);
 	}
 	if (error_code)
 		(void) unlink(new_file);
@@ -777,7 +953,12 @@ int dump_all_job_state(void)
 			       new_file, reg_file);
 		(void) unlink(new_file);
 		last_file_write_time = now;
+		job_snapshot_size = get_buf_offset(buffer);
 	}
+	/* Start a new journal which extends this snapshot */
+	job_journal_valid = false;
+	if (!error_code && (_job_state_journal_create(now) == SLURM_SUCCESS))
+		job_journal_valid = true;
 	xfree(old_file);
 	xfree(reg_file);
 	xfree(new_file);
@@ -788,6 +969,147 @@ int dump_all_job_state(void)
 	return error_code;
 }
 
+/* Append a job's state to a job state journal record unless unchanged since
+ * it was last saved. Called via list_for_each() or job_mod_for_each(). */
+static int _dump_job_journal_rec(void *x, void *arg)
+{
+	struct job_record *job_ptr = (struct job_record *) x;
+	job_journal_rec_t *journal_rec = (job_journal_rec_t *) arg;
+	Buf buffer = journal_rec->buffer;
+	uint32_t rec_offset, tmp_offset;
+	uint64_t cksum;
+
+	xassert (job_ptr->magic == JOB_MAGIC);
+
+	/* journal record: job id, record size, job state */
+	rec_offset = get_buf_offset(buffer);
+	pack32(job_ptr->job_id, buffer);
+	pack32(0, buffer);
+	_dump_job_state(job_ptr, buffer);
+	cksum = _buf_cksum(buffer, rec_offset + 8);
+	if (cksum == job_ptr->state_save_cksum) {
+		/* Unchanged since last save, discard record */
+		set_buf_offset(buffer, rec_offset);
+		return 0;
+	}
+	job_ptr->state_save_cksum = cksum;
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, rec_offset + 4);
+	pack32(tmp_offset - rec_offset - 8, buffer);
+	set_buf_offset(buffer, tmp_offset);
+	journal_rec->rec_cnt++;
+	return 0;
+}
+
+/* Return true if the next job state save must write a complete snapshot
+ * rather than append to the job state journal */
+static bool _job_state_compact_needed(void)
+{
+#if JOB_STATE_JOURNAL_PCT == 0
+	return true;
+#else
+	if (!job_journal_valid || slurmctld_config.shutdown_time)
+		return true;
+	if ((job_journal_size * 100) >
+	    (job_snapshot_size * JOB_STATE_JOURNAL_PCT))
+		return true;
+	return false;
+#endif
+}
+
+/* Return a checksum of the buffer's contents from offset to its end */
+static uint64_t _buf_cksum(Buf buffer, uint32_t offset)
+{
+	unsigned char *data = (unsigned char *) get_buf_data(buffer);
+	uint32_t i, end = get_buf_offset(buffer);
+	uint64_t cksum = 0xcbf29ce484222325ULL;	/* 64-bit FNV-1a */
+
+	for (i = offset; i < end; i++) {
+		cksum ^= data[i];
+		cksum *= 0x100000001b3ULL;
+	}
+	if (cksum == 0)		/* zero identifies a job never saved */
+		cksum = 1;
+	return cksum;
+}
+
+/*
+ * Create an empty job state journal extending the job state snapshot
+ * written at snap_time. Call with lock_state_files() or
+ * lock_state_files_shared() held.
+ * RET 0 or error code
+ */
+static int _job_state_journal_create(time_t snap_time)
+{
+	char *journal_file, *new_file;
+	int error_code = SLURM_SUCCESS, log_fd;
+	Buf buffer;
+
+	journal_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(journal_file, "/job_state.journal");
+#if JOB_STATE_JOURNAL_PCT == 0
+	/* Journal disabled, remove any left by a build which journaled */
+	(void) unlink(journal_file);
+	xfree(journal_file);
+	return SLURM_ERROR;
+#endif
+	new_file = xstrdup_printf("%s.new", journal_file);
+
+	buffer = init_buf(BUF_SIZE);
+	packstr(JOB_STATE_VERSION, buffer);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(snap_time, buffer);
+
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		error_code = _write_job_state_buf(new_file, log_fd, buffer);
+	}
+	if (error_code) {
+		(void) unlink(new_file);
+	} else if (rename(new_file, journal_file)) {
+		error("Can't rename %s to %s: %m", new_file, journal_file);
+		error_code = errno;
+		(void) unlink(new_file);
+	} else {
+		job_journal_size = get_buf_offset(buffer);
+	}
+	free_buf(buffer);
+	xfree(journal_file);
+	xfree(new_file);
+	return error_code;
+}
+
+/* Write the buffer's contents to a job state file, then sync and close it
+ * RET 0 or error code */
+static int _write_job_state_buf(char *file_name, int fd, Buf buffer)
+{
+	int error_code = SLURM_SUCCESS, pos = 0, nwrite, amount, rc;
+	char *data;
+
+	nwrite = get_buf_offset(buffer);
+	data = (char *)get_buf_data(buffer);
+	while (nwrite > 0) {
+		amount = write(fd, &data[pos], nwrite);
+		if ((amount < 0) && (errno != EINTR)) {
+			error("Error writing file %s, %m", file_name);
+			error_code = errno;
+			break;
+		}
+		nwrite -= amount;
+		pos    += amount;
+	}
+
+	rc = state_file_sync_close(fd, "job", pos);
+	if (rc && !error_code)
+		error_code = rc;
+	return error_code;
+}
+
 /* Open the job state save file, or backup if necessary.
  * state_file IN - the name of the state save file used
  * RET the file description to read from or error code
@@ -822,6 +1144,7 @@ static int _open_job_state_file(char **state_file)
 extern void backup_slurmctld_restart(void)
 {
 	last_file_write_time = (time_t) 0;
+	job_journal_valid = false;
 }
 
 /* Return the time stamp in the current job state save file */
@@ -890,7 +1213,7 @@ extern int load_all_job_state(void)
 {
 	int data_allocated, data_read = 0, error_code = SLURM_SUCCESS;
 	uint32_t data_size = 0;
-	int state_fd, job_cnt = 0;
+	int state_fd, job_cnt = 0, rec_cnt = 0;
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
@@ -964,11 +1287,15 @@ extern int load_all_job_state(void)
 			goto unpack_error;
 		job_cnt++;
 	}
+	error_code = _load_job_state_journal(buf_time, &rec_cnt);
 	assoc_mgr_unlock(&locks);
 	debug3("Set job_id_sequence to %u", job_id_sequence);
 
 	free_buf(buffer);
 	info("Recovered information about %d jobs", job_cnt);
+	if (rec_cnt)
+		info("Recovered %d job records from job state journal",
+		     rec_cnt);
 	return error_code;
 
 unpack_error:
@@ -979,6 +1306,180 @@ unpack_error:
 	return SLURM_FAILURE;
 }
 
+/*
+ * Read the job state journal which extends the job state snapshot written
+ * at snap_time. Call with lock_state_files() held.
+ * protocol_version OUT - protocol version of the journal's job records
+ * RET buffer positioned after the journal header, NULL if there is no
+ *	journal for this snapshot. Free with free_buf().
+ */
+static Buf _job_state_journal_read(time_t snap_time,
+				   uint16_t *protocol_version)
+{
+	int data_allocated, data_read = 0;
+	uint32_t data_size = 0;
+	int state_fd;
+	char *data = NULL, *state_file;
+	Buf buffer;
+	time_t buf_time = (time_t) 0;
+	char *ver_str = NULL;
+	uint32_t ver_str_len;
+
+	*protocol_version = (uint16_t) NO_VAL;
+	state_file = slurm_get_state_save_location();
+	xstrcat(state_file, "/job_state.journal");
+	state_fd = open(state_file, O_RDONLY);
+	if (state_fd < 0) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		return NULL;
+	}
+	data_allocated = BUF_SIZE;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(state_fd, &data[data_size], BUF_SIZE);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			else {
+				error("Read error on %s: %m", state_file);
+				break;
+			}
+		} else if (data_read == 0)	/* eof */
+			break;
+		data_size      += data_read;
+		data_allocated += data_read;
+		xrealloc(data, data_allocated);
+	}
+	close(state_fd);
+
+	buffer = create_buf(data, data_size);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if (ver_str && !xstrcmp(ver_str, JOB_STATE_VERSION))
+		safe_unpack16(protocol_version, buffer);
+	safe_unpack_time(&buf_time, buffer);
+	xfree(ver_str);
+	if (*protocol_version == (uint16_t) NO_VAL) {
+		error("Can not recover job state journal %s, "
+		      "incompatible version", state_file);
+		goto fini;
+	}
+	if (buf_time != snap_time) {
+		info("Job state journal %s does not match job state file, "
+		     "ignoring it", state_file);
+		goto fini;
+	}
+	xfree(state_file);
+	return buffer;
+
+unpack_error:
+	error("Invalid job state journal %s", state_file);
+	xfree(ver_str);
+fini:
+	xfree(state_file);
+	free_buf(buffer);
+	return NULL;
+}
+
+/*
+ * Replay the job state journal on top of the job records loaded from the
+ * job state snapshot written at snap_time. Each journal record replaces the
+ * jobs it contains and removes the jobs purged since the previous record.
+ * Execute with the assoc_mgr read lock held.
+ * rec_cnt OUT - count of job records replayed
+ * RET 0 or error code
+ */
+static int _load_job_state_journal(time_t snap_time, int *rec_cnt)
+{
+	Buf buffer;
+	uint16_t protocol_version;
+	uint32_t batch_size, batch_end, i, job_cnt, job_id, rec_end, rec_size;
+	uint32_t purge_cnt = 0, rec_offset, saved_job_id;
+	uint32_t *purge_ids = NULL;
+	job_id_set_t id_set = { 0, NULL };
+	time_t batch_time;
+
+	*rec_cnt = 0;
+	lock_state_files();
+	buffer = _job_state_journal_read(snap_time, &protocol_version);
+	unlock_state_files();
+	if (!buffer)
+		return SLURM_SUCCESS;
+
+	while (remaining_buf(buffer) > 0) {
+		safe_unpack32(&batch_size, buffer);
+		if (batch_size > remaining_buf(buffer)) {
+			/* Save interrupted by failure, record never completed */
+			error("Job state journal truncated, discarding last "
+			      "%u bytes", remaining_buf(buffer));
+			break;
+		}
+		batch_end = get_buf_offset(buffer) + batch_size;
+		safe_unpack_time(&batch_time, buffer);
+		safe_unpack32(&saved_job_id, buffer);
+		if (saved_job_id <= slurmctld_conf.max_job_id)
+			job_id_sequence = MAX(saved_job_id, job_id_sequence);
+		safe_unpack32_array(&purge_ids, &purge_cnt, buffer);
+		safe_unpack32(&job_cnt, buffer);
+		if ((job_cnt > batch_size) || (purge_cnt > batch_size))
+			goto unpack_error;
+
+		/* Remove every job purged or replaced by this record */
+		id_set.job_ids = xmalloc(sizeof(uint32_t) *
+					 (purge_cnt + job_cnt + 1));
+		memcpy(id_set.job_ids, purge_ids, sizeof(uint32_t) * purge_cnt);
+		id_set.cnt = purge_cnt;
+		xfree(purge_ids);
+		rec_offset = get_buf_offset(buffer);
+		for (i = 0; i < job_cnt; i++) {
+			safe_unpack32(&job_id, buffer);
+			safe_unpack32(&rec_size, buffer);
+			if (rec_size > remaining_buf(buffer))
+				goto unpack_error;
+			set_buf_offset(buffer, get_buf_offset(buffer) + rec_size);
+			id_set.job_ids[id_set.cnt++] = job_id;
+		}
+		for (i = 0; i < id_set.cnt; i++) {
+			if (!find_job_record(id_set.job_ids[i]))
+				continue;
+			qsort(id_set.job_ids, id_set.cnt, sizeof(uint32_t),
+			      _job_id_cmp);
+			list_delete_all(job_list, _list_find_job_set, &id_set);
+			break;
+		}
+		xfree(id_set.job_ids);
+
+		/* Load the replacement job records */
+		set_buf_offset(buffer, rec_offset);
+		for (i = 0; i < job_cnt; i++) {
+			safe_unpack32(&job_id, buffer);
+			safe_unpack32(&rec_size, buffer);
+			rec_end = get_buf_offset(buffer) + rec_size;
+			if ((_load_job_state(buffer, protocol_version) !=
+			     SLURM_SUCCESS) ||
+			    (get_buf_offset(buffer) != rec_end)) {
+				error("Invalid job state journal record for "
+				      "job %u at time %u", job_id,
+				      (uint32_t) batch_time);
+				set_buf_offset(buffer, rec_end);
+				continue;
+			}
+			(*rec_cnt)++;
+		}
+		if (get_buf_offset(buffer) != batch_end)
+			goto unpack_error;
+	}
+	free_buf(buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("Incomplete job state journal");
+	xfree(id_set.job_ids);
+	xfree(purge_ids);
+	free_buf(buffer);
+	return SLURM_FAILURE;
+}
+
 /*
  * load_last_job_id - load only the last job ID from state save file.
  *	Changes here should be reflected in load_all_job_state().
@@ -993,7 +1494,7 @@ extern int load_last_job_id( void )
 	Buf buffer;
 	time_t buf_time;
 	char *ver_str = NULL;
-	uint32_t ver_str_len;
+	uint32_t batch_end, batch_size, ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
 
 	/* read the file */
@@ -1053,6 +1554,25 @@ extern int load_last_job_id( void )
 
 	/* Ignore the state for individual jobs stored here */
 
+	free_buf(buffer);
+
+	/* Use the job ID from the last job state journal record, if any */
+	lock_state_files();
+	buffer = _job_state_journal_read(buf_time, &protocol_version);
+	unlock_state_files();
+	if (!buffer)
+		return error_code;
+	while (remaining_buf(buffer) > 0) {
+		safe_unpack32(&batch_size, buffer);
+		if (batch_size > remaining_buf(buffer))
+			break;
+		batch_end = get_buf_offset(buffer) + batch_size;
+		safe_unpack_time(&buf_time, buffer);
+		safe_unpack32(&job_id_sequence, buffer);
+		set_buf_offset(buffer, batch_end);
+	}
+	debug3("Job ID in job_state journal is %u", job_id_sequence);
+
 	free_buf(buffer);
 	return error_code;
 
@@ -2650,11 +3170,7 @@ unpack_error:
  */
 static void _add_job_hash(struct job_record *job_ptr)
 {
-	int inx;
-
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	(void) id_hash_add(job_hash, job_ptr->job_id, job_ptr);
 }
 
 /* _remove_job_hash - remove a job hash entry for given job record, job_id must
@@ -2664,19 +3180,11 @@ static void _add_job_hash(struct job_record *job_ptr)
  */
 static void _remove_job_hash(struct job_record *job_entry)
 {
-	struct job_record *job_ptr, **job_pptr;
-
-	job_pptr = &job_hash[JOB_HASH_INX(job_entry->job_id)];
-	while ((job_pptr != NULL) &&
-	       ((job_ptr = *job_pptr) != job_entry)) {
-		job_pptr = &job_ptr->job_next;
-	}
-	if (job_pptr == NULL) {
+	if (id_hash_find(job_hash, job_entry->job_id) != job_entry) {
 		fatal("job hash error");
 		return; /* Fix CLANG false positive error */
 	}
-	*job_pptr = job_entry->job_next;
-	job_entry->job_next = NULL;
+	(void) id_hash_remove(job_hash, job_entry->job_id);
 }
 
 /* _add_job_array_hash - add a job hash entry for given job record,
@@ -2686,18 +3194,15 @@ static void _remove_job_hash(struct job_record *job_entry)
  */
 void _add_job_array_hash(struct job_record *job_ptr)
 {
-	int inx;
-
 	if (job_ptr->array_task_id == NO_VAL)
 		return;	/* Not a job array */
 
-	inx = JOB_HASH_INX(job_ptr->array_job_id);
-	job_ptr->job_array_next_j = job_array_hash_j[inx];
-	job_array_hash_j[inx] = job_ptr;
-
-	inx = JOB_ARRAY_HASH_INX(job_ptr->array_job_id,job_ptr->array_task_id);
-	job_ptr->job_array_next_t = job_array_hash_t[inx];
-	job_array_hash_t[inx] = job_ptr;
+	/* The new task becomes the head of the array's task list */
+	job_ptr->job_array_next_j = id_hash_add(job_array_hash_j,
+						job_ptr->array_job_id, job_ptr);
+	(void) id_hash_add(job_array_hash_t,
+			   ID_HASH_KEY2(job_ptr->array_job_id,
+					job_ptr->array_task_id), job_ptr);
 }
 
 /* For the job array data structure, build the string representation of the
@@ -2740,7 +3245,6 @@ extern void build_array_str(struct job_record *job_ptr)
 extern bool test_job_array_complete(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2751,8 +3255,7 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_COMPLETE(job_ptr))
@@ -2767,7 +3270,6 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 extern bool test_job_array_completed(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2776,8 +3278,7 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_COMPLETED(job_ptr))
@@ -2792,7 +3293,6 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 extern bool test_job_array_finished(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2801,8 +3301,7 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_FINISHED(job_ptr))
@@ -2817,7 +3316,6 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 extern bool test_job_array_pending(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2828,8 +3326,7 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (IS_JOB_PENDING(job_ptr))
@@ -2845,10 +3342,9 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 extern int num_pending_job_array_tasks(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int count = 0, inx;
+	int count = 0;
 
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 	while (job_ptr) {
 		if ((job_ptr->array_job_id == array_job_id) &&
 		    IS_JOB_PENDING(job_ptr))
@@ -2884,8 +3380,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 		    (job_ptr->array_job_id == array_job_id))
 			return job_ptr;
 
-		inx = JOB_HASH_INX(array_job_id);
-		job_ptr = job_array_hash_j[inx];
+		job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 		while (job_ptr) {
 			if (job_ptr->array_job_id == array_job_id) {
 				match_job_ptr = job_ptr;
@@ -2897,15 +3392,11 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 		}
 		return match_job_ptr;
 	} else {		/* Find specific task ID */
-		inx = JOB_ARRAY_HASH_INX(array_job_id, array_task_id);
-		job_ptr = job_array_hash_t[inx];
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == array_job_id) &&
-			    (job_ptr->array_task_id == array_task_id)) {
-				return job_ptr;
-			}
-			job_ptr = job_ptr->job_array_next_t;
-		}
+		job_ptr = id_hash_find(job_array_hash_t,
+				       ID_HASH_KEY2(array_job_id,
+						    array_task_id));
+		if (job_ptr)
+			return job_ptr;
 		/* Look for job record with all of the pending tasks */
 		job_ptr = find_job_record(array_job_id);
 		if (job_ptr && job_ptr->array_recs &&
@@ -2928,16 +3419,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
  */
 struct job_record *find_job_record(uint32_t job_id)
 {
-	struct job_record *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return id_hash_find(job_hash, job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -2970,7 +3452,7 @@ static void _rebuild_part_name_list(struct job_record  *job_ptr)
 		xstrcat(job_ptr->partition, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 }
 
 /*
@@ -3037,6 +3519,7 @@ extern int kill_job_by_part_name(char *part_name)
 		}
 		if (IS_JOB_RUNNING(job_ptr) || suspended) {
 			kill_job_cnt++;
+			job_modified(job_ptr, now);
 			info("Killing job_id %u on defunct partition %s",
 			     job_ptr->job_id, part_name);
 			job_ptr->job_state = JOB_NODE_FAIL | JOB_COMPLETING;
@@ -3056,6 +3539,7 @@ extern int kill_job_by_part_name(char *part_name)
 						 false);
 		} else if (pending) {
 			kill_job_cnt++;
+			job_modified(job_ptr, now);
 			info("Killing job_id %u on defunct partition %s",
 			     job_ptr->job_id, part_name);
 			job_ptr->job_state	= JOB_CANCELLED;
@@ -3116,6 +3600,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 		}
 		if (IS_JOB_COMPLETING(job_ptr)) {
 			kill_job_cnt++;
+			job_modified(job_ptr, now);
 			while ((i = bit_ffs(job_ptr->node_bitmap_cg)) >= 0) {
 				bit_clear(job_ptr->node_bitmap_cg, i);
 				if (job_ptr->node_cnt)
@@ -3139,6 +3624,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 			}
 		} else if (IS_JOB_RUNNING(job_ptr) || suspended) {
 			kill_job_cnt++;
+			job_modified(job_ptr, now);
 			if (job_ptr->batch_flag && job_ptr->details &&
 			    slurmctld_conf.job_requeue &&
 			    (job_ptr->details->requeue > 0)) {
@@ -3349,6 +3835,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 			if (!bit_test(job_ptr->node_bitmap_cg, bit_position))
 				continue;
 			kill_job_cnt++;
+			job_modified(job_ptr, now);
 			bit_clear(job_ptr->node_bitmap_cg, bit_position);
 			job_update_tres_cnt(job_ptr, bit_position);
 			if (job_ptr->node_cnt)
@@ -3369,6 +3856,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 			}
 		} else if (IS_JOB_RUNNING(job_ptr) || suspended) {
 			kill_job_cnt++;
+			job_modified(job_ptr, now);
 			if ((job_ptr->details) &&
 			    (job_ptr->kill_on_node_fail == 0) &&
 			    (job_ptr->node_cnt > 1)) {
@@ -3761,21 +4249,12 @@ int init_job_conf(void)
  */
 extern void rehash_jobs(void)
 {
+	/* The tables grow as needed, so a change in MaxJobCount requires
+	 * no action here */
 	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-		job_array_hash_j = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-		job_array_hash_t = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
+		job_hash = id_hash_init(0);
+		job_array_hash_j = id_hash_init(0);
+		job_array_hash_t = id_hash_init(0);
 	}
 }
 
@@ -3786,7 +4265,7 @@ extern void rehash_jobs(void)
  * RET - The new job record, which is the new META job record. */
 extern struct job_record *job_array_split(struct job_record *job_ptr)
 {
-	struct job_record *job_ptr_pend = NULL, *save_job_next;
+	struct job_record *job_ptr_pend = NULL;
 	struct job_details *job_details, *details_new, *save_details;
 	uint32_t save_job_id;
 	uint64_t save_db_index = job_ptr->db_index;
@@ -3817,14 +4296,16 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	/* Copy most of original job data.
 	 * This could be done in parallel, but performance was worse. */
 	save_job_id   = job_ptr_pend->job_id;
-	save_job_next = job_ptr_pend->job_next;
 	save_details  = job_ptr_pend->details;
 	save_prio_factors = job_ptr_pend->prio_factors;
 	save_step_list = job_ptr_pend->step_list;
+	_job_mod_unlink(job_ptr_pend);
 	memcpy(job_ptr_pend, job_ptr, sizeof(struct job_record));
+	job_ptr_pend->mod_next = NULL;
+	job_ptr_pend->mod_prev = NULL;
+	job_modified(job_ptr_pend, time(NULL));
 
 	job_ptr_pend->job_id   = save_job_id;
-	job_ptr_pend->job_next = save_job_next;
 	job_ptr_pend->details  = save_details;
 	job_ptr_pend->step_list = save_step_list;
 	job_ptr_pend->db_index = save_db_index;
@@ -3878,8 +4359,8 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	memcpy(job_ptr_pend->limit_set.tres, job_ptr->limit_set.tres,
 	       sizeof(uint16_t) * slurmctld_tres_cnt);
 
-	_add_job_hash(job_ptr);		/* Sets job_next */
-	_add_job_hash(job_ptr_pend);	/* Sets job_next */
+	_add_job_hash(job_ptr);
+	_add_job_hash(job_ptr_pend);
 	_add_job_array_hash(job_ptr);
 	job_ptr_pend->job_resrcs = NULL;
 
@@ -3993,6 +4474,7 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	details_new->std_in = xstrdup(job_details->std_in);
 	details_new->std_out = xstrdup(job_details->std_out);
 	details_new->work_dir = xstrdup(job_details->work_dir);
+	job_modified(job_ptr, time(NULL));
 
 	return job_ptr_pend;
 }
@@ -4366,7 +4848,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 	no_alloc = no_alloc || (bb_g_job_test_stage_in(job_ptr, no_alloc) != 1);
 	error_code = _select_nodes_parts(job_ptr, no_alloc, NULL, err_msg);
 	if (!test_only) {
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		slurm_sched_g_schedule();	/* work for external scheduler */
 	}
 
@@ -4486,7 +4968,7 @@ extern int job_fail(uint32_t job_id, uint32_t job_state)
 				difftime(now, job_ptr->suspend_time);
 		} else
 			job_ptr->end_time       = now;
-		last_job_update                 = now;
+		job_modified(job_ptr, now);
 		job_ptr->job_state = job_state | JOB_COMPLETING;
 		job_ptr->exit_code = 1;
 		job_ptr->state_reason = FAIL_LAUNCH;
@@ -4524,7 +5006,7 @@ static int _job_signal(struct job_record *job_ptr, uint16_t signal,
 
 	/* let node select plugin do any state-dependent signalling actions */
 	select_g_job_signal(job_ptr, signal);
-	last_job_update = now;
+	job_modified(job_ptr, now);
 
 	/* save user ID of the one who requested the job be cancelled */
 	if (signal == SIGKILL)
@@ -4556,7 +5038,7 @@ static int _job_signal(struct job_record *job_ptr, uint16_t signal,
 	else
 		job_term_state = JOB_CANCELLED;
 	if (IS_JOB_SUSPENDED(job_ptr) && (signal == SIGKILL)) {
-		last_job_update         = now;
+		job_modified(job_ptr, now);
 		job_ptr->end_time       = job_ptr->suspend_time;
 		job_ptr->tot_sus_time  += difftime(now, job_ptr->suspend_time);
 		job_ptr->job_state      = job_term_state | JOB_COMPLETING;
@@ -4583,7 +5065,7 @@ static int _job_signal(struct job_record *job_ptr, uint16_t signal,
 			 */
 			job_ptr->time_last_active	= now;
 			job_ptr->end_time		= now;
-			last_job_update			= now;
+			job_modified(job_ptr, now);
 			job_ptr->job_state = job_term_state | JOB_COMPLETING;
 			build_cg_bitmap(job_ptr);
 			job_completion_logger(job_ptr, false);
@@ -4758,7 +5240,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		}
 
 		/* Signal all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = id_hash_find(job_array_hash_j, job_id);
 		if (!job_ptr && !job_ptr_done) {
 			info("%s: 2 invalid job id %u", __func__, job_id);
 			return ESLURM_INVALID_JOB_ID;
@@ -4811,7 +5293,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 	/* Find some job record and validate the user signalling the job */
 	job_ptr = find_job_record(job_id);
 	if (job_ptr == NULL) {
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = id_hash_find(job_array_hash_j, job_id);
 		while (job_ptr) {
 			if (job_ptr->array_job_id == job_id)
 				break;
@@ -4867,7 +5349,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 			new_task_count = bit_set_count(job_ptr->array_recs->
 						       task_id_bitmap);
 			if (!new_task_count) {
-				last_job_update		= now;
+				job_modified(job_ptr, now);
 				job_ptr->job_state	= JOB_CANCELLED;
 				job_ptr->start_time	= now;
 				job_ptr->end_time	= now;
@@ -5202,7 +5684,7 @@ extern int job_complete(uint32_t job_id, uid_t uid, bool requeue,
 		job_completion_logger(job_ptr, false);
 	}
 
-	last_job_update = now;
+	job_modified(job_ptr, now);
 	job_ptr->time_last_active = now;   /* Timer for resending kill RPC */
 	if (job_comp_flag) {	/* job was running */
 		build_cg_bitmap(job_ptr);
@@ -7696,7 +8178,7 @@ void job_time_limit(void)
 				job_ptr->warn_flags |= WARN_SENT;
 			}
 			if (job_ptr->end_time <= now) {
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				info("%s: Preemption GraceTime reached JobId=%u",
 				     __func__, job_ptr->job_id);
 				_job_timed_out(job_ptr);
@@ -7785,7 +8267,7 @@ void job_time_limit(void)
 			else
 				over_run = now - (over_time_limit  * 60);
 			if (job_ptr->end_time <= over_run) {
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				info("Time limit exhausted for JobId=%u",
 				     job_ptr->job_id);
 				_job_timed_out(job_ptr);
@@ -7796,7 +8278,7 @@ void job_time_limit(void)
 		}
 
 		if (resv_status != SLURM_SUCCESS) {
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			info("Reservation ended for JobId=%u",
 			     job_ptr->job_id);
 			_job_timed_out(job_ptr);
@@ -7814,7 +8296,7 @@ void job_time_limit(void)
 		acct_policy_job_time_out(job_ptr);
 
 		if (job_ptr->state_reason == FAIL_TIMEOUT) {
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			_job_timed_out(job_ptr);
 			xfree(job_ptr->state_desc);
 			continue;
@@ -8188,31 +8670,117 @@ _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
 }
 
 /*
- * _list_delete_job - delete a job record and its corresponding job_details,
- *	see common/list.h for documentation
- * IN job_entry - pointer to job_record to delete
+ * job_modified - note that a job record has changed: advance the job's
+ *	modification sequence number, move it to the end of the job
+ *	modification order and set last_job_update
+ * IN job_ptr - modified job, NULL if no specific job record changed
+ * IN now - time of the modification
+ * NOTE: Call with job write lock
  */
-static void _list_delete_job(void *job_entry)
+extern void job_modified(struct job_record *job_ptr, time_t now)
 {
-	struct job_record *job_ptr = (struct job_record *) job_entry;
-	struct job_record **job_pptr, *tmp_ptr;
+	last_job_update = now;
+	if (!job_ptr)
+		return;
+
+	_job_mod_unlink(job_ptr);
+	job_ptr->mod_seq  = ++job_mod_seq;
+	job_ptr->mod_prev = job_mod_tail;
+	if (job_mod_tail)
+		job_mod_tail->mod_next = job_ptr;
+	else
+		job_mod_head = job_ptr;
+	job_mod_tail = job_ptr;
+}
+
+/*
+ * job_modified_all - note that job records changed without job_modified(),
+ *	so that the next job state save and job information pack check
+ *	every job, and set last_job_update
+ * IN now - time of the modification
+ * NOTE: For callers holding only the job read lock, which can not call
+ *	job_modified()
+ */
+extern void job_modified_all(time_t now)
+{
+	last_job_update = now;
+	job_mod_all_seq = ++job_mod_seq;
+}
+
+/* Remove a job from the job modification order, if present */
+static void _job_mod_unlink(struct job_record *job_ptr)
+{
+	if (job_ptr->mod_prev)
+		job_ptr->mod_prev->mod_next = job_ptr->mod_next;
+	else if (job_mod_head == job_ptr)
+		job_mod_head = job_ptr->mod_next;
+	else
+		return;		/* not linked */
+	if (job_ptr->mod_next)
+		job_ptr->mod_next->mod_prev = job_ptr->mod_prev;
+	else
+		job_mod_tail = job_ptr->mod_prev;
+	job_ptr->mod_next = NULL;
+	job_ptr->mod_prev = NULL;
+}
+
+/*
+ * job_mod_for_each - call a function for each job modified since a given
+ *	point, oldest modification first
+ * IN since_seq - job_mod_seq value from an earlier pass, zero for all jobs
+ * IN f - function to call for each job, stop if it returns a negative value
+ * IN arg - argument passed to f
+ * RET number of jobs processed
+ * NOTE: Call with job read lock
+ */
+extern int job_mod_for_each(uint64_t since_seq, ListForF f, void *arg)
+{
+	struct job_record *job_ptr = job_mod_tail;
+	int cnt = 0;
+
+	if (!job_ptr || (job_ptr->mod_seq <= since_seq))
+		return cnt;
+	/* Walk back from the most recent modification to the first one
+	 * after since_seq, so that unchanged jobs are never visited */
+	while (job_ptr->mod_prev && (job_ptr->mod_prev->mod_seq > since_seq))
+		job_ptr = job_ptr->mod_prev;
+	for ( ; job_ptr; job_ptr = job_ptr->mod_next) {
+		xassert(job_ptr->magic == JOB_MAGIC);
+		cnt++;
+		if (f(job_ptr, arg) < 0)
+			break;
+	}
+	return cnt;
+}
+
+/*
+ * _list_delete_job - delete a job record and its corresponding job_details,
+ *	see common/list.h for documentation
+ * IN job_entry - pointer to job_record to delete
+ */
+static void _list_delete_job(void *job_entry)
+{
+	struct job_record *job_ptr = (struct job_record *) job_entry;
+	struct job_record **job_pptr, *tmp_ptr;
 	int job_array_size, i;
 
 	xassert(job_entry);
 	xassert (job_ptr->magic == JOB_MAGIC);
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
 
-	/* Remove the record from job hash table */
-	job_pptr = &job_hash[JOB_HASH_INX(job_ptr->job_id)];
-	while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-	       ((tmp_ptr = *job_pptr) != (struct job_record *) job_entry)) {
-		xassert(tmp_ptr->magic == JOB_MAGIC);
-		job_pptr = &tmp_ptr->job_next;
+	/* Record the purge for the next job state journal save */
+	if (purged_job_cnt >= purged_job_size) {
+		purged_job_size = MAX(1024, purged_job_size * 2);
+		xrealloc(purged_job_ids, sizeof(uint32_t) * purged_job_size);
 	}
-	if (job_pptr == NULL)
-		error("job hash error");
+	purged_job_ids[purged_job_cnt++] = job_ptr->job_id;
+	_job_mod_unlink(job_ptr);
+
+	/* Remove the record from job hash table */
+	if (id_hash_find(job_hash, job_ptr->job_id) == job_ptr)
+		(void) id_hash_remove(job_hash, job_ptr->job_id);
 	else
-		*job_pptr = job_ptr->job_next;
+		error("job hash error");
 
 	if (job_ptr->array_recs) {
 		job_array_size = MAX(1, job_ptr->array_recs->task_cnt);
@@ -8222,32 +8790,41 @@ static void _list_delete_job(void *job_entry)
 
 	/* Remove the record from job array hash tables, if applicable */
 	if (job_ptr->array_task_id != NO_VAL) {
-		job_pptr = &job_array_hash_j[
-			JOB_HASH_INX(job_ptr->array_job_id)];
-		while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-		       ((tmp_ptr = *job_pptr) !=
-			(struct job_record *) job_entry)) {
-			xassert(tmp_ptr->magic == JOB_MAGIC);
-			job_pptr = &tmp_ptr->job_array_next_j;
-		}
-		if (job_pptr == NULL)
-			error("job array hash error");
-		else
-			*job_pptr = job_ptr->job_array_next_j;
-
-		job_pptr = &job_array_hash_t[
-			JOB_ARRAY_HASH_INX(job_ptr->array_job_id,
-					   job_ptr->array_task_id)];
-		while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-		       ((tmp_ptr = *job_pptr) !=
-			(struct job_record *) job_entry)) {
-			xassert(tmp_ptr->magic == JOB_MAGIC);
-			job_pptr = &tmp_ptr->job_array_next_t;
-		}
-		if (job_pptr == NULL)
+		tmp_ptr = id_hash_find(job_array_hash_j,
+				       job_ptr->array_job_id);
+		if (tmp_ptr == job_ptr) {
+			/* Removing the head of the array's task list */
+			if (job_ptr->job_array_next_j) {
+				(void) id_hash_add(job_array_hash_j,
+						   job_ptr->array_job_id,
+						   job_ptr->job_array_next_j);
+			} else {
+				(void) id_hash_remove(job_array_hash_j,
+						      job_ptr->array_job_id);
+			}
+		} else {
+			job_pptr = &tmp_ptr;
+			while (*job_pptr &&
+			       ((tmp_ptr = *job_pptr) != job_ptr)) {
+				xassert(tmp_ptr->magic == JOB_MAGIC);
+				job_pptr = &tmp_ptr->job_array_next_j;
+			}
+			if (*job_pptr == NULL)
+				error("job array hash error");
+			else
+				*job_pptr = job_ptr->job_array_next_j;
+		}
+
+		if (id_hash_find(job_array_hash_t,
+				 ID_HASH_KEY2(job_ptr->array_job_id,
+					      job_ptr->array_task_id)) ==
+		    job_ptr) {
+			(void) id_hash_remove(job_array_hash_t,
+					      ID_HASH_KEY2(
+						      job_ptr->array_job_id,
+						      job_ptr->array_task_id));
+		} else
 			error("job array, task ID hash error");
-		else
-			*job_pptr = job_ptr->job_array_next_t;
 	}
 
 	delete_job_details(job_ptr);
@@ -8329,6 +8906,34 @@ static int _list_find_job_id(void *job_entry, void *key)
 		return 0;
 }
 
+/*
+ * _list_find_job_set - find job entries whose job_id is in a set,
+ *	see common/list.h for documentation, key is job_id_set_t
+ */
+static int _list_find_job_set(void *job_entry, void *key)
+{
+	job_id_set_t *id_set = (job_id_set_t *) key;
+	uint32_t job_id = ((struct job_record *) job_entry)->job_id;
+
+	if (bsearch(&job_id, id_set->job_ids, id_set->cnt, sizeof(uint32_t),
+		    _job_id_cmp))
+		return 1;
+	return 0;
+}
+
+/* Sort job IDs in increasing order */
+static int _job_id_cmp(const void *x, const void *y)
+{
+	uint32_t a = *(uint32_t *) x;
+	uint32_t b = *(uint32_t *) y;
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
 static void _job_purge_start(void)
 {
 	purge_quit = false;
@@ -8443,12 +9048,42 @@ static bool _all_parts_hidden(struct job_record *job_ptr)
 	return false;
 }
 
+/* list_find_first() callback, match any hidden partition */
+static int _find_hidden_part(void *x, void *key)
+{
+	struct part_record *part_ptr = (struct part_record *) x;
+
+	if (part_ptr->flags & PART_FLAG_HIDDEN)
+		return 1;
+	return 0;
+}
+
+/* Find partitions which part_filter_set() may hide from some user: those
+ * hidden from everyone and those limited by AllowGroups */
+static int _find_restricted_part(void *x, void *key)
+{
+	struct part_record *part_ptr = (struct part_record *) x;
+
+	if ((part_ptr->flags & PART_FLAG_HIDDEN) || part_ptr->allow_groups)
+		return 1;
+	return 0;
+}
+
+/* Determine if a job is only being tracked for a federation and should not
+ * be reported */
+static bool _hide_fed_job(struct job_record *job_ptr, uint16_t show_flags)
+{
+	if (!(show_flags & SHOW_FED_TRACK) &&
+	    job_ptr->fed_details && fed_mgr_is_tracker_only_job(job_ptr))
+		return true;
+	return false;
+}
+
 /* Determine if a given job should be seen by a specific user */
 static bool _hide_job(struct job_record *job_ptr, uid_t uid,
 		      uint16_t show_flags)
 {
-	if (!(show_flags & SHOW_FED_TRACK) &&
-	    job_ptr->fed_details && fed_mgr_is_tracker_only_job(job_ptr))
+	if (_hide_fed_job(job_ptr, show_flags))
 		return true;
 
 	if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
@@ -8462,6 +9097,528 @@ static bool _hide_job(struct job_record *job_ptr, uid_t uid,
 	return false;
 }
 
+/* Sort job_info_cache_rec_t records by job ID */
+static int _job_info_cache_rec_cmp(const void *x, const void *y)
+{
+	return _job_id_cmp(&((job_info_cache_rec_t *) x)->job_id,
+			   &((job_info_cache_rec_t *) y)->job_id);
+}
+
+/* Pack every job into a job_info_cache_t, skipping only those jobs which
+ * are hidden from all users. The records are packed for an operator, which
+ * matches what any other user sees of jobs they are permitted to see since
+ * SHOW_DETAIL2 requests are not cached. When rebuilding an entry for the
+ * same show_flags and protocol version, records are compared with those of
+ * the previous build to track when each job changed and which jobs were
+ * removed, as needed by pack_all_jobs_delta(). The previous records of jobs
+ * not passed to job_modified() since are copied rather than packed again,
+ * unless partitions or the configuration changed, job_modified_all() was
+ * called or the records are JOB_INFO_CACHE_AGE seconds old (expected start
+ * times of pending jobs change without job_modified() calls). */
+static void _job_info_cache_build(job_info_cache_t *cache,
+				  uint16_t show_flags,
+				  uint16_t protocol_version, time_t now)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	job_info_cache_rec_t *old_recs = NULL, *old_rec, *rec;
+	uint32_t i, old_cnt = 0, reuse_cnt = 0;
+	time_t purge_limit = now - JOB_INFO_DELTA_AGE;
+	Buf old_buffer;
+	bool reuse = false;
+	DEF_TIMERS;
+
+	START_TIMER;
+	if (cache->buffer && (cache->show_flags == show_flags) &&
+	    (cache->protocol_version == protocol_version)) {
+		old_recs = cache->recs;
+		old_cnt  = cache->rec_cnt;
+		qsort(old_recs, old_cnt, sizeof(job_info_cache_rec_t),
+		      _job_info_cache_rec_cmp);
+		if ((cache->last_part_update == last_part_update) &&
+		    (cache->last_conf_update == slurmctld_conf.last_update) &&
+		    (job_mod_all_seq <= cache->mod_seq) &&
+		    (difftime(now, cache->full_time) < JOB_INFO_CACHE_AGE))
+			reuse = true;
+	} else {
+		xfree(cache->recs);
+		cache->delta_time = now;
+		cache->purge_cnt = 0;
+	}
+	if (!reuse)
+		cache->full_time = now;
+
+	/* Pack into the spare buffer so the old records remain available */
+	old_buffer = cache->buffer;
+	if (cache->spare_buffer)
+		cache->buffer = cache->spare_buffer;
+	else
+		cache->buffer = init_buf(BUF_SIZE);
+	cache->spare_buffer = old_buffer;
+	set_buf_offset(cache->buffer, 0);
+	cache->recs = xmalloc(sizeof(job_info_cache_rec_t) *
+			      (list_count(job_list) + 1));
+	cache->rec_cnt = 0;
+
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		xassert (job_ptr->magic == JOB_MAGIC);
+
+		if (_hide_fed_job(job_ptr, show_flags))
+			continue;
+
+		rec = &cache->recs[cache->rec_cnt++];
+		rec->job_id  = job_ptr->job_id;
+		rec->user_id = job_ptr->user_id;
+		rec->offset  = get_buf_offset(cache->buffer);
+		rec->change_time = now;
+		old_rec = NULL;
+		if (old_cnt) {
+			old_rec = bsearch(rec, old_recs, old_cnt,
+					  sizeof(job_info_cache_rec_t),
+					  _job_info_cache_rec_cmp);
+		}
+
+		if (reuse && old_rec && (job_ptr->mod_seq <= cache->mod_seq)) {
+			packmem_array(get_buf_data(old_buffer) +
+				      old_rec->offset, old_rec->size,
+				      cache->buffer);
+			rec->size = old_rec->size;
+			rec->cksum = old_rec->cksum;
+			reuse_cnt++;
+		} else {
+			pack_job(job_ptr, show_flags, cache->buffer,
+				 protocol_version, (uid_t) 0);
+			rec->size = get_buf_offset(cache->buffer) -
+				    rec->offset;
+			rec->cksum = _buf_cksum(cache->buffer, rec->offset);
+		}
+
+		if (old_rec) {
+			if (old_rec->cksum == rec->cksum)
+				rec->change_time = old_rec->change_time;
+			old_rec->size = 0;	/* flag job as still present */
+		}
+	}
+	list_iterator_destroy(job_iterator);
+
+	/* Record jobs packed in the previous build but not this one */
+	for (i = 0, old_rec = old_recs; i < old_cnt; i++, old_rec++) {
+		if (old_rec->size == 0)
+			continue;
+		xrealloc(cache->purge_ids,
+			 sizeof(uint32_t) * (cache->purge_cnt + 1));
+		xrealloc(cache->purge_times,
+			 sizeof(time_t) * (cache->purge_cnt + 1));
+		cache->purge_ids[cache->purge_cnt]   = old_rec->job_id;
+		cache->purge_times[cache->purge_cnt] = now;
+		cache->purge_cnt++;
+	}
+	xfree(old_recs);
+
+	/* Forget removed jobs after JOB_INFO_DELTA_AGE, after which a delta
+	 * is no longer available for older responses */
+	for (i = 0; i < cache->purge_cnt; i++) {
+		if (cache->purge_times[i] >= purge_limit)
+			break;
+	}
+	if (i) {
+		cache->purge_cnt -= i;
+		memmove(cache->purge_ids, cache->purge_ids + i,
+			sizeof(uint32_t) * cache->purge_cnt);
+		memmove(cache->purge_times, cache->purge_times + i,
+			sizeof(time_t) * cache->purge_cnt);
+	}
+	cache->delta_time = MAX(cache->delta_time, purge_limit);
+
+	cache->cache_time       = now;
+	cache->last_conf_update = slurmctld_conf.last_update;
+	cache->last_job_update  = last_job_update;
+	cache->last_part_update = last_part_update;
+	cache->mod_seq          = job_mod_seq;
+	cache->protocol_version = protocol_version;
+	cache->show_flags       = show_flags;
+	cache->restricted_parts = (list_find_first(part_list,
+						   _find_restricted_part,
+						   NULL) != NULL);
+	cache->private_jobs     = ((slurmctld_conf.private_data &
+				    PRIVATE_DATA_JOBS) != 0);
+	cache->slurm_user_id    = slurmctld_conf.slurm_user_id;
+	END_TIMER2("_job_info_cache_build");
+	debug3("%s: packed %u jobs (%u unchanged) (show_flags=0x%x) %s",
+	       __func__, cache->rec_cnt, reuse_cnt, show_flags, TIME_STR);
+}
+
+/* Return true if a job information cache entry reflects the current job,
+ * partition and configuration records. Since update times only have a
+ * resolution of one second, an entry packed in the same second as the last
+ * update is never current. Expected start times of pending jobs are packed
+ * relative to the time of packing, so entries also expire after
+ * JOB_INFO_CACHE_AGE seconds. The update times are passed in so that
+ * callers not holding the slurmctld locks can pass those of the entry. */
+static bool _job_info_cache_current(job_info_cache_t *cache, time_t now,
+				    time_t job_update, time_t part_update,
+				    time_t conf_update)
+{
+	if ((cache->last_job_update == job_update) &&
+	    (cache->last_part_update == part_update) &&
+	    (cache->last_conf_update == conf_update) &&
+	    (cache->cache_time > job_update) &&
+	    (cache->cache_time > part_update) &&
+	    (difftime(now, cache->cache_time) < JOB_INFO_CACHE_AGE))
+		return true;
+	return false;
+}
+
+/* Return a current job_info_cache_t for the given show_flags and protocol
+ * version, rebuilding the stalest cache entry if none matches.
+ * Call with job_info_cache_mutex locked. */
+static job_info_cache_t *_job_info_cache_get(uint16_t show_flags,
+					     uint16_t protocol_version,
+					     time_t now)
+{
+	job_info_cache_t *cache, *old_cache = NULL;
+	int i;
+
+	for (i = 0; i < JOB_INFO_CACHE_CNT; i++) {
+		cache = &job_info_cache[i];
+		if (cache->buffer &&
+		    (cache->show_flags == show_flags) &&
+		    (cache->protocol_version == protocol_version)) {
+			if (_job_info_cache_current(cache, now,
+						    last_job_update,
+						    last_part_update,
+						    slurmctld_conf.
+						    last_update))
+				return cache;
+			old_cache = cache;
+			break;
+		}
+		if (!old_cache || !cache->buffer ||
+		    (old_cache->buffer &&
+		     (cache->cache_time < old_cache->cache_time)))
+			old_cache = cache;
+	}
+
+	_job_info_cache_build(old_cache, show_flags, protocol_version, now);
+	return old_cache;
+}
+
+/* Free memory used by the job information cache */
+static void _job_info_cache_fini(void)
+{
+	int i;
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	for (i = 0; i < JOB_INFO_CACHE_CNT; i++) {
+		if (job_info_cache[i].buffer)
+			free_buf(job_info_cache[i].buffer);
+		if (job_info_cache[i].spare_buffer)
+			free_buf(job_info_cache[i].spare_buffer);
+		xfree(job_info_cache[i].purge_ids);
+		xfree(job_info_cache[i].purge_times);
+		xfree(job_info_cache[i].recs);
+		memset(&job_info_cache[i], 0, sizeof(job_info_cache_t));
+	}
+	slurm_mutex_unlock(&job_info_cache_mutex);
+}
+
+/* Determine which filters apply to the job information cache records sent
+ * to a user. If filter_parts is set, call part_filter_clear() when done. */
+static void _job_info_filter_set(uint16_t show_flags, uid_t uid,
+				 bool *filter_parts, bool *filter_private)
+{
+	*filter_parts = false;
+	*filter_private = false;
+	if (((show_flags & SHOW_ALL) == 0) && (uid != 0)) {
+		part_filter_set(uid);
+		if (list_find_first(part_list, _find_hidden_part, NULL))
+			*filter_parts = true;
+		else
+			part_filter_clear();
+	}
+	if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
+	    !validate_operator(uid))
+		*filter_private = true;
+}
+
+/* Determine if a job information cache record should be hidden from a user
+ * given the filters from _job_info_filter_set() */
+static bool _job_info_rec_hidden(job_info_cache_rec_t *rec, uid_t uid,
+				 uint32_t filter_uid, uint16_t show_flags,
+				 bool filter_parts, bool filter_private)
+{
+	struct job_record *job_ptr;
+
+	if ((filter_uid != NO_VAL) && (filter_uid != rec->user_id))
+		return true;
+	if (filter_parts || filter_private) {
+		job_ptr = find_job_record(rec->job_id);
+		if (!job_ptr)
+			return true;
+		if (filter_parts && _all_parts_hidden(job_ptr))
+			return true;
+		if (filter_private && _hide_job(job_ptr, uid, show_flags))
+			return true;
+	}
+	return false;
+}
+
+/* Pack a pack_all_jobs() response from a job information cache entry.
+ * The cached records are copied in full when the user can see every job,
+ * otherwise only those records visible to the user are copied.
+ * Call with job_info_cache_mutex locked. */
+static void _pack_job_info_cache(job_info_cache_t *cache,
+				 char **buffer_ptr, int *buffer_size,
+				 uint16_t show_flags, uid_t uid,
+				 uint32_t filter_uid, bool filter_parts,
+				 bool filter_private, time_t now)
+{
+	job_info_cache_rec_t *rec;
+	uint32_t i, jobs_packed = 0, tmp_offset;
+	Buf buffer;
+
+	buffer = init_buf(get_buf_offset(cache->buffer) + BUF_SIZE);
+
+	/* write message body header : size and time */
+	/* put in a place holder job record count of 0 for now */
+	pack32(jobs_packed, buffer);
+	pack_time(now, buffer);
+
+	if (!filter_parts && !filter_private && (filter_uid == NO_VAL)) {
+		packmem_array(get_buf_data(cache->buffer),
+			      get_buf_offset(cache->buffer), buffer);
+		jobs_packed = cache->rec_cnt;
+	} else {
+		for (i = 0, rec = cache->recs; i < cache->rec_cnt;
+		     i++, rec++) {
+			if (_job_info_rec_hidden(rec, uid, filter_uid,
+						 show_flags, filter_parts,
+						 filter_private))
+				continue;
+			packmem_array(get_buf_data(cache->buffer) +
+				      rec->offset, rec->size, buffer);
+			jobs_packed++;
+		}
+	}
+
+	/* put the real record count in the message body header */
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
+/* Pack a pack_all_jobs_delta() response from a job information cache entry
+ * which knows the changes since last_update.
+ * Call with job_info_cache_mutex locked. */
+static void _pack_job_info_cache_delta(job_info_cache_t *cache,
+				       char **buffer_ptr, int *buffer_size,
+				       uint16_t show_flags, uid_t uid,
+				       time_t last_update, bool filter_parts,
+				       bool filter_private, time_t now)
+{
+	job_info_cache_rec_t *rec;
+	uint32_t i, purge_cnt = 0, send_cnt = 0, tmp_offset;
+	uint32_t *send_inx;
+	Buf buffer;
+
+	buffer = init_buf(BUF_SIZE);
+
+	/* write IDs of jobs to remove: purged jobs and those no longer
+	 * visible to the user, with a place holder count of 0 for now */
+	pack32(purge_cnt, buffer);
+	for (i = 0; i < cache->purge_cnt; i++) {
+		if (cache->purge_times[i] < last_update)
+			continue;
+		pack32(cache->purge_ids[i], buffer);
+		purge_cnt++;
+	}
+	send_inx = xmalloc(sizeof(uint32_t) * (cache->rec_cnt + 1));
+	for (i = 0, rec = cache->recs; i < cache->rec_cnt; i++, rec++) {
+		if (rec->change_time < last_update)
+			continue;
+		if (_job_info_rec_hidden(rec, uid, NO_VAL, show_flags,
+					 filter_parts, filter_private)) {
+			pack32(rec->job_id, buffer);
+			purge_cnt++;
+		} else
+			send_inx[send_cnt++] = i;
+	}
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(purge_cnt, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	/* write job information, as for pack_all_jobs() */
+	pack32(send_cnt, buffer);
+	pack_time(now, buffer);
+	for (i = 0; i < send_cnt; i++) {
+		rec = &cache->recs[send_inx[i]];
+		packmem_array(get_buf_data(cache->buffer) + rec->offset,
+			      rec->size, buffer);
+	}
+	debug3("%s: packed %u of %u jobs, %u removed since %u",
+	       __func__, send_cnt, cache->rec_cnt, purge_cnt,
+	       (uint32_t) last_update);
+	xfree(send_inx);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
+/* pack_all_jobs() for requests which can be satisfied from the job
+ * information cache */
+static void _pack_all_jobs_cached(char **buffer_ptr, int *buffer_size,
+				  uint16_t show_flags, uid_t uid,
+				  uint32_t filter_uid,
+				  uint16_t protocol_version)
+{
+	job_info_cache_t *cache;
+	bool filter_parts, filter_private;
+	time_t now = time(NULL);
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	cache = _job_info_cache_get(show_flags, protocol_version, now);
+	_job_info_filter_set(show_flags, uid, &filter_parts, &filter_private);
+	_pack_job_info_cache(cache, buffer_ptr, buffer_size, show_flags, uid,
+			     filter_uid, filter_parts, filter_private, now);
+	if (filter_parts)
+		part_filter_clear();
+	slurm_mutex_unlock(&job_info_cache_mutex);
+}
+
+/*
+ * pack_all_jobs_delta - dump job information for the jobs which changed
+ *	since a user's previous response, in machine independent form (for
+ *	network transmission as RESPONSE_JOB_INFO_DELTA). This is the IDs of
+ *	jobs to remove from the previous response, followed by job records as
+ *	packed by pack_all_jobs() for the jobs to add or replace.
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options, as used for the previous response
+ * IN uid - uid of user making request (for partition filtering)
+ * IN last_update - time of the user's previous response
+ * RET SLURM_SUCCESS or SLURM_ERROR if the changes since last_update are not
+ *	known, in which case pack_all_jobs() must be used instead
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: change _unpack_job_info_delta_msg() in common/slurm_protocol_pack.c
+ *	whenever the data format changes
+ */
+extern int pack_all_jobs_delta(char **buffer_ptr, int *buffer_size,
+			       uint16_t show_flags, uid_t uid,
+			       time_t last_update, uint16_t protocol_version)
+{
+	job_info_cache_t *cache;
+	bool filter_parts, filter_private;
+	time_t now = time(NULL);
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	/* Partition and configuration changes may alter which jobs are
+	 * visible without changing the jobs, so send everything */
+	if ((show_flags & SHOW_DETAIL2) || (last_update == 0) ||
+	    (last_update <= last_part_update) ||
+	    (last_update <= slurmctld_conf.last_update))
+		return SLURM_ERROR;
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	cache = _job_info_cache_get(show_flags, protocol_version, now);
+	if (last_update < cache->delta_time) {
+		slurm_mutex_unlock(&job_info_cache_mutex);
+		return SLURM_ERROR;
+	}
+	_job_info_filter_set(show_flags, uid, &filter_parts, &filter_private);
+	_pack_job_info_cache_delta(cache, buffer_ptr, buffer_size, show_flags,
+				   uid, last_update, filter_parts,
+				   filter_private, now);
+	if (filter_parts)
+		part_filter_clear();
+	slurm_mutex_unlock(&job_info_cache_mutex);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * pack_all_jobs_snapshot - dump job information as for pack_all_jobs() or
+ *	pack_all_jobs_delta(), but without holding any slurmctld locks while
+ *	packing. The response is packed from the job information cache as
+ *	last published by a locked request, so is only possible when the user
+ *	needs no partition or private data filtering, which would require the
+ *	partition and job records. No slurmctld locks are taken at all, so
+ *	that requests never queue behind the scheduler's job write lock.
+ *	Instead the update times recorded when the cache was published are
+ *	used, so the response may be up to JOB_INFO_CACHE_AGE seconds old.
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request
+ * IN last_response - time of the user's previous response, if any
+ * IN last_update - time of the user's previous response if a delta
+ *	response is wanted, otherwise zero
+ * OUT delta - set if a pack_all_jobs_delta() response was packed
+ * IN protocol_version - slurm protocol version of client
+ * RET SLURM_SUCCESS, SLURM_NO_CHANGE_IN_DATA if no job changed since
+ *	last_response or SLURM_ERROR if the locks must be taken
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern int pack_all_jobs_snapshot(char **buffer_ptr, int *buffer_size,
+				  uint16_t show_flags, uid_t uid,
+				  time_t last_response, time_t last_update,
+				  bool *delta, uint16_t protocol_version)
+{
+	job_info_cache_t *cache = NULL;
+	time_t now = time(NULL);
+	int i, rc = SLURM_SUCCESS;
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+	*delta = false;
+
+	if (show_flags & SHOW_DETAIL2)
+		return SLURM_ERROR;
+
+	slurm_mutex_lock(&job_info_cache_mutex);
+	for (i = 0; i < JOB_INFO_CACHE_CNT; i++) {
+		if (job_info_cache[i].buffer &&
+		    (job_info_cache[i].show_flags == show_flags) &&
+		    (job_info_cache[i].protocol_version == protocol_version)) {
+			cache = &job_info_cache[i];
+			break;
+		}
+	}
+	if (!cache ||
+	    !_job_info_cache_current(cache, now, cache->last_job_update,
+				     cache->last_part_update,
+				     cache->last_conf_update) ||
+	    (cache->restricted_parts && !(show_flags & SHOW_ALL) &&
+	     (uid != 0)) ||
+	    (cache->private_jobs && (uid != 0) &&
+	     (uid != cache->slurm_user_id))) {
+		rc = SLURM_ERROR;
+	} else if ((last_response - 1) >= cache->last_job_update) {
+		rc = SLURM_NO_CHANGE_IN_DATA;
+	} else if (last_update && (last_update > cache->last_part_update) &&
+		   (last_update > cache->last_conf_update) &&
+		   (last_update >= cache->delta_time)) {
+		_pack_job_info_cache_delta(cache, buffer_ptr, buffer_size,
+					   show_flags, uid, last_update,
+					   false, false, now);
+		*delta = true;
+	} else {
+		_pack_job_info_cache(cache, buffer_ptr, buffer_size,
+				     show_flags, uid, NO_VAL, false, false,
+				     now);
+	}
+	slurm_mutex_unlock(&job_info_cache_mutex);
+
+	return rc;
+}
+
 /*
  * pack_all_jobs - dump all job information for all jobs in
  *	machine independent form (for network transmission)
@@ -8487,6 +9644,14 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
 
+	/* The batch script is only packed for its owner, so leave
+	 * SHOW_DETAIL2 requests out of the cache */
+	if (!(show_flags & SHOW_DETAIL2)) {
+		_pack_all_jobs_cached(buffer_ptr, buffer_size, show_flags,
+				      uid, filter_uid, protocol_version);
+		return;
+	}
+
 	buffer = init_buf(BUF_SIZE);
 
 	/* write message body header : size and time */
@@ -8577,7 +9742,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 			}
 		}
 
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = id_hash_find(job_array_hash_j, job_id);
 		while (job_ptr) {
 			if ((job_ptr->job_id == job_id) && packed_head) {
 				;	/* Already packed */
@@ -9837,10 +11002,9 @@ void reset_job_bitmaps(void)
 			error("select_g_select_nodeinfo_set(%u): %m",
 			      job_ptr->job_id);
 		}
+		job_modified(job_ptr, now);
 	}
 	list_iterator_destroy(job_iterator);
-
-	last_job_update = now;
 }
 
 static int _reset_detail_bitmaps(struct job_record *job_ptr)
@@ -10228,7 +11392,7 @@ static int _update_job(struct job_record *job_ptr, job_desc_msg_t * job_specs,
 		if (IS_JOB_COMPLETED(job_ptr) && authorized &&
 		    (job_specs->burst_buffer[0] == '\0')) {
 			xfree(job_ptr->burst_buffer);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 		} else {
 			error_code = ESLURM_NOT_SUPPORTED;
 		}
@@ -10280,7 +11444,7 @@ static int _update_job(struct job_record *job_ptr, job_desc_msg_t * job_specs,
 	detail_ptr = job_ptr->details;
 	if (detail_ptr)
 		mc_ptr = detail_ptr->mc_ptr;
-	last_job_update = now;
+	job_modified(job_ptr, now);
 
 	memset(tres_req_cnt, 0, sizeof(tres_req_cnt));
 	job_specs->tres_req_cnt = tres_req_cnt;
@@ -12222,7 +13386,7 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 		}
 
 		/* Update all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = id_hash_find(job_array_hash_j, job_id);
 		if (!job_ptr && !job_ptr_done) {
 			info("update_job_str: invalid job id %u", job_id);
 			rc = ESLURM_INVALID_JOB_ID;
@@ -13061,7 +14225,7 @@ static void _validate_job_files(List batch_dirs)
 		}
 		if (job_ptr && job_ptr->array_recs) { /* Update all tasks */
 			array_job_id = job_ptr->array_job_id;
-			job_ptr = job_array_hash_j[JOB_HASH_INX(array_job_id)];
+			job_ptr = id_hash_find(job_array_hash_j, array_job_id);
 			while (job_ptr) {
 				if (job_ptr->array_job_id == array_job_id)
 					job_ptr->bit_flags |= HAS_STATE_DIR;
@@ -13222,6 +14386,7 @@ extern bool job_epilog_complete(uint32_t job_id, char *node_name,
 #endif
 		return false;
 	}
+	job_modified(job_ptr, time(NULL));
 
 #ifdef HAVE_FRONT_END
 	xassert(job_ptr->batch_host);
@@ -13373,10 +14538,16 @@ void batch_requeue_fini(struct job_record  *job_ptr)
 /* job_fini - free all memory associated with job records */
 void job_fini (void)
 {
+	_job_info_cache_fini();
 	FREE_NULL_LIST(job_list);
-	xfree(job_hash);
-	xfree(job_array_hash_j);
-	xfree(job_array_hash_t);
+	id_hash_free(job_hash);
+	job_hash = NULL;
+	id_hash_free(job_array_hash_j);
+	job_array_hash_j = NULL;
+	id_hash_free(job_array_hash_t);
+	job_array_hash_t = NULL;
+	xfree(purged_job_ids);
+	purged_job_cnt = purged_job_size = 0;
 	FREE_NULL_BITMAP(requeue_exit);
 	FREE_NULL_BITMAP(requeue_exit_hold);
 }
@@ -13460,6 +14631,7 @@ extern void job_completion_logger(struct job_record *job_ptr, bool requeue)
 
 	xassert(job_ptr);
 
+	job_modified(job_ptr, time(NULL));
 	acct_policy_remove_job_submit(job_ptr);
 	if (job_ptr->nodes) {
 		(void) bb_g_job_start_stage_out(job_ptr);
@@ -13879,7 +15051,8 @@ static int _suspend_job_nodes(struct job_record *job_ptr, bool indf_susp)
 			node_ptr->last_idle  = now;
 		}
 	}
-	last_job_update = last_node_update = now;
+	job_modified(job_ptr, now);
+	last_node_update = last_job_update;
 	return rc;
 }
 
@@ -13927,7 +15100,8 @@ static int _resume_job_nodes(struct job_record *job_ptr, bool indf_susp)
 		node_flags = node_ptr->node_state & NODE_STATE_FLAGS;
 		node_ptr->node_state = NODE_STATE_ALLOCATED | node_flags;
 	}
-	last_job_update = last_node_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
+	last_node_update = last_job_update;
 	return rc;
 }
 
@@ -14226,7 +15400,7 @@ extern int job_suspend2(suspend_msg_t *sus_ptr, uid_t uid,
 		}
 
 		/* Suspend all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = id_hash_find(job_array_hash_j, job_id);
 		if (!job_ptr && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
@@ -14356,7 +15530,7 @@ static int _job_requeue(uid_t uid, struct job_record *job_ptr, bool preempt,
 		return ESLURM_JOB_PENDING;
 
 	slurm_sched_g_requeue(job_ptr, "Job requeued by user/admin");
-	last_job_update = now;
+	job_modified(job_ptr, now);
 
 	/* In the job is in the process of completing
 	 * return SLURM_SUCCESS and set the status
@@ -14581,7 +15755,7 @@ extern int job_requeue2(uid_t uid, requeue_msg_t *req_ptr,
 		}
 
 		/* Requeue all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = id_hash_find(job_array_hash_j, job_id);
 		if (!job_ptr && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
@@ -14730,8 +15904,9 @@ static int _set_top(struct job_record *job_ptr, uid_t uid)
 			job_test_ptr->priority -= adj_prio;
 			job_test_ptr->details->nice += adj_prio;
 			delta_nice -= adj_prio;
+			job_modified(job_test_ptr, time(NULL));
 		}
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 	xfree(job_adj_list);
 
@@ -15050,7 +16225,7 @@ extern int update_job_account(char *module, struct job_record *job_ptr,
 	}
 	job_ptr->assoc_id = assoc_rec.id;
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 
 	return SLURM_SUCCESS;
 }
@@ -15114,7 +16289,7 @@ extern int update_job_wckey(char *module, struct job_record *job_ptr,
 		     module, job_ptr->job_id);
 	}
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 
 	return SLURM_SUCCESS;
 }
@@ -15242,7 +16417,7 @@ extern int job_checkpoint(checkpoint_msg_t *ckpt_ptr, uid_t uid,
 				   &resp_data.error_msg);
 		info("checkpoint_op %u of %u.%u complete, rc=%d",
 		     ckpt_ptr->op, ckpt_ptr->job_id, ckpt_ptr->step_id, rc);
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	} else {		/* operate on all of a job's steps */
 		int update_rc = -2;
 		ListIterator step_iterator;
@@ -15276,7 +16451,7 @@ extern int job_checkpoint(checkpoint_msg_t *ckpt_ptr, uid_t uid,
 			xfree(image_dir);
 		}
 		if (update_rc != -2)	/* some work done */
-			last_job_update = time(NULL);
+			job_modified(job_ptr, time(NULL));
 		list_iterator_destroy (step_iterator);
 	}
 
@@ -15704,7 +16879,7 @@ extern int job_restart(checkpoint_msg_t *ckpt_ptr, uid_t uid, int conn_fd,
 		job_ptr->details->restart_dir = image_dir;
 		image_dir = NULL;	/* Nothing left to xfree */
 
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 
  unpack_error:
@@ -16135,7 +17310,7 @@ _kill_dependent(struct job_record *job_ptr)
 	job_ptr->start_time = now;
 	job_ptr->end_time = now;
 	job_completion_logger(job_ptr, false);
-	last_job_update = now;
+	job_modified(job_ptr, now);
 	srun_allocate_abort(job_ptr);
 }
 
@@ -305,7 +305,7 @@ static bool _job_runnable_test1(struct job_record *job_ptr, bool sched_plugin)
 	if (job_ptr->state_reason == WAIT_FRONT_END) {
 		job_ptr->state_reason = WAIT_NO_REASON;
 		xfree(job_ptr->state_desc);
-		last_job_update = now;
+		job_modified(job_ptr, now);
 	}
 #endif
 
@@ -320,7 +320,7 @@ static bool _job_runnable_test1(struct job_record *job_ptr, bool sched_plugin)
 		    && job_ptr->state_reason != WAIT_MAX_REQUEUE) {
 			job_ptr->state_reason = WAIT_HELD;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 		}
 		debug3("sched: JobId=%u. State=%s. Reason=%s. Priority=%u.",
 		       job_ptr->job_id,
@@ -536,7 +536,7 @@ extern List build_job_queue(bool clear_start, bool backfill)
 				    (reason != job_ptr->state_reason)) {
 					job_ptr->state_reason = reason;
 					xfree(job_ptr->state_desc);
-					last_job_update = now;
+					job_modified(job_ptr, now);
 				}
 				/* priority_array index matches part_ptr_list
 				 * position: increment inx */
@@ -816,7 +816,7 @@ next_part:		part_ptr = (struct part_record *)
 				job_ptr->state_reason = WAIT_NO_REASON;
 				xfree(job_ptr->state_desc);
 				job_ptr->assoc_id = assoc_rec.id;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 			} else {
 				continue;
 			}
@@ -832,12 +832,12 @@ next_part:		part_ptr = (struct part_record *)
 					job_ptr->job_id);
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = FAIL_QOS;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				continue;
 			} else if (job_ptr->state_reason == FAIL_QOS) {
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = WAIT_NO_REASON;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 			}
 		}
 
@@ -847,7 +847,7 @@ next_part:		part_ptr = (struct part_record *)
 		    || (job_ptr->state_reason == WAIT_QOS_TIME_LIMIT)) {
 			job_ptr->state_reason = WAIT_NO_REASON;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 		}
 
 		if ((job_ptr->state_reason == WAIT_NODE_NOT_AVAIL) &&
@@ -866,7 +866,7 @@ next_part:		part_ptr = (struct part_record *)
 		if (license_job_test(job_ptr, now) != SLURM_SUCCESS) {
 			job_ptr->state_reason = WAIT_LICENSES;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			continue;
 		}
 
@@ -879,7 +879,7 @@ next_part:		part_ptr = (struct part_record *)
 			 * very rare. */
 			info("sched: JobId=%u has invalid account",
 			     job_ptr->job_id);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			job_ptr->state_reason = FAIL_ACCOUNT;
 			xfree(job_ptr->state_desc);
 			continue;
@@ -910,7 +910,7 @@ next_part:		part_ptr = (struct part_record *)
 		bit_free(job_ptr->details->exc_node_bitmap);
 		job_ptr->details->exc_node_bitmap = orig_exc_bitmap;
 		if (error_code == SLURM_SUCCESS) {
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			info("sched: Allocate JobId=%u Partition=%s NodeList=%s #CPUs=%u",
 			     job_ptr->job_id, job_ptr->part_ptr->name,
 			     job_ptr->nodes, job_ptr->total_cpus);
@@ -1155,7 +1155,7 @@ extern bool deadline_ok(struct job_record *job_ptr, char *func)
 		}
 	}
 	if (fail_job) {
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		job_ptr->job_state = JOB_DEADLINE;
 		job_ptr->exit_code = 1;
 		job_ptr->state_reason = FAIL_DEADLINE;
@@ -1517,7 +1517,7 @@ static int _schedule(uint32_t job_limit)
 			if (!avail_front_end(job_ptr)) {
 				job_ptr->state_reason = WAIT_FRONT_END;
 				xfree(job_ptr->state_desc);
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				continue;
 			}
 			if (!_job_runnable_test1(job_ptr, false))
@@ -1553,7 +1553,7 @@ next_part:			part_ptr = (struct part_record *)
 			if (!avail_front_end(job_ptr)) {
 				job_ptr->state_reason = WAIT_FRONT_END;
 				xfree(job_ptr->state_desc);
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				continue;
 			}
 			if ((job_ptr->array_task_id != array_task_id) &&
@@ -1660,7 +1660,7 @@ next_task:
 					     failed_part_cnt)) {
 			job_ptr->state_reason = WAIT_PRIORITY;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			debug("sched: JobId=%u. State=PENDING. "
 			       "Reason=Priority, Priority=%u. Partition=%s.",
 			       job_ptr->job_id, job_ptr->priority,
@@ -1685,7 +1685,7 @@ next_task:
 				job_ptr->state_reason = WAIT_NO_REASON;
 				xfree(job_ptr->state_desc);
 				job_ptr->assoc_id = assoc_rec.id;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 			} else {
 				debug("sched: JobId=%u has invalid association",
 				      job_ptr->job_id);
@@ -1707,12 +1707,12 @@ next_task:
 				      job_ptr->job_id);
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = FAIL_QOS;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				continue;
 			} else if (job_ptr->state_reason == FAIL_QOS) {
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = WAIT_NO_REASON;
-				last_job_update = now;
+				job_modified(job_ptr, now);
 			}
 		}
 
@@ -1763,7 +1763,7 @@ next_task:
 			 * reserved for jobs in higher priority partition */
 			job_ptr->state_reason = WAIT_RESOURCES;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			debug3("sched: JobId=%u. State=%s. Reason=%s. "
 			       "Priority=%u. Partition=%s.",
 			       job_ptr->job_id,
@@ -1776,7 +1776,7 @@ next_task:
 		if (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS) {
 			job_ptr->state_reason = WAIT_LICENSES;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			debug3("sched: JobId=%u. State=%s. Reason=%s. "
 			       "Priority=%u.",
 			       job_ptr->job_id,
@@ -1795,7 +1795,7 @@ next_task:
 			 * very rare. */
 			info("sched: JobId=%u has invalid account",
 			     job_ptr->job_id);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			job_ptr->state_reason = FAIL_ACCOUNT;
 			xfree(job_ptr->state_desc);
 			continue;
@@ -1863,7 +1863,7 @@ next_task:
 		} else if (error_code == SLURM_SUCCESS) {
 			/* job initiated */
 			debug3("sched: JobId=%u initiated", job_ptr->job_id);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			reject_array_job_id = 0;
 			reject_array_part   = NULL;
 
@@ -1933,7 +1933,7 @@ next_task:
 			     jobid2str(job_ptr, jbuf, sizeof(jbuf)),
 			     slurm_strerror(error_code));
 			if (!wiki_sched) {
-				last_job_update = now;
+				job_modified(job_ptr, now);
 				job_ptr->job_state = JOB_PENDING;
 				job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 				xfree(job_ptr->state_desc);
@@ -4244,6 +4244,7 @@ cleanup_completing(struct job_record *job_ptr)
 
 	delete_step_records(job_ptr);
 	job_ptr->job_state &= (~JOB_COMPLETING);
+	job_modified(job_ptr, time(NULL));
 	job_hold_requeue(job_ptr);
 
 	slurm_sched_g_schedule();
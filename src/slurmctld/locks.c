@@ -40,142 +40,166 @@
 #include <errno.h>
 #include <pthread.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
+#include "src/common/xstring.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
+/* Statistics for one lock type in one mode (read or write) */
+typedef struct {
+	uint32_t cnt;			/* locks granted */
+	uint32_t wait_cnt;		/* locks granted after waiting */
+	uint64_t wait_usec;		/* total time waiting for lock */
+	uint64_t hold_usec;		/* total time lock held */
+} lock_stat_t;
+
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t locks_cond[ENTITY_COUNT];
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t state_cond = PTHREAD_COND_INITIALIZER;
+static int state_shared_cnt = 0;	/* lock_state_files_shared() holders */
+static bool state_locked = false;	/* lock_state_files() held */
 
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
 
-static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
+static char *lock_names[ENTITY_COUNT] = {
+	"config", "job", "node", "partition", "federation" };
+
+/* Protected by locks_mutex */
+static lock_stat_t lock_stats[ENTITY_COUNT][2];	/* [lock][READ or WRITE] */
+static struct timeval read_tv[ENTITY_COUNT];	/* first reader granted */
+static struct timeval write_tv[ENTITY_COUNT];	/* writer granted */
+static lock_site_t *write_site[ENTITY_COUNT];	/* writer's call site */
+
+/* Call sites which have taken locks. Sites are only ever added at the head,
+ * so the list can be walked without lock_site_mutex once its head is read */
+static pthread_mutex_t lock_site_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lock_site_t *lock_site_list = NULL;
+static int lock_site_cnt = 0;
+
+static void _lock_levels(slurmctld_lock_t *lock_levels,
+			 lock_level_t *levels);
+static void _stat_site(lock_site_t *site, uint64_t wait_usec,
+		       uint64_t hold_usec);
+static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock,
+		       bool timing, uint64_t *wait_usec);
 static void _wr_rdunlock(lock_datatype_t datatype);
-static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
-static void _wr_wrunlock(lock_datatype_t datatype);
+static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock,
+		       bool timing, lock_site_t *site, uint64_t *wait_usec);
+static void _wr_wrunlock(lock_datatype_t datatype, lock_site_t **site,
+			 uint64_t *hold_usec);
 
 /* init_locks - create locks used for slurmctld data structure access
  *	control */
 void init_locks(void)
 {
+	int i;
+
 	/* just clear all semaphores */
 	memset((void *) &slurmctld_locks, 0, sizeof(slurmctld_locks));
+	for (i = 0; i < ENTITY_COUNT; i++)
+		slurm_cond_init(&locks_cond[i], NULL);
 }
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld(slurmctld_lock_t lock_levels)
+/* Expand lock_levels into an array indexed by lock_datatype_t, which is the
+ * order in which the locks must be taken */
+static void _lock_levels(slurmctld_lock_t *lock_levels, lock_level_t *levels)
 {
-	if (lock_levels.config == READ_LOCK)
-		(void) _wr_rdlock(CONFIG_LOCK, true);
-	else if (lock_levels.config == WRITE_LOCK)
-		(void) _wr_wrlock(CONFIG_LOCK, true);
-
-	if (lock_levels.job == READ_LOCK)
-		(void) _wr_rdlock(JOB_LOCK, true);
-	else if (lock_levels.job == WRITE_LOCK)
-		(void) _wr_wrlock(JOB_LOCK, true);
-
-	if (lock_levels.node == READ_LOCK)
-		(void) _wr_rdlock(NODE_LOCK, true);
-	else if (lock_levels.node == WRITE_LOCK)
-		(void) _wr_wrlock(NODE_LOCK, true);
-
-	if (lock_levels.partition == READ_LOCK)
-		(void) _wr_rdlock(PART_LOCK, true);
-	else if (lock_levels.partition == WRITE_LOCK)
-		(void) _wr_wrlock(PART_LOCK, true);
-
-	if (lock_levels.federation == READ_LOCK)
-		(void) _wr_rdlock(FED_LOCK, true);
-	else if (lock_levels.federation == WRITE_LOCK)
-		(void) _wr_wrlock(FED_LOCK, true);
+	levels[CONFIG_LOCK] = lock_levels->config;
+	levels[JOB_LOCK]    = lock_levels->job;
+	levels[NODE_LOCK]   = lock_levels->node;
+	levels[PART_LOCK]   = lock_levels->partition;
+	levels[FED_LOCK]    = lock_levels->federation;
 }
 
-/* try_lock_slurmctld - equivalent to lock_slurmctld() except
- * RET 0 on success or -1 if the locks are currently not available */
-extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
+static uint64_t _delta_usec(struct timeval *tv1, struct timeval *tv2)
 {
-	bool success = true;
-
-	if (lock_levels.config == READ_LOCK)
-		success = _wr_rdlock(CONFIG_LOCK, false);
-	else if (lock_levels.config == WRITE_LOCK)
-		success = _wr_wrlock(CONFIG_LOCK, false);
-	if (!success)
-		return -1;
+	return ((tv2->tv_sec - tv1->tv_sec) * 1000000) +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
 
-	if (lock_levels.job == READ_LOCK)
-		success = _wr_rdlock(JOB_LOCK, false);
-	else if (lock_levels.job == WRITE_LOCK)
-		success = _wr_wrlock(JOB_LOCK, false);
-	if (!success) {
-		if (lock_levels.config == READ_LOCK)
-			_wr_rdunlock(CONFIG_LOCK);
-		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
-		return -1;
+/* Add to a call site's statistics, listing the site on its first use.
+ * Only the site's own mutex is held while updating it. */
+static void _stat_site(lock_site_t *site, uint64_t wait_usec,
+		       uint64_t hold_usec)
+{
+	slurm_mutex_lock(&site->mutex);
+	if (!site->listed) {
+		slurm_mutex_lock(&lock_site_mutex);
+		site->next = lock_site_list;
+		lock_site_list = site;
+		lock_site_cnt++;
+		slurm_mutex_unlock(&lock_site_mutex);
+		site->listed = true;
 	}
-
-	if (lock_levels.node == READ_LOCK)
-		success = _wr_rdlock(NODE_LOCK, false);
-	else if (lock_levels.node == WRITE_LOCK)
-		success = _wr_wrlock(NODE_LOCK, false);
-	if (!success) {
-		if (lock_levels.job == READ_LOCK)
-			_wr_rdunlock(JOB_LOCK);
-		else if (lock_levels.job == WRITE_LOCK)
-			_wr_wrunlock(JOB_LOCK);
-		if (lock_levels.config == READ_LOCK)
-			_wr_rdunlock(CONFIG_LOCK);
-		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
-		return -1;
+	if (hold_usec) {
+		site->hold_usec += hold_usec;
+		if (site->hold_max < hold_usec)
+			site->hold_max = hold_usec;
+	} else {
+		site->cnt++;
+		site->wait_usec += wait_usec;
+		if (site->wait_max < wait_usec)
+			site->wait_max = wait_usec;
 	}
+	slurm_mutex_unlock(&site->mutex);
+}
 
-	if (lock_levels.partition == READ_LOCK)
-		success = _wr_rdlock(PART_LOCK, false);
-	else if (lock_levels.partition == WRITE_LOCK)
-		success = _wr_wrlock(PART_LOCK, false);
-	if (!success) {
-		if (lock_levels.node == READ_LOCK)
-			_wr_rdunlock(NODE_LOCK);
-		else if (lock_levels.node == WRITE_LOCK)
-			_wr_wrunlock(NODE_LOCK);
-		if (lock_levels.job == READ_LOCK)
-			_wr_rdunlock(JOB_LOCK);
-		else if (lock_levels.job == WRITE_LOCK)
-			_wr_wrunlock(JOB_LOCK);
-		if (lock_levels.config == READ_LOCK)
-			_wr_rdunlock(CONFIG_LOCK);
-		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
-		return -1;
+/* lock_slurmctld_site - Issue the required lock requests in a well defined
+ *	order, recording statistics for the call site */
+extern void lock_slurmctld_site(slurmctld_lock_t lock_levels,
+				lock_site_t *site)
+{
+	lock_level_t levels[ENTITY_COUNT];
+	uint64_t wait_usec = 0;
+	bool timing;
+	int i;
+
+	/* Hold times need the time of every lock granted, so are only
+	 * recorded with DebugFlags=Locks. The flag is read without the config
+	 * lock, a stale value only affects the statistics. */
+	timing = ((slurmctld_conf.debug_flags & DEBUG_FLAG_LOCKS) != 0);
+	_lock_levels(&lock_levels, levels);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		if (levels[i] == READ_LOCK)
+			(void) _wr_rdlock(i, true, timing, &wait_usec);
+		else if (levels[i] == WRITE_LOCK)
+			(void) _wr_wrlock(i, true, timing, site, &wait_usec);
 	}
+	_stat_site(site, wait_usec, 0);
+}
 
-	if (lock_levels.federation == READ_LOCK)
-		success = _wr_rdlock(FED_LOCK, false);
-	else if (lock_levels.federation == WRITE_LOCK)
-		success = _wr_wrlock(FED_LOCK, false);
+/* try_lock_slurmctld - equivalent to lock_slurmctld() except
+ * RET 0 on success or -1 if the locks are currently not available */
+extern int try_lock_slurmctld(slurmctld_lock_t lock_levels)
+{
+	lock_level_t levels[ENTITY_COUNT];
+	uint64_t wait_usec = 0;
+	bool success = true, timing;
+	int i;
+
+	timing = ((slurmctld_conf.debug_flags & DEBUG_FLAG_LOCKS) != 0);
+	_lock_levels(&lock_levels, levels);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		if (levels[i] == READ_LOCK)
+			success = _wr_rdlock(i, false, timing, &wait_usec);
+		else if (levels[i] == WRITE_LOCK)
+			success = _wr_wrlock(i, false, timing, NULL,
+					     &wait_usec);
+		if (!success)
+			break;
+	}
 	if (!success) {
-		if (lock_levels.partition == READ_LOCK)
-			_wr_rdunlock(PART_LOCK);
-		else if (lock_levels.partition == WRITE_LOCK)
-			_wr_wrunlock(PART_LOCK);
-		if (lock_levels.node == READ_LOCK)
-			_wr_rdunlock(NODE_LOCK);
-		else if (lock_levels.node == WRITE_LOCK)
-			_wr_wrunlock(NODE_LOCK);
-		if (lock_levels.job == READ_LOCK)
-			_wr_rdunlock(JOB_LOCK);
-		else if (lock_levels.job == WRITE_LOCK)
-			_wr_wrunlock(JOB_LOCK);
-		if (lock_levels.config == READ_LOCK)
-			_wr_rdunlock(CONFIG_LOCK);
-		else if (lock_levels.config == WRITE_LOCK)
-			_wr_wrunlock(CONFIG_LOCK);
+		/* Release the locks already taken, in reverse order */
+		while (--i >= 0) {
+			if (levels[i] == READ_LOCK)
+				_wr_rdunlock(i);
+			else if (levels[i] == WRITE_LOCK)
+				_wr_wrunlock(i, NULL, NULL);
+		}
 		return -1;
 	}
 
@@ -186,30 +210,27 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
  *	defined order */
 extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 {
-	if (lock_levels.federation == READ_LOCK)
-		_wr_rdunlock(FED_LOCK);
-	else if (lock_levels.federation == WRITE_LOCK)
-		_wr_wrunlock(FED_LOCK);
-
-	if (lock_levels.partition == READ_LOCK)
-		_wr_rdunlock(PART_LOCK);
-	else if (lock_levels.partition == WRITE_LOCK)
-		_wr_wrunlock(PART_LOCK);
-
-	if (lock_levels.node == READ_LOCK)
-		_wr_rdunlock(NODE_LOCK);
-	else if (lock_levels.node == WRITE_LOCK)
-		_wr_wrunlock(NODE_LOCK);
-
-	if (lock_levels.job == READ_LOCK)
-		_wr_rdunlock(JOB_LOCK);
-	else if (lock_levels.job == WRITE_LOCK)
-		_wr_wrunlock(JOB_LOCK);
-
-	if (lock_levels.config == READ_LOCK)
-		_wr_rdunlock(CONFIG_LOCK);
-	else if (lock_levels.config == WRITE_LOCK)
-		_wr_wrunlock(CONFIG_LOCK);
+	lock_level_t levels[ENTITY_COUNT];
+	lock_site_t *site = NULL, *tmp_site;
+	uint64_t hold_usec = 0, tmp_usec;
+	int i;
+
+	_lock_levels(&lock_levels, levels);
+	for (i = ENTITY_COUNT - 1; i >= 0; i--) {
+		if (levels[i] == READ_LOCK)
+			_wr_rdunlock(i);
+		else if (levels[i] == WRITE_LOCK) {
+			_wr_wrunlock(i, &tmp_site, &tmp_usec);
+			if (tmp_site && tmp_usec) {
+				site = tmp_site;
+				hold_usec = tmp_usec;
+			}
+		}
+	}
+	/* Hold times by call site are only known for write locks, which
+	 * have a single holder. Record that of the first lock in order. */
+	if (site)
+		_stat_site(site, 0, hold_usec);
 }
 
 /* _wr_rdlock - Issue a read lock on the specified data type
@@ -220,9 +241,12 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
  *	read locks. To prevent this, read locks were permitted to be satisified
  *	after 10 consecutive write locks. This prevented starvation, but
  *	deadlock has been observed with some values for the count. */
-static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
+static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock,
+		       bool timing, uint64_t *wait_usec)
 {
-	bool success = true;
+	struct timeval tv1, tv2;
+	bool success = true, waited = false;
+	lock_stat_t *stat = &lock_stats[datatype][0];
 
 	slurm_mutex_lock(&locks_mutex);
 	while (1) {
@@ -242,11 +266,32 @@ static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			slurm_cond_wait(&locks_cond, &locks_mutex);
+			if (!waited) {
+				/* Only time a request which must wait */
+				gettimeofday(&tv1, NULL);
+				waited = true;
+			}
+			slurm_cond_wait(&locks_cond[datatype], &locks_mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
+	if (success) {
+		stat->cnt++;
+		if (waited || (timing &&
+			       (slurmctld_locks.entity[read_lock(datatype)] ==
+				1)))
+			gettimeofday(&tv2, NULL);
+		if (waited) {
+			stat->wait_cnt++;
+			stat->wait_usec += _delta_usec(&tv1, &tv2);
+			*wait_usec += _delta_usec(&tv1, &tv2);
+		}
+		/* Read hold time is the time with any reader */
+		if (timing &&
+		    (slurmctld_locks.entity[read_lock(datatype)] == 1))
+			read_tv[datatype] = tv2;
+	}
 	slurm_mutex_unlock(&locks_mutex);
 	return success;
 }
@@ -254,16 +299,28 @@ static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
 static void _wr_rdunlock(lock_datatype_t datatype)
 {
+	struct timeval now;
+
 	slurm_mutex_lock(&locks_mutex);
 	slurmctld_locks.entity[read_lock(datatype)]--;
-	slurm_cond_broadcast(&locks_cond);
+	if ((slurmctld_locks.entity[read_lock(datatype)] == 0) &&
+	    read_tv[datatype].tv_sec) {
+		gettimeofday(&now, NULL);
+		lock_stats[datatype][0].hold_usec +=
+			_delta_usec(&read_tv[datatype], &now);
+		read_tv[datatype].tv_sec = 0;
+	}
+	slurm_cond_broadcast(&locks_cond[datatype]);
 	slurm_mutex_unlock(&locks_mutex);
 }
 
 /* _wr_wrlock - Issue a write lock on the specified data type */
-static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
+static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock,
+		       bool timing, lock_site_t *site, uint64_t *wait_usec)
 {
-	bool success = true;
+	struct timeval tv1, tv2;
+	bool success = true, waited = false;
+	lock_stat_t *stat = &lock_stats[datatype][1];
 
 	slurm_mutex_lock(&locks_mutex);
 	slurmctld_locks.entity[write_wait_lock(datatype)]++;
@@ -280,21 +337,58 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			slurm_cond_wait(&locks_cond, &locks_mutex);
+			if (!waited) {
+				/* Only time a request which must wait */
+				gettimeofday(&tv1, NULL);
+				waited = true;
+			}
+			slurm_cond_wait(&locks_cond[datatype], &locks_mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
+	if (success) {
+		stat->cnt++;
+		if (waited || timing)
+			gettimeofday(&tv2, NULL);
+		if (waited) {
+			stat->wait_cnt++;
+			stat->wait_usec += _delta_usec(&tv1, &tv2);
+			*wait_usec += _delta_usec(&tv1, &tv2);
+		}
+		if (timing)
+			write_tv[datatype] = tv2;
+		else
+			write_tv[datatype].tv_sec = 0;
+		write_site[datatype] = site;
+	}
 	slurm_mutex_unlock(&locks_mutex);
 	return success;
 }
 
-/* _wr_wrunlock - Issue a write unlock on the specified data type */
-static void _wr_wrunlock(lock_datatype_t datatype)
+/* _wr_wrunlock - Issue a write unlock on the specified data type
+ * OUT site - call site which took the lock, if known and timed
+ * OUT hold_usec - time lock held, if timed */
+static void _wr_wrunlock(lock_datatype_t datatype, lock_site_t **site,
+			 uint64_t *hold_usec)
 {
+	struct timeval now;
+	uint64_t usec = 0;
+
 	slurm_mutex_lock(&locks_mutex);
 	slurmctld_locks.entity[write_lock(datatype)]--;
-	slurm_cond_broadcast(&locks_cond);
+	if (write_tv[datatype].tv_sec) {
+		gettimeofday(&now, NULL);
+		usec = _delta_usec(&write_tv[datatype], &now);
+		lock_stats[datatype][1].hold_usec += usec;
+		write_tv[datatype].tv_sec = 0;
+	}
+	if (site)
+		*site = write_site[datatype];
+	if (hold_usec)
+		*hold_usec = usec;
+	write_site[datatype] = NULL;
+	slurm_cond_broadcast(&locks_cond[datatype]);
 	slurm_mutex_unlock(&locks_mutex);
 }
 
@@ -310,16 +404,132 @@ void get_lock_values(slurmctld_lock_flags_t * lock_flags)
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads(void)
 {
+	int i;
+
 	kill_thread = 1;
-	slurm_cond_broadcast(&locks_cond);
+	for (i = 0; i < ENTITY_COUNT; i++)
+		slurm_cond_broadcast(&locks_cond[i]);
 }
 
-/* un/lock semaphore used for saving state of slurmctld */
+/* un/lock semaphore used for saving state of slurmctld.
+ * Shared holders are never made to wait for a pending exclusive request,
+ * so the state save thread's writers are not delayed by loads. */
 extern void lock_state_files(void)
 {
 	slurm_mutex_lock(&state_mutex);
+	while (state_locked || state_shared_cnt)
+		slurm_cond_wait(&state_cond, &state_mutex);
+	state_locked = true;
+	slurm_mutex_unlock(&state_mutex);
+}
+extern void lock_state_files_shared(void)
+{
+	slurm_mutex_lock(&state_mutex);
+	while (state_locked)
+		slurm_cond_wait(&state_cond, &state_mutex);
+	state_shared_cnt++;
+	slurm_mutex_unlock(&state_mutex);
 }
 extern void unlock_state_files(void)
 {
+	slurm_mutex_lock(&state_mutex);
+	if (state_locked)
+		state_locked = false;
+	else
+		state_shared_cnt--;
+	slurm_cond_broadcast(&state_cond);
 	slurm_mutex_unlock(&state_mutex);
 }
+
+/* pack_lock_stats - pack lock statistics, as reported by sdiag */
+extern void pack_lock_stats(Buf buffer, uint16_t protocol_version)
+{
+	uint32_t cnt[ENTITY_COUNT * 2], wait_cnt[ENTITY_COUNT * 2];
+	uint64_t wait_usec[ENTITY_COUNT * 2], hold_usec[ENTITY_COUNT * 2];
+	char **site_names;
+	uint32_t *site_cnt;
+	uint64_t *site_wait, *site_wait_max, *site_hold, *site_hold_max;
+	lock_site_t *site;
+	int i, j, site_cnt_max;
+
+	slurm_mutex_lock(&locks_mutex);
+	/* Read then write statistics for each lock */
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		for (j = 0; j < 2; j++) {
+			cnt[i * 2 + j]       = lock_stats[i][j].cnt;
+			wait_cnt[i * 2 + j]  = lock_stats[i][j].wait_cnt;
+			wait_usec[i * 2 + j] = lock_stats[i][j].wait_usec;
+			hold_usec[i * 2 + j] = lock_stats[i][j].hold_usec;
+		}
+	}
+	slurm_mutex_unlock(&locks_mutex);
+	pack32(ENTITY_COUNT, buffer);
+	packstr_array(lock_names, ENTITY_COUNT, buffer);
+	pack32_array(cnt,       ENTITY_COUNT * 2, buffer);
+	pack32_array(wait_cnt,  ENTITY_COUNT * 2, buffer);
+	pack64_array(wait_usec, ENTITY_COUNT * 2, buffer);
+	pack64_array(hold_usec, ENTITY_COUNT * 2, buffer);
+
+	slurm_mutex_lock(&lock_site_mutex);
+	site = lock_site_list;
+	site_cnt_max = lock_site_cnt;
+	slurm_mutex_unlock(&lock_site_mutex);
+
+	site_names    = xmalloc(sizeof(char *)   * (site_cnt_max + 1));
+	site_cnt      = xmalloc(sizeof(uint32_t) * (site_cnt_max + 1));
+	site_wait     = xmalloc(sizeof(uint64_t) * (site_cnt_max + 1));
+	site_wait_max = xmalloc(sizeof(uint64_t) * (site_cnt_max + 1));
+	site_hold     = xmalloc(sizeof(uint64_t) * (site_cnt_max + 1));
+	site_hold_max = xmalloc(sizeof(uint64_t) * (site_cnt_max + 1));
+	for (i = 0; site && (i < site_cnt_max); i++, site = site->next) {
+		site_names[i] = xstrdup_printf("%s:%d", site->func,
+					       site->line);
+		slurm_mutex_lock(&site->mutex);
+		site_cnt[i]      = site->cnt;
+		site_wait[i]     = site->wait_usec;
+		site_wait_max[i] = site->wait_max;
+		site_hold[i]     = site->hold_usec;
+		site_hold_max[i] = site->hold_max;
+		slurm_mutex_unlock(&site->mutex);
+	}
+	pack32(i, buffer);
+	packstr_array(site_names,    i, buffer);
+	pack32_array(site_cnt,       i, buffer);
+	pack64_array(site_wait,      i, buffer);
+	pack64_array(site_wait_max,  i, buffer);
+	pack64_array(site_hold,      i, buffer);
+	pack64_array(site_hold_max,  i, buffer);
+
+	while (--i >= 0)
+		xfree(site_names[i]);
+	xfree(site_names);
+	xfree(site_cnt);
+	xfree(site_wait);
+	xfree(site_wait_max);
+	xfree(site_hold);
+	xfree(site_hold_max);
+}
+
+/* reset_lock_stats - clear lock statistics. Call sites already seen remain
+ * listed, since their static records are in use */
+extern void reset_lock_stats(void)
+{
+	lock_site_t *site;
+
+	slurm_mutex_lock(&locks_mutex);
+	memset(lock_stats, 0, sizeof(lock_stats));
+	slurm_mutex_unlock(&locks_mutex);
+
+	slurm_mutex_lock(&lock_site_mutex);
+	site = lock_site_list;
+	slurm_mutex_unlock(&lock_site_mutex);
+	for ( ; site; site = site->next) {
+		slurm_mutex_lock(&site->mutex);
+		site->cnt       = 0;
+		site->wait_usec = 0;
+		site->wait_max  = 0;
+		site->hold_usec = 0;
+		site->hold_max  = 0;
+		slurm_mutex_unlock(&site->mutex);
+	}
+}
@@ -83,6 +83,11 @@
  * and node data structures, and write lock on the partition data structure
  * would look like this: "{ NO_LOCK, READ_LOCK, READ_LOCK, WRITE_LOCK }"
  *
+ * Threads waiting for a lock are only woken when a lock of the same data
+ * structure is released. The number of locks granted and the time spent
+ * waiting for and holding them are recorded for each data structure and
+ * for each function calling lock_slurmctld(), as reported by sdiag.
+ *
  * NOTE: When using lock_slurmctld() and assoc_mgr_lock(), always call
  * lock_slurmctld() before calling assoc_mgr_lock() and then call
  * assoc_mgr_unlock() before calling unlock_slurmctld().
@@ -91,6 +96,11 @@
 #ifndef _SLURMCTLD_LOCKS_H
 #define _SLURMCTLD_LOCKS_H
 
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "src/common/pack.h"
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -146,10 +156,36 @@ extern void init_locks ( void );
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads ( void );
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld (slurmctld_lock_t lock_levels);
-
-/* try_lock_slurmctld - equivalent to lock_slurmctld() except 
+/* Statistics for one lock_slurmctld() call, see pack_lock_stats(). Each
+ * call has its own static record, so that recording statistics needs no
+ * global mutex. */
+typedef struct lock_site {
+	const char *func;		/* calling function's name */
+	int line;			/* calling line */
+	pthread_mutex_t mutex;		/* protects the fields below */
+	bool listed;			/* on the list of sites */
+	struct lock_site *next;		/* next on the list of sites */
+	uint32_t cnt;			/* locks granted */
+	uint64_t wait_usec;		/* total time waiting for locks */
+	uint64_t wait_max;
+	uint64_t hold_usec;		/* total time write locks held,
+					 * with DebugFlags=Locks */
+	uint64_t hold_max;
+} lock_site_t;
+
+/* lock_slurmctld - Issue the required lock requests in a well defined order.
+ * Wait and hold times are recorded by calling function and line, see
+ * pack_lock_stats() */
+#define lock_slurmctld(lock_levels)					\
+do {									\
+	static lock_site_t _lock_site = {				\
+		__func__, __LINE__, PTHREAD_MUTEX_INITIALIZER };	\
+	lock_slurmctld_site(lock_levels, &_lock_site);			\
+} while (0)
+extern void lock_slurmctld_site(slurmctld_lock_t lock_levels,
+				lock_site_t *site);
+
+/* try_lock_slurmctld - equivalent to lock_slurmctld() except
  * RET 0 on success or -1 if the locks are currently not available */
 extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
 
@@ -157,8 +193,20 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
-/* un/lock semaphore used for saving state of slurmctld */
+/* un/lock semaphore used for saving state of slurmctld.
+ * lock_state_files() excludes all other users of the state save files.
+ * lock_state_files_shared() is used by the state save thread's writers,
+ * which run in parallel but each write different files. */
 extern void lock_state_files ( void );
+extern void lock_state_files_shared ( void );
 extern void unlock_state_files ( void );
 
+/* pack_lock_stats - pack the number of locks granted and time spent waiting
+ *	for and holding them, by lock type and mode and by calling function,
+ *	for REQUEST_STATS_INFO */
+extern void pack_lock_stats(Buf buffer, uint16_t protocol_version);
+
+/* reset_lock_stats - clear the statistics reported by pack_lock_stats() */
+extern void reset_lock_stats(void);
+
 #endif
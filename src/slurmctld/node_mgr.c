@@ -159,7 +159,7 @@ int dump_all_node_state ( void )
 	unlock_slurmctld (node_read_lock);
 
 	/* write the buffer to file */
-	lock_state_files();
+	lock_state_files_shared();
 	log_fd = creat (new_file, 0600);
 	if (log_fd < 0) {
 		error ("Can't save state, error creating file %s %m", new_file);
@@ -179,7 +179,7 @@ int dump_all_node_state ( void )
 			pos    += amount;
 		}
 
-		rc = fsync_and_close(log_fd, "node");
+		rc = state_file_sync_close(log_fd, "node", pos);
 		if (rc && !error_code)
 			error_code = rc;
 	}
@@ -3665,7 +3665,7 @@ void make_node_idle(struct node_record *node_ptr,
 	xassert(node_ptr);
 	if (node_bitmap && (bit_test(node_bitmap, inx))) {
 		/* Not a replay */
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		bit_clear(node_bitmap, inx);
 
 		job_update_tres_cnt(job_ptr, inx);
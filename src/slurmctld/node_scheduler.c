@@ -478,6 +478,7 @@ extern void deallocate_nodes(struct job_record *job_ptr, bool timeout,
 	xassert(job_ptr->details);
 
 	trace_job(job_ptr, __func__, "");
+	job_modified(job_ptr, time(NULL));
 
 	if (select_serial == -1) {
 		if (xstrcmp(slurmctld_conf.select_type, "select/serial"))
@@ -2219,7 +2220,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		     job_ptr->part_ptr, qos_ptr)) != SLURM_SUCCESS) {
 		xfree(job_ptr->state_desc);
 		job_ptr->state_reason = WAIT_QOS;
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		return ESLURM_REQUESTED_PART_CONFIG_UNAVAILABLE;
 	}
 
@@ -2231,7 +2232,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	    != SLURM_SUCCESS) {
 		xfree(job_ptr->state_desc);
 		job_ptr->state_reason = WAIT_ACCOUNT;
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		return ESLURM_REQUESTED_PART_CONFIG_UNAVAILABLE;
 	}
 
@@ -2249,7 +2250,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	bb = bb_g_job_test_stage_in(job_ptr, test_only);
 	if (bb != 1) {
 		xfree(job_ptr->state_desc);
-		last_job_update = now;
+		job_modified(job_ptr, now);
 		if (bb == 0)
 			job_ptr->state_reason = WAIT_BURST_BUFFER_STAGING;
 		else
@@ -2424,7 +2425,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 			       job_ptr->job_id);
 			job_ptr->state_reason = WAIT_PART_NODE_LIMIT;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 
 		/* Non-fatal errors for job below */
 		} else if (error_code == ESLURM_NODE_NOT_AVAIL) {
@@ -2466,7 +2467,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 					   "for other job");
 			}
 			xfree(unavail_node);
-			last_job_update = now;
+			job_modified(job_ptr, now);
 		} else if ((error_code == ESLURM_RESERVATION_NOT_USABLE) ||
 			   (error_code == ESLURM_RESERVATION_BUSY)) {
 			job_ptr->state_reason = WAIT_RESERVATION;
@@ -2574,6 +2575,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	configuring = IS_JOB_CONFIGURING(job_ptr);
 
 	job_ptr->job_state = JOB_RUNNING;
+	job_modified(job_ptr, now);
 	if (nonstop_ops.job_begin)
 		(nonstop_ops.job_begin)(job_ptr);
 
@@ -437,7 +437,7 @@ int dump_all_part_state(void)
 	unlock_slurmctld(part_read_lock);
 
 	/* write the buffer to file */
-	lock_state_files();
+	lock_state_files_shared();
 	log_fd = creat(new_file, 0600);
 	if (log_fd < 0) {
 		error("Can't save state, error creating file %s, %m",
@@ -458,7 +458,7 @@ int dump_all_part_state(void)
 			pos    += amount;
 		}
 
-		rc = fsync_and_close(log_fd, "partition");
+		rc = state_file_sync_close(log_fd, "partition", pos);
 		if (rc && !error_code)
 			error_code = rc;
 	}
@@ -74,10 +74,12 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/slurm_topology.h"
+#include "src/common/slurmdbd_defs.h"
 #include "src/common/switch.h"
 #include "src/common/xstring.h"
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/agent_mux.h"
 #include "src/slurmctld/burst_buffer.h"
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
@@ -103,6 +105,8 @@ static int rpc_type_size = 0;	/* Size of rpc_type_* arrays */
 static uint16_t *rpc_type_id = NULL;
 static uint32_t *rpc_type_cnt = NULL;
 static uint64_t *rpc_type_time = NULL;
+static uint32_t *rpc_type_queue_depth = NULL;	/* max RPC queue length */
+static uint64_t *rpc_type_queue_time = NULL;	/* usec waiting for worker */
 static int rpc_user_size = 0;	/* Size of rpc_user_* arrays */
 static uint32_t *rpc_user_id = NULL;
 static uint32_t *rpc_user_cnt = NULL;
@@ -245,6 +249,10 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 		rpc_type_id   = xmalloc(sizeof(uint16_t) * rpc_type_size);
 		rpc_type_cnt  = xmalloc(sizeof(uint32_t) * rpc_type_size);
 		rpc_type_time = xmalloc(sizeof(uint64_t) * rpc_type_size);
+		rpc_type_queue_depth = xmalloc(sizeof(uint32_t) *
+					       rpc_type_size);
+		rpc_type_queue_time  = xmalloc(sizeof(uint64_t) *
+					       rpc_type_size);
 	}
 	for (i = 0; i < rpc_type_size; i++) {
 		if (rpc_type_id[i] == 0)
@@ -604,6 +612,14 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	if (rpc_type_index >= 0) {
 		rpc_type_cnt[rpc_type_index]++;
 		rpc_type_time[rpc_type_index] += DELTA_TIMER;
+		if (arg) {
+			rpc_type_queue_time[rpc_type_index] += arg->queue_wait;
+			if (rpc_type_queue_depth[rpc_type_index] <
+			    arg->queue_depth) {
+				rpc_type_queue_depth[rpc_type_index] =
+					arg->queue_depth;
+			}
+		}
 	}
 	if (rpc_user_index >= 0) {
 		rpc_user_cnt[rpc_user_index]++;
@@ -1340,8 +1356,13 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 	char *dump;
 	int dump_size;
 	slurm_msg_t response_msg;
+	slurm_msg_type_t response_type = RESPONSE_JOB_INFO;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
+	uint16_t show_flags = job_info_request_msg->show_flags & (~SHOW_DELTA);
+	time_t delta_update = 0;
+	bool delta = false, locked = false;
+	int rc;
 	/* Locks: Read config job, write partition (for hiding) */
 	slurmctld_lock_t job_read_lock = {
 		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK };
@@ -1350,19 +1371,44 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
-	lock_slurmctld(job_read_lock);
+	if (job_info_request_msg->show_flags & SHOW_DELTA)
+		delta_update = job_info_request_msg->last_update;
+
+	/* Try the last job information packed first, which avoids holding
+	 * locks (and delaying the scheduler's job write lock) while packing */
+	rc = pack_all_jobs_snapshot(&dump, &dump_size, show_flags, uid,
+				    job_info_request_msg->last_update,
+				    delta_update, &delta,
+				    msg->protocol_version);
+	if (rc == SLURM_ERROR) {
+		lock_slurmctld(job_read_lock);
+		locked = true;
+		if ((job_info_request_msg->last_update - 1) >= last_job_update)
+			rc = SLURM_NO_CHANGE_IN_DATA;
+	}
 
-	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
-		unlock_slurmctld(job_read_lock);
+	if (rc == SLURM_NO_CHANGE_IN_DATA) {
+		if (locked)
+			unlock_slurmctld(job_read_lock);
 		debug3("_slurm_rpc_dump_jobs, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
 	} else {
-		pack_all_jobs(&dump, &dump_size,
-			      job_info_request_msg->show_flags,
-			      g_slurm_auth_get_uid(msg->auth_cred,
-						   slurmctld_config.auth_info),
-			      NO_VAL, msg->protocol_version);
-		unlock_slurmctld(job_read_lock);
+		if (!locked) {
+			debug3("_slurm_rpc_dump_jobs, from snapshot");
+		} else if (delta_update &&
+			   (pack_all_jobs_delta(&dump, &dump_size, show_flags,
+						uid, delta_update,
+						msg->protocol_version) ==
+			    SLURM_SUCCESS)) {
+			delta = true;
+		} else {
+			pack_all_jobs(&dump, &dump_size, show_flags, uid,
+				      NO_VAL, msg->protocol_version);
+		}
+		if (locked)
+			unlock_slurmctld(job_read_lock);
+		if (delta)
+			response_type = RESPONSE_JOB_INFO_DELTA;
 		END_TIMER2("_slurm_rpc_dump_jobs");
 #if 0
 		info("_slurm_rpc_dump_jobs, size=%d %s", dump_size, TIME_STR);
@@ -1374,7 +1420,7 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 		response_msg.protocol_version = msg->protocol_version;
 		response_msg.address = msg->address;
 		response_msg.conn = msg->conn;
-		response_msg.msg_type = RESPONSE_JOB_INFO;
+		response_msg.msg_type = response_type;
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 
@@ -5649,6 +5695,8 @@ static void _clear_rpc_stats(void)
 		rpc_type_cnt[i] = 0;
 		rpc_type_id[i] = 0;
 		rpc_type_time[i] = 0;
+		rpc_type_queue_depth[i] = 0;
+		rpc_type_queue_time[i] = 0;
 	}
 	for (i = 0; i < rpc_user_size; i++) {
 		rpc_user_cnt[i] = 0;
@@ -5656,6 +5704,11 @@ static void _clear_rpc_stats(void)
 		rpc_user_time[i] = 0;
 	}
 	slurm_mutex_unlock(&rpc_mutex);
+	reset_lock_stats();
+	reset_state_save_stats();
+	agent_mux_reset_stats();
+	slurmdbd_agent_reset_stats();
+	slurm_cred_reset_stats();
 }
 
 static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
@@ -5675,6 +5728,10 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 	pack16_array(rpc_type_id,   i, buffer);
 	pack32_array(rpc_type_cnt,  i, buffer);
 	pack64_array(rpc_type_time, i, buffer);
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		pack32_array(rpc_type_queue_depth, i, buffer);
+		pack64_array(rpc_type_queue_time,  i, buffer);
+	}
 
 	for (i = 1; i < rpc_user_size; i++) {
 		if (rpc_user_id[i] == 0)
@@ -5686,6 +5743,14 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 	pack64_array(rpc_user_time, i, buffer);
 	slurm_mutex_unlock(&rpc_mutex);
 
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		pack_lock_stats(buffer, protocol_version);
+		pack_state_save_stats(buffer, protocol_version);
+		agent_mux_pack_stats(buffer, protocol_version);
+		slurmdbd_agent_pack_stats(buffer, protocol_version);
+		slurm_cred_pack_stats(buffer, protocol_version);
+	}
+
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
@@ -5799,6 +5864,8 @@ extern void free_rpc_stats(void)
 	xfree(rpc_type_cnt);
 	xfree(rpc_type_id);
 	xfree(rpc_type_time);
+	xfree(rpc_type_queue_depth);
+	xfree(rpc_type_queue_time);
 	rpc_type_size = 0;
 
 	xfree(rpc_user_cnt);
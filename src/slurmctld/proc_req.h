@@ -44,11 +44,15 @@
 #include "src/common/slurm_protocol_api.h"
 
 /* Each TCP/IP client connection has a socket
- * and address with port
+ * and address with port, plus the time it spent queued waiting for
+ * an RPC worker thread
  */
 typedef struct connection_arg {
 	int newsockfd;
 	slurm_addr_t cli_addr;
+	uint32_t queue_depth;		/* RPC queue length when queued */
+	struct timeval queue_time;	/* when queued */
+	uint32_t queue_wait;		/* usec spent in RPC queue */
 } connection_arg_t;
 
 /* Free memory used to track RPC usage by type and user */
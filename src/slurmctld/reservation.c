@@ -3062,7 +3062,7 @@ extern int dump_all_resv_state(void)
 	unlock_slurmctld(resv_read_lock);
 
 	/* write the buffer to file */
-	lock_state_files();
+	lock_state_files_shared();
 	log_fd = creat(new_file, 0600);
 	if (log_fd < 0) {
 		error("Can't save state, error creating file %s, %m",
@@ -3082,7 +3082,7 @@ extern int dump_all_resv_state(void)
 			nwrite -= amount;
 			pos    += amount;
 		}
-		rc = fsync_and_close(log_fd, "reservation");
+		rc = state_file_sync_close(log_fd, "reservation", pos);
 		if (rc && !error_code)
 			error_code = rc;
 	}
@@ -127,6 +127,41 @@
 #define MAX_BATCH_REQUEUE 5
 #endif
 
+/* Maximum number of packed job information responses (by protocol version
+ * and show_flags) to cache for REQUEST_JOB_INFO */
+#ifndef JOB_INFO_CACHE_CNT
+#define JOB_INFO_CACHE_CNT 8
+#endif
+
+/* Maximum age in seconds of a cached job information response */
+#ifndef JOB_INFO_CACHE_AGE
+#define JOB_INFO_CACHE_AGE 5
+#endif
+
+/* Maximum age in seconds of a client's previous job information response
+ * for which the changes since can be sent, see pack_all_jobs_delta() */
+#ifndef JOB_INFO_DELTA_AGE
+#define JOB_INFO_DELTA_AGE 300
+#endif
+
+/* Size of the job state journal, as a percentage of the job state snapshot
+ * size, at which the journal is compacted into a new snapshot. Set to zero
+ * to disable the journal and write a complete job state snapshot on every
+ * save */
+#ifndef JOB_STATE_JOURNAL_PCT
+#define JOB_STATE_JOURNAL_PCT 50
+#endif
+#if JOB_STATE_JOURNAL_PCT < 0
+#error JOB_STATE_JOURNAL_PCT must not be negative
+#endif
+
+/* Maximum time in seconds between job state journal saves which check every
+ * job for changes. Other saves only check the jobs passed to job_modified()
+ * since the previous save. */
+#ifndef JOB_STATE_SWEEP_AGE
+#define JOB_STATE_SWEEP_AGE 300
+#endif
+
 /*****************************************************************************\
  *  General configuration parameters and data structures
 \*****************************************************************************/
@@ -181,6 +216,16 @@ typedef struct diag_stats {
 	uint32_t bf_queue_len_sum;
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
+	uint32_t bf_table_size;		/* node_space records, last cycle */
+	uint32_t bf_table_size_sum;
+	uint32_t bf_table_add_cnt;	/* node_space reservations */
+	uint64_t bf_table_add_time;	/* nsec making reservations */
+	uint32_t bf_table_find_cnt;	/* node_space searches */
+	uint64_t bf_table_find_time;	/* nsec searching */
+
+	uint32_t rpc_worker_cnt;	/* RPC worker threads running */
+	uint32_t rpc_queue_len;		/* connections waiting for a worker */
+	uint32_t rpc_queue_max;		/* largest rpc_queue_len */
 } diag_stats_t;
 
 /* This is used to point out constants that exist in the
@@ -429,6 +474,7 @@ extern time_t last_resv_update;	/* time of last resv_list update */
  *  JOB parameters and data structures
 \*****************************************************************************/
 extern time_t last_job_update;	/* time of last update to job records */
+extern uint64_t job_mod_seq;	/* sequence number of last job_modified() */
 
 #define DETAILS_MAGIC	0xdea84e7
 #define JOB_MAGIC	0xf0b7392c
@@ -638,9 +684,7 @@ struct job_record {
 					 * to be passed to slurmdbd */
 	uint32_t group_id;		/* group submitted under */
 	uint32_t job_id;		/* job ID */
-	struct job_record *job_next;	/* next entry with same hash index */
-	struct job_record *job_array_next_j; /* job array linked list by job_id */
-	struct job_record *job_array_next_t; /* job array linked list by task_id */
+	struct job_record *job_array_next_j; /* next task of same job array */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint32_t job_state;		/* state of the job */
 	uint16_t kill_on_node_fail;	/* 1 if job should be killed on
@@ -656,6 +700,11 @@ struct job_record {
 	char *mail_user;		/* user to get e-mail notification */
 	uint32_t magic;			/* magic cookie for data integrity */
 	char *mcs_label;		/* mcs_label if mcs plugin in use */
+	struct job_record *mod_next;	/* next job in modification order,
+					 * see job_modified() */
+	struct job_record *mod_prev;	/* previous job in modification order */
+	uint64_t mod_seq;		/* job_mod_seq value of job's last
+					 * modification */
 	char *name;			/* name of the job */
 	char *network;			/* network/switch requirement spec */
 	uint32_t next_step_id;		/* next step id to be used */
@@ -737,6 +786,8 @@ struct job_record {
 					 * return valid job information during
 					 * scheduling cycle (state_reason is
 					 * cleared at start of cycle) */
+	uint64_t state_save_cksum;	/* checksum of job's last saved state
+					 * record, see dump_all_job_state() */
 	List step_list;			/* list of job's steps */
 	time_t suspend_time;		/* time job last suspended or resumed */
 	time_t time_last_active;	/* time of last job activity */
@@ -1313,6 +1364,41 @@ extern int job_fail(uint32_t job_id, uint32_t job_state);
  */
 extern void job_hold_requeue(struct job_record *job_ptr);
 
+/*
+ * job_mod_for_each - call a function for each job modified since a given
+ *	point, oldest modification first. Callers track their own position
+ *	by saving job_mod_seq when done, so each pass costs time proportional
+ *	to the number of jobs changed rather than the number of jobs.
+ *	Removed jobs are not reported.
+ * IN since_seq - job_mod_seq value from an earlier pass, zero for all jobs
+ * IN f - function to call for each job, stop if it returns a negative value
+ * IN arg - argument passed to f
+ * RET number of jobs processed
+ * NOTE: Call with job read lock. f must not modify the job list or call
+ *	job_modified().
+ */
+extern int job_mod_for_each(uint64_t since_seq, ListForF f, void *arg);
+
+/*
+ * job_modified - note that a job record has changed: advance the job's
+ *	modification sequence number, move it to the end of the job
+ *	modification order and set last_job_update
+ * IN job_ptr - modified job, NULL if no specific job record changed
+ * IN now - time of the modification
+ * NOTE: Call with job write lock
+ */
+extern void job_modified(struct job_record *job_ptr, time_t now);
+
+/*
+ * job_modified_all - note that job records changed without job_modified(),
+ *	so that the next job state save and job information pack check
+ *	every job, and set last_job_update
+ * IN now - time of the modification
+ * NOTE: For callers holding only the job read lock, which can not call
+ *	job_modified()
+ */
+extern void job_modified_all(time_t now);
+
 /*
  * determine if job is ready to execute per the node select plugin
  * IN job_id - job to test
@@ -1762,6 +1848,49 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version);
 
+/*
+ * pack_all_jobs_delta - dump job information for the jobs which changed
+ *	since a user's previous response, in machine independent form (for
+ *	network transmission as RESPONSE_JOB_INFO_DELTA)
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options, as used for the previous response
+ * IN uid - uid of user making request (for partition filtering)
+ * IN last_update - time of the user's previous response
+ * IN protocol_version - slurm protocol version of client
+ * RET SLURM_SUCCESS or SLURM_ERROR if the changes since last_update are not
+ *	known, in which case pack_all_jobs() must be used instead
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern int pack_all_jobs_delta(char **buffer_ptr, int *buffer_size,
+			       uint16_t show_flags, uid_t uid,
+			       time_t last_update, uint16_t protocol_version);
+
+/*
+ * pack_all_jobs_snapshot - dump job information as for pack_all_jobs() or
+ *	pack_all_jobs_delta() from the last job information packed, without
+ *	holding any slurmctld locks while packing
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request
+ * IN last_response - time of the user's previous response, if any
+ * IN last_update - time of the user's previous response if a delta
+ *	response is wanted, otherwise zero
+ * OUT delta - set if a pack_all_jobs_delta() response was packed
+ * IN protocol_version - slurm protocol version of client
+ * RET SLURM_SUCCESS, SLURM_NO_CHANGE_IN_DATA if no job changed since
+ *	last_response, or SLURM_ERROR if that information is out of date or
+ *	needs filtering for this user, in which case lock_slurmctld() and
+ *	use pack_all_jobs() or pack_all_jobs_delta() instead
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: call without any slurmctld locks
+ */
+extern int pack_all_jobs_snapshot(char **buffer_ptr, int *buffer_size,
+				  uint16_t show_flags, uid_t uid,
+				  time_t last_response, time_t last_update,
+				  bool *delta, uint16_t protocol_version);
+
 /*
  * pack_all_node - dump all configuration and node information for all nodes
  *	in machine independent form (for network transmission)
@@ -1945,7 +2074,7 @@ extern void qos_list_build(char *qos, bitstr_t **qos_bits);
 extern void queue_job_scheduler(void);
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash tables, which grow as needed.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void);
@@ -43,10 +43,18 @@
 #  include <sys/prctl.h>
 #endif
 
+#include <fcntl.h>
 #include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#  include <sys/syscall.h>
+#endif
 
+#include "src/common/fd.h"
 #include "src/common/macros.h"
+#include "src/common/timers.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/trigger_mgr.h"
@@ -56,18 +64,62 @@
 #define SAVE_MAX_WAIT	5
 #endif
 
+/* A state save file written by the slurmctld_state_save thread */
+typedef struct {
+	char *name;			/* file name in StateSaveLocation */
+	int (*dump_func) (void);	/* packs and writes the file */
+	int *save_flag;			/* count of saves requested */
+
+	/* Current save, protected by sync_lock */
+	pthread_t thread_id;
+	bool active;			/* being saved this cycle */
+	bool synced;			/* passed the durability barrier */
+	int fd;				/* file to sync at the barrier */
+	int sync_rc;
+	uint32_t bytes;			/* bytes written this cycle */
+
+	/* Statistics, protected by state_save_lock */
+	uint32_t save_cnt;		/* saves which wrote data */
+	uint32_t save_bytes;		/* bytes written by last save */
+	uint64_t save_usec;		/* time spent saving */
+	uint64_t save_max;		/* longest save, usec */
+} state_file_t;
+
 static pthread_mutex_t state_save_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  state_save_cond = PTHREAD_COND_INITIALIZER;
 static int save_jobs = 0, save_nodes = 0, save_parts = 0;
 static int save_front_end = 0, save_triggers = 0, save_resv = 0;
 static bool run_save_thread = true;
 
-/* fsync() and close() a file,
- * Execute fsync() and close() multiple times if necessary and log failures
+static state_file_t state_files[] = {
+	{ "front_end_state", dump_all_front_end_state, &save_front_end },
+	{ "job_state",       dump_all_job_state,       &save_jobs },
+	{ "node_state",      dump_all_node_state,      &save_nodes },
+	{ "part_state",      dump_all_part_state,      &save_parts },
+	{ "resv_state",      dump_all_resv_state,      &save_resv },
+	{ "trigger_state",   trigger_state_save,       &save_triggers },
+};
+#define STATE_FILE_CNT (sizeof(state_files) / sizeof(state_file_t))
+
+/* Durability barrier shared by the files saved in one cycle */
+static pthread_key_t state_file_key;
+static pthread_once_t state_file_key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t sync_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sync_cond = PTHREAD_COND_INITIALIZER;
+static int sync_pending = 0;	/* files yet to reach the barrier */
+static int sync_dir_fd = -1;	/* StateSaveLocation, for syncfs() */
+
+static void _state_file_key_create(void)
+{
+	if (pthread_key_create(&state_file_key, NULL))
+		fatal("%s: pthread_key_create: %m", __func__);
+}
+
+/* fsync() a file, trying several times if necessary and log failures
  * RET 0 on success or -1 on error */
-extern int fsync_and_close(int fd, char *file_type)
+static int _fsync_file(int fd, char *file_type)
 {
-	int rc = 0, retval, pos;
+	int retval, pos;
 
 	/* SLURM state save files are typically stored on shared filesystems,
 	 * so lets give fysync() three tries to sync the data to disk. */
@@ -78,8 +130,14 @@ extern int fsync_and_close(int fd, char *file_type)
 			      file_type);
 		}
 	}
-	if (retval)
-		rc = retval;
+	return retval;
+}
+
+/* close() a file, trying several times if necessary and log failures
+ * RET 0 on success or -1 on error */
+static int _close_file(int fd, char *file_type)
+{
+	int retval, pos;
 
 	for (retval = 1, pos = 1; retval && pos < 4; pos++) {
 		retval = close(fd);
@@ -88,12 +146,251 @@ extern int fsync_and_close(int fd, char *file_type)
 			      file_type);
 		}
 	}
-	if (retval)
-		rc = retval;
+	return retval;
+}
+
+/* fsync() and close() a file,
+ * Execute fsync() and close() multiple times if necessary and log failures
+ * RET 0 on success or -1 on error */
+extern int fsync_and_close(int fd, char *file_type)
+{
+	int rc = 0;
+
+	if (_fsync_file(fd, file_type))
+		rc = -1;
+	if (_close_file(fd, file_type))
+		rc = -1;
+
+	return rc;
+}
+
+/* Sync every file which reached the barrier with a single syncfs() of the
+ * file system holding StateSaveLocation if more than one did, otherwise
+ * (or if syncfs() is unavailable) fsync() each file. Call with sync_lock
+ * held. */
+static void _sync_files(void)
+{
+	int i, rc = -1, sync_cnt = 0;
+
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		if (state_files[i].active && (state_files[i].fd >= 0))
+			sync_cnt++;
+	}
+#if defined(__linux__) && defined(SYS_syncfs)
+	if ((sync_cnt > 1) && (sync_dir_fd >= 0)) {
+		int pos;
+		for (rc = 1, pos = 1; rc && pos < 4; pos++) {
+			rc = syscall(SYS_syncfs, sync_dir_fd);
+			if (rc && (errno != EINTR)) {
+				error("syncfs() error writing state save "
+				      "files: %m");
+				if (errno == ENOSYS)
+					break;
+			}
+		}
+	}
+#endif
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		if (!state_files[i].active || (state_files[i].fd < 0))
+			continue;
+		if (rc == 0) {
+			state_files[i].sync_rc = 0;
+		} else {
+			state_files[i].sync_rc =
+				_fsync_file(state_files[i].fd,
+					    state_files[i].name);
+		}
+	}
+	slurm_cond_broadcast(&sync_cond);
+}
 
+/* Mark a file as having reached the barrier, syncing all files if it was the
+ * last one. Wait for the sync unless the file has no data to sync.
+ * Call with sync_lock held. */
+static void _sync_arrive(state_file_t *file, int fd)
+{
+	file->synced = true;
+	file->fd = fd;
+	if (--sync_pending == 0)
+		_sync_files();
+	else if (fd >= 0) {
+		while (sync_pending)
+			slurm_cond_wait(&sync_cond, &sync_lock);
+	}
+}
+
+/*
+ * Sync and close a state save file written by one of the state save
+ * thread's writers. Writers saving in parallel wait for each other so that
+ * all their files can be made durable at once, with the file's previous
+ * version kept until then. The caller's lock_state_files_shared() is
+ * released while waiting: a writer still packing its file may need a
+ * slurmctld lock held by a thread waiting for lock_state_files(). Outside
+ * of the state save thread, this is the same as fsync_and_close().
+ * IN fd - file descriptor to sync and close
+ * IN file_type - type of state save file, for logging
+ * IN bytes - number of bytes written, for statistics
+ * RET 0 on success or -1 on error
+ */
+extern int state_file_sync_close(int fd, char *file_type, uint32_t bytes)
+{
+	state_file_t *file;
+	int rc;
+
+	pthread_once(&state_file_key_once, _state_file_key_create);
+	file = (state_file_t *) pthread_getspecific(state_file_key);
+	if (!file)
+		return fsync_and_close(fd, file_type);
+
+	slurm_mutex_lock(&sync_lock);
+	file->bytes += bytes;
+	if (file->synced) {
+		/* Another file written after the barrier */
+		slurm_mutex_unlock(&sync_lock);
+		return fsync_and_close(fd, file_type);
+	}
+	slurm_mutex_unlock(&sync_lock);
+
+	unlock_state_files();
+	slurm_mutex_lock(&sync_lock);
+	_sync_arrive(file, fd);
+	rc = file->sync_rc;
+	file->fd = -1;
+	slurm_mutex_unlock(&sync_lock);
+	lock_state_files_shared();
+
+	if (_close_file(fd, file_type))
+		rc = -1;
 	return rc;
 }
 
+/* Run as pthread to save one state file */
+static void *_state_file_agent(void *arg)
+{
+	state_file_t *file = (state_file_t *) arg;
+	uint64_t usec;
+	DEF_TIMERS;
+
+	pthread_setspecific(state_file_key, file);
+	START_TIMER;
+	(void) (file->dump_func)();
+	END_TIMER;
+	usec = DELTA_TIMER;
+
+	slurm_mutex_lock(&sync_lock);
+	if (!file->synced)		/* Nothing was written */
+		_sync_arrive(file, -1);
+	slurm_mutex_unlock(&sync_lock);
+
+	if (file->bytes) {
+		slurm_mutex_lock(&state_save_lock);
+		file->save_cnt++;
+		file->save_bytes = file->bytes;
+		file->save_usec += usec;
+		file->save_max = MAX(file->save_max, usec);
+		slurm_mutex_unlock(&state_save_lock);
+	}
+	return NULL;
+}
+
+/* Save the files marked active in parallel, one thread per file */
+static void _save_state_files(void)
+{
+	pthread_attr_t attr;
+	int i;
+
+	sync_dir_fd = open(slurmctld_conf.state_save_location, O_RDONLY);
+	if (sync_dir_fd >= 0)
+		fd_set_close_on_exec(sync_dir_fd);
+
+	slurm_mutex_lock(&sync_lock);
+	sync_pending = 0;
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		if (!state_files[i].active)
+			continue;
+		state_files[i].synced = false;
+		state_files[i].fd = -1;
+		state_files[i].sync_rc = 0;
+		state_files[i].bytes = 0;
+		sync_pending++;
+	}
+	slurm_mutex_unlock(&sync_lock);
+
+	slurm_attr_init(&attr);
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		if (!state_files[i].active)
+			continue;
+		if (pthread_create(&state_files[i].thread_id, &attr,
+				   _state_file_agent, &state_files[i])) {
+			error("pthread_create: %m");
+			/* Save it from this thread after the others */
+			state_files[i].thread_id = 0;
+		}
+	}
+	slurm_attr_destroy(&attr);
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		if (!state_files[i].active || state_files[i].thread_id)
+			continue;
+		/* Not a parallel writer, so leave the barrier now */
+		slurm_mutex_lock(&sync_lock);
+		_sync_arrive(&state_files[i], -1);
+		slurm_mutex_unlock(&sync_lock);
+		(void) (state_files[i].dump_func)();
+	}
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		if (state_files[i].active && state_files[i].thread_id)
+			pthread_join(state_files[i].thread_id, NULL);
+		state_files[i].active = false;
+	}
+
+	if (sync_dir_fd >= 0) {
+		(void) close(sync_dir_fd);
+		sync_dir_fd = -1;
+	}
+}
+
+/* pack_state_save_stats - pack state save file statistics, as reported by
+ *	sdiag */
+extern void pack_state_save_stats(Buf buffer, uint16_t protocol_version)
+{
+	char *names[STATE_FILE_CNT];
+	uint32_t cnt[STATE_FILE_CNT], bytes[STATE_FILE_CNT];
+	uint64_t usec[STATE_FILE_CNT], max[STATE_FILE_CNT];
+	int i;
+
+	slurm_mutex_lock(&state_save_lock);
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		names[i] = state_files[i].name;
+		cnt[i]   = state_files[i].save_cnt;
+		bytes[i] = state_files[i].save_bytes;
+		usec[i]  = state_files[i].save_usec;
+		max[i]   = state_files[i].save_max;
+	}
+	slurm_mutex_unlock(&state_save_lock);
+
+	pack32(STATE_FILE_CNT, buffer);
+	packstr_array(names, STATE_FILE_CNT, buffer);
+	pack32_array(cnt,   STATE_FILE_CNT, buffer);
+	pack32_array(bytes, STATE_FILE_CNT, buffer);
+	pack64_array(usec,  STATE_FILE_CNT, buffer);
+	pack64_array(max,   STATE_FILE_CNT, buffer);
+}
+
+/* reset_state_save_stats - clear state save file statistics */
+extern void reset_state_save_stats(void)
+{
+	int i;
+
+	slurm_mutex_lock(&state_save_lock);
+	for (i = 0; i < STATE_FILE_CNT; i++) {
+		state_files[i].save_cnt   = 0;
+		state_files[i].save_bytes = 0;
+		state_files[i].save_usec  = 0;
+		state_files[i].save_max   = 0;
+	}
+	slurm_mutex_unlock(&state_save_lock);
+}
+
 /* Queue saving of front_end state information */
 extern void schedule_front_end_save(void)
 {
@@ -168,14 +465,14 @@ extern void *slurmctld_state_save(void *no_data)
 {
 	time_t last_save = 0, now;
 	double save_delay;
-	bool run_save;
-	int save_count;
+	int i, save_count;
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "sstate", NULL, NULL, NULL) < 0) {
 		error("%s: cannot set my name to %s %m", __func__, "sstate");
 	}
 #endif
+	pthread_once(&state_file_key_once, _state_file_key_create);
 
 	while (1) {
 		/* wait for work to perform */
@@ -206,71 +503,16 @@ extern void *slurmctld_state_save(void *no_data)
 			}
 		}
 
-		/* save front_end node info if necessary */
-		run_save = false;
+		/* save every file needing it, in parallel */
 		/* slurm_mutex_lock(&state_save_lock); done above */
-		if (save_front_end) {
-			run_save = true;
-			save_front_end = 0;
-		}
-		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
-			(void)dump_all_front_end_state();
-
-		/* save job info if necessary */
-		run_save = false;
-		slurm_mutex_lock(&state_save_lock);
-		if (save_jobs) {
-			run_save = true;
-			save_jobs = 0;
-		}
-		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
-			(void)dump_all_job_state();
-
-		/* save node info if necessary */
-		run_save = false;
-		slurm_mutex_lock(&state_save_lock);
-		if (save_nodes) {
-			run_save = true;
-			save_nodes = 0;
-		}
-		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
-			(void)dump_all_node_state();
-
-		/* save partition info if necessary */
-		run_save = false;
-		slurm_mutex_lock(&state_save_lock);
-		if (save_parts) {
-			run_save = true;
-			save_parts = 0;
-		}
-		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
-			(void)dump_all_part_state();
-
-		/* save reservation info if necessary */
-		run_save = false;
-		slurm_mutex_lock(&state_save_lock);
-		if (save_resv) {
-			run_save = true;
-			save_resv = 0;
-		}
-		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
-			(void)dump_all_resv_state();
-
-		/* save trigger info if necessary */
-		run_save = false;
-		slurm_mutex_lock(&state_save_lock);
-		if (save_triggers) {
-			run_save = true;
-			save_triggers = 0;
+		for (i = 0; i < STATE_FILE_CNT; i++) {
+			if (*state_files[i].save_flag) {
+				state_files[i].active = true;
+				*state_files[i].save_flag = 0;
+			}
 		}
 		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
-			(void)trigger_state_save();
+		_save_state_files();
 	}
 }
 
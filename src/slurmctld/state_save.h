@@ -40,11 +40,34 @@
 #ifndef _SLURMCTLD_STATE_SAVE_H
 #define _SLURMCTLD_STATE_SAVE_H
 
+#include "src/common/pack.h"
+
 /* fsync() and close() a file,
  * Execute fsync() and close() multiple times if necessary and log failures
  * RET 0 on success or -1 on error */
 extern int fsync_and_close(int fd, char *file_type);
 
+/*
+ * Sync and close a state save file written by one of the state save
+ * thread's writers. Writers saving in parallel wait for each other so that
+ * all their files can be made durable at once, with the file's previous
+ * version kept until then. The caller's lock_state_files_shared() is
+ * released while waiting. Outside of the state save thread, this is the
+ * same as fsync_and_close().
+ * IN fd - file descriptor to sync and close
+ * IN file_type - type of state save file, for logging
+ * IN bytes - number of bytes written, for statistics
+ * RET 0 on success or -1 on error
+ */
+extern int state_file_sync_close(int fd, char *file_type, uint32_t bytes);
+
+/* pack_state_save_stats - pack state save file statistics, as reported by
+ *	sdiag */
+extern void pack_state_save_stats(Buf buffer, uint16_t protocol_version);
+
+/* reset_state_save_stats - clear state save file statistics */
+extern void reset_state_save_stats(void);
+
 /* Queue saving of front_end state information */
 extern void schedule_front_end_save(void);
 
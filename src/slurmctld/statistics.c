@@ -111,6 +111,28 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_depth_try_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_queue_len_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_active,	 buffer);
+
+			if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+				pack32(slurmctld_diag_stats.rpc_worker_cnt,
+				       buffer);
+				pack32(slurmctld_diag_stats.rpc_queue_len,
+				       buffer);
+				pack32(slurmctld_diag_stats.rpc_queue_max,
+				       buffer);
+
+				pack32(slurmctld_diag_stats.bf_table_size,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_table_size_sum,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_table_add_cnt,
+				       buffer);
+				pack64(slurmctld_diag_stats.bf_table_add_time,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_table_find_cnt,
+				       buffer);
+				pack64(slurmctld_diag_stats.bf_table_find_time,
+				       buffer);
+			}
 		}
 	}
 
@@ -150,6 +172,14 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	slurmctld_diag_stats.bf_table_size = 0;
+	slurmctld_diag_stats.bf_table_size_sum = 0;
+	slurmctld_diag_stats.bf_table_add_cnt = 0;
+	slurmctld_diag_stats.bf_table_add_time = 0;
+	slurmctld_diag_stats.bf_table_find_cnt = 0;
+	slurmctld_diag_stats.bf_table_find_time = 0;
+
+	slurmctld_diag_stats.rpc_queue_max = 0;
 
 	last_proc_req_start = time(NULL);
 }
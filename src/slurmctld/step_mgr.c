@@ -179,7 +179,7 @@ static struct step_record * _create_step_record(struct job_record *job_ptr,
 
 	step_ptr = (struct step_record *) xmalloc(sizeof(struct step_record));
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 	step_ptr->job_ptr    = job_ptr;
 	step_ptr->exit_code  = NO_VAL;
 	step_ptr->time_limit = INFINITE;
@@ -279,7 +279,7 @@ extern void delete_step_records (struct job_record *job_ptr)
 
 	xassert(job_ptr);
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 	step_iterator = list_iterator_create(job_ptr->step_list);
 	while ((step_ptr = (struct step_record *) list_next (step_iterator))) {
 		/* Only check if not a pending step */
@@ -383,7 +383,7 @@ delete_step_record (struct job_record *job_ptr, uint32_t step_id)
 	if (!job_ptr->step_list)
 		return error_code;
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 	step_iterator = list_iterator_create (job_ptr->step_list);
 	while ((step_ptr = (struct step_record *) list_next (step_iterator))) {
 		if (step_ptr->step_id != step_id)
@@ -809,7 +809,7 @@ int job_step_complete(uint32_t job_id, uint32_t step_id, uid_t uid,
 
 	_internal_step_complete(job_ptr, step_ptr);
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 
 	return SLURM_SUCCESS;
 }
@@ -3165,7 +3165,7 @@ extern int job_step_checkpoint(checkpoint_msg_t *ckpt_ptr,
 				   ckpt_ptr->image_dir, &resp_data.event_time,
 				   &resp_data.error_code,
 				   &resp_data.error_msg);
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 
     reply:
@@ -3231,7 +3231,7 @@ extern int job_step_checkpoint_comp(checkpoint_comp_msg_t *ckpt_ptr,
 	} else {
 		rc = checkpoint_comp((void *)step_ptr, ckpt_ptr->begin_time,
 			ckpt_ptr->error_code, ckpt_ptr->error_msg);
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 
     reply:
@@ -3290,7 +3290,7 @@ extern int job_step_checkpoint_task_comp(checkpoint_task_comp_msg_t *ckpt_ptr,
 		rc = checkpoint_task_comp((void *)step_ptr,
 			ckpt_ptr->task_id, ckpt_ptr->begin_time,
 			ckpt_ptr->error_code, ckpt_ptr->error_msg);
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 	}
 
     reply:
@@ -4110,7 +4110,7 @@ extern void step_checkpoint(void)
 			job_checkpoint(&ckpt_req, getuid(), -1,
 				       (uint16_t)NO_VAL);
 			job_ptr->ckpt_time = now;
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			continue; /* ignore periodic step ckpt */
 		}
 		step_iterator = list_iterator_create (job_ptr->step_list);
@@ -4136,7 +4136,7 @@ extern void step_checkpoint(void)
 				continue;
 
 			step_ptr->ckpt_time = now;
-			last_job_update = now;
+			job_modified(job_ptr, now);
 			image_dir = xstrdup(step_ptr->ckpt_dir);
 			xstrfmtcat(image_dir, "/%u.%u", job_ptr->job_id,
 				   step_ptr->step_id);
@@ -4408,7 +4408,7 @@ extern int update_step(step_update_request_msg_t *req, uid_t uid)
 		}
 	}
 	if (mod_cnt)
-		last_job_update = time(NULL);
+		job_modified(job_ptr, time(NULL));
 
 	return SLURM_SUCCESS;
 }
@@ -4510,7 +4510,7 @@ extern int post_job_step(struct step_record *step_ptr)
 				 job_ptr->gres_list, job_ptr->job_id,
 				 step_ptr->step_id);
 
-	last_job_update = time(NULL);
+	job_modified(job_ptr, time(NULL));
 	/* Don't need to set state. Will be destroyed in next steps. */
 	/* step_ptr->state = JOB_COMPLETE; */
 
@@ -840,7 +840,7 @@ extern int trigger_state_save(void)
 	xstrcat(new_file, "/trigger_state.new");
 	unlock_slurmctld(config_read_lock);
 
-	lock_state_files();
+	lock_state_files_shared();
 	log_fd = creat(new_file, 0600);
 	if (log_fd < 0) {
 		error("Can't save state, create file %s error %m",
@@ -861,7 +861,7 @@ extern int trigger_state_save(void)
 			pos    += amount;
 		}
 
-		rc = fsync_and_close(log_fd, "trigger");
+		rc = state_file_sync_close(log_fd, "trigger", pos);
 		if (rc && !error_code)
 			error_code = rc;
 	}
@@ -41,7 +41,9 @@
 
 #include "config.h"
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <grp.h>
 #include <poll.h>
 #include <pthread.h>
@@ -49,6 +51,7 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -275,6 +278,31 @@ static pthread_cond_t  file_bcast_cond  = PTHREAD_COND_INITIALIZER;
 static int fb_read_lock = 0, fb_write_wait_lock = 0, fb_write_lock = 0;
 static List file_bcast_list = NULL;
 
+#define SBCAST_CACHE_DIR "sbcast_cache"
+#define SBCAST_CACHE_BUF (1024 * 1024)
+static pthread_mutex_t sbcast_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* A completed file to add to the sbcast cache */
+typedef struct {
+	int fd;			/* dup of the destination file descriptor */
+	uid_t uid;
+	uint64_t file_hash;
+	uint64_t file_size;
+	uint64_t cache_size;	/* SbcastParameters CacheSize */
+} sbcast_cache_add_t;
+
+/* A file in the sbcast cache */
+typedef struct {
+	char *name;		/* file name within SBCAST_CACHE_DIR */
+	time_t mtime;		/* last use, as the file's mtime */
+	uint64_t size;
+} sbcast_cache_ent_t;
+
+/* Files in the sbcast cache, least recently used first, loaded from the
+ * cache directory when first needed. Protected by sbcast_cache_mutex. */
+static List sbcast_cache_list = NULL;
+static uint64_t sbcast_cache_total = 0;
+
 void
 slurmd_req(slurm_msg_t *msg)
 {
@@ -3106,6 +3134,7 @@ _rpc_daemon_status(slurm_msg_t *msg)
 {
 	slurm_msg_t      resp_msg;
 	slurmd_status_t *resp = NULL;
+	slurm_cred_stats_t cred_stats;
 
 	resp = xmalloc(sizeof(slurmd_status_t));
 	resp->actual_cpus        = conf->actual_cpus;
@@ -3124,6 +3153,12 @@ _rpc_daemon_status(slurm_msg_t *msg)
 	resp->slurmd_logfile     = xstrdup(conf->logfile);
 	resp->version            = xstrdup(SLURM_VERSION_STRING);
 
+	slurm_cred_get_stats(&cred_stats);
+	resp->cred_verify_cnt    = cred_stats.verify_cnt;
+	resp->cred_verify_hits   = cred_stats.verify_hits;
+	resp->cred_verify_time   = cred_stats.verify_time;
+	resp->cred_verify_max    = cred_stats.verify_max;
+
 	slurm_msg_t_copy(&resp_msg, msg);
 	resp_msg.msg_type = RESPONSE_SLURMD_STATUS;
 	resp_msg.data     = resp;
@@ -3678,11 +3713,344 @@ void file_bcast_purge(void)
 	_fb_wrlock();
 	list_destroy(file_bcast_list);
 	/* destroying list before exit, no need to unlock */
+	slurm_mutex_lock(&sbcast_cache_mutex);
+	FREE_NULL_LIST(sbcast_cache_list);
+	slurm_mutex_unlock(&sbcast_cache_mutex);
+}
+
+/*
+ * The sbcast cache holds copies of broadcast files in SlurmdSpoolDir, named
+ * by owner, content hash and size. Files are only found by the user who
+ * broadcast them, so no user can place content in another user's files.
+ */
+static char *_sbcast_cache_name(uid_t uid, uint64_t file_hash,
+				uint64_t file_size)
+{
+	return xstrdup_printf("%u.%016"PRIx64".%"PRIu64,
+			      (uint32_t) uid, file_hash, file_size);
+}
+
+static char *_sbcast_cache_path(char *name)
+{
+	return xstrdup_printf("%s/%s/%s", conf->spooldir, SBCAST_CACHE_DIR,
+			      name);
+}
+
+/* Copy size bytes from the start of in_fd to the start of out_fd */
+static int _sbcast_copy_data(int in_fd, int out_fd, uint64_t size)
+{
+	char *buf = xmalloc(SBCAST_CACHE_BUF);
+	uint64_t offset = 0;
+	ssize_t rd, wr, off;
+	int rc = SLURM_SUCCESS;
+
+	while ((offset < size) && (rc == SLURM_SUCCESS)) {
+		rd = pread(in_fd, buf, MIN(SBCAST_CACHE_BUF, size - offset),
+			   offset);
+		if (rd < 0) {
+			if (errno == EINTR)
+				continue;
+			rc = SLURM_ERROR;
+			break;
+		} else if (rd == 0) {
+			rc = SLURM_ERROR;	/* file shorter than expected */
+			break;
+		}
+		for (off = 0; off < rd; off += wr) {
+			wr = pwrite(out_fd, buf + off, rd - off, offset + off);
+			if (wr < 0) {
+				if ((errno == EINTR) || (errno == EAGAIN)) {
+					wr = 0;
+					continue;
+				}
+				rc = SLURM_ERROR;
+				break;
+			}
+		}
+		offset += rd;
+	}
+	xfree(buf);
+
+	return rc;
+}
+
+static void _sbcast_cache_ent_free(void *x)
+{
+	sbcast_cache_ent_t *ent = (sbcast_cache_ent_t *) x;
+
+	xfree(ent->name);
+	xfree(ent);
+}
+
+static int _sbcast_cache_ent_cmp(void *x, void *y)
+{
+	sbcast_cache_ent_t *ent1 = *(sbcast_cache_ent_t **) x;
+	sbcast_cache_ent_t *ent2 = *(sbcast_cache_ent_t **) y;
+
+	if (ent1->mtime < ent2->mtime)
+		return -1;
+	if (ent1->mtime > ent2->mtime)
+		return 1;
+	return 0;
+}
+
+/* Remove a file's entry from sbcast_cache_list and return it, if any.
+ * Must hold sbcast_cache_mutex. */
+static sbcast_cache_ent_t *_sbcast_cache_ent_remove(char *name)
+{
+	ListIterator iter;
+	sbcast_cache_ent_t *ent;
+
+	iter = list_iterator_create(sbcast_cache_list);
+	while ((ent = list_next(iter))) {
+		if (!xstrcmp(ent->name, name)) {
+			list_remove(iter);
+			break;
+		}
+	}
+	list_iterator_destroy(iter);
+
+	return ent;
+}
+
+/* Build sbcast_cache_list from the files in the cache directory, once.
+ * Files left behind by an interrupted copy are removed, so call this before
+ * creating any. Must hold sbcast_cache_mutex. */
+static void _sbcast_cache_load(char *dir)
+{
+	sbcast_cache_ent_t *ent;
+	struct dirent *dent;
+	struct stat st;
+	char *path = NULL;
+	DIR *dp;
+
+	if (sbcast_cache_list)
+		return;
+	sbcast_cache_list = list_create(_sbcast_cache_ent_free);
+	sbcast_cache_total = 0;
+
+	if (!(dp = opendir(dir)))
+		return;
+	while ((dent = readdir(dp))) {
+		if (dent->d_name[0] == '.')
+			continue;
+		xstrfmtcat(path, "%s/%s", dir, dent->d_name);
+		if (strstr(dent->d_name, ".tmp")) {
+			(void) unlink(path);
+		} else if (stat(path, &st) == 0) {
+			ent = xmalloc(sizeof(sbcast_cache_ent_t));
+			ent->name = xstrdup(dent->d_name);
+			ent->mtime = st.st_mtime;
+			ent->size = st.st_size;
+			sbcast_cache_total += st.st_size;
+			list_append(sbcast_cache_list, ent);
+		}
+		xfree(path);
+	}
+	closedir(dp);
+	list_sort(sbcast_cache_list, _sbcast_cache_ent_cmp);
+}
+
+/* Record the use of a cached file, which makes it the last to be evicted */
+static void _sbcast_cache_used(char *name, char *path)
+{
+	sbcast_cache_ent_t *ent;
+
+	(void) utime(path, NULL);
+	slurm_mutex_lock(&sbcast_cache_mutex);
+	if (sbcast_cache_list &&
+	    (ent = _sbcast_cache_ent_remove(name))) {
+		ent->mtime = time(NULL);
+		list_append(sbcast_cache_list, ent);
+	}
+	slurm_mutex_unlock(&sbcast_cache_mutex);
+}
+
+/* Copy a file from the sbcast cache to out_fd, the destination file which
+ * is opened and registered. Called without the file_bcast lock, as this
+ * copies the whole file before the first block's reply tells sbcast that
+ * no more blocks are needed, and registering other files must not wait
+ * for that. */
+static int _sbcast_cache_copy(uid_t uid, uint64_t file_hash,
+			      uint64_t file_size, int out_fd, char *fname)
+{
+	char *name = _sbcast_cache_name(uid, file_hash, file_size);
+	char *path = _sbcast_cache_path(name);
+	int fd, rc;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		xfree(name);
+		xfree(path);
+		return SLURM_ERROR;
+	}
+	(void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	rc = _sbcast_copy_data(fd, out_fd, file_size);
+	if (rc != SLURM_SUCCESS) {
+		error("sbcast: uid:%u can't copy cached file to `%s`: %m",
+		      uid, fname);
+		/* Blocks follow from the sender, write them over this */
+		(void) ftruncate(out_fd, 0);
+	} else
+		_sbcast_cache_used(name, path);
+	close(fd);
+	xfree(name);
+	xfree(path);
+
+	return rc;
+}
+
+/* Remove least recently used files until the cache fits in max_size.
+ * Must hold sbcast_cache_mutex. */
+static void _sbcast_cache_evict(char *dir, uint64_t max_size)
+{
+	sbcast_cache_ent_t *ent;
+	char *path;
+
+	while ((sbcast_cache_total > max_size) &&
+	       (ent = list_pop(sbcast_cache_list))) {
+		path = xstrdup_printf("%s/%s", dir, ent->name);
+		debug("sbcast: evicting `%s` from cache", path);
+		if ((unlink(path) < 0) && (errno != ENOENT))
+			error("sbcast: unlink(%s): %m", path);
+		sbcast_cache_total -= MIN(ent->size, sbcast_cache_total);
+		xfree(path);
+		_sbcast_cache_ent_free(ent);
+	}
+}
+
+/* Hash a file written by _sbcast_cache_add_thread() */
+static int _sbcast_cache_hash(int fd, uint64_t size, uint64_t *hash)
+{
+	void *data;
+
+	if (size == 0) {
+		*hash = bcast_file_hash(NULL, 0);
+		return SLURM_SUCCESS;
+	}
+	data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		return SLURM_ERROR;
+	*hash = bcast_file_hash(data, size);
+	munmap(data, size);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * The destination file belongs to the user, who may change or truncate it
+ * at any time. It is only ever read, into a new file in the cache directory
+ * (which only root can write). That copy is hashed and kept only if its
+ * hash matches the one the sender computed, so the cache never holds
+ * content other than what was broadcast under that hash.
+ */
+static void *_sbcast_cache_add_thread(void *arg)
+{
+	sbcast_cache_add_t *add = (sbcast_cache_add_t *) arg;
+	char *dir = NULL, *name = NULL, *path = NULL, *tmp_path = NULL;
+	sbcast_cache_ent_t *ent;
+	uint64_t hash = 0;
+	int fd = -1;
+
+	xstrfmtcat(dir, "%s/%s", conf->spooldir, SBCAST_CACHE_DIR);
+	if ((mkdir(dir, 0700) < 0) && (errno != EEXIST)) {
+		error("sbcast: mkdir(%s): %m", dir);
+		goto fini;
+	}
+	/* Load the cache before creating a file it would remove */
+	slurm_mutex_lock(&sbcast_cache_mutex);
+	_sbcast_cache_load(dir);
+	slurm_mutex_unlock(&sbcast_cache_mutex);
+
+	name = _sbcast_cache_name(add->uid, add->file_hash, add->file_size);
+	path = _sbcast_cache_path(name);
+	tmp_path = xstrdup_printf("%s.tmpXXXXXX", path);
+	if ((fd = mkstemp(tmp_path)) < 0) {
+		error("sbcast: mkstemp(%s): %m", tmp_path);
+		goto fini;
+	}
+	if (_sbcast_copy_data(add->fd, fd, add->file_size) != SLURM_SUCCESS) {
+		debug("sbcast: file changed before it was cached");
+		(void) unlink(tmp_path);
+		goto fini;
+	}
+	/* The file may have changed since it was written, or the sender's
+	 * hash may be wrong. Never cache either. */
+	if ((_sbcast_cache_hash(fd, add->file_size, &hash) !=
+	     SLURM_SUCCESS) || (hash != add->file_hash)) {
+		debug("sbcast: file hash mismatch, not cached");
+		(void) unlink(tmp_path);
+		goto fini;
+	}
+
+	slurm_mutex_lock(&sbcast_cache_mutex);
+	if (rename(tmp_path, path) < 0) {
+		error("sbcast: rename(%s): %m", path);
+		(void) unlink(tmp_path);
+	} else {
+		if ((ent = _sbcast_cache_ent_remove(name))) {
+			sbcast_cache_total -= MIN(ent->size,
+						  sbcast_cache_total);
+		} else {
+			ent = xmalloc(sizeof(sbcast_cache_ent_t));
+			ent->name = xstrdup(name);
+		}
+		ent->mtime = time(NULL);
+		ent->size = add->file_size;
+		sbcast_cache_total += ent->size;
+		list_append(sbcast_cache_list, ent);
+		_sbcast_cache_evict(dir, add->cache_size);
+	}
+	slurm_mutex_unlock(&sbcast_cache_mutex);
+
+fini:	if (fd >= 0)
+		close(fd);
+	close(add->fd);
+	xfree(dir);
+	xfree(name);
+	xfree(path);
+	xfree(tmp_path);
+	xfree(add);
+	return NULL;
+}
+
+/* Copy a completed file to the sbcast cache, without delaying the reply
+ * to the last block. Must have read lock. */
+static void _sbcast_cache_add(file_bcast_info_t *file_info)
+{
+	sbcast_cache_add_t *add;
+	pthread_attr_t attr;
+	pthread_t thread_id;
+	int fd;
+
+	if ((fd = dup(file_info->fd)) < 0) {
+		error("sbcast: dup: %m");
+		return;
+	}
+	fd_set_close_on_exec(fd);
+
+	add = xmalloc(sizeof(sbcast_cache_add_t));
+	add->fd = fd;
+	add->uid = file_info->uid;
+	add->file_hash = file_info->file_hash;
+	add->file_size = file_info->file_size;
+	add->cache_size = bcast_cache_size();
+
+	slurm_attr_init(&attr);
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate error %m");
+	if (pthread_create(&thread_id, &attr, _sbcast_cache_add_thread, add)) {
+		error("sbcast: pthread_create: %m");
+		close(fd);
+		xfree(add);
+	}
+	slurm_attr_destroy(&attr);
 }
 
 static int _rpc_file_bcast(slurm_msg_t *msg)
 {
-	int rc, offset, inx;
+	int rc, offset, inx, fd;
+	bool complete, cached = false;
+	uint64_t file_hash, file_size;
 	file_bcast_info_t *file_info;
 	file_bcast_msg_t *req = msg->data;
 	file_bcast_info_t key;
@@ -3730,6 +4098,35 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		return SLURM_ERROR;
 	}
 
+	/* A file already in the cache needs none of its blocks. sbcast sends
+	 * no other block until the first one is answered. */
+	if ((req->block_no == 1) && file_info->file_hash &&
+	    ((fd = dup(file_info->fd)) >= 0)) {
+		file_hash = file_info->file_hash;
+		file_size = file_info->file_size;
+		_fb_rdunlock();
+		rc = _sbcast_cache_copy(key.uid, file_hash, file_size, fd,
+					key.fname);
+		close(fd);
+		_fb_rdlock();
+		if (!(file_info = _bcast_lookup_file(&key))) {
+			error("No registered file transfer for uid %u file "
+			      "`%s`.", key.uid, key.fname);
+			_fb_rdunlock();
+			return SLURM_ERROR;
+		}
+	} else
+		rc = SLURM_ERROR;
+	if (rc == SLURM_SUCCESS) {
+		info("sbcast: uid:%u copied `%s` from cache",
+		     key.uid, key.fname);
+		file_info->modes = req->modes;
+		file_info->atime = req->atime;
+		file_info->mtime = req->mtime;
+		cached = complete = true;
+		goto finish;
+	}
+
 	/* now decompress file */
 	if (bcast_decompress_data(req) < 0) {
 		error("sbcast: data decompression error for UID %u, file %s",
@@ -3738,10 +4135,25 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		return SLURM_FAILURE;
 	}
 
+	if (req->block_cksum &&
+	    (bcast_block_cksum(req->block, req->block_len) != req->block_cksum)) {
+		error("sbcast: checksum error in block %u for UID %u, file %s",
+		      req->block_no, key.uid, key.fname);
+		_fb_rdunlock();
+		return SLURM_FAILURE;
+	}
+
+	/* Blocks may arrive out of order if sbcast pipelines them, in which
+	 * case block_offset places each one. Older clients send neither. */
 	offset = 0;
 	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
+		if (msg->protocol_version >= SLURM_16_05_PROTOCOL_VERSION)
+			inx = pwrite(file_info->fd, &req->block[offset],
+				     (req->block_len - offset),
+				     req->block_offset + offset);
+		else
+			inx = write(file_info->fd, &req->block[offset],
+				    (req->block_len - offset));
 		if (inx == -1) {
 			if ((errno == EINTR) || (errno == EAGAIN))
 				continue;
@@ -3753,20 +4165,36 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		offset += inx;
 	}
 
+	/* The read lock is shared with other blocks of this file */
+	slurm_mutex_lock(&file_bcast_mutex);
 	file_info->last_update = time(NULL);
+	file_info->received_blocks++;
+	if (req->last_block) {
+		file_info->max_blocks = req->block_no;
+		file_info->modes = req->modes;
+		file_info->atime = req->atime;
+		file_info->mtime = req->mtime;
+	}
+	complete = (file_info->max_blocks &&
+		    (file_info->received_blocks == file_info->max_blocks));
+	slurm_mutex_unlock(&file_bcast_mutex);
 
-	if (req->last_block && fchmod(file_info->fd, (req->modes & 0777))) {
+	if (complete && file_info->file_hash)
+		_sbcast_cache_add(file_info);
+
+finish:
+	if (complete && fchmod(file_info->fd, (file_info->modes & 0777))) {
 		error("sbcast: uid:%u can't chmod `%s`: %m",
 		      key.uid, key.fname);
 	}
-	if (req->last_block && fchown(file_info->fd, key.uid, key.gid)) {
+	if (complete && fchown(file_info->fd, key.uid, key.gid)) {
 		error("sbcast: uid:%u gid:%u can't chown `%s`: %m",
 		      key.uid, key.gid, key.fname);
 	}
-	if (req->last_block && req->atime) {
+	if (complete && file_info->atime) {
 		struct utimbuf time_buf;
-		time_buf.actime  = req->atime;
-		time_buf.modtime = req->mtime;
+		time_buf.actime  = file_info->atime;
+		time_buf.modtime = file_info->mtime;
 		if (utime(key.fname, &time_buf)) {
 			error("sbcast: uid:%u can't utime `%s`: %m",
 			      key.uid, key.fname);
@@ -3775,9 +4203,11 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 
 	_fb_rdunlock();
 
-	if (req->last_block) {
+	if (complete) {
 		_file_bcast_close_file(&key);
 	}
+	if (cached)
+		return ESLURMD_FILE_CACHED;
 	return SLURM_SUCCESS;
 }
 
@@ -3882,6 +4312,11 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 		file_info->gid = key->gid;
 		file_info->job_id = key->job_id;
 		file_info->start_time = time(NULL);
+		file_info->file_size = req->file_size;
+		if (req->file_hash && (msg->protocol_version >=
+				       SLURM_17_02_PROTOCOL_VERSION) &&
+		    (req->file_size <= bcast_cache_size()))
+			file_info->file_hash = req->file_hash;
 
 		//TODO: mmap the file here
 		_fb_wrlock();
@@ -3932,7 +4367,8 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 		exit(errno);
 	}
 
-	flags = O_WRONLY | O_CREAT;
+	/* Readable so that a completed file can be copied to the cache */
+	flags = O_RDWR | O_CREAT;
 	if (req->force)
 		flags |= O_TRUNC;
 	else
@@ -295,6 +295,9 @@ main (int argc, char *argv[])
 	if (conf->daemonize) {
 		if (daemon(1,1) == -1)
 			error("Couldn't daemonize slurmd: %m");
+		/* Restart the log writer thread, which daemon() lost */
+		log_alter(conf->log_opts, SYSLOG_FACILITY_DAEMON,
+			  conf->logfile);
 	}
 	test_core_limit();
 	info("slurmd version %s started", SLURM_VERSION_STRING);
@@ -1936,6 +1939,8 @@ static void _update_logging(void)
 			o->syslog_level = LOG_LEVEL_FATAL;
 	} else
 		o->syslog_level  = LOG_LEVEL_QUIET;
+	/* RPC threads queue messages, a writer thread writes the log file */
+	o->async = 1;
 
 	log_alter(conf->log_opts, SYSLOG_FACILITY_DAEMON, conf->logfile);
 	log_set_timefmt(conf->log_fmt);
@@ -56,6 +56,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "src/common/cbuf.h"
@@ -210,6 +211,7 @@ static void _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job);
 static void _free_all_outgoing_msgs(List msg_queue, stepd_step_rec_t *job);
 static bool _incoming_buf_free(stepd_step_rec_t *job);
 static bool _outgoing_buf_free(stepd_step_rec_t *job);
+static int  _max_io_bufs(stepd_step_rec_t *job);
 static int  _send_connection_okay_response(stepd_step_rec_t *job);
 static struct io_buf *_build_connection_okay_message(stepd_step_rec_t *job);
 
@@ -398,6 +400,7 @@ _client_read(eio_obj_t *obj, List objs)
 		stepd_step_task_info_t *task;
 		struct task_write_info *io;
 
+		client->job->io_bytes_in += client->in_msg->length;
 		client->in_msg->ref_count = 0;
 		if (client->header.type == SLURM_IO_ALLSTDIN) {
 			for (i = 0; i < client->job->node_tasks; i++) {
@@ -427,43 +430,51 @@ _client_read(eio_obj_t *obj, List objs)
 }
 
 /*
- * Write outgoing packed messages to the client socket.
+ * Write outgoing packed messages to the client socket, gathering as many
+ * queued messages as possible into a single writev(). The messages are
+ * shared with other clients and the outgoing cache, so are not copied.
  */
 static int
 _client_write(eio_obj_t *obj, List objs)
 {
 	struct client_io_info *client = (struct client_io_info *) obj->arg;
-	void *buf;
-	int n;
+	struct iovec iov[STDIO_MAX_WRITEV];
+	struct io_buf *msg;
+	ListIterator msgs;
+	int iovcnt = 0;
+	ssize_t n, total = 0;
 
 	xassert(client->magic == CLIENT_IO_MAGIC);
 
 	debug4("Entering _client_write");
 
 	/*
-	 * If we aren't already in the middle of sending a message, get the
-	 * next message from the queue.
+	 * Finish any message already partly written, then follow it with
+	 * the next messages from the queue.
 	 */
-	if (client->out_msg == NULL) {
-		client->out_msg = list_dequeue(client->msg_queue);
-		if (client->out_msg == NULL) {
-			debug5("_client_write: nothing in the queue");
-			return SLURM_SUCCESS;
-		}
-		debug5("  dequeue successful, client->out_msg->length = %d",
-			client->out_msg->length);
-		client->out_remaining = client->out_msg->length;
+	if (client->out_msg != NULL) {
+		iov[iovcnt].iov_base = client->out_msg->data +
+			(client->out_msg->length - client->out_remaining);
+		iov[iovcnt].iov_len = client->out_remaining;
+		total += iov[iovcnt++].iov_len;
+	}
+	msgs = list_iterator_create(client->msg_queue);
+	while ((iovcnt < STDIO_MAX_WRITEV) && (msg = list_next(msgs))) {
+		iov[iovcnt].iov_base = msg->data;
+		iov[iovcnt].iov_len = msg->length;
+		total += iov[iovcnt++].iov_len;
+	}
+	list_iterator_destroy(msgs);
+	if (iovcnt == 0) {
+		debug5("_client_write: nothing in the queue");
+		return SLURM_SUCCESS;
 	}
-
-	debug5("  client->out_remaining = %d", client->out_remaining);
 
 	/*
-	 * Write message to socket.
+	 * Write messages to socket.
 	 */
-	buf = client->out_msg->data +
-		(client->out_msg->length - client->out_remaining);
 again:
-	if ((n = write(obj->fd, buf, client->out_remaining)) < 0) {
+	if ((n = writev(obj->fd, iov, iovcnt)) < 0) {
 		if (errno == EINTR) {
 			goto again;
 		} else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
@@ -471,21 +482,35 @@ again:
 			return SLURM_SUCCESS;
 		} else {
 			client->out_eof = true;
+			if (client->out_msg) {
+				_free_outgoing_msg(client->out_msg,
+						   client->job);
+				client->out_msg = NULL;
+			}
 			_free_all_outgoing_msgs(client->msg_queue, client->job);
 			return SLURM_SUCCESS;
 		}
 	}
-	if (n < client->out_remaining) {
-		error("Only wrote %d of %d bytes to socket",
-		      n, client->out_remaining);
-	} else
-		debug5("Wrote %d bytes to socket", n);
-	client->out_remaining -= n;
-	if (client->out_remaining > 0)
-		return SLURM_SUCCESS;
+	debug5("Wrote %zd of %zd bytes in %d messages to socket",
+	       n, total, iovcnt);
 
-	_free_outgoing_msg(client->out_msg, client->job);
-	client->out_msg = NULL;
+	/*
+	 * Release the messages written in full. Releasing a message may
+	 * route more task output onto the end of msg_queue.
+	 */
+	while (n > 0) {
+		if (client->out_msg == NULL) {
+			client->out_msg = list_dequeue(client->msg_queue);
+			client->out_remaining = client->out_msg->length;
+		}
+		if (n < client->out_remaining) {
+			client->out_remaining -= n;
+			break;
+		}
+		n -= client->out_remaining;
+		_free_outgoing_msg(client->out_msg, client->job);
+		client->out_msg = NULL;
+	}
 
 	return SLURM_SUCCESS;
 }
@@ -1349,6 +1374,14 @@ _route_msg_task_to_client(eio_obj_t *obj)
 			_shrink_msg_cache(out->job->outgoing_cache, out->job);
 		}
 	}
+
+	/* Task output stays in its cbuf until a client frees a buffer */
+	if ((cbuf_used(out->buf) > 0) && !out->job->io_stalled &&
+	    !_outgoing_buf_free(out->job)) {
+		debug5("%s: no free outgoing buffer", __func__);
+		out->job->io_stalled = true;
+		out->job->io_stalls++;
+	}
 }
 
 static void
@@ -1373,6 +1406,7 @@ _free_outgoing_msg(struct io_buf *msg, stepd_step_rec_t *job)
 	if (msg->ref_count == 0) {
 		/* Put the message back on the free List */
 		list_enqueue(job->free_outgoing, msg);
+		job->io_stalled = false;
 
 		/* Try packing messages from tasks' output cbufs */
 		if (job->task == NULL)
@@ -1499,6 +1533,10 @@ _io_thr(void *arg)
 	debug("IO handler started pid=%lu", (unsigned long) getpid());
 	rc = eio_handle_mainloop(job->eio);
 	debug("IO handler exited, rc=%d", rc);
+	debug("IO forwarded %"PRIu64" bytes from tasks, %"PRIu64" bytes to "
+	      "tasks, output stalled %u times with %d of %d buffers",
+	      job->io_bytes_out, job->io_bytes_in, job->io_stalls,
+	      job->outgoing_count, _max_io_bufs(job));
 	return (void *)1;
 }
 
@@ -1824,6 +1862,7 @@ _task_build_message(struct task_read_info *out, stepd_step_rec_t *job, cbuf_t cb
 	header.ltaskid = out->ltaskid;
 	header.gtaskid = out->gtaskid;
 	header.length = n;
+	job->io_bytes_out += n;
 
 	debug4("%s: header.length %d", __func__, n);
 	packbuf = create_buf(msg->data, io_hdr_packed_size());
@@ -1874,6 +1913,37 @@ free_io_buf(struct io_buf *buf)
 	}
 }
 
+/*
+ * Return the most message buffers to allocate in each direction,
+ * STDIO_MAX_FREE_BUF unless LaunchParameters=stdio_buffers=# is configured
+ */
+static int
+_max_io_bufs(stepd_step_rec_t *job)
+{
+	char *launch_params, *tmp_ptr;
+	int max_bufs;
+
+	if (job->max_io_bufs)
+		return job->max_io_bufs;
+
+	job->max_io_bufs = STDIO_MAX_FREE_BUF;
+	launch_params = slurm_get_launch_params();
+	if (launch_params &&
+	    (tmp_ptr = xstrcasestr(launch_params, "stdio_buffers="))) {
+		max_bufs = atoi(tmp_ptr + 14);
+		/* Leave buffers for new output beyond the message cache */
+		if (max_bufs < (STDIO_MAX_MSG_CACHE * 2)) {
+			error("Invalid LaunchParameters stdio_buffers=%d, "
+			      "using %d", max_bufs, STDIO_MAX_MSG_CACHE * 2);
+			max_bufs = STDIO_MAX_MSG_CACHE * 2;
+		}
+		job->max_io_bufs = max_bufs;
+	}
+	xfree(launch_params);
+
+	return job->max_io_bufs;
+}
+
 /* This just determines if there's space to hold more of the stdin stream */
 static bool
 _incoming_buf_free(stepd_step_rec_t *job)
@@ -1882,7 +1952,7 @@ _incoming_buf_free(stepd_step_rec_t *job)
 
 	if (list_count(job->free_incoming) > 0) {
 		return true;
-	} else if (job->incoming_count < STDIO_MAX_FREE_BUF) {
+	} else if (job->incoming_count < _max_io_bufs(job)) {
 		buf = alloc_io_buf();
 		if (buf != NULL) {
 			list_enqueue(job->free_incoming, buf);
@@ -1901,7 +1971,7 @@ _outgoing_buf_free(stepd_step_rec_t *job)
 
 	if (list_count(job->free_outgoing) > 0) {
 		return true;
-	} else if (job->outgoing_count < STDIO_MAX_FREE_BUF) {
+	} else if (job->outgoing_count < _max_io_bufs(job)) {
 		buf = alloc_io_buf();
 		if (buf != NULL) {
 			list_enqueue(job->free_outgoing, buf);
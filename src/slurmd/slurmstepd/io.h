@@ -45,11 +45,15 @@
 
 /*
  * The message cache uses up free message buffers, so STDIO_MAX_MSG_CACHE
- * must be a number smaller than STDIO_MAX_FREE_BUF.
+ * must be a number smaller than STDIO_MAX_FREE_BUF. STDIO_MAX_FREE_BUF is
+ * the default, LaunchParameters=stdio_buffers=# overrides it.
  */
 #define STDIO_MAX_FREE_BUF 1024
 #define STDIO_MAX_MSG_CACHE 128
 
+/* Most queued messages gathered into one writev() to a client socket */
+#define STDIO_MAX_WRITEV 64
+
 struct io_buf {
 	int ref_count;
 	uint32_t length;
@@ -194,6 +194,14 @@ typedef struct {
 	List outgoing_cache;  /* cache of outgoing stdio messages
 			       * used when a new client attaches
 			       */
+	int max_io_bufs;      /* limit on incoming_count and
+			       * outgoing_count, zero until set
+			       */
+	uint64_t io_bytes_out;	/* task output bytes forwarded      */
+	uint64_t io_bytes_in;	/* stdin bytes forwarded to tasks   */
+	uint32_t io_stalls;	/* times task output waited for a
+				 * free outgoing buffer             */
+	bool io_stalled;	/* task output now waiting          */
 
 	pthread_t      ioid;  /* pthread id of IO thread                    */
 	pthread_t      msgid; /* pthread id of message thread               */
@@ -3193,6 +3193,10 @@ static int   _roll_usage(slurmdbd_conn_t *slurmdbd_conn,
 		rpc_stats.rollup_max_time[i] =
 			MAX(rpc_stats.rollup_max_time[i],
 			    rollup_stats.rollup_time[i]);
+		rpc_stats.rollup_units[i] += rollup_stats.rollup_units[i];
+		rpc_stats.rollup_max_unit_time[i] =
+			MAX(rpc_stats.rollup_max_unit_time[i],
+			    rollup_stats.rollup_max_unit_time[i]);
 	}
 	slurm_mutex_unlock(&rpc_mutex);
 
@@ -3499,6 +3503,8 @@ static int  _clear_stats(slurmdbd_conn_t *slurmdbd_conn,
 		rpc_stats.rollup_count[i] = 0;
 		rpc_stats.rollup_time[i] = 0;
 		rpc_stats.rollup_max_time[i] = 0;
+		rpc_stats.rollup_units[i] = 0;
+		rpc_stats.rollup_max_unit_time[i] = 0;
 	}
 	for (i = 0; i < rpc_stats.type_cnt; i++) {
 		rpc_stats.rpc_type_cnt[i] = 0;
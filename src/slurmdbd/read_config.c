@@ -107,6 +107,7 @@ static void _clear_slurmdbd_conf(void)
 		slurmdbd_conf->purge_resv = 0;
 		slurmdbd_conf->purge_step = 0;
 		slurmdbd_conf->purge_suspend = 0;
+		slurmdbd_conf->rollup_threads = 0;
 		slurmdbd_conf->slurm_user_id = NO_VAL;
 		xfree(slurmdbd_conf->slurm_user_name);
 		xfree(slurmdbd_conf->storage_backup_host);
@@ -163,6 +164,7 @@ extern int read_slurmdbd_conf(void)
 		{"PurgeJobMonths", S_P_UINT32},
 		{"PurgeStepMonths", S_P_UINT32},
 		{"PurgeSuspendMonths", S_P_UINT32},
+		{"RollupThreads", S_P_UINT16},
 		{"SlurmUser", S_P_STRING},
 		{"StepPurge", S_P_UINT32},
 		{"StorageBackupHost", S_P_STRING},
@@ -392,6 +394,12 @@ extern int read_slurmdbd_conf(void)
 					|= SLURMDB_PURGE_MONTHS;
 		}
 
+		if (!s_p_get_uint16(&slurmdbd_conf->rollup_threads,
+				    "RollupThreads", tbl) ||
+		    !slurmdbd_conf->rollup_threads)
+			slurmdbd_conf->rollup_threads =
+				DEFAULT_SLURMDBD_ROLLUP_THREADS;
+
 		s_p_get_string(&slurmdbd_conf->slurm_user_name,
 			       "SlurmUser", tbl);
 
@@ -595,6 +603,8 @@ extern void log_config(void)
 			     tmp_str, sizeof(tmp_str), 1);
 	debug2("PurgeSuspendAfter = %s", tmp_str);
 
+	debug2("RollupThreads     = %u", slurmdbd_conf->rollup_threads);
+
 	debug2("SlurmUser         = %s(%u)",
 	       slurmdbd_conf->slurm_user_name, slurmdbd_conf->slurm_user_id);
 
@@ -819,6 +829,11 @@ extern List dump_config(void)
 		key_pair->value = xstrdup("NONE");
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("RollupThreads");
+	key_pair->value = xstrdup_printf("%u", slurmdbd_conf->rollup_threads);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("SLURMDBD_CONF");
 	key_pair->value = get_extra_conf_path("slurmdbd.conf");
@@ -47,6 +47,7 @@
 #include "src/common/list.h"
 
 #define DEFAULT_SLURMDBD_AUTHTYPE	"auth/none"
+#define DEFAULT_SLURMDBD_ROLLUP_THREADS	4
 //#define DEFAULT_SLURMDBD_JOB_PURGE	12
 #define DEFAULT_SLURMDBD_PIDFILE	"/var/run/slurmdbd.pid"
 #define DEFAULT_SLURMDBD_ARCHIVE_DIR	"/tmp"
@@ -87,6 +88,8 @@ typedef struct slurm_dbd_conf {
 	uint32_t	purge_step;	/* purge time for step info	*/
 	uint32_t        purge_suspend;  /* purge suspend data older
 					 * than this in months or days	*/
+	uint16_t	rollup_threads;	/* connections rolling up hours
+					 * in parallel			*/
 	uint32_t	slurm_user_id;	/* uid of slurm_user_name	*/
 	char *		slurm_user_name;/* user that slurmcdtld runs as	*/
 	char *		storage_backup_host;/* backup host where DB is
@@ -182,21 +182,23 @@ _print_job ( bool clear_old )
 	if (params.format && strstr(params.format, "C"))
 		show_flags |= SHOW_DETAIL;
 
-	if (old_job_ptr) {
+	if (old_job_ptr && !params.job_id && !params.user_id) {
+		/* Only transfer jobs changed since the previous iteration */
+		if (clear_old)
+			old_job_ptr->last_update = 0;
+		error_code = slurm_load_jobs_delta(&old_job_ptr, show_flags);
+		new_job_ptr = old_job_ptr;
+	} else if (old_job_ptr) {
 		if (clear_old)
 			old_job_ptr->last_update = 0;
 		if (params.job_id) {
 			error_code = slurm_load_job(
 				&new_job_ptr, params.job_id,
 				show_flags);
-		} else if (params.user_id) {
+		} else {
 			error_code = slurm_load_job_user(&new_job_ptr,
 							 params.user_id,
 							 show_flags);
-		} else {
-			error_code = slurm_load_jobs(
-				old_job_ptr->last_update,
-				&new_job_ptr, show_flags);
 		}
 		if (error_code ==  SLURM_SUCCESS)
 			slurm_free_job_info_msg( old_job_ptr );
@@ -0,0 +1,256 @@
+/* Test of the archive file writer and reader of
+ * src/plugins/accounting_storage/common/common_as.c
+ */
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <src/common/pack.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <src/plugins/accounting_storage/common/common_as.h>
+
+/* dejagnu.h has a wait() of its own, which slurm's headers declare */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define SEG_CNT		24
+
+/* Provided by the accounting_storage/mysql plugin */
+char *assoc_day_table = "assoc_usage_day_table";
+char *assoc_hour_table = "assoc_usage_hour_table";
+char *assoc_month_table = "assoc_usage_month_table";
+char *cluster_day_table = "usage_day_table";
+char *cluster_hour_table = "usage_hour_table";
+char *cluster_month_table = "usage_month_table";
+char *wckey_day_table = "wckey_usage_day_table";
+char *wckey_hour_table = "wckey_usage_hour_table";
+char *wckey_month_table = "wckey_usage_month_table";
+
+static char *arch_dir = "archive_file-test.dir";
+
+/* RET the size of segment seg of an archive, a few of them empty or large */
+static uint32_t _seg_size(int seg)
+{
+	if (seg == 3)
+		return 0;
+	if (seg == 7)
+		return 6 * 1024 * 1024;
+	return (seg * 7919) % (300 * 1024);
+}
+
+/* Fill segment seg of an archive with data which differs between archives
+ * and segments, and compresses somewhat */
+static Buf _seg_buf(int archive, int seg)
+{
+	uint32_t i, size = _seg_size(seg);
+	Buf buffer = init_buf(size + 1);
+	char *data = get_buf_data(buffer);
+
+	srandom(archive * 1000 + seg);
+	for (i = 0; i < size; i++)
+		data[i] = (random() % 16) + 'a';
+	set_buf_offset(buffer, size);
+	return buffer;
+}
+
+static char *_archive_file(char *suffix)
+{
+	struct dirent *ent;
+	char *file = NULL;
+	DIR *dir = opendir(arch_dir);
+	size_t len = strlen(suffix);
+
+	while (dir && (ent = readdir(dir))) {
+		if (!strncmp(ent->d_name, "test_job_archive_", 17) &&
+		    (strlen(ent->d_name) > len) &&
+		    !strcmp(ent->d_name + strlen(ent->d_name) - len, suffix) &&
+		    (len || !strchr(ent->d_name, '.')))
+			file = xstrdup_printf("%s/%s", arch_dir, ent->d_name);
+	}
+	if (dir)
+		closedir(dir);
+	return file;
+}
+
+static int _file_cnt(void)
+{
+	struct dirent *ent;
+	DIR *dir = opendir(arch_dir);
+	int cnt = 0;
+
+	while (dir && (ent = readdir(dir))) {
+		if (ent->d_name[0] != '.')
+			cnt++;
+	}
+	if (dir)
+		closedir(dir);
+	return cnt;
+}
+
+/* Write an archive of seg_cnt segments
+ * RET SLURM_SUCCESS or SLURM_ERROR */
+static int _write_archive(int archive, int seg_cnt, bool commit)
+{
+	archive_file_t *arch_file;
+	Buf buffer;
+	int seg, rc = SLURM_SUCCESS;
+
+	/* 2008-01-01 to 2008-02-01, in months */
+	arch_file = archive_file_create("test", 1199170800, 1201849200,
+					arch_dir, "job", SLURMDB_PURGE_MONTHS);
+	if (!arch_file)
+		return SLURM_ERROR;
+	for (seg = 0; seg < seg_cnt; seg++) {
+		buffer = _seg_buf(archive, seg);
+		if (archive_file_write(arch_file, buffer) != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+		free_buf(buffer);
+	}
+	if (archive_file_close(arch_file, commit) != SLURM_SUCCESS)
+		rc = SLURM_ERROR;
+	return rc;
+}
+
+/* Write an uncompressed archive as older versions, or builds without zlib,
+ * do */
+static void _write_plain(char *file, int archive, int seg_cnt)
+{
+	int seg, fd = creat(file, 0600);
+	uint32_t nsize, magic = htonl(ARCHIVE_STREAM_MAGIC);
+	Buf buffer;
+
+	if ((fd < 0) || (write(fd, &magic, sizeof(magic)) != sizeof(magic)))
+		fail("write plain archive");
+	for (seg = 0; (fd >= 0) && (seg < seg_cnt); seg++) {
+		buffer = _seg_buf(archive, seg);
+		nsize = htonl(get_buf_offset(buffer));
+		if ((write(fd, &nsize, sizeof(nsize)) != sizeof(nsize)) ||
+		    (write(fd, get_buf_data(buffer), get_buf_offset(buffer)) !=
+		     get_buf_offset(buffer)))
+			fail("write plain archive");
+		free_buf(buffer);
+	}
+	if (fd >= 0)
+		close(fd);
+}
+
+/* Read an archive as the loader does
+ * RET the number of segments matching those written, or -1 if any did not
+ *     match, the file could not be read or it had trailing data */
+static int _read_archive(char *file, int archive)
+{
+	archive_file_t *arch_file;
+	uint32_t magic, size;
+	int amount, seg = 0;
+	char *data;
+	Buf buffer;
+
+	if (!file || !(arch_file = archive_file_open(file)))
+		return -1;
+	if ((archive_file_read(arch_file, &magic, sizeof(magic)) !=
+	     sizeof(magic)) || (ntohl(magic) != ARCHIVE_STREAM_MAGIC)) {
+		archive_file_close(arch_file, false);
+		return -1;
+	}
+	while ((amount = archive_file_read(arch_file, &size, sizeof(size))) ==
+	       sizeof(size)) {
+		size = ntohl(size);
+		buffer = _seg_buf(archive, seg);
+		data = xmalloc(size + 1);
+		if ((size != get_buf_offset(buffer)) ||
+		    (archive_file_read(arch_file, data, size) != size) ||
+		    memcmp(data, get_buf_data(buffer), size))
+			seg = -1;
+		xfree(data);
+		free_buf(buffer);
+		if (seg < 0)
+			break;
+		seg++;
+	}
+	if (amount != 0)
+		seg = -1;
+	archive_file_close(arch_file, false);
+	return seg;
+}
+
+static bool _compressed(char *file)
+{
+	unsigned char head[2] = { 0, 0 };
+	int fd = open(file, O_RDONLY);
+
+	if (fd >= 0) {
+		if (read(fd, head, 2) != 2)
+			head[0] = 0;
+		close(fd);
+	}
+	return (head[0] == 0x1f) && (head[1] == 0x8b);
+}
+
+int
+main(int argc, char *argv[])
+{
+	char *file, *old_file;
+	struct stat st;
+	int rc;
+
+	(void) mkdir(arch_dir, 0700);
+
+	note("Testing archive file round trip");
+	TEST(_write_archive(1, SEG_CNT, true) == SLURM_SUCCESS,
+	     "archive written");
+	file = _archive_file("");
+	TEST(file && (_file_cnt() == 1), "archive committed");
+	TEST(_read_archive(file, 1) == SEG_CNT, "segments read back");
+#if HAVE_LIBZ
+	TEST(_compressed(file), "archive compressed with zlib");
+#else
+	TEST(!_compressed(file), "archive not compressed without zlib");
+#endif
+
+	note("Testing abandoned and replaced archives");
+	TEST(_write_archive(2, 4, false) == SLURM_SUCCESS,
+	     "abandoned archive written");
+	TEST((_file_cnt() == 1) && (_read_archive(file, 1) == SEG_CNT),
+	     "abandoned archive removed");
+	TEST(_write_archive(3, 5, true) == SLURM_SUCCESS,
+	     "replacement archive written");
+	old_file = _archive_file(".old");
+	TEST(_read_archive(file, 3) == 5, "archive replaced");
+	TEST(_read_archive(old_file, 1) == SEG_CNT,
+	     "previous archive kept as .old");
+	xfree(old_file);
+
+	note("Testing truncated and uncompressed archives");
+	if (stat(file, &st) || truncate(file, st.st_size / 2))
+		fail("truncate");
+	rc = _read_archive(file, 3);
+	TEST(rc == -1, "truncated archive detected");
+	(void) unlink(file);
+	_write_plain(file, 4, SEG_CNT);
+	TEST(_read_archive(file, 4) == SEG_CNT, "uncompressed archive read");
+	_write_plain(file, 5, 0);
+	TEST(_read_archive(file, 5) == 0, "empty archive read");
+	TEST(!archive_file_open("archive_file-test.missing"),
+	     "missing archive not opened");
+
+	(void) unlink(file);
+	xfree(file);
+	file = _archive_file(".old");
+	(void) unlink(file);
+	xfree(file);
+	(void) rmdir(arch_dir);
+	totals();
+	return failed;
+}
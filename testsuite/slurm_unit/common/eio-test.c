@@ -0,0 +1,358 @@
+/* Test and microbenchmark of src/common/eio.c backends
+ */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <src/common/eio.h>
+#include <src/common/xmalloc.h>
+/* dejagnu.h defines a wait() of its own, which sys/wait.h already declared */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Largest object count for the benchmark */
+#define BENCH_MAX_OBJS	8192
+#define BENCH_HOPS	5000
+
+/* A token passed around a ring of pipes, one eio object per pipe */
+typedef struct {
+	eio_handle_t *eio;
+	int *wfds;		/* write end of each pipe */
+	int obj_cnt;
+	int hops;		/* hops left to make */
+	int bad;		/* unexpected reads */
+} ring_t;
+
+typedef struct {
+	ring_t *ring;
+	int inx;
+} ring_obj_t;
+
+static long _usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return ((tv2->tv_sec - tv1->tv_sec) * 1000000) +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
+static bool _ring_readable(eio_obj_t *obj)
+{
+	return !obj->shutdown;
+}
+
+static int _ring_read(eio_obj_t *obj, List objs)
+{
+	ring_obj_t *robj = obj->arg;
+	ring_t *ring = robj->ring;
+	char c;
+
+	if (read(obj->fd, &c, 1) != 1) {
+		ring->bad++;
+		return 0;
+	}
+	if (--ring->hops <= 0) {
+		eio_signal_shutdown(ring->eio);
+		return 0;
+	}
+	if (write(ring->wfds[(robj->inx + 1) % ring->obj_cnt], &c, 1) != 1)
+		ring->bad++;
+	return 0;
+}
+
+static struct io_operations ring_ops = {
+	.readable    = _ring_readable,
+	.handle_read = _ring_read,
+};
+
+/* Pass a token around a ring of obj_cnt pipes. Return usec per hop or
+ * -1 on error. */
+static double _ring(eio_backend_t backend, int obj_cnt, int hops)
+{
+	ring_t ring;
+	ring_obj_t *robjs;
+	int fds[2], i, rc;
+	struct timeval tv1, tv2;
+	char c = 1;
+
+	ring.eio = eio_handle_create(0);
+	ring.wfds = xmalloc(sizeof(int) * obj_cnt);
+	ring.obj_cnt = obj_cnt;
+	ring.hops = hops;
+	ring.bad = 0;
+	robjs = xmalloc(sizeof(ring_obj_t) * obj_cnt);
+	if (eio_handle_set_backend(ring.eio, backend) != SLURM_SUCCESS)
+		return -1;
+
+	for (i = 0; i < obj_cnt; i++) {
+		if (pipe(fds) < 0)
+			return -1;
+		ring.wfds[i] = fds[1];
+		robjs[i].ring = &ring;
+		robjs[i].inx = i;
+		eio_new_initial_obj(ring.eio,
+				    eio_obj_create(fds[0], &ring_ops,
+						   &robjs[i]));
+	}
+
+	if (write(ring.wfds[0], &c, 1) != 1)
+		return -1;
+	gettimeofday(&tv1, NULL);
+	rc = eio_handle_mainloop(ring.eio);
+	gettimeofday(&tv2, NULL);
+
+	/* Closes the read ends of the pipes */
+	eio_handle_destroy(ring.eio);
+	for (i = 0; i < obj_cnt; i++)
+		close(ring.wfds[i]);
+	xfree(ring.wfds);
+	xfree(robjs);
+
+	if ((rc != 0) || ring.bad || ring.hops)
+		return -1;
+	return (double) _usec(&tv1, &tv2) / hops;
+}
+
+/* Objects swapped on one handle while another handle runs */
+static void *_ring_thread(void *arg)
+{
+	eio_backend_t *backend = arg;
+	static double usec;
+
+	usec = _ring(*backend, 64, 20000);
+	return &usec;
+}
+
+static int null_reads = 0;
+
+static int _null_read(eio_obj_t *obj, List objs)
+{
+	char c;
+
+	if (read(obj->fd, &c, 1) == 0)
+		null_reads++;
+	obj->shutdown = true;
+	return 0;
+}
+
+static struct io_operations null_ops = {
+	.readable    = _ring_readable,
+	.handle_read = _null_read,
+};
+
+/* Replace an object with a new one on a new pipe, which is given the same
+ * descriptor number */
+static int reopen_cnt = 0;
+
+static int _reopen_read(eio_obj_t *obj, List objs)
+{
+	struct io_operations *ops = obj->ops;
+	int fds[2];
+	char c;
+
+	if (read(obj->fd, &c, 1) != 1) {
+		obj->shutdown = true;
+		return 0;
+	}
+	if (++reopen_cnt >= 10) {
+		obj->shutdown = true;
+		return 0;
+	}
+	close(obj->fd);
+	if (pipe(fds) < 0)
+		return 0;
+	/* Copies ops, so create before obj and its ops are freed */
+	list_append(objs, eio_obj_create(fds[0], ops, NULL));
+	eio_remove_obj(obj, objs);
+	if (write(fds[1], &c, 1) != 1)
+		reopen_cnt = -100;
+	/* Leak the write end, so the read end stays open without EOF */
+	return 0;
+}
+
+/* Each of two objects replaces the other, leaving the count unchanged */
+static eio_obj_t *swap_objs[2];
+static int swap_reads = 0, swap_stale = 0;
+static bool swapped = false;
+
+static int _swap_read(eio_obj_t *obj, List objs)
+{
+	struct io_operations *ops = obj->ops;
+	eio_obj_t *new_obj;
+	int fds[2], i;
+	char c = 1;
+
+	for (i = 0; i < 2; i++) {
+		if (swap_objs[i] == obj)
+			break;
+	}
+	if (i == 2) {
+		swap_stale++;
+		return 0;
+	}
+	if (read(obj->fd, &c, 1) == 1)
+		swap_reads++;
+	obj->shutdown = true;
+	if (swapped)
+		return 0;
+	swapped = true;
+	/* Keep the freed object's memory and descriptor from being reused */
+	if ((pipe(fds) < 0) || (write(fds[1], &c, 1) != 1))
+		return 0;
+	new_obj = eio_obj_create(fds[0], ops, NULL);
+	list_append(objs, new_obj);
+	eio_remove_obj(swap_objs[1 - i], objs);
+	swap_objs[1 - i] = new_obj;
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	eio_backend_t backends[] = { EIO_BACKEND_POLL, EIO_BACKEND_EPOLL };
+	char *backend_names[] = { "poll", "epoll" };
+	struct rlimit rlim;
+	eio_handle_t *eio;
+	int b, max_objs = BENCH_MAX_OBJS;
+
+	eio = eio_handle_create(0);
+	if (eio_handle_set_backend(eio, EIO_BACKEND_EPOLL) != SLURM_SUCCESS) {
+		note("epoll unavailable, testing poll only");
+		backends[1] = EIO_BACKEND_POLL;
+	}
+	eio_handle_destroy(eio);
+
+	note("Testing token ring");
+	for (b = 0; b < 2; b++) {
+		TEST(_ring(backends[b], 1, 100) >= 0.0, backend_names[b]);
+		TEST(_ring(backends[b], 64, 1000) >= 0.0, backend_names[b]);
+	}
+
+	note("Testing descriptors epoll can not poll");
+	for (b = 0; b < 2; b++) {
+		eio_handle_t *eio = eio_handle_create(0);
+		int fd = open("/dev/null", O_RDONLY);
+
+		null_reads = 0;
+		eio_handle_set_backend(eio, backends[b]);
+		eio_new_initial_obj(eio, eio_obj_create(fd, &null_ops, NULL));
+		TEST(eio_handle_mainloop(eio) == 0, backend_names[b]);
+		TEST(null_reads == 1, backend_names[b]);
+		eio_handle_destroy(eio);
+	}
+
+	note("Testing objects replaced by handlers");
+	for (b = 0; b < 2; b++) {
+		eio_handle_t *eio = eio_handle_create(0);
+		struct io_operations reopen_ops = {
+			.readable    = _ring_readable,
+			.handle_read = _reopen_read,
+		};
+		int fds[2];
+		char c = 1;
+
+		reopen_cnt = 0;
+		if ((pipe(fds) < 0) || (write(fds[1], &c, 1) != 1))
+			fail("pipe");
+		eio_handle_set_backend(eio, backends[b]);
+		eio_new_initial_obj(eio, eio_obj_create(fds[0], &reopen_ops,
+							NULL));
+		TEST(eio_handle_mainloop(eio) == 0, backend_names[b]);
+		TEST(reopen_cnt == 10, backend_names[b]);
+		eio_handle_destroy(eio);
+	}
+
+	note("Testing objects swapped with pending events");
+	if (backends[1] == EIO_BACKEND_EPOLL) {
+		eio_handle_t *eio = eio_handle_create(0);
+		struct io_operations swap_ops = {
+			.readable    = _ring_readable,
+			.handle_read = _swap_read,
+		};
+		int fds[2], i;
+		char c = 1;
+
+		eio_handle_set_backend(eio, EIO_BACKEND_EPOLL);
+		for (i = 0; i < 2; i++) {
+			if ((pipe(fds) < 0) || (write(fds[1], &c, 1) != 1))
+				fail("pipe");
+			swap_objs[i] = eio_obj_create(fds[0], &swap_ops, NULL);
+			eio_new_initial_obj(eio, swap_objs[i]);
+		}
+		TEST(eio_handle_mainloop(eio) == 0, "epoll");
+		TEST(swap_reads == 2, "epoll");
+		TEST(swap_stale == 0, "epoll");
+		eio_handle_destroy(eio);
+	}
+
+	note("Testing handles run concurrently");
+	for (b = 0; b < 2; b++) {
+		eio_handle_t *eio = eio_handle_create(0);
+		struct io_operations reopen_ops = {
+			.readable    = _ring_readable,
+			.handle_read = _reopen_read,
+		};
+		pthread_t tid;
+		double *usec = NULL;
+		int fds[2];
+		char c = 1;
+
+		reopen_cnt = 0;
+		if (pthread_create(&tid, NULL, _ring_thread, &backends[b]))
+			fail("pthread_create");
+		if ((pipe(fds) < 0) || (write(fds[1], &c, 1) != 1))
+			fail("pipe");
+		eio_handle_set_backend(eio, backends[b]);
+		eio_new_initial_obj(eio, eio_obj_create(fds[0], &reopen_ops,
+							NULL));
+		TEST(eio_handle_mainloop(eio) == 0, backend_names[b]);
+		eio_handle_destroy(eio);
+		pthread_join(tid, (void **) &usec);
+		TEST(usec && (*usec >= 0.0), backend_names[b]);
+		TEST(reopen_cnt == 10, backend_names[b]);
+	}
+
+	note("Benchmarking wakeups");
+	/* Two descriptors per object, plus some spare */
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+		rlim.rlim_cur = rlim.rlim_max;
+		(void) setrlimit(RLIMIT_NOFILE, &rlim);
+		(void) getrlimit(RLIMIT_NOFILE, &rlim);
+		while ((max_objs > 16) &&
+		       (((max_objs * 2) + 64) > rlim.rlim_cur))
+			max_objs /= 2;
+	}
+	{
+		int obj_cnt, last_cnt = 0;
+		double usec[2];
+		double ratio = 0.0;
+
+		for (obj_cnt = 16; obj_cnt <= max_objs; obj_cnt *= 4) {
+			for (b = 0; b < 2; b++)
+				usec[b] = _ring(backends[b], obj_cnt,
+						BENCH_HOPS);
+			printf("NOTE: %5d objects: poll %8.2f usec/wakeup, "
+			       "epoll %8.2f usec/wakeup\n",
+			       obj_cnt, usec[0], usec[1]);
+			TEST((usec[0] >= 0.0) && (usec[1] >= 0.0),
+			     "benchmark ring");
+			if (usec[1] > 0.0)
+				ratio = usec[0] / usec[1];
+			last_cnt = obj_cnt;
+		}
+		printf("NOTE: poll/epoll wakeup cost at %d objects: %.1f\n",
+		       last_cnt, ratio);
+	}
+
+	totals();
+	return failed;
+}
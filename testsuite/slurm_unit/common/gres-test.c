@@ -0,0 +1,192 @@
+/* Test of src/common/gres.c node-level GRES availability
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <src/common/gres.h>
+#include <src/common/list.h>
+#include <src/common/pack.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define NODE_CPUS	8
+#define TEST_ITER	2000
+
+/* Files are found relative to the slurm.conf path */
+static char *conf_file = "gres-test.conf";
+static char *gres_file = "gres.conf";
+static char *gpu_types[] = { "k80", "p100" };
+static char *gpu_cpus[] = { "0-3", "4-7", "0-7" };
+
+/* Write a random gres.conf of typed GPUs bound to CPUs and untyped NICs,
+ * RET the node's Gres value in slurm.conf */
+static char *_random_gres_conf(void)
+{
+	FILE *fp = fopen(gres_file, "w");
+	char *orig_config = NULL;
+	int i, count, gpu_cnt = 0, nic_cnt = random() % 4;
+
+	for (i = (random() % 4) + 1; i > 0; i--) {
+		count = (random() % 3) + 1;
+		gpu_cnt += count;
+		fprintf(fp, "Name=gpu Type=%s Count=%d CPUs=%s\n",
+			gpu_types[random() % 2], count,
+			gpu_cpus[random() % 3]);
+	}
+	if (nic_cnt)
+		fprintf(fp, "Name=nic Count=%d\n", nic_cnt);
+	fclose(fp);
+
+	xstrfmtcat(orig_config, "gpu:%d,nic:%d", gpu_cnt, nic_cnt);
+	return orig_config;
+}
+
+/* Build a node's gres list as slurmctld would when the node registers */
+static List _random_node(void)
+{
+	Buf buffer = init_buf(1024);
+	List node_gres_list = NULL;
+	char *orig_config, *new_config = NULL, *reason = NULL;
+
+	orig_config = _random_gres_conf();
+	if (gres_plugin_node_config_load(NODE_CPUS, "n1", NULL) !=
+	    SLURM_SUCCESS)
+		fail("gres_plugin_node_config_load");
+	gres_plugin_node_config_pack(buffer);
+	set_buf_offset(buffer, 0);
+	if (gres_plugin_node_config_unpack(buffer, "n1") != SLURM_SUCCESS)
+		fail("gres_plugin_node_config_unpack");
+	free_buf(buffer);
+
+	if (gres_plugin_node_config_validate("n1", orig_config, &new_config,
+					     &node_gres_list, 0, &reason) !=
+	    SLURM_SUCCESS)
+		fail("gres_plugin_node_config_validate");
+	xfree(orig_config);
+	xfree(new_config);
+	xfree(reason);
+
+	return node_gres_list;
+}
+
+/* RET a random job gres request of at most max_cnt GPUs */
+static char *_random_job(int max_cnt)
+{
+	char *req = NULL;
+
+	switch (random() % 4) {
+	case 0:
+		xstrfmtcat(req, "gpu:%ld", (random() % max_cnt) + 1);
+		break;
+	case 1:
+		xstrfmtcat(req, "gpu:%s:%ld", gpu_types[random() % 2],
+			   (random() % max_cnt) + 1);
+		break;
+	case 2:
+		xstrfmtcat(req, "nic:%ld", (random() % 4) + 1);
+		break;
+	default:
+		xstrfmtcat(req, "gpu:%s:%ld,nic:%ld", gpu_types[random() % 2],
+			   (random() % max_cnt) + 1, (random() % 4) + 1);
+		break;
+	}
+
+	return req;
+}
+
+/* Allocate some of a node's gres to other jobs which fit, using small
+ * requests so that topology records are left partly allocated */
+static void _random_alloc(List node_gres_list)
+{
+	List job_gres_list;
+	char *req;
+	int i;
+
+	for (i = random() % 6; i > 0; i--) {
+		req = _random_job(2);
+		job_gres_list = NULL;
+		gres_plugin_job_state_validate(req, &job_gres_list);
+		if (gres_plugin_job_test(job_gres_list, node_gres_list, false,
+					 NULL, 0, 0, i, "n1")) {
+			gres_plugin_job_alloc(job_gres_list, node_gres_list,
+					      1, 0, NODE_CPUS, i, "n1", NULL);
+		}
+		xfree(req);
+		FREE_NULL_LIST(job_gres_list);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	FILE *fp;
+	List job_gres_list, node_gres_list;
+	char *req;
+	int i, bad = 0, avail_cnt = 0;
+	bool use_total, avail, tested;
+
+	if (!(fp = fopen(conf_file, "w")))
+		fail("fopen");
+	fprintf(fp, "ClusterName=test\nControlMachine=localhost\n"
+		"GresTypes=gpu,nic\nPluginDir=.\n");
+	fclose(fp);
+	setenv("SLURM_CONF", conf_file, 1);
+
+	note("Comparing gres_plugin_job_node_avail() with "
+	     "gres_plugin_job_test()");
+	srandom(1);
+	for (i = 0; i < TEST_ITER; i++) {
+		node_gres_list = _random_node();
+		_random_alloc(node_gres_list);
+		req = _random_job(6);
+		job_gres_list = NULL;
+		if (gres_plugin_job_state_validate(req, &job_gres_list) !=
+		    SLURM_SUCCESS)
+			fail("gres_plugin_job_state_validate");
+		use_total = random() % 2;
+
+		avail = gres_plugin_job_node_avail(job_gres_list,
+						   node_gres_list, use_total);
+		tested = (gres_plugin_job_test(job_gres_list, node_gres_list,
+					       use_total, NULL, 0, 0, 0,
+					       "n1") != 0);
+		if (avail != tested) {
+			printf("NOTE: job %s use_total %d: node_avail %d "
+			       "job_test %d\n", req, use_total, avail, tested);
+			gres_plugin_node_state_log(node_gres_list, "n1");
+			bad++;
+		}
+		if (avail)
+			avail_cnt++;
+
+		xfree(req);
+		FREE_NULL_LIST(job_gres_list);
+		FREE_NULL_LIST(node_gres_list);
+	}
+	printf("NOTE: %d of %d requests available\n", avail_cnt, TEST_ITER);
+	TEST(bad == 0, "node_avail matches job_test");
+	TEST((avail_cnt > 0) && (avail_cnt < TEST_ITER),
+	     "both outcomes tested");
+
+	job_gres_list = NULL;
+	gres_plugin_job_state_validate("gpu:1", &job_gres_list);
+	TEST(!gres_plugin_job_node_avail(job_gres_list, NULL, false),
+	     "node without gres");
+	TEST(gres_plugin_job_node_avail(NULL, NULL, false),
+	     "job without gres");
+	FREE_NULL_LIST(job_gres_list);
+
+	gres_plugin_fini();
+	unlink(gres_file);
+	unlink(conf_file);
+	totals();
+	return failed;
+}
@@ -0,0 +1,156 @@
+/* Test and microbenchmark of src/common/id_hash.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <src/common/id_hash.h>
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Largest table for the benchmark, matching a very large MaxJobCount. Tables
+ * of 1000000 records and more are only built when SLURM_UNIT_BENCH is set
+ * in the environment. */
+#define BENCH_MAX_RECS	5000000
+#define BENCH_LOOKUPS	2000000
+
+/* Items are only compared, never dereferenced */
+#define ITEM(_key) ((void *) (uintptr_t) ((_key) + 1))
+
+static long _usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return ((tv2->tv_sec - tv1->tv_sec) * 1000000) +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
+/* Time random lookups in a table of rec_cnt sequential job IDs, as
+ * assigned by slurmctld. Return the mean probe count. */
+static double _bench(uint32_t rec_cnt)
+{
+	id_hash_t *hash = id_hash_init(0);
+	struct timeval tv1, tv2;
+	uint32_t i, key, found = 0;
+	double probes;
+	long usec;
+
+	for (i = 0; i < rec_cnt; i++)
+		id_hash_add(hash, i + 1, ITEM(i + 1));
+
+	srandom(rec_cnt);
+	gettimeofday(&tv1, NULL);
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		key = (random() % rec_cnt) + 1;
+		if (id_hash_find(hash, key) == ITEM(key))
+			found++;
+	}
+	gettimeofday(&tv2, NULL);
+	usec = _usec(&tv1, &tv2);
+	probes = id_hash_probes(hash);
+
+	printf("NOTE: %8u records: %6.1f nsec/lookup, %.2f probes/lookup\n",
+	       rec_cnt, (usec * 1000.0) / BENCH_LOOKUPS, probes);
+	TEST(found == BENCH_LOOKUPS, "benchmark lookups found");
+	id_hash_free(hash);
+
+	return probes;
+}
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing add/find/remove");
+	{
+		id_hash_t *hash = id_hash_init(0);
+		uint64_t key;
+		int bad = 0;
+
+		TEST(id_hash_find(hash, 1) == NULL, "empty table");
+		TEST(id_hash_add(hash, 1, ITEM(1)) == NULL, "add new key");
+		TEST(id_hash_add(hash, 1, ITEM(2)) == ITEM(1),
+		     "add replaces key");
+		TEST(id_hash_find(hash, 1) == ITEM(2), "find replaced key");
+		TEST(id_hash_remove(hash, 1) == ITEM(2), "remove key");
+		TEST(id_hash_remove(hash, 1) == NULL, "remove missing key");
+		TEST(id_hash_count(hash) == 0, "count after remove");
+
+		/* Enough keys to grow the table several times */
+		for (key = 1; key <= 100000; key++)
+			id_hash_add(hash, key, ITEM(key));
+		TEST(id_hash_count(hash) == 100000, "count after grow");
+		for (key = 1; key <= 100000; key++) {
+			if (id_hash_find(hash, key) != ITEM(key))
+				bad++;
+		}
+		TEST(bad == 0, "find after grow");
+
+		/* Remove every third key, the rest must remain reachable */
+		for (key = 3; key <= 100000; key += 3)
+			id_hash_remove(hash, key);
+		for (key = 1; key <= 100000; key++) {
+			if ((key % 3) == 0) {
+				if (id_hash_find(hash, key))
+					bad++;
+			} else if (id_hash_find(hash, key) != ITEM(key))
+				bad++;
+		}
+		TEST(bad == 0, "find after remove");
+		TEST(id_hash_count(hash) == 66667, "count after remove");
+		id_hash_free(hash);
+	}
+
+	note("Testing composite keys");
+	{
+		id_hash_t *hash = id_hash_init(1000);
+		uint32_t job_id, task_id;
+		int bad = 0;
+
+		for (job_id = 1; job_id <= 10; job_id++) {
+			for (task_id = 0; task_id < 1000; task_id++) {
+				id_hash_add(hash, ID_HASH_KEY2(job_id, task_id),
+					    ITEM(job_id * 1000 + task_id));
+			}
+		}
+		for (job_id = 1; job_id <= 10; job_id++) {
+			for (task_id = 0; task_id < 1000; task_id++) {
+				if (id_hash_find(hash,
+						 ID_HASH_KEY2(job_id, task_id)) !=
+				    ITEM(job_id * 1000 + task_id))
+					bad++;
+			}
+		}
+		TEST(bad == 0, "find composite keys");
+		TEST(id_hash_find(hash, ID_HASH_KEY2(11, 0)) == NULL,
+		     "missing composite key");
+		TEST(id_hash_probes(hash) < 2.5, "composite key probes");
+		id_hash_free(hash);
+	}
+
+	note("Benchmarking lookups");
+	{
+		uint32_t rec_cnt[] = { 10000, 100000, 1000000,
+				       BENCH_MAX_RECS };
+		double probes, max_probes = 0.0;
+		int i, bench_cnt = 2;
+
+		if (getenv("SLURM_UNIT_BENCH"))
+			bench_cnt = sizeof(rec_cnt) / sizeof(uint32_t);
+		else
+			note("Set SLURM_UNIT_BENCH for larger tables");
+		for (i = 0; i < bench_cnt; i++) {
+			probes = _bench(rec_cnt[i]);
+			if (probes > max_probes)
+				max_probes = probes;
+		}
+		/* Flat lookup cost: the mean probe sequence length depends
+		 * only on the load factor, not the number of records */
+		TEST(max_probes < 2.5, "lookup probes independent of size");
+	}
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,477 @@
+/* Test of the jobcomp/elasticsearch plugin against a stub _bulk endpoint:
+ * partial item failures, restart from the journal and journal rewrites
+ * while jobs are being logged
+ */
+#include "src/plugins/jobcomp/elasticsearch/jobcomp_elasticsearch.c"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+/* dejagnu.h has a wait() of its own, which the plugin's headers declare */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define MAX_TEST_JOB	4000
+#define WAIT_USEC	(60 * 1000000)
+
+enum stub_mode {
+	STUB_OK,	/* index every job */
+	STUB_PARTIAL,	/* reject jobs with odd job IDs */
+	STUB_TRUNCATE,	/* as STUB_PARTIAL, response cut after 3 items */
+	STUB_DOWN	/* fail every request */
+};
+
+/* Files are found relative to the slurm.conf path */
+static char *conf_file = "jobcomp_elasticsearch-test.conf";
+static char *state_dir = "jobcomp_elasticsearch-test.state";
+
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+static enum stub_mode stub_mode = STUB_OK;
+static int stub_accepted[MAX_TEST_JOB + 1];
+static int stub_rejected = 0;
+
+/* The plugin is linked with slurmctld, which provides these */
+extern char *get_job_script(struct job_record *job_ptr)
+{
+	return NULL;
+}
+
+extern int fsync_and_close(int fd, char *file_type)
+{
+	int rc = fsync(fd);
+
+	if (close(fd))
+		rc = -1;
+	return rc;
+}
+
+/* Build the response to a _bulk request, recording the jobs accepted */
+static char *_stub_bulk(char *body, int *http_status)
+{
+	char *resp = NULL, *items = NULL, *jobid;
+	bool errors = false, truncated = false;
+	int item_cnt = 0;
+	uint32_t job_id;
+
+	slurm_mutex_lock(&stub_lock);
+	if (stub_mode == STUB_DOWN) {
+		slurm_mutex_unlock(&stub_lock);
+		*http_status = 503;
+		return xstrdup("{\"error\":\"unavailable\",\"status\":503}");
+	}
+	for (jobid = strstr(body, "\"jobid\":"); jobid;
+	     jobid = strstr(jobid, "\"jobid\":")) {
+		jobid += 8;
+		job_id = strtoul(jobid, NULL, 10);
+		if (item_cnt++)
+			xstrcat(items, ",");
+		if ((stub_mode == STUB_TRUNCATE) && (item_cnt > 3)) {
+			/* Cut the response in the middle of an item */
+			xstrcat(items, "{\"index\":{\"status\":20");
+			truncated = true;
+			break;
+		}
+		if ((stub_mode != STUB_OK) && (job_id % 2)) {
+			/* Errors have a status of their own, and the reason
+			 * quotes the document */
+			xstrfmtcat(items, "{\"index\":{\"_index\":\"slurm\","
+				   "\"error\":{\"type\":\"mapper_parsing_"
+				   "exception\",\"reason\":\"failed to parse "
+				   "[\\\"status\\\":200]}\",\"caused_by\":{"
+				   "\"status\":200,\"items\":[]}},"
+				   "\"status\":400}}");
+			errors = true;
+			stub_rejected++;
+			continue;
+		}
+		xstrfmtcat(items, "{\"index\":{\"_index\":\"slurm\","
+			   "\"_id\":\"%u\",\"_shards\":{\"total\":2,"
+			   "\"failed\":0,\"status\":500},\"status\":201}}",
+			   job_id);
+		if (job_id <= MAX_TEST_JOB)
+			stub_accepted[job_id]++;
+	}
+	slurm_mutex_unlock(&stub_lock);
+
+	xstrfmtcat(resp, "{\"took\":3,\"errors\":%s,\"items\":[%s",
+		   errors ? "true" : "false", items ? items : "");
+	if (!truncated)
+		xstrcat(resp, "]}");
+	xfree(items);
+	*http_status = 200;
+	return resp;
+}
+
+/* Serve HTTP/1.1 requests on one connection until it is closed */
+static void *_stub_conn(void *arg)
+{
+	int fd = (int) (intptr_t) arg, http_status;
+	char *buf = NULL, *hdr_end, *len_hdr, *body, *resp, *reply;
+	size_t len = 0, size = 0, hdr_len, content_len;
+	ssize_t amount;
+
+	while (1) {
+		while (!buf || !(hdr_end = strstr(buf, "\r\n\r\n"))) {
+			if ((size - len) < 4096) {
+				size += 65536;
+				buf = xrealloc(buf, size);
+			}
+			amount = read(fd, buf + len, size - len - 1);
+			if (amount <= 0)
+				goto fini;
+			len += amount;
+			buf[len] = '\0';
+		}
+		*hdr_end = '\0';
+		hdr_len = hdr_end - buf + 4;
+		content_len = 0;
+		if ((len_hdr = strstr(buf, "Content-Length:")))
+			content_len = strtoul(len_hdr + 15, NULL, 10);
+		if (strstr(buf, "Expect: 100-continue") &&
+		    ((len - hdr_len) < content_len) &&
+		    (write(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25) != 25))
+			goto fini;
+		if (size <= (hdr_len + content_len)) {
+			size = hdr_len + content_len + 1;
+			buf = xrealloc(buf, size);
+		}
+		while ((len - hdr_len) < content_len) {
+			amount = read(fd, buf + len, size - len - 1);
+			if (amount <= 0)
+				goto fini;
+			len += amount;
+		}
+
+		if (!strncmp(buf, "POST ", 5)) {
+			body = xstrndup(buf + hdr_len, content_len);
+			resp = _stub_bulk(body, &http_status);
+			xfree(body);
+		} else {
+			resp = xstrdup("");
+			http_status = 200;
+		}
+		reply = xstrdup_printf("HTTP/1.1 %d Stub\r\nContent-Type: "
+				       "application/json\r\nContent-Length: "
+				       "%zu\r\n\r\n%s", http_status,
+				       strlen(resp),
+				       strncmp(buf, "HEAD ", 5) ? resp : "");
+		amount = write(fd, reply, strlen(reply));
+		xfree(reply);
+		xfree(resp);
+		if (amount < 0)
+			goto fini;
+
+		len -= hdr_len + content_len;
+		memmove(buf, buf + hdr_len + content_len, len);
+		buf[len] = '\0';
+	}
+
+fini:
+	xfree(buf);
+	close(fd);
+	return NULL;
+}
+
+static void *_stub_server(void *arg)
+{
+	int listen_fd = (int) (intptr_t) arg, fd;
+	pthread_t tid;
+
+	while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+		pthread_create(&tid, NULL, _stub_conn, (void *) (intptr_t) fd);
+		pthread_detach(tid);
+	}
+	return NULL;
+}
+
+/* Start the stub elasticsearch server, RET its URL */
+static char *_stub_start(void)
+{
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	int fd;
+	pthread_t tid;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) ||
+	    bind(fd, (struct sockaddr *) &addr, sizeof(addr)) ||
+	    listen(fd, 16) ||
+	    getsockname(fd, (struct sockaddr *) &addr, &addr_len)) {
+		fail("stub server socket");
+		exit(1);
+	}
+	pthread_create(&tid, NULL, _stub_server, (void *) (intptr_t) fd);
+	pthread_detach(tid);
+
+	return xstrdup_printf("http://127.0.0.1:%u", ntohs(addr.sin_port));
+}
+
+static void _stub_set_mode(enum stub_mode mode)
+{
+	slurm_mutex_lock(&stub_lock);
+	stub_mode = mode;
+	slurm_mutex_unlock(&stub_lock);
+}
+
+/* RET true if each job in [first, last] was accepted exactly once, and
+ * set *pending to the number not yet accepted */
+static bool _stub_accepted_once(uint32_t first, uint32_t last, int *pending)
+{
+	bool once = true;
+	uint32_t i;
+
+	*pending = 0;
+	slurm_mutex_lock(&stub_lock);
+	for (i = first; i <= last; i++) {
+		if (stub_accepted[i] == 0)
+			(*pending)++;
+		else if (stub_accepted[i] > 1)
+			once = false;
+	}
+	slurm_mutex_unlock(&stub_lock);
+	return once;
+}
+
+/* Wait for every job in [first, last] to be accepted
+ * RET true if each was accepted exactly once */
+static bool _wait_accepted(uint32_t first, uint32_t last)
+{
+	int pending, usec;
+	bool once;
+
+	for (usec = 0; usec < WAIT_USEC; usec += 100000) {
+		once = _stub_accepted_once(first, last, &pending);
+		if (!pending)
+			break;
+		usleep(100000);
+	}
+	/* Give any duplicate requests a chance to arrive */
+	usleep(1500000);
+	once = _stub_accepted_once(first, last, &pending);
+	if (pending)
+		printf("NOTE: %d of %u jobs not indexed\n", pending,
+		       last - first + 1);
+	return once && !pending;
+}
+
+/* Wait for the plugin to have at most cnt jobs pending */
+static void _wait_pending(int cnt)
+{
+	int usec;
+
+	for (usec = 0; usec < WAIT_USEC; usec += 100000) {
+		if (list_count(jobslist) <= cnt)
+			break;
+		usleep(100000);
+	}
+}
+
+static void _log_job(uint32_t job_id)
+{
+	struct job_record job;
+
+	memset(&job, 0, sizeof(job));
+	job.job_id = job_id;
+	job.user_id = getuid();
+	job.group_id = getgid();
+	job.job_state = JOB_COMPLETE | JOB_COMPLETING;
+	job.time_limit = INFINITE;
+	job.array_task_id = NO_VAL;
+	job.partition = "debug";
+	job.alloc_node = "n1";
+	job.nodes = "n[1-4]";
+	job.total_cpus = 4;
+	job.total_nodes = 4;
+	job.end_time = time(NULL);
+	job.start_time = job.end_time - 60;
+	if (slurm_jobcomp_log_record(&job) != SLURM_SUCCESS)
+		fail("slurm_jobcomp_log_record");
+}
+
+static void *_log_jobs(void *arg)
+{
+	uint32_t *range = (uint32_t *) arg, job_id;
+
+	for (job_id = range[0]; job_id <= range[1]; job_id++) {
+		_log_job(job_id);
+		if (!(job_id % 64))
+			usleep(1000);
+	}
+	return NULL;
+}
+
+/* Stop the indexing thread and forget the plugin's state without rewriting
+ * the journal, as if slurmctld died */
+static void _crash(void)
+{
+	slurm_mutex_lock(&pend_jobs_lock);
+	thread_shutdown = true;
+	slurm_cond_signal(&pend_jobs_cond);
+	slurm_mutex_unlock(&pend_jobs_lock);
+	pthread_join(job_handler_thread, NULL);
+
+	(void) close(journal_fd);
+	journal_fd = -1;
+	journal_size = 0;
+	journal_seq = 0;
+	journal_dead = 0;
+	list_destroy(jobslist);
+	jobslist = NULL;
+	pend_new_cnt = 0;
+	thread_shutdown = false;
+}
+
+/* Index jobs 1 to job_cnt with one _bulk request
+ * RET the number of jobs marked indexed, or -1 if the request failed */
+static int _bulk(int job_cnt, uint32_t *indexed_mask)
+{
+	struct job_node jnodes[32], *jobs[32];
+	struct curl_slist *headers = NULL;
+	CURL *curl_handle = curl_easy_init();
+	char *body = NULL;
+	int i, rc, cnt = 0;
+
+	headers = curl_slist_append(headers,
+				    "Content-Type: application/x-ndjson");
+	memset(jnodes, 0, sizeof(jnodes));
+	for (i = 0; i < job_cnt; i++) {
+		jnodes[i].serialized_job =
+			xstrdup_printf("{\"jobid\":%d,\"state\":\"status\"}",
+				       i + 1);
+		jobs[i] = &jnodes[i];
+		xstrfmtcat(body, "{\"index\":{}}\n%s\n",
+			   jnodes[i].serialized_job);
+	}
+	rc = _index_bulk(curl_handle, headers, jobs, job_cnt, body,
+			 strlen(body));
+	*indexed_mask = 0;
+	for (i = 0; i < job_cnt; i++) {
+		if (jnodes[i].indexed) {
+			*indexed_mask |= 1 << i;
+			cnt++;
+		}
+		xfree(jnodes[i].serialized_job);
+	}
+	xfree(body);
+	curl_slist_free_all(headers);
+	curl_easy_cleanup(curl_handle);
+	return (rc == SLURM_SUCCESS) ? cnt : -1;
+}
+
+/* Append the start of a record, as if slurmctld died while writing it */
+static void _journal_tear(void)
+{
+	char *file = _state_file_name(journal_file);
+	char torn[] = { 0, 0, 0, 100, 0, 1, 0, 0 };
+	int fd = open(file, O_WRONLY | O_APPEND);
+
+	if ((fd < 0) || (write(fd, torn, sizeof(torn)) != sizeof(torn)))
+		fail("append to journal");
+	if (fd >= 0)
+		close(fd);
+	xfree(file);
+}
+
+int
+main(int argc, char *argv[])
+{
+	FILE *fp;
+	char *url, *file;
+	uint32_t mask, range[2];
+	struct stat st;
+	pthread_t tid;
+	int compact_cnt = 0, compact_fail = 0;
+
+	if (!(fp = fopen(conf_file, "w")))
+		fail("fopen");
+	fprintf(fp, "ClusterName=test\nControlMachine=localhost\n"
+		"StateSaveLocation=%s\n", state_dir);
+	fclose(fp);
+	setenv("SLURM_CONF", conf_file, 1);
+	(void) mkdir(state_dir, 0700);
+	file = _state_file_name(journal_file);
+	(void) unlink(file);
+	xfree(file);
+
+	url = _stub_start();
+	curl_global_init(CURL_GLOBAL_ALL);
+	TEST(slurm_jobcomp_set_location(url) == SLURM_SUCCESS,
+	     "slurm_jobcomp_set_location");
+	xfree(url);
+
+	note("Testing _bulk responses");
+	_stub_set_mode(STUB_OK);
+	TEST((_bulk(8, &mask) == 8) && (mask == 0xff), "all jobs indexed");
+	_stub_set_mode(STUB_PARTIAL);
+	TEST((_bulk(8, &mask) == 4) && (mask == 0xaa),
+	     "partial failure indexes only accepted jobs");
+	_stub_set_mode(STUB_TRUNCATE);
+	TEST((_bulk(8, &mask) == 1) && (mask == 0x02),
+	     "truncated response indexes only complete items");
+	_stub_set_mode(STUB_DOWN);
+	TEST((_bulk(8, &mask) == -1) && (mask == 0), "failed request");
+
+	note("Testing partial failures and restart from the journal");
+	memset(stub_accepted, 0, sizeof(stub_accepted));
+	_stub_set_mode(STUB_PARTIAL);
+	init();
+	range[0] = 101;
+	range[1] = 300;
+	_log_jobs(range);
+	_wait_pending(100);
+	TEST(list_count(jobslist) == 100, "rejected jobs pending");
+	_crash();
+	_journal_tear();
+	_stub_set_mode(STUB_OK);
+	init();
+	TEST(_wait_accepted(101, 300),
+	     "each job indexed once after restart");
+	_wait_pending(0);
+
+	note("Testing journal rewrites while jobs are logged");
+	_stub_set_mode(STUB_DOWN);
+	range[0] = 1001;
+	range[1] = 3000;
+	pthread_create(&tid, NULL, _log_jobs, range);
+	while (list_count(jobslist) < 2000) {
+		if (_journal_compact() == SLURM_SUCCESS)
+			compact_cnt++;
+		else
+			compact_fail++;
+	}
+	pthread_join(tid, NULL);
+	printf("NOTE: %d journal rewrites, %d failed\n", compact_cnt,
+	       compact_fail);
+	TEST((compact_cnt > 1) && !compact_fail,
+	     "journal rewritten while logging");
+	_crash();
+	_stub_set_mode(STUB_OK);
+	init();
+	TEST(_wait_accepted(1001, 3000),
+	     "each job indexed once after rewrites and restart");
+	_wait_pending(0);
+
+	fini();
+	file = _state_file_name(journal_file);
+	TEST(!stat(file, &st) && (st.st_size == 0),
+	     "empty journal once all jobs are indexed");
+	(void) unlink(file);
+	xfree(file);
+	(void) rmdir(state_dir);
+	unlink(conf_file);
+	totals();
+	return failed;
+}
@@ -1,14 +1,125 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <slurm/slurm_errno.h>
 #include "src/common/log.h"
 
+#define ASYNC_THREADS	8
+#define ASYNC_MSGS	2000
+
 int bad_func()
 {
 	slurm_seterrno_ret(EINVAL);
 }
+
+static void *_async_thread(void *arg)
+{
+	int i, id = *(int *) arg;
+
+	for (i = 0; i < ASYNC_MSGS; i++)
+		info("async thread %d message %d", id, i);
+	return NULL;
+}
+
+static void *_sigwait_thread(void *arg)
+{
+	sigset_t set;
+	int *sig = (int *) arg;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	if (sigwait(&set, sig))
+		*sig = 0;
+	return NULL;
+}
+
+/* As daemons do, block a signal once logging is set up and handle it in a
+ * sigwait() thread. Sent to the process, it must reach that thread rather
+ * than kill the process through the log writer thread. */
+static int _test_async_signal(void)
+{
+	pthread_t tid;
+	sigset_t set;
+	int sig = 0;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	pthread_create(&tid, NULL, _sigwait_thread, &sig);
+	usleep(100000);
+	kill(getpid(), SIGUSR1);
+	pthread_join(tid, NULL);
+	pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+	if (sig != SIGUSR1) {
+		fprintf(stderr, "FAIL: sigwait returned signal %d\n", sig);
+		return 1;
+	}
+	return 0;
+}
+
+/* Log from several threads with asynchronous logging. Each thread's
+ * messages must be in the log file, in order, unless counted as dropped */
+static int _test_async(void)
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	pthread_t tids[ASYNC_THREADS];
+	int ids[ASYNC_THREADS], next[ASYNC_THREADS];
+	char path[] = "/tmp/log-test.XXXXXX", line[256];
+	int i, id, msg, fd, cnt = 0, rc = 0;
+	FILE *fp;
+
+	if ((fd = mkstemp(path)) < 0)
+		return 1;
+	close(fd);
+
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_opts.syslog_level = LOG_LEVEL_QUIET;
+	log_opts.async = 1;
+	/* log_alter() would read slurm.conf for the debug flags */
+	log_init("log-test", log_opts, 0, path);
+	rc = _test_async_signal();
+
+	for (i = 0; i < ASYNC_THREADS; i++) {
+		ids[i] = i;
+		next[i] = 0;
+		pthread_create(&tids[i], NULL, _async_thread, &ids[i]);
+	}
+	for (i = 0; i < ASYNC_THREADS; i++)
+		pthread_join(tids[i], NULL);
+	error("async test done");
+	log_flush();
+
+	if (!(fp = fopen(path, "r")))
+		return 1;
+	while (fgets(line, sizeof(line), fp)) {
+		char *p = strstr(line, "async thread ");
+		if (!p || (sscanf(p, "async thread %d message %d",
+				  &id, &msg) != 2))
+			continue;
+		if ((id < 0) || (id >= ASYNC_THREADS) || (msg < next[id])) {
+			fprintf(stderr, "FAIL: out of order: %s", line);
+			rc = 1;
+			continue;
+		}
+		next[id] = msg + 1;
+		cnt++;
+	}
+	fclose(fp);
+	unlink(path);
+
+	if (cnt + log_async_dropped() != ASYNC_THREADS * ASYNC_MSGS) {
+		fprintf(stderr, "FAIL: %d messages logged, %u dropped\n",
+			cnt, log_async_dropped());
+		rc = 1;
+	}
+	log_fini();
+	return rc;
+}
 int main(int ac, char **av)
 {
 	/* test elements */
@@ -62,7 +173,8 @@ int main(int ac, char **av)
 
 	if (bad_func() < 0)
 		error("bad_func: %m");
-	return 0;
+
+	return _test_async();
 }
 	
 